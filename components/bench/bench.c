@@ -0,0 +1,266 @@
+/**
+ * @file bench.c
+ * @brief 热路径微基准实现
+ */
+
+#include "bench.h"
+
+#if CONFIG_BENCH_ENABLE
+
+#include "diag_cmd.h"
+#include "msg_queue.h"
+#include "key_task.h"
+#include "bt_spp.h"
+#include "ha_mqtt.h"
+#include "heap_monitor.h"
+#include "board.h"
+#include "dlog.h"
+#include "app_pm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_idf_version.h"
+#include "esp_app_desc.h"
+
+static const char *TAG = "bench";
+
+/* 日志用例使用独立 TAG，过滤级别只影响该 TAG */
+#define BENCH_LOG_TAG       "bench_log"
+#define BENCH_SAMPLES       CONFIG_BENCH_SAMPLES
+#define BENCH_JSON_SIZE     768
+
+typedef struct {
+    const char *name;
+    esp_err_t (*setup)(void);       /* 可为 NULL，返回 ESP_ERR_NOT_SUPPORTED 时跳过 */
+    void (*run)(uint32_t i);        /* 被测操作，i 为样本序号 */
+    void (*teardown)(void);         /* 可为 NULL */
+} bench_case_t;
+
+static uint32_t s_samples[BENCH_SAMPLES];
+static QueueHandle_t s_queue = NULL;
+static key_fsm_t s_fsm;
+static bt_cmd_buffer_t s_cmd;
+static char s_json[BENCH_JSON_SIZE];
+static volatile uint32_t s_sink;    /* 保存结果，防止被测代码被优化掉 */
+
+static esp_err_t queue_setup(void)
+{
+    s_queue = xQueueCreate(1, sizeof(msg_t));
+    return s_queue != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static void queue_run(uint32_t i)
+{
+    msg_t msg = {
+        .type = MSG_TYPE_KEY,
+        .data.key = { .gpio_num = KEY_GPIO, .event = KEY_EVENT_SINGLE_CLICK },
+    };
+
+    msg_queue_send(s_queue, &msg, 0);
+    msg_queue_receive(s_queue, &msg, 0);
+}
+
+static void queue_teardown(void)
+{
+    vQueueDelete(s_queue);
+    s_queue = NULL;
+}
+
+static esp_err_t key_fsm_setup(void)
+{
+    key_fsm_init(&s_fsm, 1);
+    return ESP_OK;
+}
+
+/* 交替按下/释放，走遍空闲、按下、等待第二次、双击按下各状态 */
+static void key_fsm_run(uint32_t i)
+{
+    key_event_t event;
+    uint32_t timers;
+
+    s_sink = key_fsm_step(&s_fsm, KEY_FSM_IN_SAMPLE, (uint8_t)(i & 1), &event, &timers);
+}
+
+static esp_err_t ble_parse_setup(void)
+{
+    bt_cmd_reset(&s_cmd);
+    return ESP_OK;
+}
+
+static void ble_parse_run(uint32_t i)
+{
+    static const char cmd[] = BT_CMD_OPEN_DOOR "\n";
+    bt_cmd_t result = BT_CMD_NONE;
+
+    for (size_t k = 0; k < sizeof(cmd) - 1; k++) {
+        result = bt_cmd_feed(&s_cmd, cmd[k]);
+    }
+    if (result == BT_CMD_OPEN) {
+        bt_cmd_reset(&s_cmd);
+    }
+    s_sink = result;
+}
+
+static void discovery_run(uint32_t i)
+{
+    s_sink = ha_mqtt_build_discovery(s_json, sizeof(s_json));
+}
+
+static esp_err_t heap_json_setup(void)
+{
+    return heap_monitor_to_json(s_json, sizeof(s_json)) > 0 ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+}
+
+static void heap_json_run(uint32_t i)
+{
+    s_sink = heap_monitor_to_json(s_json, sizeof(s_json));
+}
+
+static void servo_duty_run(uint32_t i)
+{
+    s_sink = servo_angle_to_duty((uint8_t)(i % (SERVO_MAX_ANGLE + 1)));
+}
+
+static void log_dlog_run(uint32_t i)
+{
+    DLOGI(BENCH_LOG_TAG, "bench %lu", (unsigned long)i);
+}
+
+static esp_err_t log_filtered_setup(void)
+{
+    esp_log_level_set(BENCH_LOG_TAG, ESP_LOG_WARN);
+    return ESP_OK;
+}
+
+static void log_esp_run(uint32_t i)
+{
+    ESP_LOGI(BENCH_LOG_TAG, "bench %lu", (unsigned long)i);
+}
+
+static void log_filtered_teardown(void)
+{
+    esp_log_level_set(BENCH_LOG_TAG, ESP_LOG_INFO);
+}
+
+static const bench_case_t s_cases[] = {
+    { "queue_rt",       queue_setup,        queue_run,      queue_teardown },
+    { "key_fsm",        key_fsm_setup,      key_fsm_run,    NULL },
+    { "ble_parse",      ble_parse_setup,    ble_parse_run,  NULL },
+    { "json_discovery", NULL,               discovery_run,  NULL },
+    { "json_heap",      heap_json_setup,    heap_json_run,  NULL },
+    { "servo_duty",     NULL,               servo_duty_run, NULL },
+    { "log_dlog",       NULL,               log_dlog_run,   NULL },
+    { "log_filtered",   log_filtered_setup, log_esp_run,    log_filtered_teardown },
+    { "log_esp",        NULL,               log_esp_run,    NULL },
+};
+
+#define BENCH_CASE_COUNT (sizeof(s_cases) / sizeof(s_cases[0]))
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief 空测量 (两次读计数器之间无操作) 的最小周期数，从每个样本中扣除
+ */
+static uint32_t measure_overhead(void)
+{
+    uint32_t min = UINT32_MAX;
+
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = esp_cpu_get_cycle_count();
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        if (cycles < min) {
+            min = cycles;
+        }
+    }
+    return min;
+}
+
+static void run_case(const bench_case_t *c, uint32_t overhead, const diag_out_t *out)
+{
+    if (c->setup != NULL) {
+        esp_err_t ret = c->setup();
+        if (ret != ESP_OK) {
+            diag_printf(out, "# %s skipped: %s\r\n", c->name, esp_err_to_name(ret));
+            return;
+        }
+    }
+
+    /* 第一次调用预热指令缓存，不计入 */
+    c->run(0);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = esp_cpu_get_cycle_count();
+        c->run(i + 1);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        s_samples[i] = cycles > overhead ? cycles - overhead : 0;
+    }
+
+    if (c->teardown != NULL) {
+        c->teardown();
+    }
+
+    qsort(s_samples, BENCH_SAMPLES, sizeof(s_samples[0]), cmp_u32);
+    diag_printf(out, "%-16s %8lu %8lu %8lu\r\n", c->name, (unsigned long)s_samples[0],
+                (unsigned long)s_samples[BENCH_SAMPLES / 2],
+                (unsigned long)s_samples[BENCH_SAMPLES - 1]);
+}
+
+/**
+ * @brief BENCH 命令: 运行全部用例，或 "BENCH <名称>" 只运行一个
+ */
+static esp_err_t cmd_bench(int argc, char **argv, const diag_out_t *out)
+{
+    const char *only = argc >= 2 ? argv[1] : NULL;
+    bool found = false;
+
+    for (size_t i = 0; i < BENCH_CASE_COUNT && only != NULL; i++) {
+        found |= strcasecmp(only, s_cases[i].name) == 0;
+    }
+    if (only != NULL && !found) {
+        diag_printf(out, "unknown case %s\r\n", only);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_pm_acquire(APP_PM_LOCK_CMD);
+    uint32_t overhead = measure_overhead();
+
+    diag_printf(out, "# app %s, idf %s, cpu %d MHz, %d samples, overhead %lu cycles\r\n",
+                esp_app_get_description()->version, esp_get_idf_version(),
+                CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, BENCH_SAMPLES, (unsigned long)overhead);
+    diag_printf(out, "# %-14s %8s %8s %8s\r\n", "case", "min", "median", "max");
+    for (size_t i = 0; i < BENCH_CASE_COUNT; i++) {
+        if (only == NULL || strcasecmp(only, s_cases[i].name) == 0) {
+            run_case(&s_cases[i], overhead, out);
+        }
+    }
+
+    app_pm_release(APP_PM_LOCK_CMD);
+    ESP_LOGI(TAG, "Benchmark done");
+    return ESP_OK;
+}
+
+esp_err_t bench_init(void)
+{
+    return diag_cmd_register("BENCH", "hot path cycle counts (min/median/max), BENCH <case> runs one",
+                             cmd_bench, DIAG_ACCESS_REMOTE);
+}
+
+#else /* !CONFIG_BENCH_ENABLE */
+
+esp_err_t bench_init(void)
+{
+    return ESP_OK;
+}
+
+#endif /* CONFIG_BENCH_ENABLE */
@@ -0,0 +1,41 @@
+/**
+ * @file bench.h
+ * @brief 热路径微基准 - 用 CPU 周期计数器测量关键原语的单次开销
+ *
+ * 每个用例执行 CONFIG_BENCH_SAMPLES 次，每次单独用 esp_cpu_get_cycle_count 计时，
+ * 减去空测量的开销后取 min / median / max (周期)。运行期间持有 CPU 最高频率锁。
+ *   queue_rt        msg_queue_send + msg_queue_receive 往返 (同一任务，不切换上下文)
+ *   key_fsm         手势识别器处理一次消抖采样
+ *   ble_parse       BLE 指令缓冲区识别一行 "OPEN\n"
+ *   json_discovery  Home Assistant 自动发现 JSON 编码
+ *   json_heap       堆监控遥测 JSON 编码 (未开启堆监控时跳过)
+ *   servo_duty      舵机角度换算 LEDC 占空比
+ *   log_dlog        延迟日志 DLOGI
+ *   log_filtered    被级别过滤掉的 ESP_LOGI
+ *   log_esp         同步输出的 ESP_LOGI
+ *
+ * 输出每个用例一行 "<名称> <min> <median> <max>"，'#' 开头为固件版本等说明，
+ * 不同版本的输出可直接 diff，或用 tools/bench_diff.py 按中位数比较。
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 注册诊断命令 "BENCH [名称]"
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t bench_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_H */
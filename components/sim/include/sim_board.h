@@ -0,0 +1,51 @@
+/**
+ * @file sim_board.h
+ * @brief 主机仿真虚拟板级 - GPIO 与 LEDC
+ *
+ * 实现 board.c、key_task.c、led_task.c 用到的 driver/gpio.h、driver/ledc.h 子集:
+ *   - 输出电平和 LEDC 占空比写入记录文件 (sim_record)；
+ *   - 输入电平由脚本设置，电平中断按真实硬件语义触发: 中断使能且电平匹配时
+ *     持续触发，直到处理函数关闭中断。处理函数在最高优先级的仿真中断任务中执行，
+ *     抢占所有应用任务，*FromISR 接口按中断上下文使用。
+ */
+
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_GPIO_COUNT      32
+#define SIM_LEDC_CHANNELS   8
+
+/**
+ * @brief 创建仿真中断任务
+ *
+ * @return ESP_OK成功, ESP_ERR_NO_MEM失败
+ */
+esp_err_t sim_board_init(void);
+
+/**
+ * @brief 设置输入引脚电平 (脚本注入)，满足中断条件时触发处理函数
+ */
+void sim_gpio_set_input(int gpio_num, int level);
+
+/**
+ * @brief 读取引脚当前电平 (输出为最近写入值)
+ */
+int sim_gpio_level(int gpio_num);
+
+/**
+ * @brief LEDC 通道当前输出的脉宽 (us)，未配置返回 0
+ */
+uint32_t sim_ledc_pulse_us(int channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_BOARD_H */
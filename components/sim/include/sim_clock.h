@@ -0,0 +1,56 @@
+/**
+ * @file sim_clock.h
+ * @brief 主机仿真虚拟时钟 - FreeRTOS tick 即虚拟时间，空闲时快进
+ *
+ * linux 目标上应用代码对 esp_timer 的调用在链接时被 --wrap 到本模块:
+ *   - esp_timer_get_time() 返回 tick 计数换算的微秒，与 vTaskDelay/队列超时同一时基；
+ *   - esp_timer 定时器由仿真定时器任务按虚拟时间派发。
+ *
+ * 快进: 开启后一个与 idle 同优先级的任务在所有应用任务阻塞时调用 xTaskCatchUpTicks，
+ * 直接跳到最近的虚拟定时器截止时间 (包括脚本事件)，单步不超过
+ * CONFIG_SIM_WARP_MAX_STEP_MS。只用 vTaskDelay 等 tick 超时等待的任务 (例如舵机步进)
+ * 对时钟不可见，最多晚醒 max_step - 1 个 tick；步长取舵机步进周期时步进节拍仍然准确。
+ * 不开启快进时 tick 由主机定时器驱动，虚拟时间约等于墙上时间 (连接真实 broker 时使用)。
+ */
+
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 创建仿真定时器任务，需在任何 esp_timer 调用之前执行
+ *
+ * @return ESP_OK成功, ESP_ERR_NO_MEM失败
+ */
+esp_err_t sim_clock_init(void);
+
+/**
+ * @brief 开启快进
+ *
+ * @param max_step_ms 单步上限 (ms)，0 使用 CONFIG_SIM_WARP_MAX_STEP_MS
+ * @return ESP_OK成功, ESP_ERR_NO_MEM失败
+ */
+esp_err_t sim_clock_warp(uint32_t max_step_ms);
+
+/**
+ * @brief 当前虚拟时间 (us)
+ */
+int64_t sim_clock_now_us(void);
+
+/**
+ * @brief 最近一个虚拟定时器的截止时间 (us)，无挂起定时器时返回 INT64_MAX
+ */
+int64_t sim_clock_next_deadline_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_CLOCK_H */
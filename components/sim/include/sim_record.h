@@ -0,0 +1,53 @@
+/**
+ * @file sim_record.h
+ * @brief 主机仿真记录 - 按虚拟时间记录输入、输出与检查结果
+ *
+ * CSV 每行一条: t_us,kind,id,value
+ *   in      id=GPIO  value=电平         脚本注入的输入
+ *   gpio    id=GPIO  value=电平         输出电平变化
+ *   pwm     id=通道  value=脉宽(us)     LEDC 占空比更新
+ *   cmd     id=0     value=命令         脚本注入的 MQTT 门命令
+ *   check   id=行号  value=1通过/0失败
+ *   mark    id=行号  value=0            脚本标记
+ *   fault   id=故障  value=次数         脚本布防故障 (0 为撤防)
+ * 以 '#' 开头的行为元数据 (舵机脉宽范围、各类故障的恢复时间等)，由 tools/sim_report.py 解析。
+ */
+
+#ifndef SIM_RECORD_H
+#define SIM_RECORD_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 打开记录文件并写入元数据
+ *
+ * @param path 文件路径
+ * @return ESP_OK成功, ESP_FAIL无法创建文件
+ */
+esp_err_t sim_record_open(const char *path);
+
+/**
+ * @brief 追加一条记录 (未打开时忽略)
+ */
+void sim_record(const char *kind, int id, int32_t value);
+
+/**
+ * @brief 写入一行元数据
+ */
+void sim_record_meta(const char *key, const char *value);
+
+/**
+ * @brief 刷新并关闭记录文件
+ */
+void sim_record_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_RECORD_H */
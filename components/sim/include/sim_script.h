@@ -0,0 +1,45 @@
+/**
+ * @file sim_script.h
+ * @brief 主机仿真脚本 - 按虚拟时间注入按键/MQTT 命令并检查输出
+ *
+ * 每行: <延时ms> <动作> [参数]，延时相对上一条动作，'#' 之后为注释。
+ *   press / release            按键按下 (低电平) / 释放
+ *   click [hold_ms]            单击，默认按住 100 ms
+ *   double                     双击 (按 80 ms，间隔 120 ms，再按 80 ms)
+ *   long [hold_ms]             长按，默认 1500 ms
+ *   mqtt on|off                注入 MQTT 门命令 (不经过 broker)
+ *   expect servo <角度>        检查舵机当前角度 (±1°)
+ *   expect gpio <n> <电平>     检查输出引脚电平
+ *   fault <类别> <次数> [概率‰] 布防故障 (queue/wifi/mqtt/ble/servo，见 fault_inject.h)
+ *   fault <类别> off           撤防
+ *   mark                       在记录中写入标记
+ * 块:
+ *   repeat <次数> <周期ms>     到 end 为止的动作重复执行，第 k 次从块起点 + k × 周期开始
+ *   end
+ *
+ * 脚本结束并等待 CONFIG_SIM_SETTLE_MS 后打印统计 (含各类故障的恢复时间) 并退出，
+ * 有检查失败时退出码为 1。
+ */
+
+#ifndef SIM_SCRIPT_H
+#define SIM_SCRIPT_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 解析脚本并启动脚本任务
+ *
+ * @param path 脚本文件
+ * @return ESP_OK成功, ESP_ERR_NOT_FOUND文件不存在, ESP_ERR_INVALID_ARG语法错误
+ */
+esp_err_t sim_script_start(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_SCRIPT_H */
@@ -0,0 +1,32 @@
+/**
+ * @file esp_cpu.h
+ * @brief 主机仿真: esp_cpu.h 子集 (单核，周期计数为主机单调时钟纳秒)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline int esp_cpu_get_core_id(void)
+{
+    return 0;
+}
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,318 @@
+/**
+ * @file sim_board.c
+ * @brief 主机仿真虚拟 GPIO/LEDC 实现
+ */
+
+#include "sim_board.h"
+#include "sim_record.h"
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+
+static const char *TAG = "sim_board";
+
+#define SIM_IRQ_TASK_PRIO       (configMAX_PRIORITIES - 1)
+#define SIM_IRQ_TASK_STACK      4096
+
+typedef struct {
+    gpio_mode_t mode;
+    uint8_t level;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    bool edge_pending;
+    gpio_isr_t isr;
+    void *isr_arg;
+} sim_pin_t;
+
+typedef struct {
+    uint32_t freq_hz;
+    uint8_t resolution;
+} sim_ledc_timer_t;
+
+typedef struct {
+    bool configured;
+    ledc_timer_t timer;
+    int gpio_num;
+    uint32_t duty;          /* ledc_set_duty 写入，update 后生效 */
+    uint32_t duty_active;
+} sim_ledc_chan_t;
+
+static sim_pin_t s_pins[SIM_GPIO_COUNT];
+static sim_ledc_timer_t s_timers[LEDC_TIMER_MAX];
+static sim_ledc_chan_t s_channels[SIM_LEDC_CHANNELS];
+static bool s_isr_service = false;
+static TaskHandle_t s_irq_task = NULL;
+
+static inline bool pin_valid(gpio_num_t gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < SIM_GPIO_COUNT;
+}
+
+static bool pin_irq_pending(const sim_pin_t *p)
+{
+    if (!p->intr_enabled || p->isr == NULL) {
+        return false;
+    }
+    return (p->intr_type == GPIO_INTR_LOW_LEVEL && p->level == 0) ||
+           (p->intr_type == GPIO_INTR_HIGH_LEVEL && p->level == 1);
+}
+
+/**
+ * @brief 仿真中断: 电平中断在使能期间持续触发，处理函数负责关闭中断；边沿中断按跳变锁存
+ */
+static void sim_irq_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (int i = 0; i < SIM_GPIO_COUNT; i++) {
+            sim_pin_t *p = &s_pins[i];
+            /* 处理函数未关闭中断时只派发一次，避免仿真中断任务饿死其他任务 */
+            bool edge = p->edge_pending;
+            p->edge_pending = false;
+            if ((edge && p->intr_enabled && p->isr != NULL) || pin_irq_pending(p)) {
+                p->isr(p->isr_arg);
+            }
+        }
+    }
+}
+
+static void irq_kick(void)
+{
+    if (s_irq_task != NULL) {
+        xTaskNotifyGive(s_irq_task);
+    }
+}
+
+esp_err_t sim_board_init(void)
+{
+    if (xTaskCreate(sim_irq_task, "sim_irq", SIM_IRQ_TASK_STACK, NULL,
+                    SIM_IRQ_TASK_PRIO, &s_irq_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create irq task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void sim_gpio_set_input(int gpio_num, int level)
+{
+    if (!pin_valid(gpio_num)) {
+        return;
+    }
+
+    sim_pin_t *p = &s_pins[gpio_num];
+    uint8_t old = p->level;
+
+    p->level = level ? 1 : 0;
+    sim_record("in", gpio_num, p->level);
+
+    if (old == p->level || !p->intr_enabled || p->isr == NULL) {
+        return;
+    }
+    if (p->intr_type == GPIO_INTR_ANYEDGE ||
+        (p->intr_type == GPIO_INTR_POSEDGE && p->level == 1) ||
+        (p->intr_type == GPIO_INTR_NEGEDGE && p->level == 0)) {
+        p->edge_pending = true;
+    }
+    if (p->edge_pending || pin_irq_pending(p)) {
+        irq_kick();
+    }
+}
+
+int sim_gpio_level(int gpio_num)
+{
+    return pin_valid(gpio_num) ? s_pins[gpio_num].level : 0;
+}
+
+uint32_t sim_ledc_pulse_us(int channel)
+{
+    if (channel < 0 || channel >= SIM_LEDC_CHANNELS || !s_channels[channel].configured) {
+        return 0;
+    }
+
+    const sim_ledc_chan_t *c = &s_channels[channel];
+    const sim_ledc_timer_t *t = &s_timers[c->timer];
+    if (t->freq_hz == 0) {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)c->duty_active * 1000000ULL / t->freq_hz) >> t->resolution);
+}
+
+/*
+ * driver/gpio.h
+ */
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    if (!pin_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].mode = GPIO_MODE_DISABLE;
+    s_pins[gpio_num].intr_type = GPIO_INTR_DISABLE;
+    s_pins[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    if (!pin_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!pin_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sim_pin_t *p = &s_pins[gpio_num];
+    uint8_t v = level ? 1 : 0;
+    if (p->mode == GPIO_MODE_OUTPUT || p->mode == GPIO_MODE_INPUT_OUTPUT) {
+        if (p->level != v) {
+            sim_record("gpio", gpio_num, v);
+        }
+        p->level = v;
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return sim_gpio_level(gpio_num);
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    return pin_valid(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (!pin_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].intr_type = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    if (!pin_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].intr_enabled = true;
+    /* 使能时电平已满足条件，硬件立即进入中断 */
+    if (pin_irq_pending(&s_pins[gpio_num])) {
+        irq_kick();
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    if (!pin_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    if (s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (!pin_valid(gpio_num) || !s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_pins[gpio_num].isr = isr_handler;
+    s_pins[gpio_num].isr_arg = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    if (!pin_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].isr = NULL;
+    s_pins[gpio_num].isr_arg = NULL;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    return pin_valid(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/*
+ * driver/ledc.h
+ */
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    if (timer_conf == NULL || timer_conf->timer_num >= LEDC_TIMER_MAX ||
+        timer_conf->freq_hz == 0 || timer_conf->duty_resolution >= LEDC_TIMER_BIT_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_timers[timer_conf->timer_num].freq_hz = timer_conf->freq_hz;
+    s_timers[timer_conf->timer_num].resolution = timer_conf->duty_resolution;
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+    if (ledc_conf == NULL || ledc_conf->channel >= SIM_LEDC_CHANNELS ||
+        ledc_conf->timer_sel >= LEDC_TIMER_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sim_ledc_chan_t *c = &s_channels[ledc_conf->channel];
+    c->configured = true;
+    c->timer = ledc_conf->timer_sel;
+    c->gpio_num = ledc_conf->gpio_num;
+    c->duty = ledc_conf->duty;
+    c->duty_active = ledc_conf->duty;
+    sim_record("pwm", ledc_conf->channel, (int32_t)sim_ledc_pulse_us(ledc_conf->channel));
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    if (channel >= SIM_LEDC_CHANNELS || !s_channels[channel].configured) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_channels[channel].duty = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (channel >= SIM_LEDC_CHANNELS || !s_channels[channel].configured) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sim_ledc_chan_t *c = &s_channels[channel];
+    if (c->duty_active != c->duty) {
+        c->duty_active = c->duty;
+        sim_record("pwm", channel, (int32_t)sim_ledc_pulse_us(channel));
+    }
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    return channel < SIM_LEDC_CHANNELS ? s_channels[channel].duty_active : 0;
+}
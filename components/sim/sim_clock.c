@@ -0,0 +1,244 @@
+/**
+ * @file sim_clock.c
+ * @brief 主机仿真虚拟时钟与 esp_timer 替身实现
+ */
+
+#include "sim_clock.h"
+
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sim_clock";
+
+#define SIM_TIMER_TASK_PRIO     (configMAX_PRIORITIES - 2)
+#define SIM_TIMER_TASK_STACK    4096
+#define SIM_WARP_TASK_STACK     2048
+#define SIM_TICK_US             ((int64_t)portTICK_PERIOD_MS * 1000)
+
+/* 替代 esp_timer 内部结构，仅本文件可见 */
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t alarm_us;           /* 0 表示未启动 */
+    uint64_t period_us;         /* 0 表示单次 */
+    struct esp_timer *next;
+};
+
+static struct esp_timer *s_armed = NULL;   /* 按 alarm_us 升序 */
+static SemaphoreHandle_t s_mutex = NULL;
+static TaskHandle_t s_timer_task = NULL;
+static TickType_t s_max_step = 0;
+
+int64_t sim_clock_now_us(void)
+{
+    return (int64_t)xTaskGetTickCount() * SIM_TICK_US;
+}
+
+int64_t sim_clock_next_deadline_us(void)
+{
+    int64_t next = INT64_MAX;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_armed != NULL) {
+        next = s_armed->alarm_us;
+    }
+    xSemaphoreGive(s_mutex);
+    return next;
+}
+
+static void armed_insert(struct esp_timer *t)
+{
+    struct esp_timer **pp = &s_armed;
+
+    while (*pp != NULL && (*pp)->alarm_us <= t->alarm_us) {
+        pp = &(*pp)->next;
+    }
+    t->next = *pp;
+    *pp = t;
+}
+
+static bool armed_remove(struct esp_timer *t)
+{
+    for (struct esp_timer **pp = &s_armed; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == t) {
+            *pp = t->next;
+            t->next = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 按虚拟时间派发到期定时器 (对应 ESP_TIMER_TASK 派发方式)
+ */
+static void sim_timer_task(void *arg)
+{
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        while (s_armed != NULL && s_armed->alarm_us <= sim_clock_now_us()) {
+            struct esp_timer *t = s_armed;
+
+            s_armed = t->next;
+            t->next = NULL;
+            if (t->period_us > 0) {
+                t->alarm_us += t->period_us;
+                armed_insert(t);
+            } else {
+                t->alarm_us = 0;
+            }
+            xSemaphoreGive(s_mutex);
+            t->callback(t->arg);
+            xSemaphoreTake(s_mutex, portMAX_DELAY);
+        }
+        if (s_armed != NULL) {
+            wait = (TickType_t)((s_armed->alarm_us - sim_clock_now_us() + SIM_TICK_US - 1) / SIM_TICK_US);
+        }
+        xSemaphoreGive(s_mutex);
+
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+/**
+ * @brief 快进任务: 与 idle 同优先级，只在应用任务全部阻塞时运行
+ */
+static void sim_warp_task(void *arg)
+{
+    while (1) {
+        TickType_t step = s_max_step;
+        int64_t next = sim_clock_next_deadline_us();
+
+        if (next != INT64_MAX) {
+            int64_t ticks = (next - sim_clock_now_us() + SIM_TICK_US - 1) / SIM_TICK_US;
+            if (ticks < (int64_t)step) {
+                step = ticks > 0 ? (TickType_t)ticks : 1;
+            }
+        }
+        /* 到期任务在补齐的 tick 中解除阻塞，优先级更高时立即抢占本任务 */
+        xTaskCatchUpTicks(step);
+    }
+}
+
+esp_err_t sim_clock_init(void)
+{
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == NULL ||
+        xTaskCreate(sim_timer_task, "sim_timer", SIM_TIMER_TASK_STACK, NULL,
+                    SIM_TIMER_TASK_PRIO, &s_timer_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create timer task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sim_clock_warp(uint32_t max_step_ms)
+{
+    s_max_step = pdMS_TO_TICKS(max_step_ms ? max_step_ms : CONFIG_SIM_WARP_MAX_STEP_MS);
+    if (s_max_step == 0) {
+        s_max_step = 1;
+    }
+
+    if (xTaskCreate(sim_warp_task, "sim_warp", SIM_WARP_TASK_STACK, NULL,
+                    tskIDLE_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create warp task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Time warp on, max step %lu ticks", (unsigned long)s_max_step);
+    return ESP_OK;
+}
+
+/*
+ * 以下为链接时 --wrap 的 esp_timer 接口 (见 components/sim/CMakeLists.txt)
+ */
+
+int64_t __wrap_esp_timer_get_time(void)
+{
+    return sim_clock_now_us();
+}
+
+esp_err_t __wrap_esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (t == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->callback = args->callback;
+    t->arg = args->arg;
+    t->name = args->name;
+    *out_handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    if (t == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (t->alarm_us != 0) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* alarm_us 为 0 表示未启动，虚拟时间 0 时刻到期的定时器推迟 1 us */
+    t->alarm_us = sim_clock_now_us() + (int64_t)timeout_us;
+    if (t->alarm_us == 0) {
+        t->alarm_us = 1;
+    }
+    t->period_us = period_us;
+    armed_insert(t);
+    bool earliest = (s_armed == t);
+    xSemaphoreGive(s_mutex);
+
+    if (earliest) {
+        xTaskNotifyGive(s_timer_task);
+    }
+    return ESP_OK;
+}
+
+esp_err_t __wrap_esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t __wrap_esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return timer_start(timer, period, period);
+}
+
+esp_err_t __wrap_esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool armed = armed_remove(timer);
+    timer->alarm_us = 0;
+    xSemaphoreGive(s_mutex);
+    return armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t __wrap_esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->alarm_us != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    free(timer);
+    return ESP_OK;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file sim_main.c
+ * @brief 主机仿真入口 - 在 linux 目标上运行门锁业务
+ *
+ * 启动与 main/main.c 的关键路径一致 (LED/按键/舵机/队列/业务任务)，
+ * Wi-Fi、BLE 等依赖射频的模块不参与仿真；局域网 HTTP API 走主机 TCP 栈，按需启动。
+ *
+ * linux 目标的 app_main 没有命令行参数，通过环境变量配置:
+ *   SIM_SCRIPT   输入脚本 (见 sim_script.h)，未设置时只运行不注入
+ *   SIM_OUT      记录文件，默认 sim_record.csv
+ *   SIM_WARP     非空时启用时间快进，值为最大步长 ms (0 取 Kconfig 默认)
+ *   SIM_BROKER   MQTT broker URI，设置后连接真实 broker (应关闭快进)
+ *   SIM_HTTP     非空时启动 HTTP API (端口见 sdkconfig.sim)，供 tools/http_bench.py 测试
+ *   SIM_SOAK     浸泡测试迭代次数 (见 soak.h)，结束时按结果退出 (通过 0 / 失败 1)；
+ *                百万次迭代的记录过大，此时只在显式设置 SIM_OUT 时记录
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "board.h"
+#include "msg_queue.h"
+#include "led_task.h"
+#include "key_task.h"
+#include "pwm_task.h"
+#include "ha_mqtt.h"
+#include "http_api.h"
+#include "app_rtos.h"
+#include "app_pm.h"
+#include "dlog.h"
+#include "trace.h"
+#include "journal.h"
+#include "state_shadow.h"
+#include "timer_wheel.h"
+#include "supervisor.h"
+#include "fault_inject.h"
+#include "soak.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_record.h"
+#include "sim_script.h"
+
+static const char *TAG = "sim";
+
+static void mqtt_door_callback(bool is_on)
+{
+    msg_send_mqtt_door_cmd(is_on ? MQTT_CMD_DOOR_ON : MQTT_CMD_DOOR_OFF);
+}
+
+/**
+ * @brief 按键事件回调，与 main/main.c 相同
+ */
+static void key_event_handler(uint8_t gpio_num, key_event_t event)
+{
+    TRACE(TRACE_SRC_KEY, TRACE_EVT_KEY, gpio_num, event, 0);
+
+    switch (event) {
+        case KEY_EVENT_SINGLE_CLICK:
+            msg_send_key_event(QUEUE_PWM, gpio_num, event);
+            break;
+        case KEY_EVENT_LONG_PRESS:
+            msg_send_key_event(QUEUE_LED, gpio_num, event);
+            break;
+        default:
+            break;
+    }
+}
+
+static void record_meta_int(const char *key, int value)
+{
+    char buf[16];
+
+    snprintf(buf, sizeof(buf), "%d", value);
+    sim_record_meta(key, buf);
+}
+
+static void soak_done(bool passed)
+{
+    soak_epoch_t e;
+    char buf[96];
+
+    if (soak_get_last_epoch(&e) == ESP_OK) {
+        snprintf(buf, sizeof(buf), "%s,%lu,%u,%u,%lu,%u", passed ? "passed" : "failed",
+                 (unsigned long)e.epoch, e.p50_ms, e.p99_ms, (unsigned long)e.heap_used, e.tasks);
+        sim_record_meta("soak", buf);
+    }
+    sim_record_close();
+    exit(passed ? 0 : 1);
+}
+
+static esp_err_t start_tasks(void)
+{
+    if (led_task_create() != pdPASS || pwm_task_create() != pdPASS) {
+        return ESP_FAIL;
+    }
+
+    key_task_config_t key_cfg = {
+        .gpio_num = KEY_GPIO,
+        .callback = key_event_handler
+    };
+    if (key_task_create(&key_cfg) != pdPASS) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void app_main(void)
+{
+    const char *out = getenv("SIM_OUT");
+    const char *script = getenv("SIM_SCRIPT");
+    const char *warp = getenv("SIM_WARP");
+    const char *broker = getenv("SIM_BROKER");
+    const char *soak = getenv("SIM_SOAK");
+    const char *http = getenv("SIM_HTTP");
+
+    if (out != NULL || soak == NULL) {
+        sim_record_open(out ? out : "sim_record.csv");
+    }
+    record_meta_int("servo_min_us", SERVO_MIN_PULSEWIDTH_US);
+    record_meta_int("servo_max_us", SERVO_MAX_PULSEWIDTH_US);
+    record_meta_int("servo_max_angle", SERVO_MAX_ANGLE);
+    record_meta_int("key_gpio", KEY_GPIO);
+    sim_record_meta("script", script ? script : "");
+
+    if (sim_clock_init() != ESP_OK || sim_board_init() != ESP_OK) {
+        exit(2);
+    }
+    /* 按键上拉，空闲为高电平 */
+    sim_gpio_set_input(KEY_GPIO, 1);
+
+    trace_init();
+    fault_inject_init();
+    app_pm_init();
+    dlog_init();
+    timer_wheel_init();
+    supervisor_start();
+    state_shadow_init();
+    journal_init();
+    soak_init();
+
+    if (msg_queue_init_all(APP_MSG_QUEUE_LEN) != ESP_OK) {
+        exit(2);
+    }
+    configure_led();
+    configure_key();
+    configure_servo();
+    if (start_tasks() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create tasks");
+        exit(2);
+    }
+
+    if (ha_mqtt_init() == ESP_OK) {
+        ha_mqtt_register_door_callback(mqtt_door_callback);
+        if (broker != NULL) {
+            ha_mqtt_set_broker_uri(broker);
+            ha_mqtt_start();
+        }
+    }
+
+    if (http != NULL && http_api_start() != ESP_OK) {
+        exit(2);
+    }
+
+    if (script != NULL && sim_script_start(script) != ESP_OK) {
+        exit(2);
+    }
+    if (soak != NULL && soak_start((uint32_t)strtoul(soak, NULL, 10), soak_done) != ESP_OK) {
+        exit(2);
+    }
+
+    if (warp != NULL) {
+        if (broker != NULL) {
+            ESP_LOGW(TAG, "Time warp with a real broker skews MQTT keepalive");
+        }
+        sim_clock_warp((uint32_t)strtoul(warp, NULL, 10));
+    }
+
+    ESP_LOGI(TAG, "Simulator running");
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,58 @@
+/**
+ * @file sim_record.c
+ * @brief 主机仿真记录实现
+ */
+
+#include "sim_record.h"
+#include "sim_clock.h"
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "sim_record";
+
+static FILE *s_out = NULL;
+
+esp_err_t sim_record_open(const char *path)
+{
+    s_out = fopen(path, "w");
+    if (s_out == NULL) {
+        ESP_LOGE(TAG, "Cannot create %s", path);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Recording to %s", path);
+    return ESP_OK;
+}
+
+void sim_record_meta(const char *key, const char *value)
+{
+    if (s_out != NULL) {
+        vTaskSuspendAll();
+        fprintf(s_out, "# %s=%s\n", key, value);
+        xTaskResumeAll();
+    }
+}
+
+void sim_record(const char *kind, int id, int32_t value)
+{
+    if (s_out == NULL) {
+        return;
+    }
+
+    /* 挂起调度器: 任务线程在持有 stdio 锁时被切走会使下一个写入者死锁 */
+    vTaskSuspendAll();
+    fprintf(s_out, "%lld,%s,%d,%ld\n", (long long)sim_clock_now_us(), kind, id, (long)value);
+    xTaskResumeAll();
+}
+
+void sim_record_close(void)
+{
+    if (s_out != NULL) {
+        vTaskSuspendAll();
+        fclose(s_out);
+        s_out = NULL;
+        xTaskResumeAll();
+    }
+}
@@ -0,0 +1,386 @@
+/**
+ * @file sim_script.c
+ * @brief 主机仿真脚本解析与执行
+ */
+
+#include "sim_script.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "board.h"
+#include "msg_queue.h"
+#include "fault_inject.h"
+
+static const char *TAG = "sim_script";
+
+#define SIM_SCRIPT_TASK_PRIO    (configMAX_PRIORITIES - 3)
+#define SIM_SCRIPT_TASK_STACK   4096
+#define SIM_SERVO_CHANNEL       0       /* 与 main/board.c 的 LEDC_CHANNEL 一致 */
+#define SIM_REPEAT_DEPTH        4
+
+#define CLICK_HOLD_MS           100
+#define DOUBLE_HOLD_MS          80
+#define DOUBLE_GAP_MS           120
+#define LONG_HOLD_MS            1500
+
+typedef enum {
+    OP_KEY = 0,         /* a=电平 */
+    OP_MQTT,            /* a=mqtt_cmd_t */
+    OP_EXPECT_SERVO,    /* a=角度 */
+    OP_EXPECT_GPIO,     /* a=引脚 b=电平 */
+    OP_MARK,
+    OP_FAULT,           /* a=fault_id_t b=次数 c=概率‰ */
+    OP_REPEAT,          /* a=次数 b=周期ms */
+    OP_END,
+} step_op_t;
+
+typedef struct {
+    uint32_t delay_ms;  /* 相对上一步 */
+    step_op_t op;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+    uint16_t line;
+} step_t;
+
+typedef struct {
+    size_t start;       /* repeat 之后第一步 */
+    int32_t left;
+    int64_t begin_us;
+    uint32_t period_ms;
+} repeat_frame_t;
+
+static step_t *s_steps = NULL;
+static size_t s_step_count = 0;
+static size_t s_step_cap = 0;
+static TaskHandle_t s_task = NULL;
+static esp_timer_handle_t s_wait_timer = NULL;
+static uint32_t s_checks = 0;
+static uint32_t s_failures = 0;
+
+static bool step_add3(uint32_t delay_ms, step_op_t op, int32_t a, int32_t b, int32_t c, int line)
+{
+    if (s_step_count == s_step_cap) {
+        size_t cap = s_step_cap ? s_step_cap * 2 : 64;
+        step_t *steps = realloc(s_steps, cap * sizeof(step_t));
+        if (steps == NULL) {
+            return false;
+        }
+        s_steps = steps;
+        s_step_cap = cap;
+    }
+    s_steps[s_step_count++] = (step_t){
+        .delay_ms = delay_ms, .op = op, .a = a, .b = b, .c = c, .line = (uint16_t)line,
+    };
+    return true;
+}
+
+static bool step_add(uint32_t delay_ms, step_op_t op, int32_t a, int32_t b, int line)
+{
+    return step_add3(delay_ms, op, a, b, 0, line);
+}
+
+/**
+ * @brief 解析一行，复合动作 (click/double/long) 展开为按下/释放
+ */
+static bool parse_line(char *text, int line, int *depth)
+{
+    char *comment = strchr(text, '#');
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+
+    char *tok = strtok(text, " \t\r\n");
+    if (tok == NULL) {
+        return true;
+    }
+
+    /* end 不带延时 */
+    if (strcmp(tok, "end") == 0) {
+        if (*depth == 0) {
+            return false;
+        }
+        (*depth)--;
+        return step_add(0, OP_END, 0, 0, line);
+    }
+
+    char *endp;
+    uint32_t delay = strtoul(tok, &endp, 10);
+    char *action = strtok(NULL, " \t\r\n");
+    char *arg1 = strtok(NULL, " \t\r\n");
+    char *arg2 = strtok(NULL, " \t\r\n");
+    char *arg3 = strtok(NULL, " \t\r\n");
+
+    if (*endp != '\0' || action == NULL) {
+        return false;
+    }
+
+    if (strcmp(action, "press") == 0) {
+        return step_add(delay, OP_KEY, 0, 0, line);
+    }
+    if (strcmp(action, "release") == 0) {
+        return step_add(delay, OP_KEY, 1, 0, line);
+    }
+    if (strcmp(action, "click") == 0 || strcmp(action, "long") == 0) {
+        uint32_t hold = arg1 ? strtoul(arg1, NULL, 10)
+                        : (action[0] == 'c' ? CLICK_HOLD_MS : LONG_HOLD_MS);
+        return step_add(delay, OP_KEY, 0, 0, line) &&
+               step_add(hold, OP_KEY, 1, 0, line);
+    }
+    if (strcmp(action, "double") == 0) {
+        return step_add(delay, OP_KEY, 0, 0, line) &&
+               step_add(DOUBLE_HOLD_MS, OP_KEY, 1, 0, line) &&
+               step_add(DOUBLE_GAP_MS, OP_KEY, 0, 0, line) &&
+               step_add(DOUBLE_HOLD_MS, OP_KEY, 1, 0, line);
+    }
+    if (strcmp(action, "mqtt") == 0 && arg1 != NULL) {
+        if (strcmp(arg1, "on") == 0) {
+            return step_add(delay, OP_MQTT, MQTT_CMD_DOOR_ON, 0, line);
+        }
+        if (strcmp(arg1, "off") == 0) {
+            return step_add(delay, OP_MQTT, MQTT_CMD_DOOR_OFF, 0, line);
+        }
+        return false;
+    }
+    if (strcmp(action, "expect") == 0 && arg1 != NULL && arg2 != NULL) {
+        if (strcmp(arg1, "servo") == 0) {
+            return step_add(delay, OP_EXPECT_SERVO, atoi(arg2), 0, line);
+        }
+        if (strcmp(arg1, "gpio") == 0 && arg3 != NULL) {
+            return step_add(delay, OP_EXPECT_GPIO, atoi(arg2), atoi(arg3), line);
+        }
+        return false;
+    }
+    if (strcmp(action, "fault") == 0 && arg1 != NULL && arg2 != NULL) {
+        fault_id_t id = fault_inject_find(arg1);
+        if (id == FAULT_MAX) {
+            return false;
+        }
+        if (strcmp(arg2, "off") == 0) {
+            return step_add3(delay, OP_FAULT, id, 0, 0, line);
+        }
+        return step_add3(delay, OP_FAULT, id, atoi(arg2), arg3 ? atoi(arg3) : 1000, line);
+    }
+    if (strcmp(action, "mark") == 0) {
+        return step_add(delay, OP_MARK, 0, 0, line);
+    }
+    if (strcmp(action, "repeat") == 0 && arg1 != NULL && arg2 != NULL) {
+        if (*depth >= SIM_REPEAT_DEPTH) {
+            return false;
+        }
+        (*depth)++;
+        return step_add(delay, OP_REPEAT, atoi(arg1), atoi(arg2), line);
+    }
+    return false;
+}
+
+static void wait_timer_cb(void *arg)
+{
+    xTaskNotifyGive(s_task);
+}
+
+/**
+ * @brief 等待到虚拟时刻 (经 esp_timer 等待，快进任务据此推进时间)
+ */
+static void wait_until(int64_t when_us)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (when_us <= now) {
+        return;
+    }
+    esp_timer_start_once(s_wait_timer, (uint64_t)(when_us - now));
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+static int servo_angle_now(void)
+{
+    int32_t pulse = (int32_t)sim_ledc_pulse_us(SIM_SERVO_CHANNEL);
+
+    return (int)(((pulse - SERVO_MIN_PULSEWIDTH_US) * SERVO_MAX_ANGLE +
+                  (SERVO_MAX_PULSEWIDTH_US - SERVO_MIN_PULSEWIDTH_US) / 2) /
+                 (SERVO_MAX_PULSEWIDTH_US - SERVO_MIN_PULSEWIDTH_US));
+}
+
+static void check(const step_t *s, bool ok, int actual)
+{
+    s_checks++;
+    sim_record("check", s->line, ok ? 1 : 0);
+    if (!ok) {
+        int32_t expected = (s->op == OP_EXPECT_GPIO) ? s->b : s->a;
+        s_failures++;
+        ESP_LOGE(TAG, "line %u: expected %ld, got %d at %lld ms", s->line, (long)expected,
+                 actual, (long long)(esp_timer_get_time() / 1000));
+    }
+}
+
+static void run_step(const step_t *s)
+{
+    switch (s->op) {
+    case OP_KEY:
+        sim_gpio_set_input(KEY_GPIO, s->a);
+        break;
+    case OP_MQTT:
+        sim_record("cmd", 0, s->a);
+        if (!msg_send_mqtt_door_cmd((mqtt_cmd_t)s->a)) {
+            ESP_LOGW(TAG, "line %u: door command dropped", s->line);
+        }
+        break;
+    case OP_EXPECT_SERVO: {
+        int angle = servo_angle_now();
+        check(s, abs(angle - s->a) <= 1, angle);
+        break;
+    }
+    case OP_EXPECT_GPIO: {
+        int level = sim_gpio_level(s->a);
+        check(s, level == s->b, level);
+        break;
+    }
+    case OP_MARK:
+        sim_record("mark", s->line, 0);
+        break;
+    case OP_FAULT:
+        sim_record("fault", s->a, s->b);
+        if (fault_inject_arm((fault_id_t)s->a, (uint32_t)s->b, (uint16_t)s->c) != ESP_OK) {
+            ESP_LOGW(TAG, "line %u: fault injection not available", s->line);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 各类故障的恢复时间写入日志和记录元数据
+ */
+static void report_faults(void)
+{
+    for (int i = 0; i < FAULT_MAX; i++) {
+        fault_stats_t st;
+        char buf[64];
+
+        if (fault_inject_get_stats((fault_id_t)i, &st) != ESP_OK || st.injected == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "Fault %s: injected %lu, recovered %lu%s, max %lu ms, avg %lu ms",
+                 fault_inject_name((fault_id_t)i), (unsigned long)st.injected,
+                 (unsigned long)st.recoveries, st.pending ? " (1 pending)" : "",
+                 (unsigned long)st.max_ms, (unsigned long)st.avg_ms);
+        snprintf(buf, sizeof(buf), "%lu,%lu,%d,%lu,%lu", (unsigned long)st.injected,
+                 (unsigned long)st.recoveries, st.pending ? 1 : 0,
+                 (unsigned long)st.max_ms, (unsigned long)st.avg_ms);
+
+        char key[24];
+        snprintf(key, sizeof(key), "fault_%s", fault_inject_name((fault_id_t)i));
+        sim_record_meta(key, buf);
+    }
+}
+
+static void sim_script_task(void *arg)
+{
+    repeat_frame_t stack[SIM_REPEAT_DEPTH];
+    int depth = 0;
+    int64_t t = esp_timer_get_time();
+    struct timespec wall0, wall1;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall0);
+
+    for (size_t pc = 0; pc < s_step_count; pc++) {
+        const step_t *s = &s_steps[pc];
+
+        if (s->op == OP_END) {
+            repeat_frame_t *f = &stack[depth - 1];
+            if (--f->left > 0) {
+                f->begin_us += (int64_t)f->period_ms * 1000;
+                t = f->begin_us;
+                pc = f->start - 1;
+            } else {
+                depth--;
+            }
+            continue;
+        }
+
+        t += (int64_t)s->delay_ms * 1000;
+        wait_until(t);
+
+        if (s->op == OP_REPEAT) {
+            if (s->a <= 0) {
+                /* 跳过整个块 */
+                int nest = 1;
+                while (nest > 0 && ++pc < s_step_count) {
+                    nest += (s_steps[pc].op == OP_REPEAT) - (s_steps[pc].op == OP_END);
+                }
+                continue;
+            }
+            stack[depth++] = (repeat_frame_t){
+                .start = pc + 1, .left = s->a, .begin_us = t, .period_ms = (uint32_t)s->b,
+            };
+            continue;
+        }
+        run_step(s);
+    }
+
+    wait_until(esp_timer_get_time() + (int64_t)CONFIG_SIM_SETTLE_MS * 1000);
+    clock_gettime(CLOCK_MONOTONIC, &wall1);
+
+    double virt_s = esp_timer_get_time() / 1e6;
+    double wall_s = (wall1.tv_sec - wall0.tv_sec) + (wall1.tv_nsec - wall0.tv_nsec) / 1e9;
+    ESP_LOGI(TAG, "Done: %.1f s virtual in %.2f s real (x%.0f), checks %lu, failed %lu",
+             virt_s, wall_s, wall_s > 0 ? virt_s / wall_s : 0.0,
+             (unsigned long)s_checks, (unsigned long)s_failures);
+
+    report_faults();
+    sim_record_close();
+    exit(s_failures ? 1 : 0);
+}
+
+esp_err_t sim_script_start(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char text[128];
+    int line = 0;
+    int depth = 0;
+    bool ok = true;
+
+    while (ok && fgets(text, sizeof(text), f) != NULL) {
+        line++;
+        ok = parse_line(text, line, &depth);
+    }
+    fclose(f);
+
+    if (!ok || depth != 0) {
+        ESP_LOGE(TAG, "%s:%d: syntax error", path, ok ? line + 1 : line);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = wait_timer_cb,
+        .name = "sim_script",
+    };
+    esp_err_t ret = esp_timer_create(&args, &s_wait_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (xTaskCreate(sim_script_task, "sim_script", SIM_SCRIPT_TASK_STACK, NULL,
+                    SIM_SCRIPT_TASK_PRIO, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create script task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Loaded %s: %u steps", path, (unsigned)s_step_count);
+    return ESP_OK;
+}
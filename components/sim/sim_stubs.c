@@ -0,0 +1,26 @@
+/**
+ * @file sim_stubs.c
+ * @brief 主机仿真中不参与编译的模块的替身
+ */
+
+#include "bt_l2cap.h"
+#include "wifi_manager.h"
+#include "crash_report.h"
+
+/* dlog 注册批量导出源，仿真不编译 BLE */
+esp_err_t bt_l2cap_register_source(bt_l2cap_stream_t stream, bt_l2cap_source_read_t read)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+/* http_api 的 /api/status 查询 WiFi 状态，仿真没有射频 */
+bool wifi_manager_is_connected(void)
+{
+    return false;
+}
+
+/* 仿真没有核心转储分区，不注册 /api/coredump */
+esp_err_t crash_report_register_http(httpd_handle_t server)
+{
+    return ESP_OK;
+}
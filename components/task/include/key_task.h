@@ -7,6 +7,7 @@
 #define KEY_TASK_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "freertos/FreeRTOS.h"
 #include "msg_queue.h"
 
@@ -30,11 +31,52 @@ typedef struct {
     key_event_callback_t callback; /**< 事件回调函数 */
 } key_task_config_t;
 
+/* 手势识别器输入 */
+#define KEY_FSM_IN_SAMPLE       (1UL << 0)  /**< 消抖后的电平采样 */
+#define KEY_FSM_IN_LONG         (1UL << 1)  /**< 长按定时到期 */
+#define KEY_FSM_IN_WINDOW       (1UL << 2)  /**< 双击窗口到期 */
+
+/* 手势识别器要求的定时器动作 (先取消再启动) */
+#define KEY_FSM_ARM_LONG        (1UL << 0)
+#define KEY_FSM_CANCEL_LONG     (1UL << 1)
+#define KEY_FSM_ARM_WINDOW      (1UL << 2)
+#define KEY_FSM_CANCEL_WINDOW   (1UL << 3)
+
+/**
+ * @brief 手势识别器状态 (单击/双击/长按)
+ *
+ * 识别器不访问 GPIO 和定时器，按键任务把中断、消抖和定时到期转换为输入，
+ * 再执行返回的定时器动作；基准测试直接驱动识别器测量单次采样开销。
+ */
+typedef struct {
+    key_state_t state;
+    uint8_t stable_level;       /**< 最近一次消抖后的电平 */
+    bool long_press_sent;
+} key_fsm_t;
+
+/**
+ * @brief 以当前电平初始化识别器 (空闲状态)
+ */
+void key_fsm_init(key_fsm_t *fsm, uint8_t level);
+
+/**
+ * @brief 处理一次输入
+ *
+ * @param inputs KEY_FSM_IN_* 位组合
+ * @param level 消抖后的电平，仅在 KEY_FSM_IN_SAMPLE 时使用
+ * @param event 输出识别出的事件
+ * @param timers 输出 KEY_FSM_ARM_* / KEY_FSM_CANCEL_* 位组合
+ * @return true 识别出一个事件 (一次输入最多一个)
+ */
+bool key_fsm_step(key_fsm_t *fsm, uint32_t inputs, uint8_t level,
+                  key_event_t *event, uint32_t *timers);
+
 /**
  * @brief Create the key scanning task
  * 
- * Creates a FreeRTOS task that scans the specified GPIO for key press
- * and release events, invoking the callback on detected gestures.
+ * Creates a FreeRTOS task that waits for level interrupts on the specified
+ * GPIO, debounces them with timer wheel timers and invokes the callback on
+ * detected gestures. The task sleeps while the key is idle.
  * 
  * @param config 按键任务配置，包含GPIO和回调函数
  * @return pdPASS on success, errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY on failure
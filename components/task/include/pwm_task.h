@@ -6,6 +6,7 @@
 #ifndef PWM_TASK_H
 #define PWM_TASK_H
 
+#include <stdbool.h>
 #include "freertos/FreeRTOS.h"
 
 #ifdef __cplusplus
@@ -19,6 +20,13 @@ extern "C" {
  */
 BaseType_t pwm_task_create(void);
 
+/**
+ * @brief 门当前是否处于打开状态
+ *
+ * @return true 已打开 (自动关门前)
+ */
+bool pwm_task_door_is_open(void);
+
 #ifdef __cplusplus
 }
 #endif
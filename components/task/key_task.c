@@ -1,27 +1,165 @@
 /**
  * @file key_task.c
  * @brief Key Task implementation with gesture detection
+ *
+ * 按键不再轮询: GPIO 电平中断 (触发电平始终与当前稳定电平相反，兼作浅睡眠唤醒源)
+ * 通知任务，消抖、长按和双击窗口均由时间轮定时器通知，空闲时任务不被唤醒。
  */
 
 #include "key_task.h"
 #include "msg_queue.h"
+#include "app_rtos.h"
+#include "timer_wheel.h"
+#include "supervisor.h"
 #include "esp_log.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#if CONFIG_PM_ENABLE
+#include "esp_sleep.h"
+#endif
 
 static const char *TAG = "key_task";
 
-#define KEY_TASK_STACK_SIZE      2048
-#define KEY_TASK_PRIORITY        4
-#define KEY_SCAN_INTERVAL_MS     10
+#define KEY_DEBOUNCE_MS          20
 
 /* Key gesture detection timing parameters (in milliseconds) */
 #define LONG_PRESS_TIME_MS       1000
 #define DOUBLE_CLICK_INTERVAL_MS 300
-#define CLICK_MAX_TIME_MS        500
+
+/* 单次唤醒处理上限 (含事件回调中的消息投递) */
+#define KEY_LOOP_SLO_MS          500
+
+/* 任务通知位 */
+#define KEY_NOTIFY_EDGE          (1UL << 0)
+#define KEY_NOTIFY_DEBOUNCE      (1UL << 1)
+#define KEY_NOTIFY_LONG          (1UL << 2)
+#define KEY_NOTIFY_WINDOW        (1UL << 3)
 
 /* 静态配置存储 */
 static key_task_config_t s_config;
+static TaskHandle_t s_task = NULL;
+
+static wheel_timer_t s_debounce_timer;
+static wheel_timer_t s_long_timer;
+static wheel_timer_t s_window_timer;
+
+/**
+ * @brief 电平中断: 关闭中断 (电平触发会持续进入) 并通知任务
+ */
+static void key_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+
+    gpio_intr_disable(s_config.gpio_num);
+    xTaskNotifyFromISR(s_task, KEY_NOTIFY_EDGE, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief 按稳定电平重新打开中断，等待下一次电平变化
+ */
+static void key_irq_arm(uint8_t gpio_num, uint8_t stable_level)
+{
+    gpio_int_type_t type = stable_level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+
+    gpio_set_intr_type(gpio_num, type);
+#if CONFIG_PM_ENABLE
+    gpio_wakeup_enable(gpio_num, type);
+#endif
+    gpio_intr_enable(gpio_num);
+}
+
+static void key_emit(key_event_t event)
+{
+    if (s_config.callback) {
+        s_config.callback(s_config.gpio_num, event);
+    }
+}
+
+void key_fsm_init(key_fsm_t *fsm, uint8_t level)
+{
+    fsm->state = KEY_STATE_IDLE;
+    fsm->stable_level = level;
+    fsm->long_press_sent = false;
+}
+
+bool key_fsm_step(key_fsm_t *fsm, uint32_t inputs, uint8_t level,
+                  key_event_t *event, uint32_t *timers)
+{
+    bool emitted = false;
+
+    *timers = 0;
+
+    /* 先处理超时: 同一次唤醒中超时总是先于刚消抖完成的电平变化发生 */
+    if ((inputs & KEY_FSM_IN_LONG) && fsm->state == KEY_STATE_PRESSED && !fsm->long_press_sent) {
+        /* 按住达到长按时间，触发长按事件 */
+        *event = KEY_EVENT_LONG_PRESS;
+        emitted = true;
+        fsm->long_press_sent = true;  /* 标记长按事件已发送，避免重复触发 */
+    }
+
+    if ((inputs & KEY_FSM_IN_WINDOW) && fsm->state == KEY_STATE_WAIT_SECOND) {
+        /* 超过双击间隔仍未按下，判定为单击 */
+        *event = KEY_EVENT_SINGLE_CLICK;
+        emitted = true;
+        fsm->state = KEY_STATE_IDLE;
+    }
+
+    if (!(inputs & KEY_FSM_IN_SAMPLE) || level == fsm->stable_level) {
+        return emitted;
+    }
+    fsm->stable_level = level;
+
+    switch (fsm->state) {
+        /* 空闲状态：按键按下 */
+        case KEY_STATE_IDLE:
+            if (level == 0) {
+                fsm->long_press_sent = false;     /* 重置长按标志 */
+                *timers |= KEY_FSM_ARM_LONG;
+                fsm->state = KEY_STATE_PRESSED;   /* 进入按下状态 */
+            }
+            break;
+
+        /* 按下状态：释放时判断是短按还是长按 */
+        case KEY_STATE_PRESSED:
+            if (level == 1) {
+                *timers |= KEY_FSM_CANCEL_LONG;
+                if (fsm->long_press_sent) {
+                    /* 长按后释放，直接回到空闲状态（长按事件已在按住时发送） */
+                    fsm->state = KEY_STATE_IDLE;
+                } else {
+                    /* 短按释放，进入等待第二次按下状态（判断是否双击） */
+                    *timers |= KEY_FSM_ARM_WINDOW;
+                    fsm->state = KEY_STATE_WAIT_SECOND;
+                }
+            }
+            break;
+
+        /* 等待第二次按下状态：窗口内按下判定为双击的第二次按下 */
+        case KEY_STATE_WAIT_SECOND:
+            if (level == 0) {
+                *timers |= KEY_FSM_CANCEL_WINDOW;
+                fsm->state = KEY_STATE_DOUBLE_PRESSED;
+            }
+            break;
+
+        /* 双击第二次按下状态：等待释放以确认双击 */
+        case KEY_STATE_DOUBLE_PRESSED:
+            if (level == 1) {
+                *event = KEY_EVENT_DOUBLE_CLICK;
+                emitted = true;
+                fsm->state = KEY_STATE_IDLE;
+            }
+            break;
+
+        default:
+            fsm->state = KEY_STATE_IDLE;
+            break;
+    }
+    return emitted;
+}
+
+static void key_task_restart(void);
 
 /**
  * @brief Key task function with gesture detection
@@ -29,116 +167,93 @@ static key_task_config_t s_config;
 static void key_task(void *pvParameters)
 {
     uint8_t gpio_num = s_config.gpio_num;
-    key_event_callback_t callback = s_config.callback;
-    
-    key_state_t state = KEY_STATE_IDLE;
-    uint8_t last_key_level = 1;
-    uint8_t current_key_level;
-    TickType_t press_start_tick = 0;
-    TickType_t release_tick = 0;
-    bool long_press_sent = false;
-
-    ESP_LOGI(TAG, "Key task started, scanning GPIO %d", gpio_num);
-
-    /* 按键扫描主循环 */
+    key_fsm_t fsm;
+    key_event_t event;
+    uint32_t bits;
+    uint32_t timers;
+
+    key_fsm_init(&fsm, gpio_get_level(gpio_num));
+    s_task = xTaskGetCurrentTaskHandle();
+    supervisor_register(APP_TASK_KEY, 0, KEY_LOOP_SLO_MS, key_task_restart);
+    timer_wheel_setup_notify(&s_debounce_timer, "key_debounce", s_task, KEY_NOTIFY_DEBOUNCE);
+    timer_wheel_setup_notify(&s_long_timer, "key_long", s_task, KEY_NOTIFY_LONG);
+    timer_wheel_setup_notify(&s_window_timer, "key_window", s_task, KEY_NOTIFY_WINDOW);
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "GPIO ISR service install failed: %s", esp_err_to_name(ret));
+        vTaskDelete(NULL);
+        return;
+    }
+    gpio_isr_handler_add(gpio_num, key_isr, NULL);
+#if CONFIG_PM_ENABLE
+    esp_sleep_enable_gpio_wakeup();
+#endif
+    key_irq_arm(gpio_num, fsm.stable_level);
+
+    ESP_LOGI(TAG, "Key task started, GPIO %d interrupt driven", gpio_num);
+
     while (1) {
-        /* 读取当前按键电平状态 */
-        current_key_level = gpio_get_level(gpio_num);
-        TickType_t current_tick = xTaskGetTickCount();
-
-        switch (state) {
-            /* 空闲状态：等待按键按下 */
-            case KEY_STATE_IDLE:
-                /* 检测到下降沿（按键按下） */
-                if (current_key_level == 0 && last_key_level == 1) {
-                    press_start_tick = current_tick;  /* 记录按下时刻 */
-                    long_press_sent = false;          /* 重置长按标志 */
-                    state = KEY_STATE_PRESSED;        /* 进入按下状态 */
-                }
-                break;
-
-            /* 按下状态：判断是短按还是长按 */
-            case KEY_STATE_PRESSED:
-                /* 检测到上升沿（按键释放） */
-                if (current_key_level == 1 && last_key_level == 0) {
-                    TickType_t press_duration = current_tick - press_start_tick;
-                    
-                    /* 长按后释放，直接回到空闲状态（长按事件已在按住时发送） */
-                    if (press_duration >= pdMS_TO_TICKS(LONG_PRESS_TIME_MS)) {
-                        state = KEY_STATE_IDLE;
-                    } else {
-                        /* 短按释放，进入等待第二次按下状态（判断是否双击） */
-                        release_tick = current_tick;
-                        state = KEY_STATE_WAIT_SECOND;
-                    }
-                } else if (current_key_level == 0) {
-                    /* 按键持续按住，检测是否达到长按时间 */
-                    TickType_t press_duration = current_tick - press_start_tick;
-                    if (press_duration >= pdMS_TO_TICKS(LONG_PRESS_TIME_MS) && !long_press_sent) {
-                        /* 超时则触发长按事件 */
-                        if (callback) {
-                            callback(gpio_num, KEY_EVENT_LONG_PRESS);
-                        }
-                        long_press_sent = true;  /* 标记长按事件已发送，避免重复触发 */
-                    }
-                }
-                break;
-
-            /* 等待第二次按下状态：判断是单击还是双击 */
-            case KEY_STATE_WAIT_SECOND:
-                /* 检测到下降沿（第二次按下） */
-                if (current_key_level == 0 && last_key_level == 1) {
-                    TickType_t interval = current_tick - release_tick;
-                    
-                    /* 在双击间隔时间内按下，判定为双击的第二次按下 */
-                    if (interval <= pdMS_TO_TICKS(DOUBLE_CLICK_INTERVAL_MS)) {
-                        press_start_tick = current_tick;
-                        state = KEY_STATE_DOUBLE_PRESSED;
-                    } else {
-                        /* 超过双击间隔，先发送单击事件，然后作为新的按下处理 */
-                        if (callback) {
-                            callback(gpio_num, KEY_EVENT_SINGLE_CLICK);
-                        }
-                        press_start_tick = current_tick;
-                        long_press_sent = false;
-                        state = KEY_STATE_PRESSED;
-                    }
-                } else if (current_key_level == 1) {
-                    /* 按键保持释放状态，检测等待是否超时 */
-                    TickType_t wait_duration = current_tick - release_tick;
-                    
-                    /* 超过双击间隔仍未按下，判定为单击 */
-                    if (wait_duration > pdMS_TO_TICKS(DOUBLE_CLICK_INTERVAL_MS)) {
-                        if (callback) {
-                            callback(gpio_num, KEY_EVENT_SINGLE_CLICK);
-                        }
-                        state = KEY_STATE_IDLE;
-                    }
-                }
-                break;
-
-            /* 双击第二次按下状态：等待释放以确认双击 */
-            case KEY_STATE_DOUBLE_PRESSED:
-                /* 检测到上升沿（第二次按下后释放），确认双击完成 */
-                if (current_key_level == 1 && last_key_level == 0) {
-                    /* 双击事件通过回调通知 */
-                    if (callback) {
-                        callback(gpio_num, KEY_EVENT_DOUBLE_CLICK);
-                    }
-                    ESP_LOGI(TAG, "Double click detected");
-                    state = KEY_STATE_IDLE;
-                }
-                break;
+        supervisor_loop_end(APP_TASK_KEY);
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        supervisor_loop_begin(APP_TASK_KEY);
 
-            default:
-                state = KEY_STATE_IDLE;
-                break;
+        if (bits & KEY_NOTIFY_EDGE) {
+            /* 电平变化，消抖后再读取 */
+            timer_wheel_arm(&s_debounce_timer, KEY_DEBOUNCE_MS, 0);
         }
 
-        /* 更新上一次按键电平，用于边沿检测 */
-        last_key_level = current_key_level;
-        /* 按键扫描间隔延时 */
-        vTaskDelay(pdMS_TO_TICKS(KEY_SCAN_INTERVAL_MS));
+        uint32_t inputs = ((bits & KEY_NOTIFY_DEBOUNCE) ? KEY_FSM_IN_SAMPLE : 0) |
+                          ((bits & KEY_NOTIFY_LONG) ? KEY_FSM_IN_LONG : 0) |
+                          ((bits & KEY_NOTIFY_WINDOW) ? KEY_FSM_IN_WINDOW : 0);
+        uint8_t level = (bits & KEY_NOTIFY_DEBOUNCE) ? gpio_get_level(gpio_num) : fsm.stable_level;
+        bool emitted = key_fsm_step(&fsm, inputs, level, &event, &timers);
+
+        if (timers & KEY_FSM_CANCEL_LONG) {
+            timer_wheel_cancel(&s_long_timer);
+        }
+        if (timers & KEY_FSM_CANCEL_WINDOW) {
+            timer_wheel_cancel(&s_window_timer);
+        }
+        if (timers & KEY_FSM_ARM_LONG) {
+            timer_wheel_arm(&s_long_timer, LONG_PRESS_TIME_MS, 0);
+        }
+        if (timers & KEY_FSM_ARM_WINDOW) {
+            timer_wheel_arm(&s_window_timer, DOUBLE_CLICK_INTERVAL_MS, 0);
+        }
+        if (emitted) {
+            if (event == KEY_EVENT_DOUBLE_CLICK) {
+                ESP_LOGI(TAG, "Double click detected");
+            }
+            key_emit(event);
+        }
+
+        /* 消抖完成才重新打开中断，抖动期间的多次跳变只处理一次 */
+        if (bits & KEY_NOTIFY_DEBOUNCE) {
+            key_irq_arm(gpio_num, fsm.stable_level);
+        }
+    }
+}
+
+/**
+ * @brief 监督重启: 摘除中断和定时器后删除停在安全点的按键任务并重建，手势状态从空闲开始
+ */
+static void key_task_restart(void)
+{
+    gpio_intr_disable(s_config.gpio_num);
+    gpio_isr_handler_remove(s_config.gpio_num);
+    timer_wheel_cancel(&s_debounce_timer);
+    timer_wheel_cancel(&s_long_timer);
+    timer_wheel_cancel(&s_window_timer);
+
+    TaskHandle_t handle = app_task_handle(APP_TASK_KEY);
+    if (handle != NULL) {
+        vTaskDelete(handle);
+    }
+    s_task = NULL;
+
+    if (app_task_create(APP_TASK_KEY, key_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to recreate key task");
     }
 }
 
@@ -151,14 +266,7 @@ BaseType_t key_task_create(const key_task_config_t *config)
 
     s_config = *config;
 
-    BaseType_t result = xTaskCreate(
-        key_task,
-        "key_task",
-        KEY_TASK_STACK_SIZE,
-        NULL,
-        KEY_TASK_PRIORITY,
-        NULL
-    );
+    BaseType_t result = app_task_create(APP_TASK_KEY, key_task, NULL, NULL);
 
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create key task");
@@ -6,14 +6,17 @@
 #include "led_task.h"
 #include "msg_queue.h"
 #include "board.h"
+#include "app_rtos.h"
+#include "supervisor.h"
 #include "esp_log.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
 
 static const char *TAG = "led_task";
 
-#define LED_TASK_STACK_SIZE 2048
-#define LED_TASK_PRIORITY   5
+#define LED_LOOP_SLO_MS 500
+
+static void led_task_restart(void);
 
 static void led_task(void *pvParameters)
 {
@@ -22,10 +25,13 @@ static void led_task(void *pvParameters)
     static uint8_t red_led_state = LED_RED_OFF;
     static uint8_t green_led_state = LED_GRE_ON;
 
+    supervisor_register(APP_TASK_LED, 0, LED_LOOP_SLO_MS, led_task_restart);
+
     ESP_LOGI(TAG, "LED task started");
 
     while (1) {
         if (msg_queue_receive(queue, &msg, portMAX_DELAY)) {
+            supervisor_loop_begin(APP_TASK_LED);
             if (msg.type == MSG_TYPE_LED) {
                 gpio_set_level(msg.data.led.gpio_num, msg.data.led.state);
                 ESP_LOGD(TAG, "LED GPIO %d set to %d", 
@@ -45,10 +51,26 @@ static void led_task(void *pvParameters)
             } else {
                 ESP_LOGW(TAG, "Received unknown message type: %d", msg.type);
             }
+            supervisor_loop_end(APP_TASK_LED);
         }
     }
 }
 
+/**
+ * @brief 监督重启: 删除停在安全点的 LED 任务并重建
+ */
+static void led_task_restart(void)
+{
+    TaskHandle_t handle = app_task_handle(APP_TASK_LED);
+    if (handle != NULL) {
+        vTaskDelete(handle);
+    }
+
+    if (app_task_create(APP_TASK_LED, led_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to recreate led task");
+    }
+}
+
 BaseType_t led_task_create(void)
 {
     QueueHandle_t queue = msg_queue_get(QUEUE_LED);
@@ -57,14 +79,7 @@ BaseType_t led_task_create(void)
         return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
     }
 
-    BaseType_t result = xTaskCreate(
-        led_task,
-        "led_task",
-        LED_TASK_STACK_SIZE,
-        NULL,
-        LED_TASK_PRIORITY,
-        NULL
-    );
+    BaseType_t result = app_task_create(APP_TASK_LED, led_task, NULL, NULL);
 
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create led task");
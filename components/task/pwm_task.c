@@ -7,160 +7,272 @@
 #include "msg_queue.h"
 #include "board.h"
 #include "ha_mqtt.h"
+#include "app_rtos.h"
+#include "app_pm.h"
+#include "dlog.h"
+#include "trace.h"
+#include "journal.h"
+#include "state_shadow.h"
+#include "timer_wheel.h"
+#include "supervisor.h"
+#include "diag_cmd.h"
 #include "esp_log.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
 
-static const char *TAG = "servo_task";
+#include <stdlib.h>
+#include <strings.h>
 
-#define SERVO_TASK_STACK_SIZE 2048
-#define SERVO_TASK_PRIORITY   5
+static const char *TAG = "servo_task";
 
 /* 双击计数器配置 - 连续双击触发WiFi凭据清除 */
 #define DOUBLE_CLICK_RESET_TIMEOUT_MS  2000
 #define DOUBLE_CLICK_TRIGGER_COUNT     2
 
-typedef struct {
-    uint8_t count;
-    TickType_t last_tick;
-} double_click_counter_t;
+/* 单条命令处理上限: 舵机 0-180 度全程约 1.8 s，另含 MQTT 发布 */
+#define SERVO_LOOP_SLO_MS              3000
 
-/* 自动关门定时器 */
-static TimerHandle_t s_close_door_timer = NULL;
+/* 自动关门和双击计数复位定时器，到期消息投递到本任务队列 */
+static wheel_timer_t s_close_door_timer;
+static wheel_timer_t s_double_click_timer;
+static uint8_t s_double_click_count = 0;
 static bool s_door_open = false;
 
-static void close_door_timer_callback(TimerHandle_t xTimer)
+static void auto_close_door(void)
 {
     if (s_door_open) {
+        TRACE(TRACE_SRC_SERVO, TRACE_EVT_DOOR_CLOSE, 0, 1, 0);
+        journal_log(JOURNAL_EVT_DOOR_CLOSE, JOURNAL_SRC_TIMER, 0);
         servo_set_angle(SERVO_ANGLE_POS1);
         s_door_open = false;
-        ESP_LOGI(TAG, "Auto close door: Servo set to %d degrees", SERVO_ANGLE_POS1);
+        DLOGI(TAG, "Auto close door: Servo set to %d degrees", SERVO_ANGLE_POS1);
         
         /* 发布门状态到 MQTT */
         ha_mqtt_publish_door_state(false);
+        state_shadow_set_door(false);
     }
 }
 
-static bool check_counter_timeout(double_click_counter_t *counter)
+/* 双击计数，超时未达到次数时由复位定时器清零 */
+static void handle_double_click(void)
 {
-    if (counter->count == 0) return false;
-    TickType_t elapsed = xTaskGetTickCount() - counter->last_tick;
-    return (elapsed >= pdMS_TO_TICKS(DOUBLE_CLICK_RESET_TIMEOUT_MS));
-}
-
-static void increment_counter(double_click_counter_t *counter)
-{
-    counter->count++;
-    counter->last_tick = xTaskGetTickCount();
+    s_double_click_count++;
+    ESP_LOGI(TAG, "Double click count: %d/%d", 
+             s_double_click_count, DOUBLE_CLICK_TRIGGER_COUNT);
+    
+    if (s_double_click_count >= DOUBLE_CLICK_TRIGGER_COUNT) {
+        ESP_LOGI(TAG, "Trigger reached, clearing WiFi credentials");
+        journal_log(JOURNAL_EVT_CREDENTIALS_CLEAR, JOURNAL_SRC_KEY, 0);
+        msg_send_to_wifi(WIFI_CMD_CLEAR_CREDENTIALS);
+        timer_wheel_cancel(&s_double_click_timer);
+        s_double_click_count = 0;
+    } else {
+        timer_wheel_arm(&s_double_click_timer, DOUBLE_CLICK_RESET_TIMEOUT_MS, 0);
+    }
 }
 
-static void reset_counter(double_click_counter_t *counter)
+static void handle_timer(const timer_msg_data_t *timer)
 {
-    counter->count = 0;
-    counter->last_tick = 0;
+    /* 到期后又被重新启动或取消的定时器，旧消息直接丢弃 */
+    if (!timer_wheel_msg_is_current(timer)) {
+        return;
+    }
+    if (timer->timer == &s_close_door_timer) {
+        auto_close_door();
+    } else if (timer->timer == &s_double_click_timer) {
+        ESP_LOGI(TAG, "Double click counter timeout, resetting");
+        s_double_click_count = 0;
+    }
 }
 
 /* 非阻塞开门，定时器自动关门 */
-static void open_door_non_blocking(void)
+static void open_door_non_blocking(journal_src_t src)
 {
+    TRACE(TRACE_SRC_SERVO, TRACE_EVT_DOOR_OPEN, 0, 0, 0);
+    journal_log(JOURNAL_EVT_DOOR_OPEN, src, 0);
     servo_set_angle(SERVO_ANGLE_POS2);
     s_door_open = true;
-    ESP_LOGI(TAG, "Open door: Servo set to %d degrees", SERVO_ANGLE_POS2);
+    DLOGI(TAG, "Open door: Servo set to %d degrees", SERVO_ANGLE_POS2);
     
     /* 发布门状态到 MQTT */
     ha_mqtt_publish_door_state(true);
+    state_shadow_set_door(true);
     
     /* 重置并启动关门定时器 */
-    if (s_close_door_timer != NULL) {
-        xTimerStop(s_close_door_timer, 0);
-        xTimerChangePeriod(s_close_door_timer, pdMS_TO_TICKS(OPEN_TIME), 0);
-        xTimerStart(s_close_door_timer, 0);
-    }
+    timer_wheel_arm(&s_close_door_timer, OPEN_TIME, 0);
 }
 
 /* 关门操作 */
-static void close_door(void)
+static void close_door(journal_src_t src)
 {
     /* 停止自动关门定时器 */
-    if (s_close_door_timer != NULL) {
-        xTimerStop(s_close_door_timer, 0);
-    }
+    timer_wheel_cancel(&s_close_door_timer);
     
     if (s_door_open) {
+        TRACE(TRACE_SRC_SERVO, TRACE_EVT_DOOR_CLOSE, 0, 0, 0);
+        journal_log(JOURNAL_EVT_DOOR_CLOSE, src, 0);
         servo_set_angle(SERVO_ANGLE_POS1);
         s_door_open = false;
-        ESP_LOGI(TAG, "Close door: Servo set to %d degrees", SERVO_ANGLE_POS1);
+        DLOGI(TAG, "Close door: Servo set to %d degrees", SERVO_ANGLE_POS1);
         
         /* 发布门状态到 MQTT */
         ha_mqtt_publish_door_state(false);
+        state_shadow_set_door(false);
+    }
+}
+
+/*
+ * 诊断命令 SERVO 转到任意角度: 与其他通道一样记日志、更新门状态，
+ * 离开关门位置即视为开门并启动自动关门，到期转回关门位置
+ */
+static void move_servo(uint8_t angle, journal_src_t src)
+{
+    bool open = angle != SERVO_ANGLE_POS1;
+
+    TRACE(TRACE_SRC_SERVO, open ? TRACE_EVT_DOOR_OPEN : TRACE_EVT_DOOR_CLOSE, angle, 0, 0);
+    journal_log(open ? JOURNAL_EVT_DOOR_OPEN : JOURNAL_EVT_DOOR_CLOSE, src, angle);
+    servo_set_angle(angle);
+    DLOGI(TAG, "Servo moved to %d degrees", angle);
+
+    if (open != s_door_open) {
+        s_door_open = open;
+        ha_mqtt_publish_door_state(open);
+        state_shadow_set_door(open);
+    }
+    if (open) {
+        timer_wheel_arm(&s_close_door_timer, OPEN_TIME, 0);
+    } else {
+        timer_wheel_cancel(&s_close_door_timer);
     }
 }
 
+static void pwm_task_restart(void);
+
 static void servo_task(void *pvParameters)
 {
     QueueHandle_t pwm_queue = msg_queue_get(QUEUE_PWM);
     msg_t msg;
-    double_click_counter_t double_click_counter = {0};
 
-    /* 创建自动关门定时器 */
-    s_close_door_timer = xTimerCreate("close_door", pdMS_TO_TICKS(OPEN_TIME), 
-                                       pdFALSE, NULL, close_door_timer_callback);
+    supervisor_register(APP_TASK_SERVO, 0, SERVO_LOOP_SLO_MS, pwm_task_restart);
 
     ESP_LOGI(TAG, "Servo task started (Pos1: %d°, Pos2: %d°)", 
              SERVO_ANGLE_POS1, SERVO_ANGLE_POS2);
 
     while (1) {
         if (msg_queue_receive(pwm_queue, &msg, portMAX_DELAY)) {
+            supervisor_loop_begin(APP_TASK_SERVO);
+            /* 命令处理期间 CPU 保持最高频率 */
+            app_pm_acquire(APP_PM_LOCK_CMD);
+            
             if (msg.type == MSG_TYPE_KEY && msg.data.key.event == KEY_EVENT_DOUBLE_CLICK) {
-                /* 双击计数器 - 先处理计数 */
-                if (check_counter_timeout(&double_click_counter)) {
-                    ESP_LOGI(TAG, "Double click counter timeout, resetting");
-                    reset_counter(&double_click_counter);
-                }
-                
-                increment_counter(&double_click_counter);
-                ESP_LOGI(TAG, "Double click count: %d/%d", 
-                         double_click_counter.count, DOUBLE_CLICK_TRIGGER_COUNT);
-                
-                if (double_click_counter.count >= DOUBLE_CLICK_TRIGGER_COUNT) {
-                    ESP_LOGI(TAG, "Trigger reached, clearing WiFi credentials");
-                    msg_send_to_wifi(WIFI_CMD_CLEAR_CREDENTIALS);
-                    reset_counter(&double_click_counter);
-                }
-                
-
+                handle_double_click();
             }
             else if (msg.type == MSG_TYPE_KEY && msg.data.key.event == KEY_EVENT_SINGLE_CLICK)
             {
                 /* 非阻塞开门 */
-                open_door_non_blocking();
+                open_door_non_blocking(JOURNAL_SRC_KEY);
             } else if (msg.type == MSG_TYPE_PWM) {
                 if (msg.data.pwm.event == PWM_EVENT_OPEN_DOOR) {
                     /* 蓝牙开门命令 - 非阻塞 */
-                    open_door_non_blocking();
+                    open_door_non_blocking(JOURNAL_SRC_BLE);
                 } else if (msg.data.pwm.event == PWM_EVENT_SET_ANGLE) {
-                    /* 直接设置舵机角度 */
+                    /* 诊断命令 SERVO */
                     uint8_t angle = msg.data.pwm.angle;
-                    if (angle > 180) angle = 180;
-                    servo_set_angle(angle);
-                    ESP_LOGI(TAG, "Servo set to %d degrees", angle);
+                    if (angle > SERVO_MAX_ANGLE) angle = SERVO_MAX_ANGLE;
+                    move_servo(angle, JOURNAL_SRC_DIAG);
                 }
             } else if (msg.type == MSG_TYPE_MQTT) {
                 /* MQTT 开门/关门命令 */
                 if (msg.data.mqtt.cmd == MQTT_CMD_DOOR_ON) {
                     ESP_LOGI(TAG, "MQTT door ON command received");
-                    open_door_non_blocking();
+                    open_door_non_blocking(JOURNAL_SRC_MQTT);
                 } else if (msg.data.mqtt.cmd == MQTT_CMD_DOOR_OFF) {
                     ESP_LOGI(TAG, "MQTT door OFF command received");
-                    close_door();
+                    close_door(JOURNAL_SRC_MQTT);
+                }
+            } else if (msg.type == MSG_TYPE_HTTP) {
+                /* 局域网 HTTP API 开门/关门命令 */
+                if (msg.data.http.cmd == HTTP_CMD_DOOR_OPEN) {
+                    open_door_non_blocking(JOURNAL_SRC_HTTP);
+                } else if (msg.data.http.cmd == HTTP_CMD_DOOR_CLOSE) {
+                    close_door(JOURNAL_SRC_HTTP);
                 }
+            } else if (msg.type == MSG_TYPE_COAP) {
+                /* CoAP 开门/关门命令 */
+                if (msg.data.coap.cmd == COAP_CMD_DOOR_OPEN) {
+                    open_door_non_blocking(JOURNAL_SRC_COAP);
+                } else if (msg.data.coap.cmd == COAP_CMD_DOOR_CLOSE) {
+                    close_door(JOURNAL_SRC_COAP);
+                }
+            } else if (msg.type == MSG_TYPE_TIMER) {
+                handle_timer(&msg.data.timer);
             } else {
                 ESP_LOGW(TAG, "Received unknown message type: %d", msg.type);
             }
+            
+            app_pm_release(APP_PM_LOCK_CMD);
+            supervisor_loop_end(APP_TASK_SERVO);
         }
     }
 }
 
+/**
+ * @brief 监督重启: 删除停在安全点的舵机任务并重建
+ *
+ * 任务在 supervisor_loop_end 处挂起，此时已释放 PM 锁且不持有其他模块的锁。
+ * 队列和定时器保留，积压的命令和自动关门由新实例继续处理。
+ */
+static void pwm_task_restart(void)
+{
+    TaskHandle_t handle = app_task_handle(APP_TASK_SERVO);
+    if (handle != NULL) {
+        vTaskDelete(handle);
+    }
+
+    if (app_task_create(APP_TASK_SERVO, servo_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to recreate servo task");
+    }
+}
+
+/**
+ * @brief SERVO 诊断命令: 门状态和当前角度，"SERVO OPEN|CLOSE|<角度>" 经舵机队列转动 (仅串口)
+ */
+static esp_err_t cmd_servo(int argc, char **argv, const diag_out_t *out)
+{
+    if (argc >= 2) {
+        unsigned long angle;
+        char *end;
+
+        if (!diag_cmd_check_local(out)) {
+            return ESP_ERR_NOT_ALLOWED;
+        }
+        if (strcasecmp(argv[1], "OPEN") == 0) {
+            angle = SERVO_ANGLE_POS2;
+        } else if (strcasecmp(argv[1], "CLOSE") == 0) {
+            angle = SERVO_ANGLE_POS1;
+        } else {
+            angle = strtoul(argv[1], &end, 10);
+            if (end == argv[1] || *end != '\0' || angle > SERVO_MAX_ANGLE) {
+                diag_printf(out, "SERVO OPEN|CLOSE|<0-%d>\r\n", SERVO_MAX_ANGLE);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        if (!msg_send_pwm_set_angle((uint8_t)angle)) {
+            diag_printf(out, "queue full\r\n");
+            return ESP_FAIL;
+        }
+        diag_printf(out, "moving to %lu\r\n", angle);
+        return ESP_OK;
+    }
+
+    diag_printf(out, "door=%s angle=%u\r\n", s_door_open ? "open" : "closed", servo_get_angle());
+    return ESP_OK;
+}
+
+bool pwm_task_door_is_open(void)
+{
+    return s_door_open;
+}
+
 BaseType_t pwm_task_create(void)
 {
     QueueHandle_t queue = msg_queue_get(QUEUE_PWM);
@@ -169,14 +281,12 @@ BaseType_t pwm_task_create(void)
         return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
     }
 
-    BaseType_t result = xTaskCreate(
-        servo_task,
-        "servo_task",
-        SERVO_TASK_STACK_SIZE,
-        NULL,
-        SERVO_TASK_PRIORITY,
-        NULL
-    );
+    timer_wheel_setup_msg(&s_close_door_timer, "close_door", QUEUE_PWM);
+    timer_wheel_setup_msg(&s_double_click_timer, "double_click", QUEUE_PWM);
+    diag_cmd_register("SERVO", "door state and servo angle, SERVO OPEN|CLOSE|<angle> moves it (UART)",
+                      cmd_servo, DIAG_ACCESS_REMOTE);
+
+    BaseType_t result = app_task_create(APP_TASK_SERVO, servo_task, NULL, NULL);
 
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create servo task");
@@ -0,0 +1,276 @@
+/**
+ * @file app_event.c
+ * @brief 应用事件循环实现
+ */
+
+#include "app_event.h"
+#include "app_rtos.h"
+#include "diag_cmd.h"
+#include "supervisor.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "app_event";
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+/* 单个事件处理上限 (所有处理函数合计) */
+#define APP_EVENT_LOOP_SLO_MS   2000
+
+#define MAX_HANDLERS            16
+#define MAX_SYSTEM_HANDLERS     8
+
+static const char *const s_event_names[APP_EVENT_MAX] = {
+    "wifi_start", "wifi_disc", "wifi_ip", "sc_status", "sc_creds", "sc_ack",
+};
+
+/* 投递时在数据前附加时间戳，用于统计排队延迟 */
+typedef union {
+    app_event_wifi_disconnected_t disconnected;
+    app_event_got_ip_t got_ip;
+    app_event_sc_status_t sc_status;
+    app_event_sc_credentials_t sc_credentials;
+} app_event_payload_t;
+
+typedef struct {
+    int64_t post_us;
+    app_event_payload_t data;
+} app_event_msg_t;
+
+typedef struct {
+    app_event_id_t id;
+    app_event_handler_t handler;
+    void *arg;
+} handler_entry_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_queue_us;
+    uint32_t max_run_us;
+    uint64_t total_run_us;
+} event_stat_t;
+
+/* 默认循环上的处理函数及其耗时 */
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+} system_entry_t;
+
+static esp_event_loop_handle_t s_loop = NULL;
+static handler_entry_t s_handlers[MAX_HANDLERS];
+static uint8_t s_handler_count = 0;
+static system_entry_t s_system[MAX_SYSTEM_HANDLERS];
+static uint8_t s_system_count = 0;
+static event_stat_t s_stats[APP_EVENT_MAX];
+static volatile uint32_t s_posted = 0;
+static volatile uint32_t s_dispatched = 0;
+static volatile uint32_t s_dropped = 0;
+static uint32_t s_max_pending = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief 应用循环上唯一的 esp_event 处理函数: 统计延迟并分发到已注册的处理函数
+ */
+static void dispatch(void *arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+    const app_event_msg_t *msg = (const app_event_msg_t *)event_data;
+    int64_t start = esp_timer_get_time();
+
+    if (id < 0 || id >= APP_EVENT_MAX) {
+        return;
+    }
+
+    supervisor_loop_begin(APP_TASK_EVENT);
+    for (uint8_t i = 0; i < s_handler_count; i++) {
+        if (s_handlers[i].id == (app_event_id_t)id) {
+            s_handlers[i].handler((app_event_id_t)id, &msg->data, s_handlers[i].arg);
+        }
+    }
+    supervisor_loop_end(APP_TASK_EVENT);
+
+    int64_t end = esp_timer_get_time();
+    uint32_t queue_us = (uint32_t)(start - msg->post_us);
+    uint32_t run_us = (uint32_t)(end - start);
+    event_stat_t *st = &s_stats[id];
+
+    portENTER_CRITICAL(&s_lock);
+    s_dispatched++;
+    st->count++;
+    st->total_run_us += run_us;
+    if (queue_us > st->max_queue_us) {
+        st->max_queue_us = queue_us;
+    }
+    if (run_us > st->max_run_us) {
+        st->max_run_us = run_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void system_trampoline(void *arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+    system_entry_t *e = (system_entry_t *)arg;
+    int64_t start = esp_timer_get_time();
+
+    e->handler(e->arg, base, id, event_data);
+
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    portENTER_CRITICAL(&s_lock);
+    e->count++;
+    e->total_us += us;
+    if (us > e->max_us) {
+        e->max_us = us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t app_event_register(app_event_id_t id, app_event_handler_t handler, void *arg)
+{
+    if (id >= APP_EVENT_MAX || handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_handler_count >= MAX_HANDLERS) {
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGE(TAG, "Handler table full");
+        return ESP_ERR_NO_MEM;
+    }
+    s_handlers[s_handler_count] = (handler_entry_t){ .id = id, .handler = handler, .arg = arg };
+    s_handler_count++;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t app_event_post(app_event_id_t id, const void *data, size_t size, uint32_t timeout_ms)
+{
+    app_event_msg_t msg;
+
+    if (s_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (id >= APP_EVENT_MAX || size > sizeof(msg.data) || (size > 0 && data == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    msg.post_us = esp_timer_get_time();
+    if (size > 0) {
+        memcpy(&msg.data, data, size);
+    }
+
+    esp_err_t ret = esp_event_post_to(s_loop, APP_EVENT, id, &msg,
+                                      offsetof(app_event_msg_t, data) + size,
+                                      pdMS_TO_TICKS(timeout_ms));
+    portENTER_CRITICAL(&s_lock);
+    if (ret == ESP_OK) {
+        s_posted++;
+        uint32_t pending = s_posted - s_dispatched;
+        if (pending > s_max_pending) {
+            s_max_pending = pending;
+        }
+    } else {
+        s_dropped++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Dropped event %s: %s", s_event_names[id], esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t app_event_register_system(esp_event_base_t base, int32_t id,
+                                    esp_event_handler_t handler, void *arg)
+{
+    if (s_system_count >= MAX_SYSTEM_HANDLERS) {
+        ESP_LOGE(TAG, "System handler table full");
+        return ESP_ERR_NO_MEM;
+    }
+
+    system_entry_t *e = &s_system[s_system_count];
+    *e = (system_entry_t){ .base = base, .id = id, .handler = handler, .arg = arg };
+
+    esp_err_t ret = esp_event_handler_register(base, id, system_trampoline, e);
+    if (ret == ESP_OK) {
+        s_system_count++;
+    }
+    return ret;
+}
+
+/**
+ * @brief EVT 命令: 应用循环各事件的排队延迟/处理耗时，默认循环上处理函数的耗时
+ */
+static esp_err_t cmd_evt(int argc, char **argv, const diag_out_t *out)
+{
+    diag_printf(out, "app loop: posted %lu, dropped %lu, pending max %lu/%d\r\n",
+                (unsigned long)s_posted, (unsigned long)s_dropped,
+                (unsigned long)s_max_pending, APP_EVENT_QUEUE_LEN);
+    diag_printf(out, "%-12s %6s %9s %9s %9s\r\n", "event", "count", "queue_max", "run_avg", "run_max");
+    for (int i = 0; i < APP_EVENT_MAX; i++) {
+        const event_stat_t *st = &s_stats[i];
+        diag_printf(out, "%-12s %6lu %7luus %7luus %7luus\r\n", s_event_names[i],
+                    (unsigned long)st->count, (unsigned long)st->max_queue_us,
+                    (unsigned long)(st->count ? st->total_run_us / st->count : 0),
+                    (unsigned long)st->max_run_us);
+    }
+
+    diag_printf(out, "default loop handlers:\r\n");
+    for (uint8_t i = 0; i < s_system_count; i++) {
+        const system_entry_t *e = &s_system[i];
+        diag_printf(out, "  %-10s %4ld %6lu avg %5luus max %5luus\r\n", e->base, (long)e->id,
+                    (unsigned long)e->count,
+                    (unsigned long)(e->count ? e->total_us / e->count : 0),
+                    (unsigned long)e->max_us);
+    }
+    return ESP_OK;
+}
+
+static void app_event_task(void *pvParameters)
+{
+    /* 处理函数包含凭据写入 NVS 和任务创建，无重启函数，违规时升级为重启设备 */
+    supervisor_register(APP_TASK_EVENT, 0, APP_EVENT_LOOP_SLO_MS, NULL);
+
+    while (1) {
+        esp_event_loop_run(s_loop, portMAX_DELAY);
+    }
+}
+
+esp_err_t app_event_start(void)
+{
+    /* 不创建内部任务，由任务表中的 APP_TASK_EVENT 运行，优先级和栈统一配置 */
+    esp_event_loop_args_t args = {
+        .queue_size = APP_EVENT_QUEUE_LEN,
+        .task_name = NULL,
+    };
+
+    esp_err_t ret = esp_event_loop_create(&args, &s_loop);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Event loop create failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = esp_event_handler_register_with(s_loop, APP_EVENT, ESP_EVENT_ANY_ID, dispatch, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Dispatcher register failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (app_task_create(APP_TASK_EVENT, app_event_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create app event task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    diag_cmd_register("EVT", "app event loop latency and default loop handler time",
+                      cmd_evt, DIAG_ACCESS_REMOTE);
+    ESP_LOGI(TAG, "App event loop started, queue %d", APP_EVENT_QUEUE_LEN);
+    return ESP_OK;
+}
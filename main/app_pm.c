@@ -0,0 +1,181 @@
+/**
+ * @file app_pm.c
+ * @brief 应用电源管理实现
+ */
+
+#include "app_pm.h"
+#include "diag_cmd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+static const char *TAG = "app_pm";
+
+#if CONFIG_PM_ENABLE
+
+#include "esp_pm.h"
+#include "esp_timer.h"
+
+#define PM_DUMP_BUF_SIZE    1536
+
+typedef struct {
+    const char *name;
+    esp_pm_lock_type_t type;
+} app_pm_lock_def_t;
+
+typedef struct {
+    esp_pm_lock_handle_t handle;
+    uint32_t depth;
+    int64_t since_us;
+    app_pm_lock_stat_t stat;
+} app_pm_lock_state_t;
+
+static const app_pm_lock_def_t s_lock_defs[APP_PM_LOCK_MAX] = {
+    [APP_PM_LOCK_SERVO] = { "servo", ESP_PM_APB_FREQ_MAX },
+    [APP_PM_LOCK_CMD]   = { "cmd",   ESP_PM_CPU_FREQ_MAX },
+    [APP_PM_LOCK_BULK]  = { "bulk",  ESP_PM_CPU_FREQ_MAX },
+    [APP_PM_LOCK_OTA]   = { "ota",   ESP_PM_CPU_FREQ_MAX },
+};
+
+static app_pm_lock_state_t s_locks[APP_PM_LOCK_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void app_pm_acquire(app_pm_lock_id_t id)
+{
+    if (id >= APP_PM_LOCK_MAX || s_locks[id].handle == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_locks[id].depth++ == 0) {
+        s_locks[id].since_us = esp_timer_get_time();
+        s_locks[id].stat.count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    esp_pm_lock_acquire(s_locks[id].handle);
+}
+
+void app_pm_release(app_pm_lock_id_t id)
+{
+    if (id >= APP_PM_LOCK_MAX || s_locks[id].handle == NULL) {
+        return;
+    }
+
+    esp_pm_lock_release(s_locks[id].handle);
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_locks[id].depth > 0 && --s_locks[id].depth == 0) {
+        s_locks[id].stat.held_us += esp_timer_get_time() - s_locks[id].since_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t app_pm_get_lock_stat(app_pm_lock_id_t id, app_pm_lock_stat_t *out)
+{
+    if (id >= APP_PM_LOCK_MAX || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *out = s_locks[id].stat;
+    if (s_locks[id].depth > 0) {
+        out->held_us += esp_timer_get_time() - s_locks[id].since_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief PM 命令: 应用锁统计与各电源状态驻留时间
+ */
+static esp_err_t cmd_pm(int argc, char **argv, const diag_out_t *out)
+{
+    app_pm_lock_stat_t stat;
+
+    diag_printf(out, "%-6s %8s %10s\r\n", "lock", "count", "held_ms");
+    for (int i = 0; i < APP_PM_LOCK_MAX; i++) {
+        app_pm_get_lock_stat((app_pm_lock_id_t)i, &stat);
+        diag_printf(out, "%-6s %8lu %10llu\r\n", s_lock_defs[i].name,
+                    (unsigned long)stat.count, stat.held_us / 1000);
+    }
+
+#if CONFIG_PM_PROFILING
+    /* esp_pm_dump_locks 的 Mode stats 给出各电源状态的驻留时间和占比 */
+    char *buf = malloc(PM_DUMP_BUF_SIZE);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    FILE *f = fmemopen(buf, PM_DUMP_BUF_SIZE, "w");
+    if (f != NULL) {
+        esp_pm_dump_locks(f);
+        long len = ftell(f);
+        fclose(f);
+        if (len > 0) {
+            out->fn(buf, (size_t)len, out->ctx);
+        }
+    }
+    free(buf);
+#else
+    diag_printf(out, "enable CONFIG_PM_PROFILING for residency\r\n");
+#endif
+    return ESP_OK;
+}
+
+esp_err_t app_pm_init(void)
+{
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_APP_PM_MAX_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_APP_PM_MIN_FREQ_MHZ,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true,
+#endif
+    };
+
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_pm_configure failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    for (int i = 0; i < APP_PM_LOCK_MAX; i++) {
+        ret = esp_pm_lock_create(s_lock_defs[i].type, 0, s_lock_defs[i].name,
+                                 &s_locks[i].handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create PM lock %s", s_lock_defs[i].name);
+            return ret;
+        }
+    }
+
+    diag_cmd_register("PM", "PM lock stats and power state residency", cmd_pm, DIAG_ACCESS_REMOTE);
+
+    ESP_LOGI(TAG, "PM configured: %d-%d MHz, light sleep %s",
+             CONFIG_APP_PM_MIN_FREQ_MHZ, CONFIG_APP_PM_MAX_FREQ_MHZ,
+             pm_config.light_sleep_enable ? "on" : "off");
+    return ESP_OK;
+}
+
+#else /* !CONFIG_PM_ENABLE */
+
+esp_err_t app_pm_init(void)
+{
+    ESP_LOGI(TAG, "Power management disabled");
+    return ESP_OK;
+}
+
+void app_pm_acquire(app_pm_lock_id_t id)
+{
+}
+
+void app_pm_release(app_pm_lock_id_t id)
+{
+}
+
+esp_err_t app_pm_get_lock_stat(app_pm_lock_id_t id, app_pm_lock_stat_t *out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_PM_ENABLE */
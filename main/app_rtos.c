@@ -0,0 +1,191 @@
+/**
+ * @file app_rtos.c
+ * @brief 应用任务创建与登记
+ */
+
+#include "app_rtos.h"
+#include "esp_log.h"
+
+static const char *TAG = "app_rtos";
+
+/* 任务删除回调使用的 TLS 槽位，槽位 0 保留给 pthread */
+#define APP_TLS_INDEX           1
+#define APP_TASK_REUSE_WAIT_MS  100
+
+_Static_assert(CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS > APP_TLS_INDEX,
+               "APP_TLS_INDEX requires more FreeRTOS TLS pointers");
+
+typedef struct {
+    const char *name;
+    uint32_t stack_size;
+    UBaseType_t priority;
+#if CONFIG_APP_STATIC_ALLOCATION
+    StackType_t *stack;         /* HEAP 任务为 NULL，从堆创建 */
+    StaticTask_t *tcb;
+#endif
+} app_task_def_t;
+
+typedef struct {
+    TaskHandle_t handle;
+    uint16_t gen;       /* 实例代数，区分同一 ID 的新旧实例 */
+    bool busy;          /* 实例存在 (含已删除但尚未回收) */
+} app_task_slot_t;
+
+/* TLS 值编码: 低 16 位为任务 ID，高 16 位为实例代数 */
+#define TLS_VALUE(id, gen)  ((void *)(uintptr_t)(((uint32_t)(gen) << 16) | (id)))
+#define TLS_ID(v)           ((app_task_id_t)((uintptr_t)(v) & 0xFFFF))
+#define TLS_GEN(v)          ((uint16_t)((uintptr_t)(v) >> 16))
+
+#if CONFIG_APP_STATIC_ALLOCATION
+/* 按分配列展开: 只为 STATIC 任务保留静态栈和 TCB */
+#define APP_TASK_STORAGE_STATIC(id, stack) \
+    static StackType_t s_stack_##id[stack]; \
+    static StaticTask_t s_tcb_##id;
+#define APP_TASK_STORAGE_HEAP(id, stack)
+#define APP_TASK_BUFFERS_STATIC(id)     s_stack_##id, &s_tcb_##id
+#define APP_TASK_BUFFERS_HEAP(id)       NULL, NULL
+
+#define APP_TASK_STORAGE(id, name, stack, prio, alloc) APP_TASK_STORAGE_##alloc(id, stack)
+APP_TASK_TABLE(APP_TASK_STORAGE)
+#undef APP_TASK_STORAGE
+
+#define APP_TASK_DEF(id, name, stack, prio, alloc) \
+    [id] = { name, stack, prio, APP_TASK_BUFFERS_##alloc(id) },
+#else
+#define APP_TASK_DEF(id, name, stack, prio, alloc) \
+    [id] = { name, stack, prio },
+#endif
+
+static const app_task_def_t s_task_defs[APP_TASK_MAX] = {
+    APP_TASK_TABLE(APP_TASK_DEF)
+};
+#undef APP_TASK_DEF
+
+static app_task_slot_t s_task_slots[APP_TASK_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief 任务删除回调
+ *
+ * 由 FreeRTOS 在回收 TCB 时调用 (自删除的任务在 idle 任务中回收)，
+ * 此后静态栈才能被下一个实例复用。
+ */
+static void task_deleted_cb(int index, void *pvTLS)
+{
+    app_task_id_t id = TLS_ID(pvTLS);
+
+    if (id >= APP_TASK_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    /* 旧实例晚于新实例回收时不影响新实例的登记 */
+    if (s_task_slots[id].gen == TLS_GEN(pvTLS)) {
+        s_task_slots[id].handle = NULL;
+        s_task_slots[id].busy = false;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static bool claim_slot(app_task_id_t id)
+{
+    bool claimed = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (!s_task_slots[id].busy) {
+        s_task_slots[id].busy = true;
+        claimed = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return claimed;
+}
+
+BaseType_t app_task_create(app_task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *out)
+{
+    if (id >= APP_TASK_MAX || fn == NULL) {
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+
+    const app_task_def_t *def = &s_task_defs[id];
+    TaskHandle_t handle = NULL;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+    const bool use_static = def->stack != NULL;
+#else
+    const bool use_static = false;
+#endif
+
+    if (use_static) {
+        /* 等待上一实例释放静态栈 */
+        int waited_ms = 0;
+        while (!claim_slot(id)) {
+            if (waited_ms >= APP_TASK_REUSE_WAIT_MS) {
+                ESP_LOGE(TAG, "Task %s still in use, cannot reuse static stack", def->name);
+                return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+            }
+            vTaskDelay(1);
+            waited_ms += portTICK_PERIOD_MS;
+        }
+    } else {
+        /* 堆分配时允许新实例与尚未回收的旧实例并存，登记表只跟踪最新实例 */
+        claim_slot(id);
+    }
+
+    /* 挂起调度器，确保新任务运行 (并可能自删除) 之前已挂上删除回调 */
+    vTaskSuspendAll();
+#if CONFIG_APP_STATIC_ALLOCATION
+    if (use_static) {
+        handle = xTaskCreateStatic(fn, def->name, def->stack_size, arg, def->priority,
+                                   def->stack, def->tcb);
+    }
+#endif
+    if (!use_static &&
+        xTaskCreate(fn, def->name, def->stack_size, arg, def->priority, &handle) != pdPASS) {
+        handle = NULL;
+    }
+    if (handle != NULL) {
+        portENTER_CRITICAL(&s_lock);
+        uint16_t gen = ++s_task_slots[id].gen;
+        s_task_slots[id].handle = handle;
+        s_task_slots[id].busy = true;
+        portEXIT_CRITICAL(&s_lock);
+        vTaskSetThreadLocalStoragePointerAndDelCallback(handle, APP_TLS_INDEX,
+                                                        TLS_VALUE(id, gen), task_deleted_cb);
+    }
+    xTaskResumeAll();
+
+    if (handle == NULL) {
+        portENTER_CRITICAL(&s_lock);
+        s_task_slots[id].busy = false;
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGE(TAG, "Failed to create task %s", def->name);
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+
+    if (out != NULL) {
+        *out = handle;
+    }
+    return pdPASS;
+}
+
+const char *app_task_name(app_task_id_t id)
+{
+    return (id < APP_TASK_MAX) ? s_task_defs[id].name : "?";
+}
+
+uint32_t app_task_stack_size(app_task_id_t id)
+{
+    return (id < APP_TASK_MAX) ? s_task_defs[id].stack_size : 0;
+}
+
+TaskHandle_t app_task_handle(app_task_id_t id)
+{
+    TaskHandle_t handle = NULL;
+
+    if (id < APP_TASK_MAX) {
+        portENTER_CRITICAL(&s_lock);
+        handle = s_task_slots[id].handle;
+        portEXIT_CRITICAL(&s_lock);
+    }
+    return handle;
+}
@@ -1,4 +1,8 @@
 #include "board.h"
+#include "app_pm.h"
+#include "dlog.h"
+#include "trace.h"
+#include "fault_inject.h"
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 #include "esp_log.h"
@@ -51,7 +55,12 @@ esp_err_t configure_servo(void)
         .timer_num        = LEDC_TIMER,
         .duty_resolution  = LEDC_DUTY_RES,
         .freq_hz          = SERVO_FREQ_HZ,
+#if CONFIG_PM_ENABLE
+        // RC_FAST 在 Light-sleep 中保持运行，舵机保持力矩不中断
+        .clk_cfg          = LEDC_USE_RC_FAST_CLK
+#else
         .clk_cfg          = LEDC_AUTO_CLK
+#endif
     };
     esp_err_t ret = ledc_timer_config(&timer_conf);
     if (ret != ESP_OK) {
@@ -67,7 +76,10 @@ esp_err_t configure_servo(void)
         .intr_type      = LEDC_INTR_DISABLE,
         .gpio_num       = SERVO_GPIO,
         .duty           = 0,
-        .hpoint         = 0
+        .hpoint         = 0,
+#if CONFIG_PM_ENABLE
+        .sleep_mode     = LEDC_SLEEP_MODE_KEEP_ALIVE,
+#endif
     };
     ret = ledc_channel_config(&channel_conf);
     if (ret != ESP_OK) {
@@ -83,10 +95,7 @@ esp_err_t configure_servo(void)
     return ESP_OK;
 }
 
-/**
- * @brief 直接设置舵机角度（无平滑过渡）
- */
-static esp_err_t servo_set_angle_direct(uint8_t angle)
+uint32_t servo_angle_to_duty(uint8_t angle)
 {
     if (angle > SERVO_MAX_ANGLE) {
         angle = SERVO_MAX_ANGLE;
@@ -97,12 +106,28 @@ static esp_err_t servo_set_angle_direct(uint8_t angle)
         (angle * (SERVO_MAX_PULSEWIDTH_US - SERVO_MIN_PULSEWIDTH_US)) / SERVO_MAX_ANGLE;
 
     // 将脉宽转换为LEDC duty值
-    uint32_t duty = (pulse_width_us * LEDC_DUTY_MAX) / 20000;
+    return (pulse_width_us * LEDC_DUTY_MAX) / 20000;
+}
+
+/**
+ * @brief 直接设置舵机角度（无平滑过渡）
+ */
+static esp_err_t servo_set_angle_direct(uint8_t angle)
+{
+    uint32_t duty = servo_angle_to_duty(angle);
+
+    if (FAULT_INJECT(FAULT_SERVO_LEDC)) {
+        return ESP_FAIL;
+    }
 
     esp_err_t ret = ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, duty);
     if (ret != ESP_OK) return ret;
 
-    return ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+    ret = ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+    if (ret == ESP_OK) {
+        FAULT_RECOVERED(FAULT_SERVO_LEDC);
+    }
+    return ret;
 }
 
 esp_err_t servo_set_angle(uint8_t target_angle)
@@ -113,7 +138,11 @@ esp_err_t servo_set_angle(uint8_t target_angle)
         target_angle = SERVO_MAX_ANGLE;
     }
 
-    ESP_LOGI(TAG, "Servo moving: %d -> %d degrees", s_current_angle, target_angle);
+    DLOGI(TAG, "Servo moving: %d -> %d degrees", s_current_angle, target_angle);
+
+    // 运动期间保持 APB 最高频率，禁止 Light-sleep 打断步进节拍
+    app_pm_acquire(APP_PM_LOCK_SERVO);
+    TRACE(TRACE_SRC_SERVO, TRACE_EVT_SERVO_MOVE, 0, s_current_angle, target_angle);
 
     // 平滑过渡到目标角度
     while (s_current_angle != target_angle) {
@@ -138,12 +167,22 @@ esp_err_t servo_set_angle(uint8_t target_angle)
         esp_err_t ret = servo_set_angle_direct(s_current_angle);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to set servo angle");
+            TRACE(TRACE_SRC_SERVO, TRACE_EVT_SERVO_DONE, 0, s_current_angle, ret);
+            app_pm_release(APP_PM_LOCK_SERVO);
             return ret;
         }
 
         vTaskDelay(pdMS_TO_TICKS(SERVO_STEP_DELAY_MS));
     }
 
-    ESP_LOGI(TAG, "Servo reached %d degrees", s_current_angle);
+    TRACE(TRACE_SRC_SERVO, TRACE_EVT_SERVO_DONE, 0, s_current_angle, ESP_OK);
+    app_pm_release(APP_PM_LOCK_SERVO);
+
+    DLOGI(TAG, "Servo reached %d degrees", s_current_angle);
     return ESP_OK;
+}
+
+uint8_t servo_get_angle(void)
+{
+    return s_current_angle;
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+/**
+ * @file boot_trace.c
+ * @brief 启动过程分析实现
+ */
+
+#include "boot_trace.h"
+
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "boot_trace";
+
+typedef struct {
+    int64_t start_us;
+    int64_t end_us;
+    esp_err_t err;
+} boot_stage_rec_t;
+
+static const char *const s_stage_names[BOOT_STAGE_MAX] = {
+    [BOOT_STAGE_NVS]    = "nvs",
+    [BOOT_STAGE_LED]    = "led",
+    [BOOT_STAGE_KEY]    = "key",
+    [BOOT_STAGE_SERVO]  = "servo",
+    [BOOT_STAGE_QUEUES] = "queues",
+    [BOOT_STAGE_TASKS]  = "tasks",
+    [BOOT_STAGE_WIFI]   = "wifi",
+    [BOOT_STAGE_BLE]    = "ble",
+    [BOOT_STAGE_MQTT]   = "mqtt",
+};
+
+static const char *const s_mark_names[BOOT_MARK_MAX] = {
+    [BOOT_MARK_APP_MAIN]     = "app_main",
+    [BOOT_MARK_UNLOCK_READY] = "unlock_ready",
+    [BOOT_MARK_BLE_ADV]      = "ble_adv",
+    [BOOT_MARK_WIFI_UP]      = "wifi_up",
+    [BOOT_MARK_MQTT_UP]      = "mqtt_up",
+};
+
+/* 各阶段由不同任务写入各自的槽位，无需加锁 */
+static boot_stage_rec_t s_stages[BOOT_STAGE_MAX];
+static int64_t s_marks[BOOT_MARK_MAX];
+
+void boot_trace_begin(boot_stage_t stage)
+{
+    if (stage < BOOT_STAGE_MAX) {
+        s_stages[stage].start_us = esp_timer_get_time();
+    }
+}
+
+void boot_trace_end(boot_stage_t stage, esp_err_t err)
+{
+    if (stage < BOOT_STAGE_MAX) {
+        s_stages[stage].end_us = esp_timer_get_time();
+        s_stages[stage].err = err;
+    }
+}
+
+void boot_trace_mark(boot_mark_t mark)
+{
+    if (mark < BOOT_MARK_MAX && s_marks[mark] == 0) {
+        s_marks[mark] = esp_timer_get_time();
+    }
+}
+
+void boot_trace_dump(void)
+{
+    ESP_LOGI(TAG, "Boot stages (us since reset):");
+    for (int i = 0; i < BOOT_STAGE_MAX; i++) {
+        const boot_stage_rec_t *rec = &s_stages[i];
+        if (rec->end_us == 0) {
+            ESP_LOGI(TAG, "  %-8s not run", s_stage_names[i]);
+            continue;
+        }
+        ESP_LOGI(TAG, "  %-8s %8lld -> %8lld (%6lld us)%s", s_stage_names[i],
+                 rec->start_us, rec->end_us, rec->end_us - rec->start_us,
+                 rec->err == ESP_OK ? "" : " FAILED");
+    }
+    for (int i = 0; i < BOOT_MARK_MAX; i++) {
+        if (s_marks[i] != 0) {
+            ESP_LOGI(TAG, "  @%-12s %8lld", s_mark_names[i], s_marks[i]);
+        }
+    }
+}
+
+int boot_trace_to_json(char *buf, size_t len)
+{
+    size_t pos = 0;
+    int n;
+
+#define APPEND(...) do { \
+        n = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n < 0 || (size_t)n >= len - pos) return -1; \
+        pos += n; \
+    } while (0)
+
+    APPEND("{\"stages\":{");
+    for (int i = 0; i < BOOT_STAGE_MAX; i++) {
+        const boot_stage_rec_t *rec = &s_stages[i];
+        APPEND("%s\"%s\":[%lld,%lld,%d]", i ? "," : "", s_stage_names[i],
+               rec->start_us, rec->end_us, rec->err);
+    }
+    APPEND("},\"marks\":{");
+    for (int i = 0; i < BOOT_MARK_MAX; i++) {
+        APPEND("%s\"%s\":%lld", i ? "," : "", s_mark_names[i], s_marks[i]);
+    }
+    APPEND("}}");
+
+#undef APPEND
+    return (int)pos;
+}
@@ -0,0 +1,457 @@
+/**
+ * @file bt_l2cap.c
+ * @brief BLE L2CAP CoC 批量传输服务实现
+ */
+
+#include "bt_l2cap.h"
+#include "bt_spp.h"
+#include "app_rtos.h"
+#include "app_pm.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+
+#include "host/ble_hs.h"
+#include "host/ble_l2cap.h"
+
+static const char *TAG = "BT_L2CAP";
+
+#if CONFIG_BT_L2CAP_BULK_ENABLE
+
+#define L2CAP_COC_MTU           CONFIG_BT_L2CAP_BULK_MTU
+#define L2CAP_COC_BUF_COUNT     4
+
+/* 发送任务通知位 */
+#define NOTIFY_START      BIT0
+#define NOTIFY_UNSTALLED  BIT1
+#define NOTIFY_ABORT      BIT2
+
+/* 批量传输期间使用的快速连接参数 */
+static const struct ble_gap_upd_params s_bulk_conn_params = {
+    .itvl_min = 6,    /* 7.5ms (6 * 1.25ms) */
+    .itvl_max = 12,   /* 15ms (12 * 1.25ms) */
+    .latency = 0,
+    .supervision_timeout = BT_CONN_SUPERVISION_TIMEOUT,
+    .min_ce_len = 0,
+    .max_ce_len = 0,
+};
+
+/* 传输结束后恢复的常规连接参数 */
+static const struct ble_gap_upd_params s_idle_conn_params = {
+    .itvl_min = BT_CONN_ITVL_MIN,
+    .itvl_max = BT_CONN_ITVL_MAX,
+    .latency = 0,
+    .supervision_timeout = BT_CONN_SUPERVISION_TIMEOUT,
+    .min_ce_len = 0,
+    .max_ce_len = 0,
+};
+
+/* SDU 缓冲池 */
+static os_membuf_t s_coc_mem[OS_MEMPOOL_SIZE(L2CAP_COC_BUF_COUNT, L2CAP_COC_MTU)];
+static struct os_mempool s_coc_mempool;
+static struct os_mbuf_pool s_coc_mbuf_pool;
+
+/* 信道状态 */
+typedef struct {
+    struct ble_l2cap_chan *chan;
+    uint16_t conn_handle;
+    uint16_t peer_mtu;
+    /* 待处理请求 */
+    uint8_t req_stream;
+    uint32_t req_offset;
+    uint32_t req_max_len;
+} bt_l2cap_state_t;
+
+static bt_l2cap_state_t s_state = {0};
+static bt_l2cap_source_read_t s_sources[BT_L2CAP_STREAM_MAX] = {0};
+static bt_l2cap_stats_t s_last_stats = {0};
+static bool s_has_stats = false;
+static TaskHandle_t s_tx_task_handle = NULL;
+static uint8_t s_frame_buf[L2CAP_COC_MTU];
+
+/**
+ * @brief 吞吐测试数据源: 按偏移生成递增图案
+ */
+static int test_source_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (offset >= CONFIG_BT_L2CAP_BULK_TEST_SIZE) {
+        return 0;
+    }
+    if (len > CONFIG_BT_L2CAP_BULK_TEST_SIZE - offset) {
+        len = CONFIG_BT_L2CAP_BULK_TEST_SIZE - offset;
+    }
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(offset + i);
+    }
+    return (int)len;
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void fill_header(uint8_t *p, uint8_t type, uint8_t stream, uint16_t seq, uint16_t len)
+{
+    p[0] = type;
+    p[1] = stream;
+    put_le16(&p[2], seq);
+    put_le16(&p[4], len);
+}
+
+/**
+ * @brief 发送一帧，信用耗尽时等待 TX_UNSTALLED
+ *
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE信道断开或被中止
+ */
+static esp_err_t send_frame(const uint8_t *frame, uint16_t len, uint32_t *stalls)
+{
+    struct os_mbuf *om = os_mbuf_get_pkthdr(&s_coc_mbuf_pool, 0);
+    if (om == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (os_mbuf_append(om, frame, len) != 0) {
+        os_mbuf_free_chain(om);
+        return ESP_ERR_NO_MEM;
+    }
+
+    while (1) {
+        if (s_state.chan == NULL) {
+            os_mbuf_free_chain(om);
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        int rc = ble_l2cap_send(s_state.chan, om);
+        if (rc == 0) {
+            return ESP_OK;
+        }
+
+        uint32_t bits = 0;
+        if (rc == BLE_HS_ESTALLED) {
+            /* SDU 已被协议栈接管，等待对端补充信用后继续 */
+            (*stalls)++;
+            xTaskNotifyWait(0, NOTIFY_UNSTALLED, &bits, pdMS_TO_TICKS(5000));
+            if (bits & NOTIFY_ABORT) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            return (bits & NOTIFY_UNSTALLED) ? ESP_OK : ESP_ERR_TIMEOUT;
+        }
+
+        if (rc == BLE_HS_EBUSY) {
+            /* 上一个 SDU 仍在发送，mbuf 未被接管，稍后重试 */
+            (*stalls)++;
+            xTaskNotifyWait(0, NOTIFY_UNSTALLED, &bits, pdMS_TO_TICKS(100));
+            if (bits & NOTIFY_ABORT) {
+                os_mbuf_free_chain(om);
+                return ESP_ERR_INVALID_STATE;
+            }
+            continue;
+        }
+
+        ESP_LOGE(TAG, "L2CAP send failed: rc=%d", rc);
+        os_mbuf_free_chain(om);
+        return ESP_FAIL;
+    }
+}
+
+static void send_error(uint8_t stream, esp_err_t err)
+{
+    uint8_t frame[BT_L2CAP_FRAME_HDR_LEN + 4];
+    uint32_t stalls = 0;
+
+    fill_header(frame, BT_L2CAP_FRAME_ERR, stream, 0, 4);
+    put_le32(&frame[BT_L2CAP_FRAME_HDR_LEN], (uint32_t)err);
+    send_frame(frame, sizeof(frame), &stalls);
+}
+
+/**
+ * @brief 执行一次数据流传输
+ */
+static void run_transfer(uint8_t stream, uint32_t offset, uint32_t max_len)
+{
+    bt_l2cap_source_read_t read = (stream < BT_L2CAP_STREAM_MAX) ? s_sources[stream] : NULL;
+    if (read == NULL) {
+        ESP_LOGW(TAG, "No source for stream %d", stream);
+        send_error(stream, ESP_ERR_NOT_FOUND);
+        return;
+    }
+
+    uint16_t frame_len = s_state.peer_mtu < L2CAP_COC_MTU ? s_state.peer_mtu : L2CAP_COC_MTU;
+    uint16_t chunk_max = frame_len - BT_L2CAP_FRAME_HDR_LEN;
+    bt_l2cap_stats_t stats = { .stream = stream };
+    uint32_t crc = 0;
+    uint16_t seq = 0;
+    esp_err_t err = ESP_OK;
+
+    ESP_LOGI(TAG, "Transfer start: stream=%d offset=%lu frame=%d",
+             stream, (unsigned long)offset, frame_len);
+
+    app_pm_acquire(APP_PM_LOCK_BULK);
+    ble_gap_update_params(s_state.conn_handle, &s_bulk_conn_params);
+    int64_t start_us = esp_timer_get_time();
+
+    while (max_len == 0 || stats.bytes < max_len) {
+        uint16_t want = chunk_max;
+        if (max_len != 0 && max_len - stats.bytes < want) {
+            want = (uint16_t)(max_len - stats.bytes);
+        }
+
+        int n = read(offset + stats.bytes, &s_frame_buf[BT_L2CAP_FRAME_HDR_LEN], want);
+        if (n < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        fill_header(s_frame_buf, BT_L2CAP_FRAME_DATA, stream, seq++, (uint16_t)n);
+        crc = esp_rom_crc32_le(crc, &s_frame_buf[BT_L2CAP_FRAME_HDR_LEN], n);
+
+        err = send_frame(s_frame_buf, BT_L2CAP_FRAME_HDR_LEN + n, &stats.stalls);
+        if (err != ESP_OK) {
+            break;
+        }
+        stats.bytes += n;
+        stats.frames++;
+    }
+
+    stats.duration_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    if (stats.duration_ms == 0) {
+        stats.duration_ms = 1;
+    }
+    stats.kbps = (uint32_t)(((uint64_t)stats.bytes * 1000) / ((uint64_t)stats.duration_ms * 1024));
+
+    if (err == ESP_OK) {
+        uint8_t frame[BT_L2CAP_FRAME_HDR_LEN + 12];
+        fill_header(frame, BT_L2CAP_FRAME_END, stream, seq, 12);
+        put_le32(&frame[BT_L2CAP_FRAME_HDR_LEN], stats.bytes);
+        put_le32(&frame[BT_L2CAP_FRAME_HDR_LEN + 4], crc);
+        put_le32(&frame[BT_L2CAP_FRAME_HDR_LEN + 8], stats.duration_ms);
+        err = send_frame(frame, sizeof(frame), &stats.stalls);
+    } else if (s_state.chan != NULL) {
+        send_error(stream, err);
+    }
+
+    if (s_state.chan != NULL) {
+        ble_gap_update_params(s_state.conn_handle, &s_idle_conn_params);
+    }
+    app_pm_release(APP_PM_LOCK_BULK);
+
+    s_last_stats = stats;
+    s_has_stats = true;
+
+    ESP_LOGI(TAG, "Transfer %s: %lu bytes in %lu ms (%lu KB/s, %lu stalls)",
+             err == ESP_OK ? "done" : "failed",
+             (unsigned long)stats.bytes, (unsigned long)stats.duration_ms,
+             (unsigned long)stats.kbps, (unsigned long)stats.stalls);
+}
+
+static void l2cap_tx_task(void *param)
+{
+    uint32_t bits;
+
+    while (1) {
+        xTaskNotifyWait(0, NOTIFY_START | NOTIFY_ABORT, &bits, portMAX_DELAY);
+        if ((bits & NOTIFY_START) && !(bits & NOTIFY_ABORT) && s_state.chan != NULL) {
+            run_transfer(s_state.req_stream, s_state.req_offset, s_state.req_max_len);
+        }
+    }
+}
+
+/**
+ * @brief 处理客户端发来的控制帧 (运行在 NimBLE Host 任务)
+ */
+static void handle_rx_frame(const uint8_t *data, uint16_t len)
+{
+    if (len < BT_L2CAP_FRAME_HDR_LEN) {
+        return;
+    }
+
+    switch (data[0]) {
+        case BT_L2CAP_FRAME_REQ:
+            if (len < BT_L2CAP_FRAME_HDR_LEN + 8) {
+                ESP_LOGW(TAG, "Short REQ frame, len=%d", len);
+                return;
+            }
+            s_state.req_stream = data[1];
+            s_state.req_offset = get_le32(&data[BT_L2CAP_FRAME_HDR_LEN]);
+            s_state.req_max_len = get_le32(&data[BT_L2CAP_FRAME_HDR_LEN + 4]);
+            xTaskNotify(s_tx_task_handle, NOTIFY_START, eSetBits);
+            break;
+
+        case BT_L2CAP_FRAME_ABORT:
+            xTaskNotify(s_tx_task_handle, NOTIFY_ABORT, eSetBits);
+            break;
+
+        default:
+            ESP_LOGW(TAG, "Unknown frame type 0x%02x", data[0]);
+            break;
+    }
+}
+
+static int l2cap_event(struct ble_l2cap_event *event, void *arg)
+{
+    struct ble_l2cap_chan_info info;
+    struct os_mbuf *sdu_rx;
+
+    switch (event->type) {
+        case BLE_L2CAP_EVENT_COC_CONNECTED:
+            if (event->connect.status != 0) {
+                ESP_LOGE(TAG, "CoC connect failed, status=%d", event->connect.status);
+                return 0;
+            }
+            s_state.chan = event->connect.chan;
+            s_state.conn_handle = event->connect.conn_handle;
+            s_state.peer_mtu = L2CAP_COC_MTU;
+            if (ble_l2cap_get_chan_info(event->connect.chan, &info) == 0) {
+                s_state.peer_mtu = info.peer_coc_mtu;
+            }
+            /* 启用数据长度扩展，减少空口分片 */
+            ble_gap_set_data_len(event->connect.conn_handle, 251, 2120);
+            ESP_LOGI(TAG, "CoC connected, peer MTU=%d", s_state.peer_mtu);
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+            ESP_LOGI(TAG, "CoC disconnected");
+            s_state.chan = NULL;
+            xTaskNotify(s_tx_task_handle, NOTIFY_ABORT, eSetBits);
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_ACCEPT:
+            sdu_rx = os_mbuf_get_pkthdr(&s_coc_mbuf_pool, 0);
+            if (sdu_rx == NULL) {
+                return BLE_HS_ENOMEM;
+            }
+            return ble_l2cap_recv_ready(event->accept.chan, sdu_rx);
+
+        case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+            if (event->receive.sdu_rx != NULL) {
+                uint8_t buf[BT_L2CAP_FRAME_HDR_LEN + 8];
+                uint16_t len = OS_MBUF_PKTLEN(event->receive.sdu_rx);
+                if (len > sizeof(buf)) {
+                    len = sizeof(buf);
+                }
+                if (os_mbuf_copydata(event->receive.sdu_rx, 0, len, buf) == 0) {
+                    handle_rx_frame(buf, len);
+                }
+                os_mbuf_free_chain(event->receive.sdu_rx);
+            }
+            /* 为下一个 SDU 准备接收缓冲 */
+            sdu_rx = os_mbuf_get_pkthdr(&s_coc_mbuf_pool, 0);
+            if (sdu_rx != NULL) {
+                ble_l2cap_recv_ready(event->receive.chan, sdu_rx);
+            }
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+            xTaskNotify(s_tx_task_handle, NOTIFY_UNSTALLED, eSetBits);
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+esp_err_t bt_l2cap_init(void)
+{
+    int rc = os_mempool_init(&s_coc_mempool, L2CAP_COC_BUF_COUNT, L2CAP_COC_MTU,
+                             s_coc_mem, "coc_sdu_pool");
+    if (rc != 0) {
+        ESP_LOGE(TAG, "SDU mempool init failed: rc=%d", rc);
+        return ESP_FAIL;
+    }
+
+    rc = os_mbuf_pool_init(&s_coc_mbuf_pool, &s_coc_mempool, L2CAP_COC_MTU, L2CAP_COC_BUF_COUNT);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "SDU mbuf pool init failed: rc=%d", rc);
+        return ESP_FAIL;
+    }
+
+    if (app_task_create(APP_TASK_L2CAP_TX, l2cap_tx_task, NULL, &s_tx_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create L2CAP TX task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    rc = ble_l2cap_create_server(CONFIG_BT_L2CAP_BULK_PSM, L2CAP_COC_MTU, l2cap_event, NULL);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Create L2CAP server failed: rc=%d", rc);
+        return ESP_FAIL;
+    }
+
+    s_sources[BT_L2CAP_STREAM_TEST] = test_source_read;
+
+    ESP_LOGI(TAG, "L2CAP CoC server on PSM 0x%04x, MTU=%d", CONFIG_BT_L2CAP_BULK_PSM, L2CAP_COC_MTU);
+    return ESP_OK;
+}
+
+esp_err_t bt_l2cap_register_source(bt_l2cap_stream_t stream, bt_l2cap_source_read_t read)
+{
+    if (stream >= BT_L2CAP_STREAM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_sources[stream] = read;
+    return ESP_OK;
+}
+
+bool bt_l2cap_is_connected(void)
+{
+    return s_state.chan != NULL;
+}
+
+esp_err_t bt_l2cap_get_last_stats(bt_l2cap_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_has_stats) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *stats = s_last_stats;
+    return ESP_OK;
+}
+
+#else /* !CONFIG_BT_L2CAP_BULK_ENABLE */
+
+esp_err_t bt_l2cap_init(void)
+{
+    ESP_LOGI(TAG, "L2CAP bulk transfer disabled");
+    return ESP_OK;
+}
+
+esp_err_t bt_l2cap_register_source(bt_l2cap_stream_t stream, bt_l2cap_source_read_t read)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool bt_l2cap_is_connected(void)
+{
+    return false;
+}
+
+esp_err_t bt_l2cap_get_last_stats(bt_l2cap_stats_t *stats)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_BT_L2CAP_BULK_ENABLE */
@@ -4,7 +4,13 @@
  */
 
 #include "bt_spp.h"
+#include "bt_l2cap.h"
 #include "msg_queue.h"
+#include "boot_trace.h"
+#include "diag_cmd.h"
+#include "dlog.h"
+#include "trace.h"
+#include "fault_inject.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -13,7 +19,6 @@
 #include "freertos/task.h"
 
 #include "esp_log.h"
-#include "nvs_flash.h"
 
 /* NimBLE headers for ESP-IDF 5.x */
 #include "nimble/nimble_port.h"
@@ -46,23 +51,63 @@ typedef struct {
     bool notify_enabled;
 } bt_ble_state_t;
 
-/* 指令缓冲区 */
-typedef struct {
-    char buffer[BT_CMD_MAX_LEN];
-    uint8_t len;
-} bt_cmd_buffer_t;
-
 static bt_ble_state_t s_ble_state = {0};
 static bt_cmd_buffer_t s_cmd_buffer = {0};
 static uint8_t own_addr_type;
 
 /* 前向声明 */
 static void handle_open_command(void);
+static void handle_diag_line(void);
 static int gatt_svr_chr_access(uint16_t conn_handle, uint16_t attr_handle,
                                 struct ble_gatt_access_ctxt *ctxt, void *arg);
 static void ble_advertise(void);
 static int ble_gap_event(struct ble_gap_event *event, void *arg);
 
+bt_cmd_t bt_cmd_feed(bt_cmd_buffer_t *cmd, char c)
+{
+    /* 换行结束一行: 整行为 OPEN 才是开门指令，其余按诊断命令处理 */
+    if (c == '\r' || c == '\n') {
+        if (cmd->overflow) {
+            bt_cmd_reset(cmd);
+            return BT_CMD_NONE;
+        }
+        if (cmd->len == 0) {
+            return BT_CMD_NONE;
+        }
+        return strcmp(cmd->buffer, BT_CMD_OPEN_DOOR) == 0 ? BT_CMD_OPEN : BT_CMD_LINE;
+    }
+    
+    /* 超长行整行丢弃，不能让它的结尾被当成一行新指令 */
+    if (cmd->overflow) {
+        return BT_CMD_NONE;
+    }
+    if (cmd->len >= BT_CMD_MAX_LEN - 1) {
+        ESP_LOGW(TAG, "Line too long, dropping it");
+        cmd->overflow = true;
+        return BT_CMD_NONE;
+    }
+    
+    cmd->buffer[cmd->len++] = c;
+    cmd->buffer[cmd->len] = '\0';
+    return BT_CMD_NONE;
+}
+
+bt_cmd_t bt_cmd_write_end(const bt_cmd_buffer_t *cmd, size_t start_len)
+{
+    /* 续写前一次写入的行不算: 只有整次写入就是 OPEN 才视为完整指令 */
+    if (start_len != 0 || cmd->overflow) {
+        return BT_CMD_NONE;
+    }
+    return strcmp(cmd->buffer, BT_CMD_OPEN_DOOR) == 0 ? BT_CMD_OPEN : BT_CMD_NONE;
+}
+
+void bt_cmd_reset(bt_cmd_buffer_t *cmd)
+{
+    cmd->len = 0;
+    cmd->overflow = false;
+    memset(cmd->buffer, 0, sizeof(cmd->buffer));
+}
+
 /**
  * @brief 解析接收到的BLE数据
  */
@@ -72,28 +117,27 @@ static void parse_command(const uint8_t *data, uint16_t len)
         return;
     }
 
+    size_t start_len = s_cmd_buffer.len;
     for (uint16_t i = 0; i < len; i++) {
-        char c = (char)data[i];
-        
-        if (s_cmd_buffer.len >= BT_CMD_MAX_LEN - 1) {
-            ESP_LOGW(TAG, "Buffer overflow, resetting");
-            s_cmd_buffer.len = 0;
-            memset(s_cmd_buffer.buffer, 0, sizeof(s_cmd_buffer.buffer));
-        }
-        
-        s_cmd_buffer.buffer[s_cmd_buffer.len++] = c;
-        s_cmd_buffer.buffer[s_cmd_buffer.len] = '\0';
-        
-        if (s_cmd_buffer.len >= 4) {
-            char *cmd_start = s_cmd_buffer.buffer + s_cmd_buffer.len - 4;
-            if (strncmp(cmd_start, BT_CMD_OPEN_DOOR, 4) == 0) {
+        switch (bt_cmd_feed(&s_cmd_buffer, (char)data[i])) {
+            case BT_CMD_OPEN:
                 ESP_LOGI(TAG, "OPEN command detected");
                 handle_open_command();
-                s_cmd_buffer.len = 0;
-                memset(s_cmd_buffer.buffer, 0, sizeof(s_cmd_buffer.buffer));
-            }
+                bt_cmd_reset(&s_cmd_buffer);
+                break;
+            case BT_CMD_LINE:
+                handle_diag_line();
+                break;
+            default:
+                break;
         }
     }
+
+    if (bt_cmd_write_end(&s_cmd_buffer, start_len) == BT_CMD_OPEN) {
+        ESP_LOGI(TAG, "OPEN command detected (no line ending)");
+        handle_open_command();
+        bt_cmd_reset(&s_cmd_buffer);
+    }
 }
 
 /**
@@ -102,6 +146,7 @@ static void parse_command(const uint8_t *data, uint16_t len)
 static void handle_open_command(void)
 {
     bool sent = msg_send_pwm_open_door();
+    TRACE(TRACE_SRC_BLE, TRACE_EVT_BLE_OPEN, s_ble_state.conn_handle, sent, 0);
     
     if (sent) {
         ESP_LOGI(TAG, "OPEN executed, door opening");
@@ -112,6 +157,46 @@ static void handle_open_command(void)
     }
 }
 
+/**
+ * @brief 诊断命令输出: 按 ATT MTU 分片通知
+ */
+static void diag_out_ble(const char *text, size_t len, void *ctx)
+{
+    uint16_t mtu = ble_att_mtu(s_ble_state.conn_handle);
+    size_t chunk_max = (mtu > 3) ? (size_t)(mtu - 3) : 20;
+
+    while (len > 0) {
+        size_t chunk = len < chunk_max ? len : chunk_max;
+        if (bt_spp_send(text, chunk) != ESP_OK) {
+            return;
+        }
+        text += chunk;
+        len -= chunk;
+    }
+}
+
+static void diag_done_ble(esp_err_t ret, const diag_out_t *out)
+{
+    if (ret == ESP_ERR_NOT_FOUND) {
+        bt_spp_send(BT_RSP_UNKNOWN, strlen(BT_RSP_UNKNOWN));
+    }
+}
+
+/**
+ * @brief 缓冲区中的诊断命令行交给 diag 任务执行，不占用 host 任务
+ */
+static void handle_diag_line(void)
+{
+    /* BLE 连接没有认证，只能执行只读命令 */
+    static const diag_out_t out = { .fn = diag_out_ble, .ctx = NULL, .local = false };
+
+    if (diag_cmd_submit(s_cmd_buffer.buffer, &out, diag_done_ble) == ESP_ERR_NO_MEM) {
+        bt_spp_send(BT_RSP_BUSY, strlen(BT_RSP_BUSY));
+    }
+
+    bt_cmd_reset(&s_cmd_buffer);
+}
+
 /* GATT 服务定义 */
 static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
     {
@@ -151,7 +236,7 @@ static int gatt_svr_chr_access(uint16_t conn_handle, uint16_t attr_handle,
             if (len > sizeof(buf)) len = sizeof(buf);
             
             if (ble_hs_mbuf_to_flat(ctxt->om, buf, len, NULL) == 0) {
-                ESP_LOGI(TAG, "RX data, len=%d", len);
+                DLOGI(TAG, "RX data, len=%d", len);
                 parse_command(buf, len);
             }
         }
@@ -200,6 +285,7 @@ static void ble_advertise(void)
     }
     
     ESP_LOGI(TAG, "Advertising started");
+    boot_trace_mark(BOOT_MARK_BLE_ADV);
 }
 
 /**
@@ -216,6 +302,7 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
                 s_ble_state.connected = true;
                 s_ble_state.conn_handle = event->connect.conn_handle;
                 ESP_LOGI(TAG, "Connected, handle=%d", event->connect.conn_handle);
+                TRACE(TRACE_SRC_BLE, TRACE_EVT_BLE_CONNECT, event->connect.conn_handle, 0, 0);
                 
                 /* 获取连接信息 */
                 rc = ble_gap_conn_find(event->connect.conn_handle, &desc);
@@ -226,10 +313,10 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
                 
                 /* 更新连接参数以提高稳定性 */
                 struct ble_gap_upd_params params = {
-                    .itvl_min = 24,   /* 30ms (24 * 1.25ms) */
-                    .itvl_max = 40,   /* 50ms (40 * 1.25ms) */
+                    .itvl_min = BT_CONN_ITVL_MIN,
+                    .itvl_max = BT_CONN_ITVL_MAX,
                     .latency = 0,
-                    .supervision_timeout = 400,  /* 4s (400 * 10ms) */
+                    .supervision_timeout = BT_CONN_SUPERVISION_TIMEOUT,
                     .min_ce_len = 0,
                     .max_ce_len = 0,
                 };
@@ -242,6 +329,8 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
 
         case BLE_GAP_EVENT_DISCONNECT:
             ESP_LOGI(TAG, "Disconnected, reason=%d", event->disconnect.reason);
+            TRACE(TRACE_SRC_BLE, TRACE_EVT_BLE_DISCONNECT, s_ble_state.conn_handle,
+                  event->disconnect.reason, 0);
             s_ble_state.connected = false;
             s_ble_state.conn_handle = 0;
             s_ble_state.notify_enabled = false;
@@ -301,6 +390,18 @@ static void ble_host_task(void *param)
     nimble_port_freertos_deinit();
 }
 
+/**
+ * @brief BLE 诊断命令: 连接状态、MTU、通知开关
+ */
+static esp_err_t cmd_ble(int argc, char **argv, const diag_out_t *out)
+{
+    diag_printf(out, "connected=%d handle=%u mtu=%u notify=%d\r\n",
+                s_ble_state.connected, s_ble_state.conn_handle,
+                s_ble_state.connected ? ble_att_mtu(s_ble_state.conn_handle) : 0,
+                s_ble_state.notify_enabled);
+    return ESP_OK;
+}
+
 /**
  * @brief 初始化BLE服务
  */
@@ -310,19 +411,8 @@ esp_err_t bt_spp_init(void)
 
     ESP_LOGI(TAG, "Initializing BLE (NimBLE)...");
 
-    /* 初始化NVS */
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "NVS init failed: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    /* 初始化NimBLE (ESP-IDF 5.x) */
-    ret = nimble_port_init();
+    /* 初始化NimBLE (ESP-IDF 5.x)，NVS 已由启动流程初始化 */
+    esp_err_t ret = nimble_port_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "NimBLE init failed: %s", esp_err_to_name(ret));
         return ret;
@@ -351,6 +441,13 @@ esp_err_t bt_spp_init(void)
 
     ble_svc_gap_device_name_set(BT_DEVICE_NAME);
 
+    /* 初始化L2CAP批量传输信道 */
+    if (bt_l2cap_init() != ESP_OK) {
+        ESP_LOGW(TAG, "L2CAP bulk channel unavailable");
+    }
+
+    diag_cmd_register("BLE", "BLE link state, MTU and notify", cmd_ble, DIAG_ACCESS_REMOTE);
+
     /* 启动NimBLE Host任务 */
     nimble_port_freertos_init(ble_host_task);
 
@@ -378,6 +475,11 @@ esp_err_t bt_spp_send(const char *data, size_t len)
         return ESP_ERR_INVALID_STATE;
     }
 
+    if (FAULT_INJECT(FAULT_BLE_NOTIFY)) {
+        ESP_LOGE(TAG, "Notify failed: rc=%d (injected)", BLE_HS_ENOMEM);
+        return ESP_FAIL;
+    }
+
     struct os_mbuf *om = ble_hs_mbuf_from_flat(data, len);
     if (om == NULL) {
         return ESP_ERR_NO_MEM;
@@ -390,5 +492,6 @@ esp_err_t bt_spp_send(const char *data, size_t len)
         return ESP_FAIL;
     }
 
+    FAULT_RECOVERED(FAULT_BLE_NOTIFY);
     return ESP_OK;
 }
@@ -0,0 +1,889 @@
+/**
+ * @file coap_server.c
+ * @brief CoAP 服务器实现
+ *
+ * 单个任务在 select() 上等待 UDP 报文和影子更新 (eventfd 唤醒)，超时只用于 CON 重传，
+ * 空闲时不产生周期唤醒。
+ */
+
+#include "coap_server.h"
+#include "msg_queue.h"
+#include "state_shadow.h"
+#include "app_rtos.h"
+#include "diag_cmd.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "esp_log.h"
+
+#if CONFIG_COAP_SERVER_ENABLE
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_vfs_eventfd.h"
+#include "esp_netif.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "coap";
+
+#define COAP_VERSION            1
+#define COAP_TYPE_CON           0
+#define COAP_TYPE_NON           1
+#define COAP_TYPE_ACK           2
+#define COAP_TYPE_RST           3
+
+#define COAP_CODE(c, d)         (((c) << 5) | (d))
+#define COAP_EMPTY              0
+#define COAP_GET                COAP_CODE(0, 1)
+#define COAP_POST               COAP_CODE(0, 2)
+#define COAP_PUT                COAP_CODE(0, 3)
+#define COAP_CHANGED            COAP_CODE(2, 4)
+#define COAP_CONTENT            COAP_CODE(2, 5)
+#define COAP_BAD_REQUEST        COAP_CODE(4, 0)
+#define COAP_UNAUTHORIZED       COAP_CODE(4, 1)
+#define COAP_BAD_OPTION         COAP_CODE(4, 2)
+#define COAP_NOT_FOUND          COAP_CODE(4, 4)
+#define COAP_NOT_ALLOWED        COAP_CODE(4, 5)
+#define COAP_UNAVAILABLE        COAP_CODE(5, 3)
+
+#define COAP_OPT_URI_HOST       3
+#define COAP_OPT_OBSERVE        6
+#define COAP_OPT_URI_PORT       7
+#define COAP_OPT_URI_PATH       11
+#define COAP_OPT_CONTENT_FORMAT 12
+#define COAP_OPT_URI_QUERY      15
+#define COAP_OPT_ACCEPT         17
+
+#define COAP_FORMAT_NONE        -1
+#define COAP_FORMAT_LINK        40
+#define COAP_FORMAT_JSON        50
+
+#define COAP_TOKEN_MAX          8
+#define COAP_PATH_MAX           32
+#define COAP_KEY_MAX            32
+#define COAP_RX_SIZE            256     /* 请求都很小 */
+#define COAP_TX_SIZE            1024    /* 不使用分块传输，通知须在一个报文内 */
+#define COAP_DOOR_SIZE          192
+#define COAP_TELEMETRY_SIZE     (COAP_TX_SIZE - 32)
+
+/* 传输参数 (RFC 7252 4.8) */
+#define COAP_ACK_TIMEOUT_MS     2000
+#define COAP_ACK_RANDOM_MS      1000    /* ACK_RANDOM_FACTOR 1.5 */
+#define COAP_MAX_RETRANSMIT     4
+#define COAP_EXCHANGE_LIFETIME_US (247LL * 1000000)
+#define COAP_CON_EVERY          8       /* 遥测每 N 条用一次 CON */
+#define COAP_DEDUP_SIZE         8
+#define COAP_MAX_OBSERVERS      CONFIG_COAP_SERVER_MAX_OBSERVERS
+
+#define COAP_WELL_KNOWN_DOOR        "</door>;rt=\"doorlock.state\";ct=50;obs,"
+#define COAP_WELL_KNOWN_TELEMETRY   "</telemetry>;ct=50;obs"
+
+/* 未配置命令密钥时不提供 /door，与 HTTP API 未配置令牌时一样不开放开门 */
+#define COAP_DOOR_ENABLED           (sizeof(CONFIG_COAP_SERVER_KEY) > 1)
+
+typedef enum {
+    RES_DOOR = 0,
+    RES_TELEMETRY,
+    RES_MAX
+} coap_res_t;
+
+/**
+ * @brief 可观察资源的最新表示，由影子监听回调更新
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    uint32_t seq;           /* 每次更新加 1，用作 Observe 序号 */
+} coap_resource_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t code;
+    uint16_t mid;
+    uint8_t tkl;
+    uint8_t token[COAP_TOKEN_MAX];
+    char path[COAP_PATH_MAX];
+    char key[COAP_KEY_MAX];
+    bool has_observe;
+    uint32_t observe;
+    bool bad_option;
+    const uint8_t *payload;
+    size_t payload_len;
+} coap_req_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    uint16_t last_opt;
+    bool overflow;
+} coap_pdu_t;
+
+typedef struct {
+    bool active;
+    coap_res_t res;
+    struct sockaddr_in addr;
+    uint8_t tkl;
+    uint8_t token[COAP_TOKEN_MAX];
+    uint32_t sent_seq;      /* 已通知的资源版本 */
+    uint16_t last_mid;      /* 最近一条通知，用于匹配 ACK/RST */
+    bool con_pending;
+    uint8_t retransmits;
+    uint32_t timeout_ms;
+    int64_t deadline_us;
+    uint8_t since_con;
+} coap_observer_t;
+
+/**
+ * @brief 已执行的 CON 命令，客户端重传时直接重发应答
+ */
+typedef struct {
+    uint32_t addr;
+    uint16_t port;
+    uint16_t mid;
+    uint8_t code;
+    int64_t time_us;
+} coap_dedup_t;
+
+static int s_sock = -1;
+static int s_wake_fd = -1;
+static uint16_t s_mid = 0;
+static SemaphoreHandle_t s_lock = NULL;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t s_lock_buf;
+#endif
+
+static char s_door_buf[COAP_DOOR_SIZE];
+static char s_telemetry_buf[COAP_TELEMETRY_SIZE];
+static coap_resource_t s_res[RES_MAX] = {
+    [RES_DOOR] = { s_door_buf, sizeof(s_door_buf), 0, 0 },
+    [RES_TELEMETRY] = { s_telemetry_buf, sizeof(s_telemetry_buf), 0, 0 },
+};
+static coap_observer_t s_observers[COAP_MAX_OBSERVERS];
+static coap_dedup_t s_dedup[COAP_DEDUP_SIZE];
+static size_t s_dedup_next = 0;
+
+static uint8_t s_rx[COAP_RX_SIZE];
+static uint8_t s_tx[COAP_TX_SIZE];
+
+/* 诊断统计 */
+static uint32_t s_requests = 0;
+static uint32_t s_commands = 0;
+static uint32_t s_duplicates = 0;
+static uint32_t s_notifications = 0;
+static uint32_t s_retransmits = 0;
+static uint32_t s_observer_drops = 0;
+static uint32_t s_oversize = 0;
+
+/* ---------- 编解码 ---------- */
+
+static esp_err_t read_ext(const uint8_t *buf, size_t len, size_t *pos, uint32_t *v)
+{
+    if (*v == 13) {
+        if (*pos + 1 > len) {
+            return ESP_FAIL;
+        }
+        *v = 13 + buf[*pos];
+        *pos += 1;
+    } else if (*v == 14) {
+        if (*pos + 2 > len) {
+            return ESP_FAIL;
+        }
+        *v = 269 + ((uint32_t)buf[*pos] << 8 | buf[*pos + 1]);
+        *pos += 2;
+    } else if (*v == 15) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void parse_option(coap_req_t *req, uint32_t num, const uint8_t *val, size_t len)
+{
+    size_t used;
+
+    switch (num) {
+        case COAP_OPT_URI_PATH:
+            used = strlen(req->path);
+            if (used + len + 2 > sizeof(req->path)) {
+                req->bad_option = true;
+                return;
+            }
+            if (used > 0) {
+                req->path[used++] = '/';
+            }
+            memcpy(req->path + used, val, len);
+            req->path[used + len] = '\0';
+            break;
+        case COAP_OPT_URI_QUERY:
+            if (len > 2 && val[0] == 'k' && val[1] == '=' && len - 2 < sizeof(req->key)) {
+                memcpy(req->key, val + 2, len - 2);
+                req->key[len - 2] = '\0';
+            }
+            break;
+        case COAP_OPT_OBSERVE:
+            req->has_observe = true;
+            req->observe = 0;
+            for (size_t i = 0; i < len && i < 3; i++) {
+                req->observe = (req->observe << 8) | val[i];
+            }
+            break;
+        case COAP_OPT_URI_HOST:
+        case COAP_OPT_URI_PORT:
+        case COAP_OPT_CONTENT_FORMAT:
+        case COAP_OPT_ACCEPT:
+            break;
+        default:
+            /* 不认识的关键选项 (奇数编号) 必须拒绝 */
+            if (num & 1) {
+                req->bad_option = true;
+            }
+            break;
+    }
+}
+
+static esp_err_t coap_parse(const uint8_t *buf, size_t len, coap_req_t *req)
+{
+    memset(req, 0, sizeof(*req));
+    if (len < 4 || (buf[0] >> 6) != COAP_VERSION) {
+        return ESP_FAIL;
+    }
+    req->type = (buf[0] >> 4) & 0x03;
+    req->tkl = buf[0] & 0x0F;
+    req->code = buf[1];
+    req->mid = (uint16_t)(buf[2] << 8 | buf[3]);
+    if (req->tkl > COAP_TOKEN_MAX || 4 + (size_t)req->tkl > len) {
+        return ESP_FAIL;
+    }
+    memcpy(req->token, buf + 4, req->tkl);
+
+    size_t pos = 4 + req->tkl;
+    uint32_t num = 0;
+    while (pos < len) {
+        if (buf[pos] == 0xFF) {
+            if (++pos == len) {
+                return ESP_FAIL;    /* 有标记却没有载荷 */
+            }
+            req->payload = buf + pos;
+            req->payload_len = len - pos;
+            break;
+        }
+        uint32_t delta = buf[pos] >> 4;
+        uint32_t olen = buf[pos] & 0x0F;
+        pos++;
+        if (read_ext(buf, len, &pos, &delta) != ESP_OK ||
+            read_ext(buf, len, &pos, &olen) != ESP_OK || olen > len - pos) {
+            return ESP_FAIL;
+        }
+        num += delta;
+        parse_option(req, num, buf + pos, olen);
+        pos += olen;
+    }
+    return ESP_OK;
+}
+
+static void pdu_init(coap_pdu_t *p, uint8_t type, uint8_t code, uint16_t mid,
+                     const uint8_t *token, uint8_t tkl)
+{
+    p->buf = s_tx;
+    p->size = sizeof(s_tx);
+    p->buf[0] = (COAP_VERSION << 6) | (type << 4) | tkl;
+    p->buf[1] = code;
+    p->buf[2] = mid >> 8;
+    p->buf[3] = mid & 0xFF;
+    memcpy(p->buf + 4, token, tkl);
+    p->len = 4 + tkl;
+    p->last_opt = 0;
+    p->overflow = false;
+}
+
+static uint8_t opt_nibble(uint32_t v, uint8_t *ext, size_t *ext_len)
+{
+    if (v < 13) {
+        *ext_len = 0;
+        return v;
+    }
+    if (v < 269) {
+        ext[0] = v - 13;
+        *ext_len = 1;
+        return 13;
+    }
+    ext[0] = (v - 269) >> 8;
+    ext[1] = (v - 269) & 0xFF;
+    *ext_len = 2;
+    return 14;
+}
+
+/**
+ * @brief 追加选项，调用方须按选项编号升序调用
+ */
+static void pdu_option(coap_pdu_t *p, uint16_t num, const void *val, size_t len)
+{
+    uint8_t dext[2], lext[2];
+    size_t dlen, llen;
+    uint8_t dn = opt_nibble(num - p->last_opt, dext, &dlen);
+    uint8_t ln = opt_nibble(len, lext, &llen);
+
+    if (p->len + 1 + dlen + llen + len > p->size) {
+        p->overflow = true;
+        return;
+    }
+    p->buf[p->len++] = (dn << 4) | ln;
+    memcpy(p->buf + p->len, dext, dlen);
+    p->len += dlen;
+    memcpy(p->buf + p->len, lext, llen);
+    p->len += llen;
+    memcpy(p->buf + p->len, val, len);
+    p->len += len;
+    p->last_opt = num;
+}
+
+static void pdu_option_uint(coap_pdu_t *p, uint16_t num, uint32_t v)
+{
+    uint8_t be[4];
+    size_t n = 0;
+
+    /* 最短编码，0 编码为空值 */
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (n > 0 || (v >> shift) & 0xFF) {
+            be[n++] = (v >> shift) & 0xFF;
+        }
+    }
+    pdu_option(p, num, be, n);
+}
+
+static void pdu_payload(coap_pdu_t *p, const void *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    if (p->len + 1 + len > p->size) {
+        p->overflow = true;
+        return;
+    }
+    p->buf[p->len++] = 0xFF;
+    memcpy(p->buf + p->len, data, len);
+    p->len += len;
+}
+
+static void pdu_send(const coap_pdu_t *p, const struct sockaddr_in *to)
+{
+    if (p->overflow) {
+        s_oversize++;
+        return;
+    }
+    sendto(s_sock, p->buf, p->len, 0, (const struct sockaddr *)to, sizeof(*to));
+}
+
+static uint16_t next_mid(void)
+{
+    return s_mid++;
+}
+
+/* ---------- 观察者 ---------- */
+
+static bool same_endpoint(const struct sockaddr_in *a, const struct sockaddr_in *b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+static coap_observer_t *observer_find(const struct sockaddr_in *from, const uint8_t *token, uint8_t tkl)
+{
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        coap_observer_t *o = &s_observers[i];
+        if (o->active && same_endpoint(&o->addr, from) && o->tkl == tkl &&
+            memcmp(o->token, token, tkl) == 0) {
+            return o;
+        }
+    }
+    return NULL;
+}
+
+static coap_observer_t *observer_add(coap_res_t res, const struct sockaddr_in *from,
+                                     const coap_req_t *req)
+{
+    coap_observer_t *o = observer_find(from, req->token, req->tkl);
+
+    for (int i = 0; o == NULL && i < COAP_MAX_OBSERVERS; i++) {
+        if (!s_observers[i].active) {
+            o = &s_observers[i];
+        }
+    }
+    if (o == NULL) {
+        return NULL;
+    }
+    memset(o, 0, sizeof(*o));
+    o->active = true;
+    o->res = res;
+    o->addr = *from;
+    o->tkl = req->tkl;
+    memcpy(o->token, req->token, req->tkl);
+    return o;
+}
+
+static void observer_drop(coap_observer_t *o, const char *why)
+{
+    ESP_LOGI(TAG, "Observer " IPSTR ":%u removed (%s)", IP2STR((esp_ip4_addr_t *)&o->addr.sin_addr),
+             ntohs(o->addr.sin_port), why);
+    o->active = false;
+    s_observer_drops++;
+}
+
+/**
+ * @brief 发送资源的最新表示；重传时沿用计数和退避超时 (RFC 7641 4.5.2)
+ */
+static void notify(coap_observer_t *o, bool con, bool retry)
+{
+    coap_resource_t *r = &s_res[o->res];
+    coap_pdu_t pdu;
+    uint16_t mid = next_mid();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    pdu_init(&pdu, con ? COAP_TYPE_CON : COAP_TYPE_NON, COAP_CONTENT, mid, o->token, o->tkl);
+    pdu_option_uint(&pdu, COAP_OPT_OBSERVE, r->seq & 0xFFFFFF);
+    pdu_option_uint(&pdu, COAP_OPT_CONTENT_FORMAT, COAP_FORMAT_JSON);
+    pdu_payload(&pdu, r->buf, r->len);
+    o->sent_seq = r->seq;
+    xSemaphoreGive(s_lock);
+
+    pdu_send(&pdu, &o->addr);
+    o->last_mid = mid;
+    s_notifications++;
+    if (!con) {
+        o->since_con++;
+        return;
+    }
+    if (!retry) {
+        o->retransmits = 0;
+        o->timeout_ms = COAP_ACK_TIMEOUT_MS + esp_random() % COAP_ACK_RANDOM_MS;
+    }
+    o->con_pending = true;
+    o->since_con = 0;
+    o->deadline_us = esp_timer_get_time() + (int64_t)o->timeout_ms * 1000;
+}
+
+static void notify_observers(void)
+{
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        coap_observer_t *o = &s_observers[i];
+        /* 等待 ACK 期间不发新通知，确认或重传时带上最新表示 */
+        if (!o->active || o->con_pending || o->sent_seq == s_res[o->res].seq) {
+            continue;
+        }
+        notify(o, o->res == RES_DOOR || o->since_con + 1 >= COAP_CON_EVERY, false);
+    }
+}
+
+static void retransmit_expired(void)
+{
+    int64_t now = esp_timer_get_time();
+
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        coap_observer_t *o = &s_observers[i];
+        if (!o->active || !o->con_pending || now < o->deadline_us) {
+            continue;
+        }
+        if (o->retransmits >= COAP_MAX_RETRANSMIT) {
+            observer_drop(o, "no ACK");
+            continue;
+        }
+        o->retransmits++;
+        o->timeout_ms *= 2;
+        s_retransmits++;
+        notify(o, true, true);
+    }
+}
+
+/**
+ * @brief select() 超时: 最早的重传截止时间，没有待确认通知时无限等待
+ */
+static struct timeval *next_timeout(struct timeval *tv)
+{
+    int64_t earliest = INT64_MAX;
+
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        const coap_observer_t *o = &s_observers[i];
+        if (o->active && o->con_pending && o->deadline_us < earliest) {
+            earliest = o->deadline_us;
+        }
+    }
+    if (earliest == INT64_MAX) {
+        return NULL;
+    }
+    int64_t wait = earliest - esp_timer_get_time();
+    if (wait < 0) {
+        wait = 0;
+    }
+    tv->tv_sec = wait / 1000000;
+    tv->tv_usec = wait % 1000000;
+    return tv;
+}
+
+/* ---------- 请求处理 ---------- */
+
+static void respond(const coap_req_t *req, const struct sockaddr_in *to, uint8_t code,
+                    int format, const void *payload, size_t len)
+{
+    coap_pdu_t pdu;
+
+    if (req->type == COAP_TYPE_CON) {
+        pdu_init(&pdu, COAP_TYPE_ACK, code, req->mid, req->token, req->tkl);
+    } else {
+        pdu_init(&pdu, COAP_TYPE_NON, code, next_mid(), req->token, req->tkl);
+    }
+    if (format != COAP_FORMAT_NONE) {
+        pdu_option_uint(&pdu, COAP_OPT_CONTENT_FORMAT, format);
+    }
+    pdu_payload(&pdu, payload, len);
+    pdu_send(&pdu, to);
+}
+
+static coap_dedup_t *dedup_find(const struct sockaddr_in *from, uint16_t mid)
+{
+    int64_t now = esp_timer_get_time();
+
+    for (int i = 0; i < COAP_DEDUP_SIZE; i++) {
+        coap_dedup_t *d = &s_dedup[i];
+        if (d->time_us != 0 && now - d->time_us < COAP_EXCHANGE_LIFETIME_US &&
+            d->addr == from->sin_addr.s_addr && d->port == from->sin_port && d->mid == mid) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+static void dedup_store(const struct sockaddr_in *from, uint16_t mid, uint8_t code)
+{
+    coap_dedup_t *d = &s_dedup[s_dedup_next];
+
+    s_dedup_next = (s_dedup_next + 1) % COAP_DEDUP_SIZE;
+    d->addr = from->sin_addr.s_addr;
+    d->port = from->sin_port;
+    d->mid = mid;
+    d->code = code;
+    d->time_us = esp_timer_get_time();
+}
+
+static bool payload_is(const coap_req_t *req, const char *word)
+{
+    size_t n = strlen(word);
+    return req->payload_len == n && strncasecmp((const char *)req->payload, word, n) == 0;
+}
+
+/**
+ * @brief 常数时间比较，耗时不随匹配的前缀长度变化
+ */
+static bool key_matches(const char *value)
+{
+    static const char key[] = CONFIG_COAP_SERVER_KEY;
+    size_t expected = sizeof(key) - 1;
+    size_t len = strnlen(value, expected + 1);
+    uint8_t diff = (len != expected) || expected == 0;
+
+    for (size_t i = 0; i < expected; i++) {
+        diff |= (uint8_t)(value[i < len ? i : 0] ^ key[i]);
+    }
+    return diff == 0;
+}
+
+static uint8_t door_command(const coap_req_t *req)
+{
+    coap_cmd_t cmd;
+
+    if (!key_matches(req->key)) {
+        return COAP_UNAUTHORIZED;
+    }
+    if (payload_is(req, "open") || payload_is(req, "ON")) {
+        cmd = COAP_CMD_DOOR_OPEN;
+    } else if (payload_is(req, "close") || payload_is(req, "OFF")) {
+        cmd = COAP_CMD_DOOR_CLOSE;
+    } else {
+        return COAP_BAD_REQUEST;
+    }
+    s_commands++;
+    return msg_send_coap_door_cmd(cmd) ? COAP_CHANGED : COAP_UNAVAILABLE;
+}
+
+/**
+ * @brief GET 可观察资源: Observe=0 注册，Observe=1 或普通 GET 取消同一令牌的注册
+ */
+static void get_resource(const coap_req_t *req, const struct sockaddr_in *from, coap_res_t res)
+{
+    coap_resource_t *r = &s_res[res];
+    coap_observer_t *o = NULL;
+    coap_pdu_t pdu;
+
+    if (req->has_observe && req->observe == 0) {
+        o = observer_add(res, from, req);
+    } else {
+        o = observer_find(from, req->token, req->tkl);
+        if (o != NULL) {
+            o->active = false;
+        }
+        o = NULL;
+    }
+
+    if (req->type == COAP_TYPE_CON) {
+        pdu_init(&pdu, COAP_TYPE_ACK, COAP_CONTENT, req->mid, req->token, req->tkl);
+    } else {
+        pdu_init(&pdu, COAP_TYPE_NON, COAP_CONTENT, next_mid(), req->token, req->tkl);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (o != NULL) {
+        pdu_option_uint(&pdu, COAP_OPT_OBSERVE, r->seq & 0xFFFFFF);
+        o->sent_seq = r->seq;
+    }
+    pdu_option_uint(&pdu, COAP_OPT_CONTENT_FORMAT, COAP_FORMAT_JSON);
+    pdu_payload(&pdu, r->len ? r->buf : "{}", r->len ? r->len : 2);
+    xSemaphoreGive(s_lock);
+    pdu_send(&pdu, from);
+}
+
+static void handle_request(const coap_req_t *req, const struct sockaddr_in *from)
+{
+    bool is_get = (req->code == COAP_GET);
+    bool is_cmd = (req->code == COAP_PUT || req->code == COAP_POST);
+
+    s_requests++;
+    if (req->bad_option) {
+        respond(req, from, COAP_BAD_OPTION, COAP_FORMAT_NONE, NULL, 0);
+        return;
+    }
+
+    if (COAP_DOOR_ENABLED && strcmp(req->path, "door") == 0) {
+        if (is_get) {
+            get_resource(req, from, RES_DOOR);
+        } else if (is_cmd) {
+            coap_dedup_t *d = (req->type == COAP_TYPE_CON) ? dedup_find(from, req->mid) : NULL;
+            uint8_t code;
+            if (d != NULL) {
+                s_duplicates++;
+                code = d->code;
+            } else {
+                code = door_command(req);
+                if (req->type == COAP_TYPE_CON) {
+                    dedup_store(from, req->mid, code);
+                }
+            }
+            respond(req, from, code, COAP_FORMAT_NONE, NULL, 0);
+        } else {
+            respond(req, from, COAP_NOT_ALLOWED, COAP_FORMAT_NONE, NULL, 0);
+        }
+    } else if (strcmp(req->path, "telemetry") == 0) {
+        if (is_get) {
+            get_resource(req, from, RES_TELEMETRY);
+        } else {
+            respond(req, from, COAP_NOT_ALLOWED, COAP_FORMAT_NONE, NULL, 0);
+        }
+    } else if (strcmp(req->path, ".well-known/core") == 0 && is_get) {
+        const char *links = COAP_DOOR_ENABLED ? COAP_WELL_KNOWN_DOOR COAP_WELL_KNOWN_TELEMETRY
+                                              : COAP_WELL_KNOWN_TELEMETRY;
+        respond(req, from, COAP_CONTENT, COAP_FORMAT_LINK, links, strlen(links));
+    } else {
+        respond(req, from, COAP_NOT_FOUND, COAP_FORMAT_NONE, NULL, 0);
+    }
+}
+
+static void handle_datagram(void)
+{
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    coap_req_t req;
+
+    int len = recvfrom(s_sock, s_rx, sizeof(s_rx), 0, (struct sockaddr *)&from, &from_len);
+    if (len <= 0) {
+        return;
+    }
+    if (coap_parse(s_rx, len, &req) != ESP_OK) {
+        /* 格式错误的 CON 报文以 RST 拒绝，其余静默丢弃 */
+        if (len >= 4 && ((s_rx[0] >> 4) & 0x03) == COAP_TYPE_CON) {
+            coap_pdu_t pdu;
+            pdu_init(&pdu, COAP_TYPE_RST, COAP_EMPTY, (uint16_t)(s_rx[2] << 8 | s_rx[3]), NULL, 0);
+            pdu_send(&pdu, &from);
+        }
+        return;
+    }
+
+    if (req.type == COAP_TYPE_ACK || req.type == COAP_TYPE_RST) {
+        for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+            coap_observer_t *o = &s_observers[i];
+            if (!o->active || o->last_mid != req.mid || !same_endpoint(&o->addr, &from)) {
+                continue;
+            }
+            if (req.type == COAP_TYPE_RST) {
+                observer_drop(o, "RST");
+            } else {
+                o->con_pending = false;
+            }
+        }
+        return;
+    }
+
+    if (req.code == COAP_EMPTY) {
+        /* CoAP ping: 以 RST 应答 */
+        if (req.type == COAP_TYPE_CON) {
+            coap_pdu_t pdu;
+            pdu_init(&pdu, COAP_TYPE_RST, COAP_EMPTY, req.mid, NULL, 0);
+            pdu_send(&pdu, &from);
+        }
+        return;
+    }
+    if ((req.code >> 5) == 0) {
+        handle_request(&req, &from);
+    }
+}
+
+static void coap_task(void *arg)
+{
+    for (;;) {
+        fd_set rfds;
+        struct timeval tv;
+
+        FD_ZERO(&rfds);
+        FD_SET(s_sock, &rfds);
+        FD_SET(s_wake_fd, &rfds);
+        int n = select((s_sock > s_wake_fd ? s_sock : s_wake_fd) + 1, &rfds, NULL, NULL,
+                       next_timeout(&tv));
+        if (n < 0) {
+            ESP_LOGE(TAG, "select failed: %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (n > 0 && FD_ISSET(s_wake_fd, &rfds)) {
+            uint64_t count;
+            read(s_wake_fd, &count, sizeof(count));
+        }
+        if (n > 0 && FD_ISSET(s_sock, &rfds)) {
+            handle_datagram();
+        }
+        retransmit_expired();
+        notify_observers();
+    }
+}
+
+/**
+ * @brief 影子监听: 只复制最新表示并唤醒服务任务，发送在服务任务中完成
+ */
+static void shadow_listener(state_shadow_kind_t kind, const char *json, size_t len)
+{
+    coap_resource_t *r;
+    uint64_t one = 1;
+
+    if (kind == STATE_SHADOW_STATE) {
+        r = &s_res[RES_DOOR];
+    } else if (kind == STATE_SHADOW_TELEMETRY) {
+        r = &s_res[RES_TELEMETRY];
+    } else {
+        return;
+    }
+    if (len >= r->size) {
+        s_oversize++;
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    memcpy(r->buf, json, len);
+    r->buf[len] = '\0';
+    r->len = len;
+    r->seq++;
+    xSemaphoreGive(s_lock);
+    write(s_wake_fd, &one, sizeof(one));
+}
+
+/**
+ * @brief COAP 命令: 请求、通知与观察者统计
+ */
+static esp_err_t cmd_coap(int argc, char **argv, const diag_out_t *out)
+{
+    diag_printf(out, "coap port %d: %lu requests, %lu commands, %lu duplicates\r\n",
+                CONFIG_COAP_SERVER_PORT, (unsigned long)s_requests,
+                (unsigned long)s_commands, (unsigned long)s_duplicates);
+    diag_printf(out, "notify %lu, retransmit %lu, observers dropped %lu, oversize %lu\r\n",
+                (unsigned long)s_notifications, (unsigned long)s_retransmits,
+                (unsigned long)s_observer_drops, (unsigned long)s_oversize);
+    for (int i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        const coap_observer_t *o = &s_observers[i];
+        if (o->active) {
+            diag_printf(out, "  " IPSTR ":%u %s seq %lu%s\r\n",
+                        IP2STR((esp_ip4_addr_t *)&o->addr.sin_addr), ntohs(o->addr.sin_port),
+                        o->res == RES_DOOR ? "door" : "telemetry",
+                        (unsigned long)o->sent_seq, o->con_pending ? " (awaiting ACK)" : "");
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t coap_server_start(void)
+{
+    esp_vfs_eventfd_config_t eventfd_cfg = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_COAP_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    if (s_sock >= 0) {
+        return ESP_OK;
+    }
+
+    /* 其他模块可能已注册 eventfd */
+    esp_err_t ret = esp_vfs_eventfd_register(&eventfd_cfg);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+    s_wake_fd = eventfd(0, 0);
+    if (s_wake_fd < 0) {
+        return ESP_FAIL;
+    }
+
+#if CONFIG_APP_STATIC_ALLOCATION
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+#else
+    s_lock = xSemaphoreCreateMutex();
+#endif
+    if (s_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_sock < 0 || bind(s_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "Failed to bind UDP port %d: %d", CONFIG_COAP_SERVER_PORT, errno);
+        if (s_sock >= 0) {
+            close(s_sock);
+            s_sock = -1;
+        }
+        return ESP_FAIL;
+    }
+
+    s_mid = (uint16_t)esp_random();
+    s_res[RES_DOOR].len = state_shadow_snapshot(s_door_buf, sizeof(s_door_buf));
+    state_shadow_add_listener(shadow_listener);
+
+    if (app_task_create(APP_TASK_COAP, coap_task, NULL, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    diag_cmd_register("COAP", "CoAP server statistics and observers", cmd_coap, DIAG_ACCESS_REMOTE);
+
+    if (!COAP_DOOR_ENABLED) {
+        ESP_LOGW(TAG, "No CoAP key configured, /door is not served");
+    }
+    ESP_LOGI(TAG, "Listening on UDP port %d (%d observers)", CONFIG_COAP_SERVER_PORT,
+             COAP_MAX_OBSERVERS);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_COAP_SERVER_ENABLE */
+
+esp_err_t coap_server_start(void)
+{
+    return ESP_OK;
+}
+
+#endif /* CONFIG_COAP_SERVER_ENABLE */
@@ -0,0 +1,261 @@
+/**
+ * @file cpu_stats.c
+ * @brief CPU 占用统计实现
+ */
+
+#include "cpu_stats.h"
+#include "diag_cmd.h"
+#include "ha_mqtt.h"
+#include "app_rtos.h"
+#include "supervisor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "cpu_stats";
+
+#if CONFIG_CPU_STATS_ENABLE
+
+#define RING_LEN            (CONFIG_CPU_STATS_WINDOW + 1)
+#define CPU_STATS_JSON_SIZE 1024
+
+/* 运行时间计数器来源为 esp_timer，单位 us */
+#define RUNTIME_TO_MS(t)    ((uint32_t)((t) / 1000))
+
+typedef struct {
+    UBaseType_t number;                 /* 任务编号，任务生命周期内唯一 */
+    configRUN_TIME_COUNTER_TYPE runtime;
+} task_sample_t;
+
+typedef struct {
+    configRUN_TIME_COUNTER_TYPE total;
+    uint8_t count;
+    task_sample_t tasks[CPU_STATS_MAX_TASKS];
+} cpu_snapshot_t;
+
+static cpu_snapshot_t s_ring[RING_LEN];
+static uint32_t s_sample_count = 0;
+static TaskStatus_t s_status[CPU_STATS_MAX_TASKS];
+static char s_names[CPU_STATS_MAX_TASKS][configMAX_TASK_NAME_LEN];
+
+static cpu_stats_t s_result;
+static bool s_result_valid = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool take_snapshot(cpu_snapshot_t *snap)
+{
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t n = uxTaskGetSystemState(s_status, CPU_STATS_MAX_TASKS, &total);
+
+    if (n == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, sample skipped", CPU_STATS_MAX_TASKS);
+        return false;
+    }
+
+    snap->total = total;
+    snap->count = (uint8_t)n;
+    for (UBaseType_t i = 0; i < n; i++) {
+        snap->tasks[i].number = s_status[i].xTaskNumber;
+        snap->tasks[i].runtime = s_status[i].ulRunTimeCounter;
+        strlcpy(s_names[i], s_status[i].pcTaskName, sizeof(s_names[i]));
+    }
+    return true;
+}
+
+/**
+ * @brief 计算任务在 [from, to] 区间内的占用千分比
+ */
+static uint16_t usage_pm(const cpu_snapshot_t *from, const cpu_snapshot_t *to, size_t idx)
+{
+    configRUN_TIME_COUNTER_TYPE base = 0;
+    configRUN_TIME_COUNTER_TYPE span = to->total - from->total;
+
+    /* 窗口内新建的任务基准为 0 */
+    for (uint8_t i = 0; i < from->count; i++) {
+        if (from->tasks[i].number == to->tasks[idx].number) {
+            base = from->tasks[i].runtime;
+            break;
+        }
+    }
+    if (span == 0) {
+        return 0;
+    }
+    return (uint16_t)(((uint64_t)(to->tasks[idx].runtime - base) * 1000) / span);
+}
+
+static void compute_result(void)
+{
+    if (s_sample_count < 2) {
+        return;
+    }
+
+    const cpu_snapshot_t *newest = &s_ring[(s_sample_count - 1) % RING_LEN];
+    const cpu_snapshot_t *prev = &s_ring[(s_sample_count - 2) % RING_LEN];
+    const cpu_snapshot_t *oldest = (s_sample_count >= RING_LEN) ?
+                                   &s_ring[s_sample_count % RING_LEN] : &s_ring[0];
+    cpu_stats_t result = {
+        .short_ms = RUNTIME_TO_MS(newest->total - prev->total),
+        .long_ms = RUNTIME_TO_MS(newest->total - oldest->total),
+    };
+
+    for (uint8_t i = 0; i < newest->count; i++) {
+        cpu_task_usage_t usage;
+        strlcpy(usage.name, s_names[i], sizeof(usage.name));
+        usage.short_pm = usage_pm(prev, newest, i);
+        usage.long_pm = usage_pm(oldest, newest, i);
+
+        if (strncmp(usage.name, "IDLE", 4) == 0) {
+            result.idle_short_pm += usage.short_pm / portNUM_PROCESSORS;
+            result.idle_long_pm += usage.long_pm / portNUM_PROCESSORS;
+        }
+
+        /* 按长窗口占用率降序插入 */
+        uint8_t pos = result.count;
+        while (pos > 0 && result.tasks[pos - 1].long_pm < usage.long_pm) {
+            result.tasks[pos] = result.tasks[pos - 1];
+            pos--;
+        }
+        result.tasks[pos] = usage;
+        result.count++;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_result = result;
+    s_result_valid = true;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t cpu_stats_get(cpu_stats_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool valid = s_result_valid;
+    if (valid) {
+        *out = s_result;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+int cpu_stats_to_json(char *buf, size_t len)
+{
+    cpu_stats_t stats;
+    size_t pos = 0;
+    int n;
+
+    if (cpu_stats_get(&stats) != ESP_OK) {
+        return -1;
+    }
+
+#define APPEND(...) do { \
+        n = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n < 0 || (size_t)n >= len - pos) return -1; \
+        pos += n; \
+    } while (0)
+
+    APPEND("{\"win\":[%lu,%lu],\"idle\":[%u,%u],\"tasks\":{",
+           (unsigned long)stats.short_ms, (unsigned long)stats.long_ms,
+           stats.idle_short_pm, stats.idle_long_pm);
+    for (uint8_t i = 0; i < stats.count; i++) {
+        APPEND("%s\"%s\":[%u,%u]", i ? "," : "", stats.tasks[i].name,
+               stats.tasks[i].short_pm, stats.tasks[i].long_pm);
+    }
+    APPEND("}}");
+
+#undef APPEND
+    return (int)pos;
+}
+
+/**
+ * @brief TOP 命令: 按长窗口占用率列出任务
+ */
+static esp_err_t cmd_top(int argc, char **argv, const diag_out_t *out)
+{
+    cpu_stats_t stats;
+
+    if (cpu_stats_get(&stats) != ESP_OK) {
+        diag_printf(out, "no data yet\r\n");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    diag_printf(out, "win %lums/%lums idle %u.%u%%/%u.%u%%\r\n",
+                (unsigned long)stats.short_ms, (unsigned long)stats.long_ms,
+                stats.idle_short_pm / 10, stats.idle_short_pm % 10,
+                stats.idle_long_pm / 10, stats.idle_long_pm % 10);
+    for (uint8_t i = 0; i < stats.count; i++) {
+        diag_printf(out, "%-16s %3u.%u %3u.%u\r\n", stats.tasks[i].name,
+                    stats.tasks[i].short_pm / 10, stats.tasks[i].short_pm % 10,
+                    stats.tasks[i].long_pm / 10, stats.tasks[i].long_pm % 10);
+    }
+    return ESP_OK;
+}
+
+static void cpu_stats_task(void *pvParameters)
+{
+    const uint32_t report_every = (CONFIG_CPU_STATS_REPORT_PERIOD_S * 1000) /
+                                  CONFIG_CPU_STATS_PERIOD_MS;
+    uint32_t count = 0;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    supervisor_register(APP_TASK_CPU_STATS,
+                        SUPERVISOR_BACKGROUND_HEARTBEAT_MS(CONFIG_CPU_STATS_PERIOD_MS), 0, NULL);
+
+    while (1) {
+        supervisor_heartbeat(APP_TASK_CPU_STATS);
+        if (take_snapshot(&s_ring[s_sample_count % RING_LEN])) {
+            s_sample_count++;
+            compute_result();
+        }
+
+        if (report_every > 0 && ++count >= report_every) {
+            count = 0;
+            if (ha_mqtt_is_connected()) {
+                static char json[CPU_STATS_JSON_SIZE];
+                if (cpu_stats_to_json(json, sizeof(json)) > 0) {
+                    ha_mqtt_publish_telemetry("cpu", json);
+                }
+            }
+        }
+
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_CPU_STATS_PERIOD_MS));
+    }
+}
+
+esp_err_t cpu_stats_start(void)
+{
+    diag_cmd_register("TOP", "per-task CPU usage (short/long window %)", cmd_top, DIAG_ACCESS_REMOTE);
+
+    if (app_task_create(APP_TASK_CPU_STATS, cpu_stats_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create cpu stats task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "CPU stats started, window %d x %d ms",
+             CONFIG_CPU_STATS_WINDOW, CONFIG_CPU_STATS_PERIOD_MS);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_CPU_STATS_ENABLE */
+
+esp_err_t cpu_stats_start(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t cpu_stats_get(cpu_stats_t *out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+int cpu_stats_to_json(char *buf, size_t len)
+{
+    return -1;
+}
+
+#endif /* CONFIG_CPU_STATS_ENABLE */
@@ -0,0 +1,568 @@
+/**
+ * @file crash_report.c
+ * @brief 崩溃报告实现
+ */
+
+#include "crash_report.h"
+#include "app_rtos.h"
+#include "trace.h"
+#include "diag_cmd.h"
+#include "bt_l2cap.h"
+#include "ha_mqtt.h"
+#include "http_api.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_app_desc.h"
+#include "esp_memory_utils.h"
+#include "esp_core_dump.h"
+
+static const char *TAG = "crash";
+
+#if CONFIG_CRASH_REPORT_ENABLE
+
+#define CRASH_TRACE_RECORDS     CONFIG_CRASH_REPORT_TRACE_RECORDS
+#define CRASH_MAX_TASKS         CONFIG_CRASH_REPORT_MAX_TASKS
+#define CRASH_BT_DEPTH          8
+#define CRASH_TASK_NAME_LEN     16
+#define CRASH_PANIC_LEN         64
+#define CRASH_JSON_SIZE         1536
+#define CRASH_CHUNK_SIZE        1024
+/* 转储分区头 (core_dump_header_t) 之后才是 ELF，在开头这一段内查找 ELF 魔数 */
+#define CRASH_ELF_SEARCH        64
+
+/* ELF32 (newlib 不提供 elf.h) */
+#define ELF_PT_LOAD             1
+#define ELF_PT_NOTE             4
+#define ELF_NT_PRSTATUS         1
+
+typedef struct {
+    uint8_t e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;
+    uint32_t e_phoff;
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} elf32_ehdr_t;
+
+typedef struct {
+    uint32_t p_type;
+    uint32_t p_offset;
+    uint32_t p_vaddr;
+    uint32_t p_paddr;
+    uint32_t p_filesz;
+    uint32_t p_memsz;
+    uint32_t p_flags;
+    uint32_t p_align;
+} elf32_phdr_t;
+
+typedef struct {
+    uint32_t namesz;
+    uint32_t descsz;
+    uint32_t type;
+} elf32_nhdr_t;
+
+/*
+ * IDF 为每个任务写一个 "CORE" NT_PRSTATUS 注释: pr_pid 为 TCB 地址，
+ * pr_reg 从 pc 开始 (RISC-V elf_prstatus 布局)
+ */
+#define PRSTATUS_PID_OFFSET     24
+#define PRSTATUS_PC_OFFSET      72
+
+typedef struct {
+    char name[CRASH_TASK_NAME_LEN];
+    uint32_t tcb;
+    uint32_t pc;
+} crash_task_t;
+
+typedef struct {
+    bool has_dump;
+    bool dump_valid;
+    bool names_valid;       /* 转储来自当前固件，TCB 中的名称偏移可信 */
+    uint32_t dump_size;
+    char task[CRASH_TASK_NAME_LEN];
+    char panic[CRASH_PANIC_LEN];
+    char elf[CRASH_TASK_NAME_LEN];
+    uint32_t pc;
+    uint32_t ra;
+    uint32_t sp;
+    uint32_t mcause;
+    uint32_t mtval;
+    uint32_t bt[CRASH_BT_DEPTH];
+    uint32_t bt_depth;
+    crash_task_t tasks[CRASH_MAX_TASKS];
+    uint32_t task_count;
+} crash_summary_t;
+
+static esp_reset_reason_t s_reason;
+static bool s_crashed = false;
+static trace_record_t s_trace[CRASH_TRACE_RECORDS];
+static uint32_t s_trace_count = 0;
+static crash_summary_t s_summary;
+static volatile bool s_summary_ready = false;
+
+static const esp_partition_t *s_part = NULL;
+static uint32_t s_image_off = 0;    /* 转储在分区内的偏移 */
+static uint32_t s_image_size = 0;
+
+static const char *reason_name(esp_reset_reason_t reason)
+{
+    switch (reason) {
+        case ESP_RST_PANIC:    return "panic";
+        case ESP_RST_INT_WDT:  return "int_wdt";
+        case ESP_RST_TASK_WDT: return "task_wdt";
+        case ESP_RST_WDT:      return "wdt";
+        default:               return "other";
+    }
+}
+
+static bool is_crash_reason(esp_reset_reason_t reason)
+{
+    return reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+           reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+}
+
+/**
+ * @brief 刷新转储位置，无转储返回 ESP_ERR_NOT_FOUND
+ */
+static esp_err_t image_locate(void)
+{
+    size_t addr = 0;
+    size_t size = 0;
+
+    s_image_size = 0;
+    if (s_part == NULL) {
+        s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_DATA_COREDUMP, NULL);
+        if (s_part == NULL) {
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+    esp_err_t ret = esp_core_dump_image_get(&addr, &size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (addr < s_part->address || addr + size > s_part->address + s_part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    s_image_off = addr - s_part->address;
+    s_image_size = size;
+    return ESP_OK;
+}
+
+static esp_err_t image_read(uint32_t offset, void *buf, size_t len)
+{
+    if (offset > s_image_size || len > s_image_size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return esp_partition_read(s_part, s_image_off + offset, buf, len);
+}
+
+/**
+ * @brief L2CAP 数据源: 转储原始数据
+ */
+static int coredump_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (offset == 0 && image_locate() != ESP_OK) {
+        return -1;
+    }
+    if (offset >= s_image_size) {
+        return 0;
+    }
+    if (len > s_image_size - offset) {
+        len = s_image_size - offset;
+    }
+    return image_read(offset, buf, len) == ESP_OK ? (int)len : -1;
+}
+
+/**
+ * @brief 从 ELF 注释和 TCB 段中提取任务列表
+ */
+static void extract_tasks(crash_summary_t *sum)
+{
+    uint8_t head[CRASH_ELF_SEARCH];
+    uint32_t elf = UINT32_MAX;
+    elf32_ehdr_t eh;
+    elf32_phdr_t ph;
+
+    if (image_read(0, head, sizeof(head)) != ESP_OK) {
+        return;
+    }
+    for (uint32_t i = 0; i + 4 <= sizeof(head); i += 4) {
+        if (memcmp(head + i, "\x7f" "ELF", 4) == 0) {
+            elf = i;
+            break;
+        }
+    }
+    if (elf == UINT32_MAX || image_read(elf, &eh, sizeof(eh)) != ESP_OK ||
+        eh.e_phentsize != sizeof(elf32_phdr_t)) {
+        return;
+    }
+
+    /* 第一遍: 每个任务的 NT_PRSTATUS 给出 TCB 地址和 PC */
+    for (uint32_t i = 0; i < eh.e_phnum && sum->task_count < CRASH_MAX_TASKS; i++) {
+        if (image_read(elf + eh.e_phoff + i * sizeof(ph), &ph, sizeof(ph)) != ESP_OK) {
+            return;
+        }
+        if (ph.p_type != ELF_PT_NOTE) {
+            continue;
+        }
+        uint32_t pos = 0;
+        while (pos + sizeof(elf32_nhdr_t) <= ph.p_filesz && sum->task_count < CRASH_MAX_TASKS) {
+            elf32_nhdr_t nh;
+            char name[9] = {0};
+            uint32_t base = elf + ph.p_offset + pos;
+
+            if (image_read(base, &nh, sizeof(nh)) != ESP_OK) {
+                return;
+            }
+            uint32_t name_len = (nh.namesz + 3) & ~3u;
+            uint32_t desc = base + sizeof(nh) + name_len;
+            if (nh.namesz < sizeof(name)) {
+                image_read(base + sizeof(nh), name, nh.namesz);
+            }
+            if (nh.type == ELF_NT_PRSTATUS && strcmp(name, "CORE") == 0 &&
+                nh.descsz >= PRSTATUS_PC_OFFSET + sizeof(uint32_t)) {
+                crash_task_t *t = &sum->tasks[sum->task_count];
+                if (image_read(desc + PRSTATUS_PID_OFFSET, &t->tcb, sizeof(t->tcb)) == ESP_OK &&
+                    image_read(desc + PRSTATUS_PC_OFFSET, &t->pc, sizeof(t->pc)) == ESP_OK) {
+                    snprintf(t->name, sizeof(t->name), "%08lx", (unsigned long)t->tcb);
+                    sum->task_count++;
+                }
+            }
+            pos += sizeof(nh) + name_len + ((nh.descsz + 3) & ~3u);
+        }
+    }
+
+    if (!sum->names_valid) {
+        return;
+    }
+
+    /* 第二遍: TCB 段内按当前固件的 TCB 布局读取任务名 */
+    for (uint32_t i = 0; i < eh.e_phnum; i++) {
+        if (image_read(elf + eh.e_phoff + i * sizeof(ph), &ph, sizeof(ph)) != ESP_OK) {
+            return;
+        }
+        if (ph.p_type != ELF_PT_LOAD || ph.p_filesz < sizeof(StaticTask_t)) {
+            continue;
+        }
+        for (uint32_t t = 0; t < sum->task_count; t++) {
+            if (sum->tasks[t].tcb != ph.p_vaddr) {
+                continue;
+            }
+            char name[CRASH_TASK_NAME_LEN] = {0};
+            size_t len = sizeof(name) - 1;
+            if (len > configMAX_TASK_NAME_LEN) {
+                len = configMAX_TASK_NAME_LEN;
+            }
+            if (image_read(elf + ph.p_offset + offsetof(StaticTask_t, ucDummy7), name, len) == ESP_OK &&
+                name[0] != '\0') {
+                strlcpy(sum->tasks[t].name, name, sizeof(sum->tasks[t].name));
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 读取 Flash 中的转储并生成摘要 (只在摘要任务中、上线后调用)
+ */
+static void build_summary(crash_summary_t *sum)
+{
+    memset(sum, 0, sizeof(*sum));
+    if (image_locate() != ESP_OK) {
+        return;
+    }
+    sum->has_dump = true;
+    sum->dump_size = s_image_size;
+    if (esp_core_dump_image_check() != ESP_OK) {
+        ESP_LOGW(TAG, "Core dump checksum mismatch");
+        return;
+    }
+
+    esp_core_dump_summary_t *cd = malloc(sizeof(*cd));
+    if (cd == NULL) {
+        return;
+    }
+    if (esp_core_dump_get_summary(cd) != ESP_OK) {
+        free(cd);
+        return;
+    }
+
+    char running[CRASH_TASK_NAME_LEN];
+
+    sum->dump_valid = true;
+    strlcpy(sum->task, cd->exc_task, sizeof(sum->task));
+    strlcpy(sum->elf, (const char *)cd->app_elf_sha256, sizeof(sum->elf));
+    esp_app_get_elf_sha256(running, sizeof(running));
+    sum->names_valid = sum->elf[0] != '\0' &&
+                       strncmp(running, sum->elf, strlen(sum->elf)) == 0;
+    sum->pc = cd->exc_pc;
+    sum->ra = cd->ex_info.ra;
+    sum->sp = cd->ex_info.sp;
+    sum->mcause = cd->ex_info.mcause;
+    sum->mtval = cd->ex_info.mtval;
+
+    /* RISC-V 转储不含回溯，取栈中指向可执行区的字作为候选返回地址 */
+    const uint32_t *words = (const uint32_t *)cd->exc_bt_info.stackdump;
+    uint32_t count = cd->exc_bt_info.dump_size / sizeof(uint32_t);
+    for (uint32_t i = 0; i < count && sum->bt_depth < CRASH_BT_DEPTH; i++) {
+        if (esp_ptr_executable((void *)(uintptr_t)words[i])) {
+            sum->bt[sum->bt_depth++] = words[i];
+        }
+    }
+    free(cd);
+
+    esp_core_dump_get_panic_reason(sum->panic, sizeof(sum->panic));
+    extract_tasks(sum);
+}
+
+/**
+ * @brief 摘要序列化为 JSON
+ *
+ * 格式: {"reason":..,"dump":size,"task":..,"panic":..,"pc":..,"ra":..,"sp":..,
+ *        "mcause":..,"mtval":..,"elf":..,"bt":[..],"tasks":[[name,pc],..],
+ *        "trace":[[ts_us,src,evt,a16,a0,a1],..]}，地址为十六进制字符串
+ */
+static int summary_to_json(const crash_summary_t *sum, char *buf, size_t len)
+{
+    size_t pos = 0;
+    int n;
+
+#define APPEND(...) do { \
+        n = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n < 0 || (size_t)n >= len - pos) return -1; \
+        pos += n; \
+    } while (0)
+
+    APPEND("{\"reason\":\"%s\",\"dump\":%lu", reason_name(s_reason),
+           (unsigned long)(sum->has_dump ? sum->dump_size : 0));
+    if (sum->dump_valid) {
+        /* panic 描述来自 IDF，不含引号和反斜杠 */
+        APPEND(",\"task\":\"%s\",\"panic\":\"%s\",\"pc\":\"%08lx\",\"ra\":\"%08lx\","
+               "\"sp\":\"%08lx\",\"mcause\":%lu,\"mtval\":\"%08lx\",\"elf\":\"%s\",\"bt\":[",
+               sum->task, sum->panic, (unsigned long)sum->pc, (unsigned long)sum->ra,
+               (unsigned long)sum->sp, (unsigned long)sum->mcause, (unsigned long)sum->mtval,
+               sum->elf);
+        for (uint32_t i = 0; i < sum->bt_depth; i++) {
+            APPEND("%s\"%08lx\"", i ? "," : "", (unsigned long)sum->bt[i]);
+        }
+        APPEND("],\"tasks\":[");
+        for (uint32_t i = 0; i < sum->task_count; i++) {
+            APPEND("%s[\"%s\",\"%08lx\"]", i ? "," : "", sum->tasks[i].name,
+                   (unsigned long)sum->tasks[i].pc);
+        }
+        APPEND("]");
+    } else if (sum->has_dump) {
+        APPEND(",\"corrupt\":true");
+    }
+    APPEND(",\"trace\":[");
+    for (uint32_t i = 0; i < s_trace_count; i++) {
+        const trace_record_t *r = &s_trace[i];
+        APPEND("%s[%lu,%u,%u,%u,%lu,%lu]", i ? "," : "", (unsigned long)r->ts_us,
+               r->src, r->evt, r->a16, (unsigned long)r->a0, (unsigned long)r->a1);
+    }
+    APPEND("]}");
+
+#undef APPEND
+    return (int)pos;
+}
+
+/**
+ * @brief 摘要任务: 上线后读取转储、发布摘要，随后退出
+ */
+static void crash_report_task(void *pvParameters)
+{
+    static char json[CRASH_JSON_SIZE];
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    build_summary(&s_summary);
+    s_summary_ready = true;
+
+    int len = summary_to_json(&s_summary, json, sizeof(json));
+    if (len > 0) {
+        esp_err_t ret = ha_mqtt_publish_telemetry("crash", json);
+        ESP_LOGW(TAG, "Crash summary (%s, dump %lu bytes) %s", reason_name(s_reason),
+                 (unsigned long)s_summary.dump_size, ret == ESP_OK ? "published" : "publish failed");
+    }
+
+    vTaskDelete(NULL);
+}
+
+void crash_report_online(void)
+{
+    TaskHandle_t handle = app_task_handle(APP_TASK_CRASH_REPORT);
+
+    if (handle != NULL) {
+        xTaskNotifyGive(handle);
+    }
+}
+
+/**
+ * @brief CORE 命令: 转储状态与摘要，"CORE ERASE" 擦除转储
+ */
+static esp_err_t cmd_core(int argc, char **argv, const diag_out_t *out)
+{
+    if (argc >= 2 && strcasecmp(argv[1], "ERASE") == 0) {
+        if (!diag_cmd_check_local(out)) {
+            return ESP_ERR_NOT_ALLOWED;
+        }
+        esp_err_t ret = esp_core_dump_image_erase();
+        diag_printf(out, "core erase: %s\r\n", esp_err_to_name(ret));
+        return ret;
+    }
+
+    esp_err_t ret = image_locate();
+    diag_printf(out, "reset %s (%d), dump %s %lu bytes\r\n", reason_name(s_reason), s_reason,
+                ret == ESP_OK ? "present" : esp_err_to_name(ret), (unsigned long)s_image_size);
+    if (!s_summary_ready) {
+        diag_printf(out, "summary %s\r\n", s_crashed ? "pending" : "not generated");
+        return ESP_OK;
+    }
+
+    const crash_summary_t *sum = &s_summary;
+    if (!sum->dump_valid) {
+        diag_printf(out, "summary: no valid dump\r\n");
+        return ESP_OK;
+    }
+    diag_printf(out, "task %s pc %08lx ra %08lx mcause %lu: %s\r\n", sum->task,
+                (unsigned long)sum->pc, (unsigned long)sum->ra, (unsigned long)sum->mcause,
+                sum->panic);
+    for (uint32_t i = 0; i < sum->task_count; i++) {
+        diag_printf(out, "  %-16s pc %08lx\r\n", sum->tasks[i].name, (unsigned long)sum->tasks[i].pc);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t handle_coredump_get(httpd_req_t *req)
+{
+    if (!http_api_authorized(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    if (image_locate() != ESP_OK) {
+        httpd_resp_set_status(req, "404 Not Found");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    uint8_t *buf = malloc(CRASH_CHUNK_SIZE);
+    if (buf == NULL) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"core.bin\"");
+
+    esp_err_t ret = ESP_OK;
+    for (uint32_t off = 0; off < s_image_size && ret == ESP_OK; off += CRASH_CHUNK_SIZE) {
+        size_t n = s_image_size - off < CRASH_CHUNK_SIZE ? s_image_size - off : CRASH_CHUNK_SIZE;
+        ret = image_read(off, buf, n);
+        if (ret == ESP_OK) {
+            ret = httpd_resp_send_chunk(req, (const char *)buf, n);
+        }
+    }
+    free(buf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t handle_coredump_delete(httpd_req_t *req)
+{
+    if (!http_api_authorized(req)) {
+        httpd_resp_set_status(req, "401 Unauthorized");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    esp_err_t ret = esp_core_dump_image_erase();
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, ret == ESP_OK ? "{\"ok\":true}" : "{\"error\":\"erase\"}");
+}
+
+esp_err_t crash_report_register_http(httpd_handle_t server)
+{
+    static const httpd_uri_t uris[] = {
+        { .uri = "/api/coredump", .method = HTTP_GET,    .handler = handle_coredump_get },
+        { .uri = "/api/coredump", .method = HTTP_DELETE, .handler = handle_coredump_delete },
+    };
+
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        esp_err_t ret = httpd_register_uri_handler(server, &uris[i]);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t crash_report_init(void)
+{
+    s_reason = esp_reset_reason();
+    s_crashed = is_crash_reason(s_reason);
+
+    bt_l2cap_register_source(BT_L2CAP_STREAM_COREDUMP, coredump_read);
+    diag_cmd_register("CORE", "core dump status and crash summary, CORE ERASE clears dump",
+                      cmd_core, DIAG_ACCESS_REMOTE);
+
+    if (!s_crashed) {
+        return ESP_OK;
+    }
+
+    /* trace_init 刚写入本次启动记录，之前的就是崩溃前的最后几条事件 */
+    trace_record_t recent[CRASH_TRACE_RECORDS + 4];
+    size_t n = trace_snapshot(recent, CRASH_TRACE_RECORDS + 4);
+    size_t boot = n;
+    while (boot > 0 && !(recent[boot - 1].src == TRACE_SRC_SYS &&
+                         recent[boot - 1].evt == TRACE_EVT_BOOT)) {
+        boot--;
+    }
+    if (boot > 0) {
+        size_t first = boot - 1 > CRASH_TRACE_RECORDS ? boot - 1 - CRASH_TRACE_RECORDS : 0;
+        s_trace_count = boot - 1 - first;
+        memcpy(s_trace, &recent[first], s_trace_count * sizeof(trace_record_t));
+    }
+
+    if (app_task_create(APP_TASK_CRASH_REPORT, crash_report_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create crash report task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGW(TAG, "Reset by %s, summary deferred until online", reason_name(s_reason));
+    return ESP_OK;
+}
+
+#else /* !CONFIG_CRASH_REPORT_ENABLE */
+
+esp_err_t crash_report_init(void)
+{
+    return ESP_OK;
+}
+
+void crash_report_online(void)
+{
+}
+
+esp_err_t crash_report_register_http(httpd_handle_t server)
+{
+    return ESP_OK;
+}
+
+#endif /* CONFIG_CRASH_REPORT_ENABLE */
@@ -0,0 +1,220 @@
+/**
+ * @file diag_cmd.c
+ * @brief 诊断命令分发实现
+ */
+
+#include "diag_cmd.h"
+#include "app_rtos.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+
+static const char *TAG = "diag_cmd";
+
+/* 全部可选模块 (FAULT/SOAK/BENCH/HTTP/WS/COAP 等) 开启时共 25 条，含 HELP */
+#define DIAG_CMD_MAX        32
+#define DIAG_PRINTF_BUF     128
+#define DIAG_QUEUE_LEN      4
+
+typedef struct {
+    const char *name;
+    const char *help;
+    diag_cmd_handler_t handler;
+    diag_access_t access;
+} diag_cmd_entry_t;
+
+/* 提交到 diag 任务的命令 */
+typedef struct {
+    char line[DIAG_CMD_LINE_MAX];
+    const diag_out_t *out;
+    diag_done_fn_t done;
+} diag_job_t;
+
+static diag_cmd_entry_t s_cmds[DIAG_CMD_MAX];
+static volatile int s_cmd_count = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t s_jobs = NULL;
+static diag_cmd_hook_t s_hook = NULL;
+
+/**
+ * @brief 列出当前通道可执行的命令
+ */
+static esp_err_t cmd_help(int argc, char **argv, const diag_out_t *out)
+{
+    int count = s_cmd_count;
+
+    for (int i = 0; i < count; i++) {
+        if (out->local || s_cmds[i].access == DIAG_ACCESS_REMOTE) {
+            diag_printf(out, "%-8s %s\r\n", s_cmds[i].name, s_cmds[i].help);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t diag_cmd_register(const char *name, const char *help, diag_cmd_handler_t handler,
+                            diag_access_t access)
+{
+    if (name == NULL || handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&s_lock);
+    if (s_cmd_count == 0) {
+        /* 首次注册时加入内置 HELP */
+        s_cmds[s_cmd_count++] = (diag_cmd_entry_t){ "HELP", "list commands", cmd_help, DIAG_ACCESS_REMOTE };
+    }
+    if (s_cmd_count >= DIAG_CMD_MAX) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        /* 先写表项再增加计数，执行方无需加锁 */
+        s_cmds[s_cmd_count] = (diag_cmd_entry_t){ name, help ? help : "", handler, access };
+        s_cmd_count = s_cmd_count + 1;
+    }
+    diag_cmd_hook_t hook = s_hook;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret != ESP_OK) {
+        /* 注册都在初始化阶段，表满说明新增模块后未调整 DIAG_CMD_MAX，首次启动即暴露 */
+        ESP_LOGE(TAG, "Command table full (%d), cannot register %s", DIAG_CMD_MAX, name);
+        assert(ret == ESP_OK);
+    } else if (hook != NULL) {
+        hook(name, help ? help : "");
+    }
+    return ret;
+}
+
+void diag_cmd_set_register_hook(diag_cmd_hook_t hook)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_hook = hook;
+    int count = s_cmd_count;
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; hook != NULL && i < count; i++) {
+        hook(s_cmds[i].name, s_cmds[i].help);
+    }
+}
+
+esp_err_t diag_cmd_execute(const char *line, const diag_out_t *out)
+{
+    char buf[DIAG_CMD_LINE_MAX];
+    char *argv[DIAG_CMD_MAX_ARGS];
+    int argc = 0;
+    char *save = NULL;
+
+    if (line == NULL || out == NULL || out->fn == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    strlcpy(buf, line, sizeof(buf));
+    for (char *tok = strtok_r(buf, " \t\r\n", &save);
+         tok != NULL && argc < DIAG_CMD_MAX_ARGS;
+         tok = strtok_r(NULL, " \t\r\n", &save)) {
+        argv[argc++] = tok;
+    }
+    if (argc == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int count = s_cmd_count;
+    for (int i = 0; i < count; i++) {
+        if (strcasecmp(argv[0], s_cmds[i].name) == 0) {
+            if (s_cmds[i].access != DIAG_ACCESS_REMOTE && !diag_cmd_check_local(out)) {
+                return ESP_ERR_NOT_ALLOWED;
+            }
+            ESP_LOGI(TAG, "Executing %s", s_cmds[i].name);
+            return s_cmds[i].handler(argc, argv, out);
+        }
+    }
+
+    ESP_LOGW(TAG, "Unknown command: %s", argv[0]);
+    return ESP_ERR_NOT_FOUND;
+}
+
+static void diag_task(void *pvParameters)
+{
+    static diag_job_t job;
+
+    while (1) {
+        if (xQueueReceive(s_jobs, &job, portMAX_DELAY) == pdTRUE) {
+            esp_err_t ret = diag_cmd_execute(job.line, job.out);
+            if (job.done != NULL) {
+                job.done(ret, job.out);
+            }
+        }
+    }
+}
+
+esp_err_t diag_cmd_start(void)
+{
+    s_jobs = xQueueCreate(DIAG_QUEUE_LEN, sizeof(diag_job_t));
+    if (s_jobs == NULL || app_task_create(APP_TASK_DIAG, diag_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create diag task");
+        if (s_jobs != NULL) {
+            vQueueDelete(s_jobs);
+            s_jobs = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t diag_cmd_submit(const char *line, const diag_out_t *out, diag_done_fn_t done)
+{
+    diag_job_t job = { .out = out, .done = done };
+
+    if (line == NULL || out == NULL || out->fn == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_jobs == NULL) {
+        esp_err_t ret = diag_cmd_execute(line, out);
+        if (done != NULL) {
+            done(ret, out);
+        }
+        return ESP_OK;
+    }
+
+    strlcpy(job.line, line, sizeof(job.line));
+    if (xQueueSend(s_jobs, &job, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Diag queue full, dropping: %s", job.line);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool diag_cmd_check_local(const diag_out_t *out)
+{
+    if (out->local) {
+        return true;
+    }
+    /* BLE NUS 与 MQTT 诊断主题没有认证，改变状态的命令只接受串口 */
+    ESP_LOGW(TAG, "Refusing state-changing command from a remote channel");
+    diag_printf(out, "DENIED: UART only\r\n");
+    return false;
+}
+
+void diag_printf(const diag_out_t *out, const char *fmt, ...)
+{
+    char buf[DIAG_PRINTF_BUF];
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    out->fn(buf, (size_t)len, out->ctx);
+}
@@ -0,0 +1,147 @@
+/**
+ * @file diag_console.c
+ * @brief UART 诊断控制台实现
+ */
+
+#include "diag_console.h"
+
+#if CONFIG_DIAG_CONSOLE_ENABLE
+
+#include "diag_cmd.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_console.h"
+#include "esp_log.h"
+
+static const char *TAG = "diag_con";
+
+#define CONSOLE_PROMPT          "lock>"
+#define CONSOLE_TASK_STACK      4096
+#define CONSOLE_TASK_PRIORITY   1       /* 与 diag 任务相同，只在空闲时读串口 */
+
+static SemaphoreHandle_t s_done = NULL;
+static SemaphoreHandle_t s_reg_lock = NULL;
+static esp_err_t s_ret;
+
+static void console_out(const char *text, size_t len, void *ctx)
+{
+    fwrite(text, 1, len, stdout);
+}
+
+static void console_done(esp_err_t ret, const diag_out_t *out)
+{
+    s_ret = ret;
+    fflush(stdout);
+    xSemaphoreGive(s_done);
+}
+
+/**
+ * @brief 所有诊断命令共用的 esp_console 入口，在 REPL 任务中调用
+ *
+ * 参数重新拼成一行交给 diag 任务，等待执行完成后返回。
+ */
+static int console_cmd(int argc, char **argv)
+{
+    static const diag_out_t out = { .fn = console_out, .ctx = NULL, .local = true };
+    char line[DIAG_CMD_LINE_MAX];
+    size_t pos = 0;
+
+    line[0] = '\0';
+    for (int i = 0; i < argc && pos < sizeof(line); i++) {
+        pos += snprintf(line + pos, sizeof(line) - pos, i ? " %s" : "%s", argv[i]);
+    }
+
+    if (diag_cmd_submit(line, &out, console_done) != ESP_OK) {
+        printf("BUSY\n");
+        return 1;
+    }
+    xSemaphoreTake(s_done, portMAX_DELAY);
+
+    if (s_ret == ESP_ERR_NOT_FOUND) {
+        printf("UNKNOWN\n");
+    }
+    return s_ret == ESP_OK ? 0 : 1;
+}
+
+/**
+ * @brief 诊断命令注册通知: 同名注册到 esp_console (HELP 由 esp_console 的 help 代替)
+ */
+static void console_register(const char *name, const char *help)
+{
+    if (strcasecmp(name, "HELP") == 0) {
+        return;
+    }
+
+    const esp_console_cmd_t cmd = {
+        .command = name,
+        .help = help,
+        .func = console_cmd,
+    };
+
+    /* esp_console 命令链表不加锁，各模块可能在不同任务中注册 */
+    xSemaphoreTake(s_reg_lock, portMAX_DELAY);
+    esp_err_t ret = esp_console_cmd_register(&cmd);
+    xSemaphoreGive(s_reg_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to register %s: %s", name, esp_err_to_name(ret));
+    }
+}
+
+esp_err_t diag_console_start(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_cfg = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    esp_err_t ret;
+
+    s_done = xSemaphoreCreateBinary();
+    s_reg_lock = xSemaphoreCreateMutex();
+    if (s_done == NULL || s_reg_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create semaphores");
+        return ESP_ERR_NO_MEM;
+    }
+
+    repl_cfg.prompt = CONSOLE_PROMPT;
+    repl_cfg.max_cmdline_length = DIAG_CMD_LINE_MAX;
+    repl_cfg.task_stack_size = CONSOLE_TASK_STACK;
+    repl_cfg.task_priority = CONSOLE_TASK_PRIORITY;
+
+#if CONFIG_ESP_CONSOLE_UART_DEFAULT || CONFIG_ESP_CONSOLE_UART_CUSTOM
+    esp_console_dev_uart_config_t hw_cfg = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_uart(&hw_cfg, &repl_cfg, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    esp_console_dev_usb_serial_jtag_config_t hw_cfg = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_usb_serial_jtag(&hw_cfg, &repl_cfg, &repl);
+#else
+    ret = ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create console: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    esp_console_register_help_command();
+    diag_cmd_set_register_hook(console_register);
+
+    ret = esp_console_start_repl(repl);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start console: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Diagnostics console started");
+    return ESP_OK;
+}
+
+#else /* !CONFIG_DIAG_CONSOLE_ENABLE */
+
+esp_err_t diag_console_start(void)
+{
+    return ESP_OK;
+}
+
+#endif /* CONFIG_DIAG_CONSOLE_ENABLE */
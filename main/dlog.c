@@ -0,0 +1,238 @@
+/**
+ * @file dlog.c
+ * @brief 延迟二进制日志实现
+ */
+
+#include "dlog.h"
+#include "diag_cmd.h"
+#include "bt_l2cap.h"
+#include "app_rtos.h"
+#include "supervisor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+
+static const char *TAG = "dlog";
+
+#if CONFIG_DLOG_ENABLE
+
+#define DLOG_RING_MASK      (CONFIG_DLOG_RING_SIZE - 1)
+#define DLOG_LINE_MAX       160
+#define DLOG_BENCH_COUNT    16
+
+_Static_assert((CONFIG_DLOG_RING_SIZE & DLOG_RING_MASK) == 0,
+               "CONFIG_DLOG_RING_SIZE must be a power of two");
+#if UINTPTR_MAX == 0xFFFFFFFF
+_Static_assert(sizeof(dlog_record_t) == 32, "dlog_record_t layout is part of the dump format");
+#endif
+
+static dlog_record_t s_ring[CONFIG_DLOG_RING_SIZE];
+static uint32_t s_head = 0;         /* 写入总数 */
+static uint32_t s_dropped = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* 转储快照 */
+static dlog_dump_header_t s_dump_hdr;
+
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt, uint32_t nargs,
+                uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint32_t ts = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    uint32_t idx = s_head++;
+    dlog_record_t *rec = &s_ring[idx & DLOG_RING_MASK];
+    rec->ts_us = ts;
+    rec->tag = tag;
+    rec->fmt = fmt;
+    rec->level = (uint8_t)level;
+    rec->nargs = (uint8_t)nargs;
+    rec->seq = (uint16_t)idx;
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+    rec->args[3] = a3;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+static char level_letter(uint8_t level)
+{
+    static const char letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+    return level < sizeof(letters) ? letters[level] : '?';
+}
+
+#if CONFIG_DLOG_DRAIN_TASK
+/**
+ * @brief 排空任务: 在低优先级上下文中格式化并输出
+ */
+static void dlog_drain_task(void *pvParameters)
+{
+    uint32_t tail = 0;
+    dlog_record_t rec;
+    char line[DLOG_LINE_MAX];
+
+    supervisor_register(APP_TASK_DLOG,
+                        SUPERVISOR_BACKGROUND_HEARTBEAT_MS(CONFIG_DLOG_DRAIN_PERIOD_MS), 0, NULL);
+
+    while (1) {
+        supervisor_heartbeat(APP_TASK_DLOG);
+        while (1) {
+            uint32_t lost = 0;
+
+            portENTER_CRITICAL(&s_lock);
+            if (tail == s_head) {
+                portEXIT_CRITICAL(&s_lock);
+                break;
+            }
+            /* 落后超过一圈时跳到最旧的有效记录 */
+            if (s_head - tail > CONFIG_DLOG_RING_SIZE) {
+                lost = s_head - CONFIG_DLOG_RING_SIZE - tail;
+                tail = s_head - CONFIG_DLOG_RING_SIZE;
+                s_dropped += lost;
+            }
+            rec = s_ring[tail & DLOG_RING_MASK];
+            tail++;
+            portEXIT_CRITICAL(&s_lock);
+
+            if (lost > 0) {
+                ESP_LOGW(TAG, "%lu records lost", (unsigned long)lost);
+            }
+
+            /* RV32 上 int/指针/uint32_t 均按一个 32 位字传递 */
+            snprintf(line, sizeof(line), rec.fmt,
+                     rec.args[0], rec.args[1], rec.args[2], rec.args[3]);
+            esp_log_write((esp_log_level_t)rec.level, rec.tag, "%c (%lu) %s: %s\n",
+                          level_letter(rec.level), (unsigned long)(rec.ts_us / 1000),
+                          rec.tag, line);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DLOG_DRAIN_PERIOD_MS));
+    }
+}
+#endif /* CONFIG_DLOG_DRAIN_TASK */
+
+int dlog_dump_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (offset == 0) {
+        portENTER_CRITICAL(&s_lock);
+        s_dump_hdr.magic = DLOG_MAGIC;
+        s_dump_hdr.record_size = sizeof(dlog_record_t);
+        s_dump_hdr.head = s_head;
+        s_dump_hdr.count = s_head < CONFIG_DLOG_RING_SIZE ? s_head : CONFIG_DLOG_RING_SIZE;
+        s_dump_hdr.dropped = s_dropped;
+        portEXIT_CRITICAL(&s_lock);
+    }
+
+    size_t total = sizeof(s_dump_hdr) + (size_t)s_dump_hdr.count * sizeof(dlog_record_t);
+    if (offset >= total) {
+        return 0;
+    }
+    if (len > total - offset) {
+        len = total - offset;
+    }
+
+    size_t done = 0;
+    while (done < len) {
+        size_t pos = offset + done;
+        size_t n;
+
+        if (pos < sizeof(s_dump_hdr)) {
+            n = sizeof(s_dump_hdr) - pos;
+            if (n > len - done) {
+                n = len - done;
+            }
+            memcpy(buf + done, (const uint8_t *)&s_dump_hdr + pos, n);
+        } else {
+            size_t rel = pos - sizeof(s_dump_hdr);
+            uint32_t idx = s_dump_hdr.head - s_dump_hdr.count + rel / sizeof(dlog_record_t);
+            size_t rec_off = rel % sizeof(dlog_record_t);
+            dlog_record_t rec;
+
+            /* 转储期间被覆盖的记录由主机端通过 seq 识别 */
+            portENTER_CRITICAL(&s_lock);
+            rec = s_ring[idx & DLOG_RING_MASK];
+            portEXIT_CRITICAL(&s_lock);
+
+            n = sizeof(rec) - rec_off;
+            if (n > len - done) {
+                n = len - done;
+            }
+            memcpy(buf + done, (const uint8_t *)&rec + rec_off, n);
+        }
+        done += n;
+    }
+    return (int)done;
+}
+
+/**
+ * @brief DLOG 命令: 对比延迟日志与同步日志的单条开销
+ */
+static esp_err_t cmd_dlog(int argc, char **argv, const diag_out_t *out)
+{
+    char line[DLOG_LINE_MAX];
+    uint32_t start;
+
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < DLOG_BENCH_COUNT; i++) {
+        DLOGI(TAG, "bench %d/%d", i, DLOG_BENCH_COUNT);
+    }
+    uint32_t dlog_cycles = (esp_cpu_get_cycle_count() - start) / DLOG_BENCH_COUNT;
+
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < DLOG_BENCH_COUNT; i++) {
+        snprintf(line, sizeof(line), "bench %d/%d", i, DLOG_BENCH_COUNT);
+    }
+    uint32_t fmt_cycles = (esp_cpu_get_cycle_count() - start) / DLOG_BENCH_COUNT;
+
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < DLOG_BENCH_COUNT; i++) {
+        ESP_LOGI(TAG, "bench %d/%d", i, DLOG_BENCH_COUNT);
+    }
+    uint32_t log_cycles = (esp_cpu_get_cycle_count() - start) / DLOG_BENCH_COUNT;
+
+    diag_printf(out, "cycles/call: dlog %lu, format %lu, esp_log %lu\r\n",
+                (unsigned long)dlog_cycles, (unsigned long)fmt_cycles,
+                (unsigned long)log_cycles);
+    diag_printf(out, "records %lu dropped %lu\r\n",
+                (unsigned long)s_head, (unsigned long)s_dropped);
+    return ESP_OK;
+}
+
+esp_err_t dlog_init(void)
+{
+    diag_cmd_register("DLOG", "deferred log stats and per-call cost", cmd_dlog, DIAG_ACCESS_REMOTE);
+    bt_l2cap_register_source(BT_L2CAP_STREAM_DLOG, dlog_dump_read);
+
+#if CONFIG_DLOG_DRAIN_TASK
+    if (app_task_create(APP_TASK_DLOG, dlog_drain_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create dlog drain task");
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+
+    ESP_LOGI(TAG, "Deferred log ring: %d records", CONFIG_DLOG_RING_SIZE);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_DLOG_ENABLE */
+
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt, uint32_t nargs,
+                uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+}
+
+esp_err_t dlog_init(void)
+{
+    return ESP_OK;
+}
+
+int dlog_dump_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    return 0;
+}
+
+#endif /* CONFIG_DLOG_ENABLE */
@@ -0,0 +1,286 @@
+/**
+ * @file fault_inject.c
+ * @brief 故障注入实现
+ */
+
+#include "fault_inject.h"
+#include "diag_cmd.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "fault_inject";
+
+static const char *const s_fault_names[FAULT_MAX] = {
+    "queue", "wifi", "mqtt", "ble", "servo",
+};
+
+fault_id_t fault_inject_find(const char *name)
+{
+    for (int i = 0; i < FAULT_MAX; i++) {
+        if (name != NULL && strcasecmp(name, s_fault_names[i]) == 0) {
+            return (fault_id_t)i;
+        }
+    }
+    return FAULT_MAX;
+}
+
+const char *fault_inject_name(fault_id_t id)
+{
+    return id < FAULT_MAX ? s_fault_names[id] : "?";
+}
+
+#if CONFIG_FAULT_INJECT_ENABLE
+
+typedef struct {
+    uint32_t remaining;
+    uint16_t permille;
+    uint32_t hits;
+    uint32_t injected;
+    uint32_t recoveries;
+    uint32_t last_ms;
+    uint32_t max_ms;
+    uint64_t total_ms;
+    int64_t since_us;       /* 本次故障首次注入时间 */
+    fault_trigger_t trigger;
+} fault_state_t;
+
+volatile uint32_t fault_inject_armed_mask = 0;
+volatile uint32_t fault_inject_pending_mask = 0;
+
+static fault_state_t s_faults[FAULT_MAX];
+static uint32_t s_rand = 0x2545F491;   /* 固定种子，仿真结果可复现 */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* xorshift32，调用方持有 s_lock */
+static uint32_t next_random(void)
+{
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return s_rand;
+}
+
+bool fault_inject_hit(fault_id_t id)
+{
+    fault_state_t *f = &s_faults[id];
+    const uint32_t bit = 1UL << id;
+    int64_t now = esp_timer_get_time();
+    bool inject = false;
+    uint32_t injected;
+
+    portENTER_CRITICAL(&s_lock);
+    if (f->remaining > 0) {
+        f->hits++;
+        if (f->permille >= 1000 || next_random() % 1000 < f->permille) {
+            inject = true;
+            f->injected++;
+            if (--f->remaining == 0) {
+                fault_inject_armed_mask &= ~bit;
+            }
+            if ((fault_inject_pending_mask & bit) == 0) {
+                f->since_us = now;
+                fault_inject_pending_mask |= bit;
+            }
+        }
+    }
+    injected = f->injected;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (inject) {
+        TRACE(TRACE_SRC_SYS, TRACE_EVT_FAULT_INJECT, id, injected, 0);
+    }
+    return inject;
+}
+
+void fault_inject_recovered(fault_id_t id)
+{
+    fault_state_t *f = &s_faults[id];
+    const uint32_t bit = 1UL << id;
+    int64_t now = esp_timer_get_time();
+    bool recovered = false;
+    uint32_t ms = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    if (fault_inject_pending_mask & bit) {
+        fault_inject_pending_mask &= ~bit;
+        ms = (uint32_t)((now - f->since_us) / 1000);
+        f->recoveries++;
+        f->last_ms = ms;
+        f->total_ms += ms;
+        if (ms > f->max_ms) {
+            f->max_ms = ms;
+        }
+        recovered = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (recovered) {
+        TRACE(TRACE_SRC_SYS, TRACE_EVT_FAULT_RECOVER, id, 0, ms);
+        ESP_LOGI(TAG, "Fault %s recovered in %lu ms", s_fault_names[id], (unsigned long)ms);
+    }
+}
+
+esp_err_t fault_inject_arm(fault_id_t id, uint32_t count, uint16_t permille)
+{
+    if (id >= FAULT_MAX || (count > 0 && (permille == 0 || permille > 1000))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    fault_state_t *f = &s_faults[id];
+    const uint32_t bit = 1UL << id;
+
+    portENTER_CRITICAL(&s_lock);
+    f->remaining = count;
+    f->permille = permille;
+    if (count > 0) {
+        fault_inject_armed_mask |= bit;
+    } else {
+        fault_inject_armed_mask &= ~bit;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (count > 0) {
+        ESP_LOGW(TAG, "Armed %s: %lu failures at %u permille", s_fault_names[id],
+                 (unsigned long)count, permille);
+    } else {
+        ESP_LOGI(TAG, "Disarmed %s", s_fault_names[id]);
+    }
+
+    /* 触发型故障在布防时执行第一次注入 */
+    if (count > 0 && f->trigger != NULL && fault_inject_hit(id)) {
+        f->trigger();
+    }
+    return ESP_OK;
+}
+
+void fault_inject_set_trigger(fault_id_t id, fault_trigger_t trigger)
+{
+    if (id < FAULT_MAX) {
+        s_faults[id].trigger = trigger;
+    }
+}
+
+esp_err_t fault_inject_get_stats(fault_id_t id, fault_stats_t *out)
+{
+    if (id >= FAULT_MAX || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const fault_state_t *f = &s_faults[id];
+
+    portENTER_CRITICAL(&s_lock);
+    *out = (fault_stats_t){
+        .remaining = f->remaining,
+        .permille = f->permille,
+        .hits = f->hits,
+        .injected = f->injected,
+        .recoveries = f->recoveries,
+        .last_ms = f->last_ms,
+        .max_ms = f->max_ms,
+        .avg_ms = f->recoveries ? (uint32_t)(f->total_ms / f->recoveries) : 0,
+        .pending = (fault_inject_pending_mask & (1UL << id)) != 0,
+    };
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief FAULT 命令:
+ *   FAULT                          各类故障的布防状态与恢复时间
+ *   FAULT <类别> <次数> [概率‰]    布防，概率默认 1000
+ *   FAULT <类别> OFF               撤防
+ *   FAULT CLEAR                    撤防全部并清零统计
+ */
+static esp_err_t cmd_fault(int argc, char **argv, const diag_out_t *out)
+{
+    if (argc >= 2 && strcasecmp(argv[1], "CLEAR") == 0) {
+        portENTER_CRITICAL(&s_lock);
+        for (int i = 0; i < FAULT_MAX; i++) {
+            fault_trigger_t trigger = s_faults[i].trigger;
+            s_faults[i] = (fault_state_t){ .trigger = trigger };
+        }
+        fault_inject_armed_mask = 0;
+        fault_inject_pending_mask = 0;
+        portEXIT_CRITICAL(&s_lock);
+        diag_printf(out, "OK\r\n");
+        return ESP_OK;
+    }
+
+    if (argc >= 3) {
+        fault_id_t id = fault_inject_find(argv[1]);
+        if (id == FAULT_MAX) {
+            diag_printf(out, "unknown fault %s (queue/wifi/mqtt/ble/servo)\r\n", argv[1]);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        uint32_t count = 0;
+        uint16_t permille = 1000;
+        if (strcasecmp(argv[2], "OFF") != 0) {
+            count = strtoul(argv[2], NULL, 10);
+            if (argc >= 4) {
+                permille = (uint16_t)strtoul(argv[3], NULL, 10);
+            }
+        }
+        esp_err_t ret = fault_inject_arm(id, count, permille);
+        diag_printf(out, "%s\r\n", ret == ESP_OK ? "OK" : esp_err_to_name(ret));
+        return ret;
+    }
+
+    diag_printf(out, "%-6s %9s %6s %6s %5s %7s %7s %7s\r\n",
+                "fault", "armed", "hits", "inject", "recov", "last", "max", "avg");
+    for (int i = 0; i < FAULT_MAX; i++) {
+        fault_stats_t st;
+        char armed[16];
+
+        fault_inject_get_stats((fault_id_t)i, &st);
+        if (st.remaining > 0) {
+            snprintf(armed, sizeof(armed), "%lu@%u", (unsigned long)st.remaining, st.permille);
+        } else {
+            strcpy(armed, "-");
+        }
+        diag_printf(out, "%-6s %9s %6lu %6lu %4lu%s %5lums %5lums %5lums\r\n",
+                    s_fault_names[i], armed, (unsigned long)st.hits,
+                    (unsigned long)st.injected, (unsigned long)st.recoveries,
+                    st.pending ? "*" : " ", (unsigned long)st.last_ms,
+                    (unsigned long)st.max_ms, (unsigned long)st.avg_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t fault_inject_init(void)
+{
+    diag_cmd_register("FAULT", "fault injection: FAULT [<queue|wifi|mqtt|ble|servo> <n|OFF> [permille]|CLEAR]",
+                      cmd_fault, DIAG_ACCESS_LOCAL);
+    ESP_LOGW(TAG, "Fault injection points compiled in");
+    return ESP_OK;
+}
+
+#else /* !CONFIG_FAULT_INJECT_ENABLE */
+
+esp_err_t fault_inject_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t fault_inject_arm(fault_id_t id, uint32_t count, uint16_t permille)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void fault_inject_set_trigger(fault_id_t id, fault_trigger_t trigger)
+{
+}
+
+esp_err_t fault_inject_get_stats(fault_id_t id, fault_stats_t *out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_FAULT_INJECT_ENABLE */
@@ -12,11 +12,19 @@
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "esp_log.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "esp_mac.h"
+#endif
 #include "esp_event.h"
 #include "mqtt_client.h"
 
 #include "ha_mqtt.h"
+#include "app_rtos.h"
+#include "diag_cmd.h"
+#include "dlog.h"
+#include "trace.h"
+#include "fault_inject.h"
+#include "state_shadow.h"
 
 static const char *TAG = "ha_mqtt";
 
@@ -28,11 +36,17 @@ static const char *TAG = "ha_mqtt";
 #define TOPIC_BUF_SIZE 128
 #define PAYLOAD_BUF_SIZE 512
 #define DEVICE_ID_SIZE 16
+#define DIAG_RSP_BUF_SIZE 1024
+#define SUBSCRIPTION_MAX 4
 
 /* 静态变量 */
 static esp_mqtt_client_handle_t s_mqtt_client = NULL;
 static EventGroupHandle_t s_mqtt_event_group = NULL;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticEventGroup_t s_mqtt_event_group_buf;
+#endif
 static ha_mqtt_door_callback_t s_door_callback = NULL;
+static ha_mqtt_connect_callback_t s_connect_callback = NULL;
 static char s_device_id[DEVICE_ID_SIZE] = {0};
 static bool s_initialized = false;
 
@@ -41,6 +55,27 @@ static char s_cmd_topic[TOPIC_BUF_SIZE] = {0};
 static char s_state_topic[TOPIC_BUF_SIZE] = {0};
 static char s_availability_topic[TOPIC_BUF_SIZE] = {0};
 static char s_discovery_topic[TOPIC_BUF_SIZE] = {0};
+static char s_telemetry_prefix[TOPIC_BUF_SIZE] = {0};
+static char s_diag_cmd_topic[TOPIC_BUF_SIZE] = {0};
+static char s_diag_rsp_topic[TOPIC_BUF_SIZE] = {0};
+static char s_device_prefix[TOPIC_BUF_SIZE] = {0};
+
+/* 模块注册的设备主题订阅 */
+typedef struct {
+    const char *suffix;
+    int qos;
+    ha_mqtt_data_callback_t callback;
+} subscription_t;
+static subscription_t s_subscriptions[SUBSCRIPTION_MAX];
+static int s_subscription_count = 0;
+static const subscription_t *s_fragment_sub = NULL;  /* 分片消息的后续分片无主题 */
+
+/* 诊断命令响应缓冲 (仅在 diag 任务中使用，命令串行执行) */
+typedef struct {
+    char buf[DIAG_RSP_BUF_SIZE];
+    size_t len;
+} diag_rsp_t;
+static diag_rsp_t s_diag_rsp;
 
 /* 前向声明 */
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, 
@@ -50,6 +85,22 @@ static void build_topics(void);
 static esp_err_t publish_ha_discovery(void);
 
 
+/**
+ * @brief 发布消息 (门状态、遥测和 ha_mqtt_publish 的公共出口，带故障注入点)
+ */
+static int publish(const char *topic, const char *data, int len, int qos, int retain)
+{
+    if (FAULT_INJECT(FAULT_MQTT_PUBLISH)) {
+        return -1;
+    }
+
+    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, data, len, qos, retain);
+    if (msg_id >= 0) {
+        FAULT_RECOVERED(FAULT_MQTT_PUBLISH);
+    }
+    return msg_id;
+}
+
 /**
  * @brief 生成设备 ID
  * 
@@ -69,7 +120,12 @@ static void generate_device_id(void)
     } else {
         /* 使用 MAC 地址后 3 字节生成设备 ID */
         uint8_t mac[6];
+#if CONFIG_IDF_TARGET_LINUX
+        /* 主机仿真没有 MAC */
+        esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+#else
         esp_err_t ret = esp_read_mac(mac, ESP_MAC_WIFI_STA);
+#endif
         
         if (ret == ESP_OK) {
             snprintf(s_device_id, DEVICE_ID_SIZE, "%02x%02x%02x", 
@@ -92,6 +148,10 @@ static void build_topics(void)
     snprintf(s_state_topic, TOPIC_BUF_SIZE, "esp32c6/%s/door/state", s_device_id);
     snprintf(s_availability_topic, TOPIC_BUF_SIZE, "esp32c6/%s/availability", s_device_id);
     snprintf(s_discovery_topic, TOPIC_BUF_SIZE, "homeassistant/switch/%s/door/config", s_device_id);
+    snprintf(s_telemetry_prefix, TOPIC_BUF_SIZE, "esp32c6/%s/telemetry", s_device_id);
+    snprintf(s_diag_cmd_topic, TOPIC_BUF_SIZE, "esp32c6/%s/diag/cmd", s_device_id);
+    snprintf(s_diag_rsp_topic, TOPIC_BUF_SIZE, "esp32c6/%s/diag/rsp", s_device_id);
+    snprintf(s_device_prefix, TOPIC_BUF_SIZE, "esp32c6/%s", s_device_id);
     
     ESP_LOGI(TAG, "Command topic: %s", s_cmd_topic);
     ESP_LOGI(TAG, "State topic: %s", s_state_topic);
@@ -100,24 +160,9 @@ static void build_topics(void)
 }
 
 
-/**
- * @brief 发布 Home Assistant 自动发现配置
- * 
- * 生成符合 Home Assistant MQTT Discovery 规范的 JSON 配置，
- * 并发布到 Discovery 主题。
- * 
- * @return ESP_OK 成功，其他失败
- */
-static esp_err_t publish_ha_discovery(void)
+int ha_mqtt_build_discovery(char *buf, size_t len)
 {
-    if (!ha_mqtt_is_connected()) {
-        ESP_LOGW(TAG, "MQTT not connected, cannot publish discovery");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
-    /* 构建 Discovery JSON 配置 */
-    char discovery_payload[PAYLOAD_BUF_SIZE];
-    int len = snprintf(discovery_payload, PAYLOAD_BUF_SIZE,
+    int n = snprintf(buf, len,
         "{"
         "\"name\":\"Door Switch\","
         "\"unique_id\":\"%s_door\","
@@ -142,7 +187,27 @@ static esp_err_t publish_ha_discovery(void)
         s_device_id
     );
     
-    if (len < 0 || len >= PAYLOAD_BUF_SIZE) {
+    return (n < 0 || (size_t)n >= len) ? -1 : n;
+}
+
+/**
+ * @brief 发布 Home Assistant 自动发现配置
+ * 
+ * 生成符合 Home Assistant MQTT Discovery 规范的 JSON 配置，
+ * 并发布到 Discovery 主题。
+ * 
+ * @return ESP_OK 成功，其他失败
+ */
+static esp_err_t publish_ha_discovery(void)
+{
+    if (!ha_mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected, cannot publish discovery");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    /* 构建 Discovery JSON 配置 */
+    char discovery_payload[PAYLOAD_BUF_SIZE];
+    if (ha_mqtt_build_discovery(discovery_payload, sizeof(discovery_payload)) < 0) {
         ESP_LOGE(TAG, "Discovery payload buffer overflow");
         return ESP_ERR_NO_MEM;
     }
@@ -164,6 +229,109 @@ static esp_err_t publish_ha_discovery(void)
 }
 
 
+static void diag_out_mqtt(const char *text, size_t len, void *ctx)
+{
+    diag_rsp_t *rsp = ctx;
+    size_t room = sizeof(rsp->buf) - rsp->len;
+
+    if (len > room) {
+        len = room;
+    }
+    memcpy(rsp->buf + rsp->len, text, len);
+    rsp->len += len;
+}
+
+static void diag_done_mqtt(esp_err_t ret, const diag_out_t *out)
+{
+    if (ret == ESP_ERR_NOT_FOUND) {
+        diag_out_mqtt("UNKNOWN\r\n", 9, &s_diag_rsp);
+    }
+    if (s_diag_rsp.len > 0) {
+        esp_mqtt_client_publish(s_mqtt_client, s_diag_rsp_topic,
+                                s_diag_rsp.buf, s_diag_rsp.len, 0, 0);
+    }
+    s_diag_rsp.len = 0;
+}
+
+/**
+ * @brief 诊断命令交给 diag 任务执行，完成后响应整体发布到 diag/rsp
+ */
+static void handle_diag_command(const char *data, int data_len)
+{
+    /* 远程通道，只能执行只读命令 */
+    static const diag_out_t out = { .fn = diag_out_mqtt, .ctx = &s_diag_rsp, .local = false };
+    char line[DIAG_CMD_LINE_MAX];
+
+    if (data_len <= 0) {
+        return;
+    }
+    if (data_len >= (int)sizeof(line)) {
+        data_len = sizeof(line) - 1;
+    }
+    memcpy(line, data, data_len);
+    line[data_len] = '\0';
+
+    if (diag_cmd_submit(line, &out, diag_done_mqtt) == ESP_ERR_NO_MEM) {
+        esp_mqtt_client_publish(s_mqtt_client, s_diag_rsp_topic, "BUSY\r\n", 6, 0, 0);
+    }
+}
+
+/**
+ * @brief MQTT 诊断命令: 连接状态、设备 ID、outbox 占用
+ */
+static esp_err_t cmd_mqtt(int argc, char **argv, const diag_out_t *out)
+{
+    diag_printf(out, "connected=%d id=%s outbox=%d\r\n", ha_mqtt_is_connected(),
+                s_device_id, s_mqtt_client != NULL ? esp_mqtt_client_get_outbox_size(s_mqtt_client) : 0);
+    return ESP_OK;
+}
+
+static void subscribe_registered(void)
+{
+    char topic[TOPIC_BUF_SIZE];
+    
+    for (int i = 0; i < s_subscription_count; i++) {
+        snprintf(topic, sizeof(topic), "%s/%s", s_device_prefix, s_subscriptions[i].suffix);
+        esp_mqtt_client_subscribe(s_mqtt_client, topic, s_subscriptions[i].qos);
+    }
+}
+
+/**
+ * @brief 按设备主题分发，返回是否已处理
+ */
+static bool dispatch_subscription(esp_mqtt_event_handle_t event)
+{
+    const subscription_t *sub = NULL;
+    
+    if (event->topic_len == 0 && event->current_data_offset > 0) {
+        sub = s_fragment_sub;
+    } else {
+        size_t prefix_len = strlen(s_device_prefix);
+        
+        if (event->topic_len > (int)prefix_len + 1 &&
+            strncmp(event->topic, s_device_prefix, prefix_len) == 0 &&
+            event->topic[prefix_len] == '/') {
+            const char *suffix = event->topic + prefix_len + 1;
+            int suffix_len = event->topic_len - (int)prefix_len - 1;
+            
+            for (int i = 0; i < s_subscription_count; i++) {
+                if ((int)strlen(s_subscriptions[i].suffix) == suffix_len &&
+                    strncmp(s_subscriptions[i].suffix, suffix, suffix_len) == 0) {
+                    sub = &s_subscriptions[i];
+                    break;
+                }
+            }
+        }
+        s_fragment_sub = sub;
+    }
+    
+    if (sub == NULL) {
+        return false;
+    }
+    sub->callback(event->data, event->data_len, event->current_data_offset, event->total_data_len);
+    return true;
+}
+
 /**
  * @brief MQTT 事件处理器
  */
@@ -175,8 +343,10 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
     switch ((esp_mqtt_event_id_t)event_id) {
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT connected to broker");
+            TRACE(TRACE_SRC_MQTT, TRACE_EVT_MQTT_CONNECT, 0, 0, 0);
             xEventGroupSetBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
             xEventGroupClearBits(s_mqtt_event_group, MQTT_DISCONNECTED_BIT);
+            state_shadow_set_mqtt(true);
             
             /* 发布在线状态 */
             esp_mqtt_client_publish(s_mqtt_client, s_availability_topic, 
@@ -189,15 +359,25 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
             int msg_id = esp_mqtt_client_subscribe(s_mqtt_client, s_cmd_topic, 1);
             ESP_LOGI(TAG, "Subscribed to %s, msg_id=%d", s_cmd_topic, msg_id);
             
+            /* 订阅诊断命令主题 */
+            esp_mqtt_client_subscribe(s_mqtt_client, s_diag_cmd_topic, 0);
+            subscribe_registered();
+            
             /* 发布初始门状态（默认为 OFF） */
             esp_mqtt_client_publish(s_mqtt_client, s_state_topic, "OFF", 0, 1, 1);
             ESP_LOGI(TAG, "Published initial door state: OFF");
+            
+            if (s_connect_callback != NULL) {
+                s_connect_callback();
+            }
             break;
             
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "MQTT disconnected from broker");
+            TRACE(TRACE_SRC_MQTT, TRACE_EVT_MQTT_DISCONNECT, 0, 0, 0);
             xEventGroupClearBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
             xEventGroupSetBits(s_mqtt_event_group, MQTT_DISCONNECTED_BIT);
+            state_shadow_set_mqtt(false);
             break;
             
         case MQTT_EVENT_SUBSCRIBED:
@@ -213,28 +393,37 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
             break;
             
         case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "MQTT data received on topic: %.*s", 
-                     event->topic_len, event->topic);
-            ESP_LOGI(TAG, "Data: %.*s", event->data_len, event->data);
+            /* 主题和负载位于 MQTT 缓冲区，延迟日志只记录长度 */
+            DLOGI(TAG, "MQTT data received, topic_len=%d data_len=%d",
+                  event->topic_len, event->data_len);
+            ESP_LOGD(TAG, "Topic: %.*s Data: %.*s", event->topic_len, event->topic,
+                     event->data_len, event->data);
             
             /* 检查是否是命令主题 */
-            if (event->topic_len > 0 && 
+            if (dispatch_subscription(event)) {
+                /* 已由注册模块处理 */
+            } else if (event->topic_len > 0 && 
                 strncmp(event->topic, s_cmd_topic, event->topic_len) == 0) {
                 
                 /* 解析命令 */
                 if (event->data_len >= 2 && strncmp(event->data, "ON", 2) == 0) {
                     ESP_LOGI(TAG, "Received door ON command");
+                    TRACE(TRACE_SRC_MQTT, TRACE_EVT_MQTT_DOOR_CMD, 0, 1, 0);
                     if (s_door_callback != NULL) {
                         s_door_callback(true);
                     }
                 } else if (event->data_len >= 3 && strncmp(event->data, "OFF", 3) == 0) {
                     ESP_LOGI(TAG, "Received door OFF command");
+                    TRACE(TRACE_SRC_MQTT, TRACE_EVT_MQTT_DOOR_CMD, 0, 0, 0);
                     if (s_door_callback != NULL) {
                         s_door_callback(false);
                     }
                 } else {
                     ESP_LOGW(TAG, "Unknown command: %.*s", event->data_len, event->data);
                 }
+            } else if (event->topic_len == (int)strlen(s_diag_cmd_topic) &&
+                       strncmp(event->topic, s_diag_cmd_topic, event->topic_len) == 0) {
+                handle_diag_command(event->data, event->data_len);
             }
             break;
             
@@ -267,14 +456,20 @@ esp_err_t ha_mqtt_init(void)
         return ESP_ERR_INVALID_ARG;
     }
     
-    /* 生成设备 ID */
-    generate_device_id();
+    /* 生成设备 ID (mDNS 可能已提前生成) */
+    if (s_device_id[0] == '\0') {
+        generate_device_id();
+    }
     
     /* 构建主题 */
     build_topics();
     
     /* 创建事件组 */
+#if CONFIG_APP_STATIC_ALLOCATION
+    s_mqtt_event_group = xEventGroupCreateStatic(&s_mqtt_event_group_buf);
+#else
     s_mqtt_event_group = xEventGroupCreate();
+#endif
     if (s_mqtt_event_group == NULL) {
         ESP_LOGE(TAG, "Failed to create event group");
         return ESP_ERR_NO_MEM;
@@ -330,6 +525,8 @@ esp_err_t ha_mqtt_init(void)
         return ret;
     }
     
+    diag_cmd_register("MQTT", "MQTT connection state and outbox size", cmd_mqtt, DIAG_ACCESS_REMOTE);
+
     s_initialized = true;
     ESP_LOGI(TAG, "MQTT client initialized, broker: %s", broker_uri);
     
@@ -337,6 +534,23 @@ esp_err_t ha_mqtt_init(void)
 }
 
 
+esp_err_t ha_mqtt_set_broker_uri(const char *uri)
+{
+    if (!s_initialized || s_mqtt_client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (uri == NULL || uri[0] == '\0') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = esp_mqtt_client_set_uri(s_mqtt_client, uri);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "MQTT broker set to %s", uri);
+    }
+    return ret;
+}
+
+
 esp_err_t ha_mqtt_start(void)
 {
     if (!s_initialized || s_mqtt_client == NULL) {
@@ -374,6 +588,11 @@ esp_err_t ha_mqtt_stop(void)
         return ret;
     }
     
+    /* 主动停止不产生 DISCONNECTED 事件 */
+    xEventGroupClearBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
+    xEventGroupSetBits(s_mqtt_event_group, MQTT_DISCONNECTED_BIT);
+    state_shadow_set_mqtt(false);
+    
     ESP_LOGI(TAG, "MQTT client stopped");
     return ESP_OK;
 }
@@ -401,8 +620,7 @@ esp_err_t ha_mqtt_publish_door_state(bool is_on)
     }
     
     const char *state = is_on ? "ON" : "OFF";
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, s_state_topic, 
-                                          state, 0, 1, 1);
+    int msg_id = publish(s_state_topic, state, 0, 1, 1);
     
     if (msg_id < 0) {
         ESP_LOGE(TAG, "Failed to publish door state");
@@ -419,8 +637,101 @@ void ha_mqtt_register_door_callback(ha_mqtt_door_callback_t callback)
     ESP_LOGI(TAG, "Door callback %s", callback ? "registered" : "unregistered");
 }
 
+void ha_mqtt_register_connect_callback(ha_mqtt_connect_callback_t callback)
+{
+    s_connect_callback = callback;
+}
+
+esp_err_t ha_mqtt_publish_telemetry(const char *name, const char *payload)
+{
+    if (payload == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    /* 本地 WebSocket 推送不依赖 broker 连接 */
+    state_shadow_telemetry(name, payload);
+    return ha_mqtt_publish_telemetry_raw(name, payload, strlen(payload));
+}
+
+esp_err_t ha_mqtt_publish_telemetry_raw(const char *name, const void *data, size_t len)
+{
+    if (name == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!ha_mqtt_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    char topic[TOPIC_BUF_SIZE];
+    int topic_len = snprintf(topic, sizeof(topic), "%s/%s", s_telemetry_prefix, name);
+    if (topic_len < 0 || topic_len >= (int)sizeof(topic)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    /* 遥测数据无需保留，QoS 0 避免占用 outbox */
+    int msg_id = publish(topic, (const char *)data, (int)len, 0, 0);
+    if (msg_id < 0) {
+        ESP_LOGW(TAG, "Failed to publish telemetry %s", name);
+        return ESP_FAIL;
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t ha_mqtt_subscribe(const char *suffix, int qos, ha_mqtt_data_callback_t callback)
+{
+    if (suffix == NULL || callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_subscription_count >= SUBSCRIPTION_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    s_subscriptions[s_subscription_count] = (subscription_t) {
+        .suffix = suffix,
+        .qos = qos,
+        .callback = callback,
+    };
+    s_subscription_count++;
+    
+    /* 已连接时立即订阅，否则在下次连接时订阅 */
+    if (ha_mqtt_is_connected()) {
+        char topic[TOPIC_BUF_SIZE];
+        snprintf(topic, sizeof(topic), "%s/%s", s_device_prefix, suffix);
+        esp_mqtt_client_subscribe(s_mqtt_client, topic, qos);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ha_mqtt_publish(const char *suffix, const void *data, size_t len, int qos)
+{
+    if (suffix == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!ha_mqtt_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    char topic[TOPIC_BUF_SIZE];
+    int topic_len = snprintf(topic, sizeof(topic), "%s/%s", s_device_prefix, suffix);
+    if (topic_len < 0 || topic_len >= (int)sizeof(topic)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    if (publish(topic, (const char *)data, (int)len, qos, 0) < 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 const char* ha_mqtt_get_device_id(void)
 {
+    /* mDNS 等模块可能在 ha_mqtt_init 之前需要设备 ID */
+    if (s_device_id[0] == '\0') {
+        generate_device_id();
+    }
     return s_device_id;
 }
 
@@ -0,0 +1,386 @@
+/**
+ * @file heap_monitor.c
+ * @brief 堆监控实现
+ */
+
+#include "heap_monitor.h"
+#include "diag_cmd.h"
+#include "ha_mqtt.h"
+#include "app_rtos.h"
+#include "supervisor.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#if CONFIG_HEAP_TASK_TRACKING
+#include "esp_heap_task_info.h"
+#endif
+
+static const char *TAG = "heap_mon";
+
+static const char *const s_subsys_names[HEAP_SUBSYS_MAX] = {
+    "app", "wifi", "ble", "mqtt", "net", "sys", "dead", "boot",
+};
+
+const char *heap_monitor_subsys_name(heap_subsys_t subsys)
+{
+    return (subsys < HEAP_SUBSYS_MAX) ? s_subsys_names[subsys] : "?";
+}
+
+#if CONFIG_HEAP_MONITOR_ENABLE
+
+#define HEAP_MON_CAPS           MALLOC_CAP_8BIT
+#define HEAP_MON_MAX_TASKS      32
+#define HEAP_MON_HISTORY        CONFIG_HEAP_MONITOR_HISTORY
+#define HEAP_MON_JSON_SIZE      768
+
+typedef struct {
+    uint32_t free;
+    uint32_t largest;
+    uint16_t frag_pm;
+} heap_sample_t;
+
+/* 非应用任务按名称前缀归属子系统 */
+static const struct {
+    const char *prefix;
+    heap_subsys_t subsys;
+} s_task_map[] = {
+    { "wifi",     HEAP_SUBSYS_WIFI },
+    { "nimble",   HEAP_SUBSYS_BLE },
+    { "bt",       HEAP_SUBSYS_BLE },
+    { "mqtt",     HEAP_SUBSYS_MQTT },
+    { "tiT",      HEAP_SUBSYS_NET },
+    { "sys_evt",  HEAP_SUBSYS_NET },
+    { "httpd",    HEAP_SUBSYS_NET },
+    { "mdns",     HEAP_SUBSYS_NET },
+};
+
+static heap_sample_t s_history[HEAP_MON_HISTORY];
+static uint32_t s_history_count = 0;
+static heap_stats_t s_stats;
+static bool s_stats_valid = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* 分配失败回调写入，采样任务读取 */
+static volatile uint32_t s_fail_count = 0;
+static volatile uint32_t s_fail_size = 0;
+static char s_fail_task[configMAX_TASK_NAME_LEN];
+static uint32_t s_fail_reported = 0;
+
+#if CONFIG_HEAP_TASK_TRACKING
+static heap_task_totals_t s_totals[HEAP_MON_MAX_TASKS];
+static TaskStatus_t s_status[HEAP_MON_MAX_TASKS];
+#endif
+
+/**
+ * @brief 分配失败回调 (在失败的调用者上下文中执行，只做记录并唤醒采样任务)
+ */
+static void alloc_failed_cb(size_t size, uint32_t caps, const char *function_name)
+{
+    TaskHandle_t task = app_task_handle(APP_TASK_HEAP_MON);
+
+    s_fail_size = size;
+    s_fail_count++;
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        strlcpy(s_fail_task, pcTaskGetName(NULL), sizeof(s_fail_task));
+    }
+    TRACE(TRACE_SRC_SYS, TRACE_EVT_HEAP_ALLOC_FAIL, 0, size, caps);
+
+    if (task != NULL && task != xTaskGetCurrentTaskHandle()) {
+        xTaskNotifyGive(task);
+    }
+}
+
+#if CONFIG_HEAP_TASK_TRACKING
+static heap_subsys_t classify(TaskHandle_t handle, const char *name)
+{
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        if (app_task_handle((app_task_id_t)i) == handle) {
+            return HEAP_SUBSYS_APP;
+        }
+    }
+    for (size_t i = 0; i < sizeof(s_task_map) / sizeof(s_task_map[0]); i++) {
+        if (strncasecmp(name, s_task_map[i].prefix, strlen(s_task_map[i].prefix)) == 0) {
+            return s_task_map[i].subsys;
+        }
+    }
+    return HEAP_SUBSYS_SYS;
+}
+
+/**
+ * @brief 按任务汇总堆块，折算到子系统并取占用最多的任务
+ */
+static void sample_tasks(heap_stats_t *st)
+{
+    size_t num_totals = 0;
+    heap_task_info_params_t params = {
+        .caps = { HEAP_MON_CAPS },
+        .mask = { HEAP_MON_CAPS },
+        .totals = s_totals,
+        .num_totals = &num_totals,
+        .max_totals = HEAP_MON_MAX_TASKS,
+    };
+
+    heap_caps_get_per_task_info(&params);
+    /* 先遍历堆再取任务列表: 两次调用之间新建的任务归为 dead，下一次采样即更正 */
+    UBaseType_t n = uxTaskGetSystemState(s_status, HEAP_MON_MAX_TASKS, NULL);
+
+    st->tracked = true;
+    for (size_t i = 0; i < num_totals; i++) {
+        heap_task_usage_t usage = {
+            .bytes = s_totals[i].size[0],
+            .blocks = s_totals[i].count[0],
+        };
+        heap_subsys_t subsys;
+
+        if (s_totals[i].task == NULL) {
+            subsys = HEAP_SUBSYS_BOOT;
+            strlcpy(usage.name, "(boot)", sizeof(usage.name));
+        } else {
+            subsys = HEAP_SUBSYS_DEAD;
+            strlcpy(usage.name, "(deleted)", sizeof(usage.name));
+            for (UBaseType_t k = 0; k < n; k++) {
+                if (s_status[k].xHandle == s_totals[i].task) {
+                    strlcpy(usage.name, s_status[k].pcTaskName, sizeof(usage.name));
+                    subsys = classify(s_totals[i].task, usage.name);
+                    break;
+                }
+            }
+        }
+        st->subsys[subsys] += usage.bytes;
+
+        /* 按占用降序插入，只保留前 HEAP_MONITOR_TOP_TASKS 个 */
+        uint8_t pos = st->count < HEAP_MONITOR_TOP_TASKS ? st->count : HEAP_MONITOR_TOP_TASKS;
+        while (pos > 0 && st->tasks[pos - 1].bytes < usage.bytes) {
+            if (pos < HEAP_MONITOR_TOP_TASKS) {
+                st->tasks[pos] = st->tasks[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < HEAP_MONITOR_TOP_TASKS) {
+            st->tasks[pos] = usage;
+            if (st->count < HEAP_MONITOR_TOP_TASKS) {
+                st->count++;
+            }
+        }
+    }
+}
+#endif /* CONFIG_HEAP_TASK_TRACKING */
+
+static void sample(void)
+{
+    multi_heap_info_t info;
+    heap_stats_t st = {0};
+
+    heap_caps_get_info(&info, HEAP_MON_CAPS);
+    st.free = info.total_free_bytes;
+    st.largest = info.largest_free_block;
+    st.min_free = info.minimum_free_bytes;
+    st.frag_pm = st.free ? (uint16_t)(1000 - (uint64_t)st.largest * 1000 / st.free) : 0;
+
+    s_history[s_history_count++ % HEAP_MON_HISTORY] = (heap_sample_t){
+        .free = st.free, .largest = st.largest, .frag_pm = st.frag_pm,
+    };
+    uint32_t valid = s_history_count < HEAP_MON_HISTORY ? s_history_count : HEAP_MON_HISTORY;
+    st.largest_min = UINT32_MAX;
+    for (uint32_t i = 0; i < valid; i++) {
+        if (s_history[i].largest < st.largest_min) {
+            st.largest_min = s_history[i].largest;
+        }
+        if (s_history[i].frag_pm > st.frag_max_pm) {
+            st.frag_max_pm = s_history[i].frag_pm;
+        }
+    }
+
+    st.fail_count = s_fail_count;
+    st.fail_size = s_fail_size;
+    strlcpy(st.fail_task, s_fail_task, sizeof(st.fail_task));
+
+#if CONFIG_HEAP_TASK_TRACKING
+    sample_tasks(&st);
+#endif
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats = st;
+    s_stats_valid = true;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t heap_monitor_get(heap_stats_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool valid = s_stats_valid;
+    if (valid) {
+        *out = s_stats;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+int heap_monitor_to_json(char *buf, size_t len)
+{
+    static heap_stats_t st;
+    size_t pos = 0;
+    int n;
+
+    if (heap_monitor_get(&st) != ESP_OK) {
+        return -1;
+    }
+
+#define APPEND(...) do { \
+        n = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n < 0 || (size_t)n >= len - pos) return -1; \
+        pos += n; \
+    } while (0)
+
+    APPEND("{\"free\":%lu,\"largest\":%lu,\"min\":%lu,\"frag\":%u,\"largest_min\":%lu,"
+           "\"frag_max\":%u,\"fail\":[%lu,%lu,\"%s\"]",
+           (unsigned long)st.free, (unsigned long)st.largest, (unsigned long)st.min_free,
+           st.frag_pm, (unsigned long)st.largest_min, st.frag_max_pm,
+           (unsigned long)st.fail_count, (unsigned long)st.fail_size, st.fail_task);
+    if (st.tracked) {
+        APPEND(",\"subsys\":{");
+        for (int i = 0; i < HEAP_SUBSYS_MAX; i++) {
+            APPEND("%s\"%s\":%lu", i ? "," : "", s_subsys_names[i], (unsigned long)st.subsys[i]);
+        }
+        APPEND("},\"tasks\":{");
+        for (uint8_t i = 0; i < st.count; i++) {
+            APPEND("%s\"%s\":[%lu,%lu]", i ? "," : "", st.tasks[i].name,
+                   (unsigned long)st.tasks[i].bytes, (unsigned long)st.tasks[i].blocks);
+        }
+        APPEND("}");
+    }
+    APPEND("}");
+
+#undef APPEND
+    return (int)pos;
+}
+
+static void publish(void)
+{
+    static char json[HEAP_MON_JSON_SIZE];
+
+    if (ha_mqtt_is_connected() && heap_monitor_to_json(json, sizeof(json)) > 0) {
+        ha_mqtt_publish_telemetry("heap", json);
+    }
+}
+
+/**
+ * @brief HEAP 命令: 当前采样与子系统分布，"HEAP HIST" 输出历史采样
+ */
+static esp_err_t cmd_heap(int argc, char **argv, const diag_out_t *out)
+{
+    static heap_stats_t st;
+
+    if (argc >= 2 && strcasecmp(argv[1], "HIST") == 0) {
+        uint32_t count = s_history_count;
+        uint32_t first = count > HEAP_MON_HISTORY ? count - HEAP_MON_HISTORY : 0;
+
+        diag_printf(out, "%4s %8s %8s %5s\r\n", "#", "free", "largest", "frag");
+        for (uint32_t i = first; i < count; i++) {
+            const heap_sample_t *h = &s_history[i % HEAP_MON_HISTORY];
+            diag_printf(out, "%4lu %8lu %8lu %3u.%u\r\n", (unsigned long)i,
+                        (unsigned long)h->free, (unsigned long)h->largest,
+                        h->frag_pm / 10, h->frag_pm % 10);
+        }
+        return ESP_OK;
+    }
+
+    if (heap_monitor_get(&st) != ESP_OK) {
+        diag_printf(out, "no data yet\r\n");
+        return ESP_ERR_INVALID_STATE;
+    }
+    diag_printf(out, "free %lu, largest %lu, min %lu, frag %u.%u%% (max %u.%u%%)\r\n",
+                (unsigned long)st.free, (unsigned long)st.largest, (unsigned long)st.min_free,
+                st.frag_pm / 10, st.frag_pm % 10, st.frag_max_pm / 10, st.frag_max_pm % 10);
+    diag_printf(out, "alloc failures %lu, last %lu bytes in %s\r\n", (unsigned long)st.fail_count,
+                (unsigned long)st.fail_size, st.fail_task[0] ? st.fail_task : "-");
+    if (!st.tracked) {
+        diag_printf(out, "enable CONFIG_HEAP_TASK_TRACKING for per-subsystem usage\r\n");
+        return ESP_OK;
+    }
+    for (int i = 0; i < HEAP_SUBSYS_MAX; i++) {
+        diag_printf(out, "%-6s %8lu\r\n", s_subsys_names[i], (unsigned long)st.subsys[i]);
+    }
+    for (uint8_t i = 0; i < st.count; i++) {
+        diag_printf(out, "  %-16s %8lu %5lu\r\n", st.tasks[i].name,
+                    (unsigned long)st.tasks[i].bytes, (unsigned long)st.tasks[i].blocks);
+    }
+    return ESP_OK;
+}
+
+static void heap_monitor_task(void *pvParameters)
+{
+    const uint32_t report_every = (CONFIG_HEAP_MONITOR_REPORT_PERIOD_S * 1000) /
+                                  CONFIG_HEAP_MONITOR_PERIOD_MS;
+    uint32_t count = 0;
+
+    supervisor_register(APP_TASK_HEAP_MON,
+                        SUPERVISOR_BACKGROUND_HEARTBEAT_MS(CONFIG_HEAP_MONITOR_PERIOD_MS), 0, NULL);
+
+    while (1) {
+        supervisor_heartbeat(APP_TASK_HEAP_MON);
+        sample();
+
+        /* 分配失败后立即上报当时的分布，不等周期 */
+        uint32_t fails = s_fail_count;
+        if (fails != s_fail_reported) {
+            ESP_LOGW(TAG, "%lu allocation failure(s), last %lu bytes in %s",
+                     (unsigned long)(fails - s_fail_reported), (unsigned long)s_fail_size,
+                     s_fail_task[0] ? s_fail_task : "?");
+            s_fail_reported = fails;
+            publish();
+        } else if (report_every > 0 && ++count >= report_every) {
+            count = 0;
+            publish();
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_HEAP_MONITOR_PERIOD_MS));
+    }
+}
+
+esp_err_t heap_monitor_start(void)
+{
+    heap_caps_register_failed_alloc_callback(alloc_failed_cb);
+    diag_cmd_register("HEAP", "heap usage per subsystem and fragmentation, HEAP HIST for trend",
+                      cmd_heap, DIAG_ACCESS_REMOTE);
+
+    if (app_task_create(APP_TASK_HEAP_MON, heap_monitor_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create heap monitor task");
+        return ESP_ERR_NO_MEM;
+    }
+
+#if CONFIG_HEAP_TASK_TRACKING
+    ESP_LOGI(TAG, "Heap monitor started, period %d ms, per-task tracking on", CONFIG_HEAP_MONITOR_PERIOD_MS);
+#else
+    ESP_LOGI(TAG, "Heap monitor started, period %d ms", CONFIG_HEAP_MONITOR_PERIOD_MS);
+#endif
+    return ESP_OK;
+}
+
+#else /* !CONFIG_HEAP_MONITOR_ENABLE */
+
+esp_err_t heap_monitor_start(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t heap_monitor_get(heap_stats_t *out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+int heap_monitor_to_json(char *buf, size_t len)
+{
+    return -1;
+}
+
+#endif /* CONFIG_HEAP_MONITOR_ENABLE */
@@ -0,0 +1,279 @@
+/**
+ * @file http_api.c
+ * @brief 局域网 HTTP REST API 实现
+ */
+
+#include "http_api.h"
+#include "msg_queue.h"
+#include "board.h"
+#include "pwm_task.h"
+#include "ha_mqtt.h"
+#include "wifi_manager.h"
+#include "diag_cmd.h"
+#include "ws_push.h"
+#include "crash_report.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_app_desc.h"
+#include "esp_http_server.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#else
+#include "lwip/sockets.h"
+#endif
+
+static const char *TAG = "http_api";
+
+#if CONFIG_HTTP_API_ENABLE
+
+#define HTTP_API_STACK_SIZE     4096
+#define HTTP_API_PRIORITY       4       /* 与按键任务同级，低于舵机任务 */
+#define HTTP_API_URI_COUNT      4
+#define HTTP_API_PUBLIC_URIS    2       /* s_uris 前两项只读，未配置令牌时也注册 */
+#define HTTP_API_WS_URI_COUNT   1
+#define HTTP_API_CORE_URI_COUNT 2
+#define HTTP_API_JSON_SIZE      192
+#define HTTP_API_AUTH_PREFIX    "Bearer "
+
+static httpd_handle_t s_server = NULL;
+
+/* 统计 (仅 httpd 任务写入) */
+static uint32_t s_requests = 0;
+static uint32_t s_rejected = 0;     /* 鉴权失败或队列满 */
+static uint64_t s_busy_us = 0;      /* 处理函数累计耗时 */
+
+static esp_err_t send_json(httpd_req_t *req, const char *status, const char *json)
+{
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+}
+
+static const char s_token[] = CONFIG_HTTP_API_TOKEN;
+
+/**
+ * @brief 与令牌比较，耗时只取决于令牌长度，不随第一个不同字节的位置变化
+ */
+static bool token_matches(const char *value)
+{
+    size_t expected = strlen(s_token);
+    size_t len = strnlen(value, expected + 1);
+    uint8_t diff = len != expected;
+
+    for (size_t i = 0; i < expected; i++) {
+        diff |= (uint8_t)(value[i < len ? i : 0] ^ s_token[i]);
+    }
+    return diff == 0;
+}
+
+bool http_api_authorized(httpd_req_t *req)
+{
+    char value[sizeof(HTTP_API_AUTH_PREFIX) + sizeof(s_token)];
+
+    /* 未配置令牌时控制端点不注册，这里按未授权处理 */
+    if (s_token[0] == '\0') {
+        return false;
+    }
+    return httpd_req_get_hdr_value_str(req, "Authorization", value, sizeof(value)) == ESP_OK &&
+           strncmp(value, HTTP_API_AUTH_PREFIX, strlen(HTTP_API_AUTH_PREFIX)) == 0 &&
+           token_matches(value + strlen(HTTP_API_AUTH_PREFIX));
+}
+
+bool http_api_ws_authorized(httpd_req_t *req)
+{
+    char query[sizeof("token=") + sizeof(s_token)];
+    char value[sizeof(s_token)];
+
+    if (http_api_authorized(req)) {
+        return true;
+    }
+    return s_token[0] != '\0' &&
+           httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+           httpd_query_key_value(query, "token", value, sizeof(value)) == ESP_OK &&
+           token_matches(value);
+}
+
+static bool check_auth(httpd_req_t *req)
+{
+    if (http_api_authorized(req)) {
+        return true;
+    }
+
+    s_rejected++;
+    httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+    send_json(req, "401 Unauthorized", "{\"error\":\"unauthorized\"}");
+    return false;
+}
+
+/**
+ * @brief 所有端点的公共入口: 鉴权、计数和耗时统计
+ *
+ * 未配置令牌时只注册了只读端点，不做鉴权
+ */
+static esp_err_t dispatch(httpd_req_t *req)
+{
+    esp_err_t (*handler)(httpd_req_t *) = req->user_ctx;
+    int64_t start = esp_timer_get_time();
+
+    s_requests++;
+    esp_err_t ret = (s_token[0] == '\0' || check_auth(req)) ? handler(req) : ESP_OK;
+    s_busy_us += (uint64_t)(esp_timer_get_time() - start);
+    return ret;
+}
+
+static esp_err_t handle_status(httpd_req_t *req)
+{
+    char json[HTTP_API_JSON_SIZE];
+
+    snprintf(json, sizeof(json),
+             "{\"door\":\"%s\",\"uptime\":%lu,\"heap\":%lu,\"wifi\":%s,\"mqtt\":%s}",
+             pwm_task_door_is_open() ? "open" : "closed",
+             (unsigned long)(esp_timer_get_time() / 1000000),
+             (unsigned long)esp_get_free_heap_size(),
+             wifi_manager_is_connected() ? "true" : "false",
+             ha_mqtt_is_connected() ? "true" : "false");
+    return send_json(req, "200 OK", json);
+}
+
+static esp_err_t send_door_cmd(httpd_req_t *req, http_cmd_t cmd)
+{
+    if (!msg_send_http_door_cmd(cmd)) {
+        s_rejected++;
+        return send_json(req, "503 Service Unavailable", "{\"error\":\"busy\"}");
+    }
+    return send_json(req, "200 OK", "{\"ok\":true}");
+}
+
+static esp_err_t handle_open(httpd_req_t *req)
+{
+    return send_door_cmd(req, HTTP_CMD_DOOR_OPEN);
+}
+
+static esp_err_t handle_close(httpd_req_t *req)
+{
+    return send_door_cmd(req, HTTP_CMD_DOOR_CLOSE);
+}
+
+static esp_err_t handle_config_get(httpd_req_t *req)
+{
+    char json[HTTP_API_JSON_SIZE];
+    const esp_app_desc_t *desc = esp_app_get_description();
+
+    snprintf(json, sizeof(json),
+             "{\"device\":\"%s\",\"version\":\"%s\",\"open_ms\":%d,\"angle_closed\":%d,\"angle_open\":%d}",
+             ha_mqtt_get_device_id(), desc->version, OPEN_TIME, SERVO_ANGLE_POS1, SERVO_ANGLE_POS2);
+    return send_json(req, "200 OK", json);
+}
+
+static const httpd_uri_t s_uris[HTTP_API_URI_COUNT] = {
+    { .uri = "/api/status", .method = HTTP_GET,  .handler = dispatch, .user_ctx = handle_status },
+    { .uri = "/api/config", .method = HTTP_GET,  .handler = dispatch, .user_ctx = handle_config_get },
+    { .uri = "/api/open",   .method = HTTP_POST, .handler = dispatch, .user_ctx = handle_open },
+    { .uri = "/api/close",  .method = HTTP_POST, .handler = dispatch, .user_ctx = handle_close },
+};
+
+/**
+ * @brief 新连接关闭 Nagle
+ *
+ * httpd 分两次发送应答头和正文，keep-alive 连接上第二段会等到对端确认前一个
+ * 应答后才发出 (对端延迟确认时约 40ms)，关闭后单次请求延迟只取决于处理时间
+ */
+static esp_err_t on_open(httpd_handle_t hd, int sockfd)
+{
+    int one = 1;
+
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return ESP_OK;
+}
+
+/**
+ * @brief 连接关闭: 通知 WebSocket 推送释放客户端 (设置 close_fn 后需自行关闭套接字)
+ */
+static void on_close(httpd_handle_t hd, int sockfd)
+{
+    ws_push_session_closed(sockfd);
+    close(sockfd);
+}
+
+/**
+ * @brief HTTP 命令: 请求数、拒绝数、平均处理耗时
+ */
+static esp_err_t cmd_http(int argc, char **argv, const diag_out_t *out)
+{
+    uint32_t requests = s_requests;
+
+    diag_printf(out, "http port %d: %s, %lu requests, %lu rejected, avg %lu us\r\n",
+                CONFIG_HTTP_API_PORT, s_server ? "running" : "stopped",
+                (unsigned long)requests, (unsigned long)s_rejected,
+                (unsigned long)(requests ? s_busy_us / requests : 0));
+    return ESP_OK;
+}
+
+esp_err_t http_api_start(void)
+{
+    httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+
+    if (s_server != NULL) {
+        return ESP_OK;
+    }
+
+    cfg.server_port = CONFIG_HTTP_API_PORT;
+    cfg.max_open_sockets = CONFIG_HTTP_API_MAX_SOCKETS;
+    cfg.max_uri_handlers = HTTP_API_URI_COUNT + HTTP_API_WS_URI_COUNT + HTTP_API_CORE_URI_COUNT;
+    cfg.stack_size = HTTP_API_STACK_SIZE;
+    cfg.task_priority = HTTP_API_PRIORITY;
+    /* 空闲的 keep-alive 连接在连接数满时被淘汰，不拒绝新客户端 */
+    cfg.lru_purge_enable = true;
+    cfg.keep_alive_enable = true;
+    cfg.open_fn = on_open;
+    cfg.close_fn = on_close;
+
+    esp_err_t ret = httpd_start(&s_server, &cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start server: %s", esp_err_to_name(ret));
+        s_server = NULL;
+        return ret;
+    }
+    diag_cmd_register("HTTP", "LAN HTTP API statistics", cmd_http, DIAG_ACCESS_REMOTE);
+
+    /* 未配置令牌时不开放控制、推送和转储端点，只提供只读状态 */
+    bool secured = s_token[0] != '\0';
+    size_t count = secured ? HTTP_API_URI_COUNT : HTTP_API_PUBLIC_URIS;
+    for (size_t i = 0; i < count; i++) {
+        httpd_register_uri_handler(s_server, &s_uris[i]);
+    }
+    if (secured) {
+        ws_push_register(s_server);
+        crash_report_register_http(s_server);
+    } else {
+        ESP_LOGW(TAG, "No API token configured, door control, WebSocket and coredump disabled");
+    }
+    ESP_LOGI(TAG, "Listening on port %d (%d sockets)", CONFIG_HTTP_API_PORT,
+             CONFIG_HTTP_API_MAX_SOCKETS);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_HTTP_API_ENABLE */
+
+esp_err_t http_api_start(void)
+{
+    return ESP_OK;
+}
+
+bool http_api_authorized(httpd_req_t *req)
+{
+    return false;
+}
+
+bool http_api_ws_authorized(httpd_req_t *req)
+{
+    return false;
+}
+
+#endif /* CONFIG_HTTP_API_ENABLE */
@@ -0,0 +1,116 @@
+/**
+ * @file app_event.h
+ * @brief 应用事件循环 - 与系统默认事件循环隔离的应用级事件分发
+ *
+ * 默认事件循环由 Wi-Fi、IP、SmartConfig 等系统组件共用，其中的处理函数耗时会推迟
+ * 所有系统事件。系统事件处理函数只拷贝必要字段并投递到应用事件循环，
+ * 创建任务、写 NVS、重连等操作在应用事件任务 (APP_TASK_EVENT) 中执行。
+ *
+ * 应用事件循环是不带内部任务的 esp_event 循环，由 APP_TASK_TABLE 中的任务运行，
+ * 优先级与栈大小在任务表中配置，队列深度为 APP_EVENT_QUEUE_LEN。
+ * 每个事件记录投递时间，统计排队延迟与处理耗时；处理耗时受 supervisor 的延迟 SLO 约束。
+ * 通过 app_event_register_system 注册到默认循环的处理函数同样统计耗时。
+ *
+ * 查询: 诊断命令 EVT。
+ */
+
+#ifndef APP_EVENT_H
+#define APP_EVENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ESP_EVENT_DECLARE_BASE(APP_EVENT);
+
+/**
+ * @brief 应用事件
+ */
+typedef enum {
+    APP_EVENT_WIFI_STA_START = 0,   /**< STA 已启动，无数据 */
+    APP_EVENT_WIFI_DISCONNECTED,    /**< STA 断开，app_event_wifi_disconnected_t */
+    APP_EVENT_WIFI_GOT_IP,          /**< 获取 IP，app_event_got_ip_t */
+    APP_EVENT_SC_STATUS,            /**< SmartConfig 扫描/找到信道，app_event_sc_status_t */
+    APP_EVENT_SC_GOT_CREDENTIALS,   /**< SmartConfig 收到凭据，app_event_sc_credentials_t */
+    APP_EVENT_SC_ACK_DONE,          /**< SmartConfig 已回复手机，无数据 */
+    APP_EVENT_MAX
+} app_event_id_t;
+
+typedef struct {
+    uint8_t reason;
+} app_event_wifi_disconnected_t;
+
+typedef struct {
+    uint32_t ip;
+} app_event_got_ip_t;
+
+typedef struct {
+    int32_t sc_event;               /**< SC_EVENT_SCAN_DONE / SC_EVENT_FOUND_CHANNEL */
+} app_event_sc_status_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+    uint8_t bssid[6];
+    bool bssid_set;
+} app_event_sc_credentials_t;
+
+/**
+ * @brief 应用事件处理函数，在应用事件任务中调用
+ *
+ * @param id 事件
+ * @param data 事件数据，仅在调用期间有效 (无数据事件的内容未定义)
+ * @param arg 注册时传入的参数
+ */
+typedef void (*app_event_handler_t)(app_event_id_t id, const void *data, void *arg);
+
+/**
+ * @brief 创建应用事件循环和事件任务，注册诊断命令 "EVT"
+ *
+ * 需在注册任何事件处理函数、启动 Wi-Fi 之前调用。
+ *
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t app_event_start(void);
+
+/**
+ * @brief 注册应用事件处理函数
+ *
+ * @param id 事件
+ * @param handler 处理函数
+ * @param arg 处理函数参数
+ * @return ESP_OK成功, ESP_ERR_NO_MEM处理函数表已满
+ */
+esp_err_t app_event_register(app_event_id_t id, app_event_handler_t handler, void *arg);
+
+/**
+ * @brief 投递应用事件 (数据被拷贝)
+ *
+ * 可在系统事件处理函数中调用；队列满时等待至多 timeout_ms，仍失败则计入丢弃数。
+ *
+ * @param id 事件
+ * @param data 事件数据，可为 NULL
+ * @param size 数据长度
+ * @param timeout_ms 队列满时的等待时间
+ * @return ESP_OK成功, ESP_ERR_TIMEOUT队列满, ESP_ERR_INVALID_STATE未启动
+ */
+esp_err_t app_event_post(app_event_id_t id, const void *data, size_t size, uint32_t timeout_ms);
+
+/**
+ * @brief 在默认事件循环上注册系统事件处理函数，并统计其耗时
+ *
+ * @return ESP_OK成功, ESP_ERR_NO_MEM记录表已满, 其他为 esp_event_handler_register 的错误
+ */
+esp_err_t app_event_register_system(esp_event_base_t base, int32_t id,
+                                    esp_event_handler_t handler, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_EVENT_H */
@@ -0,0 +1,67 @@
+/**
+ * @file app_pm.h
+ * @brief 应用电源管理 - 动态调频、自动 Light-sleep 与按场景持有的 PM 锁
+ *
+ * 空闲时不持有任何锁，系统降频并进入 Light-sleep；
+ * 只有舵机运动、命令处理、BLE 批量传输期间才按需抬高时钟。
+ * 未开启 CONFIG_PM_ENABLE 时所有接口为空操作。
+ */
+
+#ifndef APP_PM_H
+#define APP_PM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 应用 PM 锁
+ */
+typedef enum {
+    APP_PM_LOCK_SERVO = 0,  /**< 舵机运动: APB 最高频率，保证 LEDC 时钟和步进节拍 */
+    APP_PM_LOCK_CMD,        /**< 命令处理: CPU 最高频率，缩短开门响应 */
+    APP_PM_LOCK_BULK,       /**< BLE 批量传输: CPU 最高频率 */
+    APP_PM_LOCK_OTA,        /**< OTA 下载解压: CPU 最高频率 */
+    APP_PM_LOCK_MAX
+} app_pm_lock_id_t;
+
+/**
+ * @brief 锁持有统计
+ */
+typedef struct {
+    uint32_t count;         /**< 获取次数 (嵌套只计一次) */
+    uint64_t held_us;       /**< 累计持有时间 */
+} app_pm_lock_stat_t;
+
+/**
+ * @brief 配置动态调频与自动 Light-sleep，创建应用 PM 锁
+ *
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t app_pm_init(void);
+
+/**
+ * @brief 获取 PM 锁 (可嵌套)
+ */
+void app_pm_acquire(app_pm_lock_id_t id);
+
+/**
+ * @brief 释放 PM 锁
+ */
+void app_pm_release(app_pm_lock_id_t id);
+
+/**
+ * @brief 获取锁持有统计
+ *
+ * @return ESP_OK成功, ESP_ERR_NOT_SUPPORTED未开启电源管理
+ */
+esp_err_t app_pm_get_lock_stat(app_pm_lock_id_t id, app_pm_lock_stat_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_PM_H */
@@ -0,0 +1,109 @@
+/**
+ * @file app_rtos.h
+ * @brief 应用 RTOS 对象配置表与任务创建接口
+ *
+ * 所有应用任务的栈大小和优先级集中在 APP_TASK_TABLE 中定义，
+ * 调整栈大小时参考 task_monitor 输出的建议值。
+ * supervisor 优先级高于其他应用任务，被监督任务忙循环时仍能检查和恢复。
+ * 开启 CONFIG_APP_STATIC_ALLOCATION 后，任务栈和 TCB 位于静态存储区 (启动阶段的一次性任务除外)，
+ * 队列、事件组也在各自模块中使用 xXxxCreateStatic 创建，定时器为 timer_wheel 的静态节点，
+ * 运行期不再从堆分配。
+ */
+
+#ifndef APP_RTOS_H
+#define APP_RTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 消息队列深度 (每个 queue_id_t 一个队列) */
+#define APP_MSG_QUEUE_LEN 10
+
+/* 应用事件循环队列深度 (app_event) */
+#define APP_EVENT_QUEUE_LEN 16
+
+/*
+ * 应用任务表
+ *
+ *  ID                       名称                 栈(字节)  优先级  静态模式下的分配
+ *
+ * 分配列只在 CONFIG_APP_STATIC_ALLOCATION 下起作用: STATIC 任务的栈和 TCB 常驻静态
+ * 存储区；HEAP 用于启动阶段跑完即退出的任务，仍从堆分配，退出后栈归还堆，
+ * 不为它们永久保留静态存储。
+ */
+#define APP_TASK_TABLE(X) \
+    X(APP_TASK_LED,          "led_task",          2048,     5,     STATIC) \
+    X(APP_TASK_SERVO,        "servo_task",        2048,     5,     STATIC) \
+    X(APP_TASK_KEY,          "key_task",          2048,     4,     STATIC) \
+    X(APP_TASK_WIFI_MSG,     "wifi_msg_task",     2048,     4,     STATIC) \
+    X(APP_TASK_EVENT,        "app_event",         4096,     4,     STATIC) \
+    X(APP_TASK_SMARTCONFIG,  "smartconfig_task",  4096,     3,     STATIC) \
+    X(APP_TASK_MQTT_START,   "mqtt_start",        3072,     3,     STATIC) \
+    X(APP_TASK_L2CAP_TX,     "l2cap_tx",          3072,     2,     STATIC) \
+    X(APP_TASK_BOOT_WIFI,    "boot_wifi",         4096,     2,     HEAP) \
+    X(APP_TASK_BOOT_BLE,     "boot_ble",          4096,     2,     HEAP) \
+    X(APP_TASK_MONITOR,      "task_monitor",      3072,     1,     STATIC) \
+    X(APP_TASK_CPU_STATS,    "cpu_stats",         4096,     1,     STATIC) \
+    X(APP_TASK_DLOG,         "dlog_drain",        3072,     1,     STATIC) \
+    X(APP_TASK_JOURNAL,      "journal",           3072,     2,     STATIC) \
+    X(APP_TASK_OTA,          "ota",               6144,     2,     STATIC) \
+    X(APP_TASK_COAP,         "coap_server",       3072,     3,     STATIC) \
+    X(APP_TASK_SUPERVISOR,   "supervisor",        3072,     6,     STATIC) \
+    X(APP_TASK_SUP_REPORT,   "sup_report",        3072,     2,     STATIC) \
+    X(APP_TASK_CRASH_REPORT, "crash_report",      4096,     1,     STATIC) \
+    X(APP_TASK_HEAP_MON,     "heap_mon",          3072,     1,     STATIC) \
+    X(APP_TASK_SOAK,         "soak",              4096,     2,     STATIC) \
+    X(APP_TASK_DIAG,         "diag",              4096,     1,     STATIC)
+
+/**
+ * @brief 应用任务 ID
+ */
+typedef enum {
+#define APP_TASK_ENUM(id, name, stack, prio, alloc) id,
+    APP_TASK_TABLE(APP_TASK_ENUM)
+#undef APP_TASK_ENUM
+    APP_TASK_MAX
+} app_task_id_t;
+
+/**
+ * @brief 按任务表创建应用任务
+ *
+ * 静态分配模式下 STATIC 任务同一 ID 同时只能存在一个实例；若上一实例刚自删除、
+ * 尚未被 idle 任务回收，会短暂等待其释放静态栈。
+ *
+ * @param id 任务 ID
+ * @param fn 任务函数
+ * @param arg 任务参数
+ * @param out 输出任务句柄，可为 NULL
+ * @return pdPASS成功, errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY失败
+ */
+BaseType_t app_task_create(app_task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *out);
+
+/**
+ * @brief 获取任务名称
+ */
+const char *app_task_name(app_task_id_t id);
+
+/**
+ * @brief 获取任务配置的栈大小 (字节)
+ */
+uint32_t app_task_stack_size(app_task_id_t id);
+
+/**
+ * @brief 获取当前运行实例的句柄
+ *
+ * @return 任务句柄，任务未运行或已删除返回 NULL
+ */
+TaskHandle_t app_task_handle(app_task_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_RTOS_H */
@@ -48,5 +48,16 @@ esp_err_t configure_servo(void);
  */
 esp_err_t servo_set_angle(uint8_t angle);
 
+/**
+ * @brief 角度换算为 LEDC 占空比 (14 位分辨率，50Hz)
+ * @param angle 角度，超过 SERVO_MAX_ANGLE 按最大角度计算
+ */
+uint32_t servo_angle_to_duty(uint8_t angle);
+
+/**
+ * @brief 当前舵机角度 (移动过程中为最近一步的角度)
+ */
+uint8_t servo_get_angle(void);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+/**
+ * @file boot_trace.h
+ * @brief 启动过程分析 - 记录各初始化阶段的 esp_timer 时间戳
+ */
+
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 启动阶段 (有起止时间)
+ */
+typedef enum {
+    BOOT_STAGE_NVS = 0,
+    BOOT_STAGE_LED,
+    BOOT_STAGE_KEY,
+    BOOT_STAGE_SERVO,
+    BOOT_STAGE_QUEUES,
+    BOOT_STAGE_TASKS,
+    BOOT_STAGE_WIFI,
+    BOOT_STAGE_BLE,
+    BOOT_STAGE_MQTT,
+    BOOT_STAGE_MAX
+} boot_stage_t;
+
+/**
+ * @brief 启动里程碑 (单一时间点)
+ */
+typedef enum {
+    BOOT_MARK_APP_MAIN = 0,     /**< 进入 app_main */
+    BOOT_MARK_UNLOCK_READY,     /**< 按键/舵机链路可用，可以开门 */
+    BOOT_MARK_BLE_ADV,          /**< BLE 开始广播 */
+    BOOT_MARK_WIFI_UP,          /**< WiFi 获取 IP */
+    BOOT_MARK_MQTT_UP,          /**< MQTT 连接 Broker */
+    BOOT_MARK_MAX
+} boot_mark_t;
+
+/**
+ * @brief 记录阶段开始
+ */
+void boot_trace_begin(boot_stage_t stage);
+
+/**
+ * @brief 记录阶段结束
+ *
+ * @param stage 阶段
+ * @param err 阶段执行结果
+ */
+void boot_trace_end(boot_stage_t stage, esp_err_t err);
+
+/**
+ * @brief 记录里程碑，仅首次调用生效
+ */
+void boot_trace_mark(boot_mark_t mark);
+
+/**
+ * @brief 打印启动时间表
+ */
+void boot_trace_dump(void);
+
+/**
+ * @brief 将启动时间表编码为 JSON
+ *
+ * @param buf 输出缓冲区
+ * @param len 缓冲区大小
+ * @return 写入长度，缓冲区不足返回 -1
+ */
+int boot_trace_to_json(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_TRACE_H */
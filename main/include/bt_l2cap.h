@@ -0,0 +1,109 @@
+/**
+ * @file bt_l2cap.h
+ * @brief BLE L2CAP 面向连接信道 (CoC) 批量传输服务
+ *
+ * 在 NUS 服务旁提供一个 L2CAP CoC 端点，用于事件日志、调试数据等大块数据导出。
+ * 基于信用的流控由 NimBLE 完成，本模块负责帧封装和数据源调度。
+ *
+ * 帧格式 (每个 SDU 一帧，小端):
+ *   | type(1) | stream(1) | seq(2) | len(2) | payload(len) |
+ *
+ * 交互流程:
+ *   1. 客户端连接 PSM = CONFIG_BT_L2CAP_BULK_PSM
+ *   2. 客户端发送 REQ 帧: payload = offset(4) + max_len(4, 0 表示不限)
+ *   3. 设备连续发送 DATA 帧，最后发送 END 帧:
+ *      payload = total_len(4) + crc32(4) + duration_ms(4)
+ *   4. 出错时发送 ERR 帧: payload = esp_err_t(4)
+ */
+
+#ifndef BT_L2CAP_H
+#define BT_L2CAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 帧类型 */
+#define BT_L2CAP_FRAME_REQ    0x01  /* 客户端 -> 设备: 请求数据流 */
+#define BT_L2CAP_FRAME_DATA   0x02  /* 设备 -> 客户端: 数据 */
+#define BT_L2CAP_FRAME_END    0x03  /* 设备 -> 客户端: 传输结束 */
+#define BT_L2CAP_FRAME_ERR    0x04  /* 设备 -> 客户端: 错误 */
+#define BT_L2CAP_FRAME_ABORT  0x05  /* 客户端 -> 设备: 中止传输 */
+
+#define BT_L2CAP_FRAME_HDR_LEN 6
+
+/**
+ * @brief 批量数据流 ID
+ */
+typedef enum {
+    BT_L2CAP_STREAM_TEST = 0,   /**< 吞吐测试图案数据 */
+    BT_L2CAP_STREAM_DLOG = 1,   /**< 延迟日志转储 (dlog.h) */
+    BT_L2CAP_STREAM_TRACE = 2,  /**< 飞行记录器转储 (trace.h) */
+    BT_L2CAP_STREAM_JOURNAL = 3, /**< 门禁事件日志导出 (journal.h) */
+    BT_L2CAP_STREAM_COREDUMP = 4, /**< 核心转储原始数据 (crash_report.h) */
+    BT_L2CAP_STREAM_MAX = 8
+} bt_l2cap_stream_t;
+
+/**
+ * @brief 数据源读取回调
+ *
+ * @param offset 流内偏移
+ * @param buf 输出缓冲区
+ * @param len 缓冲区大小
+ * @return 实际读取字节数，0 表示流结束，负数表示错误
+ */
+typedef int (*bt_l2cap_source_read_t)(uint32_t offset, uint8_t *buf, size_t len);
+
+/**
+ * @brief 最近一次传输统计
+ */
+typedef struct {
+    uint8_t stream;         /**< 数据流 ID */
+    uint32_t bytes;         /**< 有效负载字节数 */
+    uint32_t frames;        /**< 发送帧数 */
+    uint32_t stalls;        /**< 因信用耗尽而阻塞的次数 */
+    uint32_t duration_ms;   /**< 传输耗时 */
+    uint32_t kbps;          /**< 吞吐量 (KB/s) */
+} bt_l2cap_stats_t;
+
+/**
+ * @brief 初始化 L2CAP CoC 服务端
+ *
+ * 需要在 nimble_port_init() 之后、Host 任务启动之前调用
+ *
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t bt_l2cap_init(void);
+
+/**
+ * @brief 注册批量数据源
+ *
+ * @param stream 数据流 ID
+ * @param read 读取回调，传 NULL 取消注册
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t bt_l2cap_register_source(bt_l2cap_stream_t stream, bt_l2cap_source_read_t read);
+
+/**
+ * @brief 检查 CoC 信道是否已建立
+ */
+bool bt_l2cap_is_connected(void);
+
+/**
+ * @brief 获取最近一次传输统计
+ *
+ * @param stats 输出统计
+ * @return ESP_OK成功, ESP_ERR_NOT_FOUND尚无传输
+ */
+esp_err_t bt_l2cap_get_last_stats(bt_l2cap_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BT_L2CAP_H */
@@ -20,7 +20,10 @@ extern "C" {
 /* SPP服务名称 */
 #define SPP_SERVER_NAME "SPP_SERVER"
 
-/* 指令定义 */
+/*
+ * 指令以换行 (\r 或 \n) 结尾，整行为 OPEN 时开门，其他行按诊断命令处理 (见 diag_cmd.h)。
+ * 兼容旧客户端: 没有未完成的行时，一次写入恰为 OPEN (不带换行) 同样开门。
+ */
 #define BT_CMD_OPEN_DOOR "OPEN"
 #define BT_CMD_MAX_LEN   32
 
@@ -28,9 +31,34 @@ extern "C" {
 #define BT_RSP_OK        "OK\r\n"
 #define BT_RSP_ERROR     "ERROR\r\n"
 #define BT_RSP_UNKNOWN   "UNKNOWN\r\n"
+#define BT_RSP_BUSY      "BUSY\r\n"
+
+/**
+ * @brief 接收到的字节流识别结果
+ */
+typedef enum {
+    BT_CMD_NONE = 0,    /**< 未完成 */
+    BT_CMD_OPEN,        /**< 换行结束的一行，或一次完整写入，恰好为 OPEN */
+    BT_CMD_LINE,        /**< 换行结束一条其他的非空行 (诊断命令) */
+} bt_cmd_t;
+
+/**
+ * @brief 指令缓冲区
+ */
+typedef struct {
+    char buffer[BT_CMD_MAX_LEN];
+    uint8_t len;
+    bool overflow;      /**< 当前行超长，丢弃到换行为止 */
+} bt_cmd_buffer_t;
+
+/* 常规连接参数 */
+#define BT_CONN_ITVL_MIN              24   /* 30ms (24 * 1.25ms) */
+#define BT_CONN_ITVL_MAX              40   /* 50ms (40 * 1.25ms) */
+#define BT_CONN_SUPERVISION_TIMEOUT   400  /* 4s (400 * 10ms) */
 
 /**
  * @brief 初始化蓝牙SPP服务
+ * @note 调用前需要完成 NVS 初始化
  * @return ESP_OK成功, 其他失败
  */
 esp_err_t bt_spp_init(void);
@@ -49,6 +77,29 @@ bool bt_spp_is_connected(void);
  */
 esp_err_t bt_spp_send(const char *data, size_t len);
 
+/**
+ * @brief 向指令缓冲区追加一个字节并识别指令 (不执行，识别后由调用方 bt_cmd_reset)
+ *
+ * 超过 BT_CMD_MAX_LEN - 1 字节的行整行丢弃。
+ */
+bt_cmd_t bt_cmd_feed(bt_cmd_buffer_t *cmd, char c);
+
+/**
+ * @brief 一次写入的字节全部 bt_cmd_feed 之后调用，识别不带换行的 OPEN 写入
+ *
+ * 写入开始时没有未完成的行 (start_len 为 0) 且缓冲区恰为 OPEN 时返回 BT_CMD_OPEN，
+ * 其余情况返回 BT_CMD_NONE，缓冲区内容留待后续写入补全换行。
+ *
+ * @param cmd 指令缓冲区
+ * @param start_len 本次写入开始前的 cmd->len
+ */
+bt_cmd_t bt_cmd_write_end(const bt_cmd_buffer_t *cmd, size_t start_len);
+
+/**
+ * @brief 清空指令缓冲区
+ */
+void bt_cmd_reset(bt_cmd_buffer_t *cmd);
+
 #ifdef __cplusplus
 }
 #endif
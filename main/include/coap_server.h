@@ -0,0 +1,44 @@
+/**
+ * @file coap_server.h
+ * @brief CoAP/UDP 轻量控制端点 (RFC 7252 子集 + RFC 7641 observe)
+ *
+ * 面向电池供电和高密度部署: 无 TCP 握手和 MQTT 保活，一条命令一个 UDP 往返。
+ *
+ * 资源 (coap://<设备>:5683):
+ *   GET  /door         当前状态 (与 state_shadow 的 state 消息相同)，Observe=0 订阅
+ *   PUT  /door         载荷 "open"/"close" (或 "ON"/"OFF")，返回 2.04 / 5.03 队列满
+ *   GET  /telemetry    最新一条遥测，Observe=0 订阅
+ *   GET  /.well-known/core
+ *
+ * 开/关门命令写入舵机任务队列，与 MQTT、HTTP 命令走同一条处理路径。
+ * 请求的 CON 报文以捎带 ACK 应答；重复的 CON 命令 (客户端重传) 只执行一次。
+ * 门状态通知以 CON 发送并按 RFC 7252 退避重传，重传耗尽或收到 RST 时移除观察者；
+ * 遥测通知以 NON 发送，每 COAP_CON_EVERY 条改用 CON 确认观察者仍在。
+ *
+ * PUT/POST 需带 Uri-Query "k=<CONFIG_COAP_SERVER_KEY>"；未配置密钥时不提供 /door
+ * (返回 4.04)，只有 /telemetry。未使用 DTLS，密钥明文传输，仅适合受信任的局域网。
+ *
+ * 与 MQTT 路径的延迟/报文数对比: tools/coap_bench.py
+ */
+
+#ifndef COAP_SERVER_H
+#define COAP_SERVER_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 启动 CoAP 服务器 (需在 esp_netif 初始化之后调用)
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t coap_server_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_SERVER_H */
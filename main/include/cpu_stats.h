@@ -0,0 +1,73 @@
+/**
+ * @file cpu_stats.h
+ * @brief CPU 占用统计 - 基于 FreeRTOS 运行时间统计的滑动窗口采样
+ *
+ * 每个采样周期读取一次各任务累计运行时间，给出两个窗口内的占用率:
+ * 短窗口为最近一个采样周期，长窗口为最近 CONFIG_CPU_STATS_WINDOW 个周期。
+ * 占用率以千分比表示，多核芯片上各核合计为 1000 * 核数。
+ */
+
+#ifndef CPU_STATS_H
+#define CPU_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CPU_STATS_MAX_TASKS 24
+
+/**
+ * @brief 单个任务的占用率
+ */
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint16_t short_pm;      /**< 短窗口占用 (‰) */
+    uint16_t long_pm;       /**< 长窗口占用 (‰) */
+} cpu_task_usage_t;
+
+/**
+ * @brief 统计快照
+ */
+typedef struct {
+    uint32_t short_ms;      /**< 短窗口长度 (ms) */
+    uint32_t long_ms;       /**< 长窗口长度 (ms) */
+    uint16_t idle_short_pm; /**< 短窗口空闲占比 (‰) */
+    uint16_t idle_long_pm;  /**< 长窗口空闲占比 (‰) */
+    uint8_t count;          /**< 有效任务数 */
+    cpu_task_usage_t tasks[CPU_STATS_MAX_TASKS];
+} cpu_stats_t;
+
+/**
+ * @brief 启动采样任务并注册 TOP 诊断命令
+ *
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t cpu_stats_start(void);
+
+/**
+ * @brief 获取最近一次计算的统计结果
+ *
+ * @param out 输出快照，任务按长窗口占用率降序排列
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE尚无完整窗口
+ */
+esp_err_t cpu_stats_get(cpu_stats_t *out);
+
+/**
+ * @brief 将统计结果序列化为 JSON
+ *
+ * 格式: {"win":[short_ms,long_ms],"idle":[s,l],"tasks":{"<name>":[s,l],...}}
+ *
+ * @return 写入长度，失败返回 -1
+ */
+int cpu_stats_to_json(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPU_STATS_H */
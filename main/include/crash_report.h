@@ -0,0 +1,51 @@
+/**
+ * @file crash_report.h
+ * @brief 崩溃报告 - Flash 核心转储的启动摘要与完整转储导出
+ *
+ * panic / 看门狗复位时 ESP-IDF 把 ELF 格式核心转储写入 coredump 分区。重启后:
+ *   - 启动阶段只记录复位原因，并从 noinit 飞行记录器中截取上一次启动的最后几条事件 (内存拷贝)；
+ *   - 低优先级任务等到 MQTT 上线后才读取 Flash: 校验转储、提取 panic 原因、PC/RA、
+ *     栈中的疑似返回地址、任务列表 (TCB 名称与 PC)，组成约 1 KB 的 JSON
+ *     发布到 telemetry/crash，因此不推迟上线时间。
+ *
+ * 完整转储 (分区原始格式) 可通过 L2CAP 数据流 BT_L2CAP_STREAM_COREDUMP 或
+ * HTTP GET /api/coredump 取回，主机端用 `esp-coredump info_corefile -t raw -c core.bin app.elf` 解析。
+ * 转储保留到 HTTP DELETE /api/coredump 或诊断命令 "CORE ERASE" 擦除，之后的崩溃覆盖写入。
+ */
+
+#ifndef CRASH_REPORT_H
+#define CRASH_REPORT_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 记录复位原因和上一次启动的跟踪事件，注册转储通道和诊断命令 "CORE"
+ *
+ * 需在 trace_init() 之后、其他任务启动之前调用；崩溃复位时创建摘要任务。
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t crash_report_init(void);
+
+/**
+ * @brief MQTT 已连接，允许摘要任务开始读取 Flash 并发布 (可重复调用)
+ */
+void crash_report_online(void);
+
+/**
+ * @brief 在 HTTP 服务器上注册 GET/DELETE /api/coredump
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t crash_report_register_http(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRASH_REPORT_H */
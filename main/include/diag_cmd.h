@@ -0,0 +1,143 @@
+/**
+ * @file diag_cmd.h
+ * @brief 诊断命令分发 - UART 控制台、BLE 与 MQTT 共用的文本命令表
+ *
+ * 命令为一行文本，首个单词为命令名 (不区分大小写)，其余为参数。
+ * 各模块在初始化时注册自己的命令，输出通过调用方提供的回调写回。
+ *
+ * 远程通道用 diag_cmd_submit 把命令交给最低优先级的 diag 任务串行执行，
+ * 耗时的命令 (BENCH、TRACE DUMP 等) 不占用 BLE host / MQTT 任务，也不抢占开门路径。
+ *
+ * 权限: BLE NUS 与 MQTT 没有认证，只能执行注册为 DIAG_ACCESS_REMOTE 的只读命令；
+ * 改变设备状态的命令注册为 DIAG_ACCESS_LOCAL，只在本地 UART 控制台执行。
+ * 远程可用命令中改变状态的子命令 (如 CORE ERASE) 由处理函数用 diag_cmd_check_local 拒绝。
+ */
+
+#ifndef DIAG_CMD_H
+#define DIAG_CMD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DIAG_CMD_MAX_ARGS   8
+#define DIAG_CMD_LINE_MAX   64
+
+/**
+ * @brief 命令输出回调
+ *
+ * @param text 输出文本 (不保证以 '\0' 结尾)
+ * @param len 文本长度
+ * @param ctx 调用方上下文
+ */
+typedef void (*diag_out_fn_t)(const char *text, size_t len, void *ctx);
+
+/**
+ * @brief 命令输出通道
+ */
+typedef struct {
+    diag_out_fn_t fn;
+    void *ctx;
+    bool local;         /**< 本地 UART 控制台，可执行改变设备状态的命令；远程通道为 false */
+} diag_out_t;
+
+/**
+ * @brief 命令可用的通道
+ */
+typedef enum {
+    DIAG_ACCESS_LOCAL = 0,  /**< 仅本地 UART 控制台 */
+    DIAG_ACCESS_REMOTE,     /**< 只读命令，BLE/MQTT 也可执行 */
+} diag_access_t;
+
+/**
+ * @brief 命令处理函数
+ *
+ * @param argc 参数个数 (含命令名)
+ * @param argv 参数数组
+ * @param out 输出通道
+ * @return ESP_OK成功, 其他失败
+ */
+typedef esp_err_t (*diag_cmd_handler_t)(int argc, char **argv, const diag_out_t *out);
+
+/**
+ * @brief 注册命令
+ *
+ * @param name 命令名 (静态字符串)
+ * @param help 帮助文本 (静态字符串)
+ * @param handler 处理函数
+ * @param access 可用通道
+ * @return ESP_OK成功, ESP_ERR_NO_MEM命令表已满
+ */
+esp_err_t diag_cmd_register(const char *name, const char *help, diag_cmd_handler_t handler,
+                            diag_access_t access);
+
+/**
+ * @brief 解析并执行一行命令
+ *
+ * @param line 命令行
+ * @param out 输出通道
+ * @return 处理函数返回值, ESP_ERR_NOT_FOUND未知命令, ESP_ERR_INVALID_ARG空行,
+ *         ESP_ERR_NOT_ALLOWED远程通道执行仅限本地的命令
+ */
+esp_err_t diag_cmd_execute(const char *line, const diag_out_t *out);
+
+/**
+ * @brief 异步命令完成回调 (在 diag 任务中调用)
+ *
+ * @param ret 处理函数返回值，同 diag_cmd_execute
+ * @param out 提交时的输出通道
+ */
+typedef void (*diag_done_fn_t)(esp_err_t ret, const diag_out_t *out);
+
+/**
+ * @brief 命令注册通知 (UART 控制台据此把命令同步到 esp_console)
+ */
+typedef void (*diag_cmd_hook_t)(const char *name, const char *help);
+
+/**
+ * @brief 创建 diag 执行任务
+ *
+ * @return ESP_OK成功, ESP_ERR_NO_MEM创建失败
+ */
+esp_err_t diag_cmd_start(void);
+
+/**
+ * @brief 提交一行命令到 diag 任务执行
+ *
+ * 命令行被复制，out 指向的结构和其 ctx 须保持有效直到 done 被调用。
+ * diag 任务未启动时在调用方上下文中同步执行。
+ *
+ * @param line 命令行
+ * @param out 输出通道
+ * @param done 完成回调，可为 NULL
+ * @return ESP_OK已提交, ESP_ERR_NO_MEM队列已满, ESP_ERR_INVALID_ARG参数错误
+ */
+esp_err_t diag_cmd_submit(const char *line, const diag_out_t *out, diag_done_fn_t done);
+
+/**
+ * @brief 设置命令注册通知，已注册的命令立即逐个通知一次
+ */
+void diag_cmd_set_register_hook(diag_cmd_hook_t hook);
+
+/**
+ * @brief 改变设备状态的子命令执行前检查通道，远程通道输出拒绝信息
+ *
+ * @param out 输出通道
+ * @return true 本地 UART 可以执行, false 已拒绝 (处理函数返回 ESP_ERR_NOT_ALLOWED)
+ */
+bool diag_cmd_check_local(const diag_out_t *out);
+
+/**
+ * @brief 格式化输出
+ */
+void diag_printf(const diag_out_t *out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIAG_CMD_H */
@@ -0,0 +1,33 @@
+/**
+ * @file diag_console.h
+ * @brief UART 诊断控制台 - 基于 esp_console REPL，命令来自 diag_cmd 命令表
+ *
+ * 通过 diag_cmd 的注册通知把每条诊断命令同步注册到 esp_console，输入一行后交给
+ * diag 任务执行，REPL 任务等待结果，UART、BLE (NUS) 和 MQTT 三个通道共用同一张
+ * 命令表和同一个最低优先级执行任务。命令名区分大小写 (与 HELP 列出的一致)，
+ * 列表用 esp_console 自带的 help。只有本通道能执行改变设备状态的命令 (见 diag_cmd.h)。
+ *
+ * 控制台通道由 CONFIG_ESP_CONSOLE_UART / CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG 决定。
+ */
+
+#ifndef DIAG_CONSOLE_H
+#define DIAG_CONSOLE_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 创建 REPL 并注册已有的诊断命令，之后注册的命令自动加入
+ *
+ * @return ESP_OK成功 (未开启 CONFIG_DIAG_CONSOLE_ENABLE 时直接返回), 其他为 esp_console 错误
+ */
+esp_err_t diag_console_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIAG_CONSOLE_H */
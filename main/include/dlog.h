@@ -0,0 +1,113 @@
+/**
+ * @file dlog.h
+ * @brief 延迟二进制日志 - 热路径只记录格式串指针和原始参数
+ *
+ * DLOGx 宏在调用处只做一次 32 字节的记录拷贝，字符串格式化由低优先级
+ * 排空任务完成，或在主机端用 tools/dlog_decode.py 结合 ELF 解码转储。
+ *
+ * 使用限制:
+ *  - 最多 4 个参数，每个参数按 32 位保存 (整数、指针、字符)
+ *  - %s 参数必须指向常量字符串 (存放于 rodata)，不能是栈或堆上的缓冲区
+ *  - 不支持浮点和 64 位参数
+ *
+ * 未开启 CONFIG_DLOG_ENABLE 时 DLOGx 直接展开为 ESP_LOGx。
+ */
+
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DLOG_MAX_ARGS   4
+#define DLOG_MAGIC      0x31474C44  /* "DLG1" */
+
+/**
+ * @brief 日志记录 (转储格式与内存布局一致，小端)
+ */
+typedef struct {
+    uint32_t ts_us;                 /**< esp_timer 时间戳低 32 位 */
+    const char *tag;
+    const char *fmt;
+    uint8_t level;                  /**< esp_log_level_t */
+    uint8_t nargs;
+    uint16_t seq;                   /**< 写入序号低 16 位，主机端用于检测丢失 */
+    uint32_t args[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+/**
+ * @brief 转储头
+ */
+typedef struct {
+    uint32_t magic;                 /**< DLOG_MAGIC */
+    uint16_t record_size;           /**< sizeof(dlog_record_t) */
+    uint16_t count;                 /**< 随后的记录数 */
+    uint32_t head;                  /**< 转储时的写入总数 */
+    uint32_t dropped;               /**< 排空任务累计丢失数 */
+} dlog_dump_header_t;
+
+/**
+ * @brief 写入一条记录
+ *
+ * 请通过 DLOGx 宏调用。可在任务和中断中使用。
+ */
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt, uint32_t nargs,
+                uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/**
+ * @brief 初始化环形缓冲区，启动排空任务并注册转储通道
+ *
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t dlog_init(void);
+
+/**
+ * @brief 读取转储数据 (头 + 最近的记录，按时间顺序)
+ *
+ * 读取偏移 0 时锁定当前写入位置，之后的读取基于该快照。
+ *
+ * @return 读取字节数，0 表示结束
+ */
+int dlog_dump_read(uint32_t offset, uint8_t *buf, size_t len);
+
+#if CONFIG_DLOG_ENABLE
+
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, N, ...) N
+#define DLOG_NARGS(...) DLOG_NARGS_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define DLOG_ARG(x) ((uint32_t)(uintptr_t)(x))
+#define DLOG_PICK_(_d, a0, a1, a2, a3, ...) \
+    DLOG_ARG(a0), DLOG_ARG(a1), DLOG_ARG(a2), DLOG_ARG(a3)
+
+#define DLOG_WRITE(level, tag, fmt, ...) do { \
+        _Static_assert(DLOG_NARGS(__VA_ARGS__) <= DLOG_MAX_ARGS, "dlog: too many arguments"); \
+        if (LOG_LOCAL_LEVEL >= (level)) { \
+            dlog_write((level), (tag), (fmt), DLOG_NARGS(__VA_ARGS__), \
+                       DLOG_PICK_(0, ##__VA_ARGS__, 0, 0, 0, 0, 0)); \
+        } \
+    } while (0)
+
+#define DLOGE(tag, fmt, ...) DLOG_WRITE(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_WRITE(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_WRITE(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_WRITE(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+#else
+
+#define DLOGE(tag, fmt, ...) ESP_LOGE(tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) ESP_LOGW(tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) ESP_LOGI(tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) ESP_LOGD(tag, fmt, ##__VA_ARGS__)
+
+#endif /* CONFIG_DLOG_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLOG_H */
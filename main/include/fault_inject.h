@@ -0,0 +1,131 @@
+/**
+ * @file fault_inject.h
+ * @brief 故障注入 - 在队列、网络和执行器路径上人为制造失败并统计恢复时间
+ *
+ * 注入点以 FAULT_INJECT(id) 嵌入调用路径，返回 true 时调用方按真实失败处理
+ * (队列满、发布失败、通知失败、LEDC 错误)；恢复点 FAULT_RECOVERED(id) 放在同一路径的
+ * 成功分支。未开启 CONFIG_FAULT_INJECT_ENABLE 时两个宏展开为常量/空语句，
+ * 注入点不产生任何代码；开启后未布防的注入点只有一次位测试。
+ *
+ * 布防: fault_inject_arm(id, 次数, 概率‰)，每次经过注入点按概率失败，累计失败次数
+ * 达到上限后自动撤防。Wi-Fi 断开没有调用路径可失败，布防时通过注册的触发函数
+ * 立即断开，之后的重连成功事件同样作为注入点 (连续断开)。
+ *
+ * 恢复时间: 一类故障首次注入到其恢复点首次成功的间隔，按故障类别统计次数/最大/平均值。
+ *
+ * 控制: 诊断命令 FAULT，主机仿真脚本的 fault 动作 (见 components/sim/include/sim_script.h)。
+ */
+
+#ifndef FAULT_INJECT_H
+#define FAULT_INJECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 故障类别
+ */
+typedef enum {
+    FAULT_QUEUE_FULL = 0,   /**< msg_queue_send 返回队列满 */
+    FAULT_WIFI_DISCONNECT,  /**< Wi-Fi 断开，恢复点为重新获取 IP */
+    FAULT_MQTT_PUBLISH,     /**< MQTT 发布失败 */
+    FAULT_BLE_NOTIFY,       /**< BLE 通知失败 */
+    FAULT_SERVO_LEDC,       /**< 舵机 LEDC 占空比更新失败 */
+    FAULT_MAX
+} fault_id_t;
+
+/**
+ * @brief 单类故障统计
+ */
+typedef struct {
+    uint32_t remaining;     /**< 剩余注入次数，0 表示未布防 */
+    uint16_t permille;      /**< 每次经过注入点的失败概率 (‰) */
+    uint32_t hits;          /**< 布防期间经过注入点次数 */
+    uint32_t injected;      /**< 累计注入次数 */
+    uint32_t recoveries;    /**< 已恢复的故障次数 */
+    uint32_t last_ms;       /**< 最近一次恢复时间 */
+    uint32_t max_ms;
+    uint32_t avg_ms;
+    bool pending;           /**< 已注入、尚未恢复 */
+} fault_stats_t;
+
+/**
+ * @brief 触发型故障的执行函数 (布防时调用一次)
+ */
+typedef void (*fault_trigger_t)(void);
+
+#if CONFIG_FAULT_INJECT_ENABLE
+
+/* 布防位与未恢复位，注入点和恢复点先测试对应位，未布防时不调用函数 */
+extern volatile uint32_t fault_inject_armed_mask;
+extern volatile uint32_t fault_inject_pending_mask;
+
+bool fault_inject_hit(fault_id_t id);
+void fault_inject_recovered(fault_id_t id);
+
+#define FAULT_INJECT(id) \
+    ((fault_inject_armed_mask & (1UL << (id))) != 0 && fault_inject_hit(id))
+#define FAULT_RECOVERED(id) do { \
+        if (fault_inject_pending_mask & (1UL << (id))) { \
+            fault_inject_recovered(id); \
+        } \
+    } while (0)
+
+#else
+
+#define FAULT_INJECT(id) (false)
+#define FAULT_RECOVERED(id) do { } while (0)
+
+#endif /* CONFIG_FAULT_INJECT_ENABLE */
+
+/**
+ * @brief 注册诊断命令 "FAULT"
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t fault_inject_init(void);
+
+/**
+ * @brief 布防故障
+ *
+ * @param id 故障类别
+ * @param count 注入次数，0 表示撤防
+ * @param permille 每次经过注入点的失败概率 (1-1000‰)
+ * @return ESP_OK成功, ESP_ERR_INVALID_ARG参数错误, ESP_ERR_NOT_SUPPORTED未开启故障注入
+ */
+esp_err_t fault_inject_arm(fault_id_t id, uint32_t count, uint16_t permille);
+
+/**
+ * @brief 注册触发型故障的执行函数
+ */
+void fault_inject_set_trigger(fault_id_t id, fault_trigger_t trigger);
+
+/**
+ * @brief 按名称 (queue / wifi / mqtt / ble / servo，不区分大小写) 查找故障类别
+ *
+ * @return 故障类别，未找到返回 FAULT_MAX
+ */
+fault_id_t fault_inject_find(const char *name);
+
+/**
+ * @brief 故障类别名称
+ */
+const char *fault_inject_name(fault_id_t id);
+
+/**
+ * @brief 读取单类故障统计
+ *
+ * @return ESP_OK成功, ESP_ERR_INVALID_ARG参数错误, ESP_ERR_NOT_SUPPORTED未开启故障注入
+ */
+esp_err_t fault_inject_get_stats(fault_id_t id, fault_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAULT_INJECT_H */
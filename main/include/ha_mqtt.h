@@ -4,12 +4,16 @@
  * 
  * 实现 MQTT 客户端，集成 Home Assistant 自动发现，
  * 提供开门开关远程控制功能。
+ * 
+ * 诊断命令 (见 diag_cmd.h) 发往 esp32c6/<device_id>/diag/cmd，
+ * 响应发布到 esp32c6/<device_id>/diag/rsp。
  */
 
 #ifndef HA_MQTT_H
 #define HA_MQTT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -25,6 +29,25 @@ extern "C" {
  */
 typedef void (*ha_mqtt_door_callback_t)(bool is_on);
 
+/**
+ * @brief MQTT 连接成功回调函数类型
+ * 
+ * 每次连接 Broker 成功后，在 MQTT 任务中调用
+ */
+typedef void (*ha_mqtt_connect_callback_t)(void);
+
+/**
+ * @brief 设备主题数据回调
+ *
+ * 超过 MQTT 接收缓冲区的消息会分片回调，offset/total 为分片在整条消息中的位置
+ *
+ * @param data 分片数据
+ * @param len 分片长度
+ * @param offset 分片在消息中的偏移
+ * @param total 消息总长度
+ */
+typedef void (*ha_mqtt_data_callback_t)(const char *data, int len, int offset, int total);
+
 /**
  * @brief 初始化 MQTT 客户端
  * 
@@ -45,6 +68,16 @@ esp_err_t ha_mqtt_init(void);
  */
 esp_err_t ha_mqtt_start(void);
 
+/**
+ * @brief 更换 Broker 地址 (例如 mDNS 发现的地址)
+ * 
+ * 启动前调用时直接用于首次连接；运行中调用时在下一次自动重连时生效。
+ * 
+ * @param uri Broker URI，格式: mqtt://host:port
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 未初始化
+ */
+esp_err_t ha_mqtt_set_broker_uri(const char *uri);
+
 /**
  * @brief 停止 MQTT 客户端
  * 
@@ -78,6 +111,66 @@ esp_err_t ha_mqtt_publish_door_state(bool is_on);
  */
 void ha_mqtt_register_door_callback(ha_mqtt_door_callback_t callback);
 
+/**
+ * @brief 注册 MQTT 连接成功回调
+ * 
+ * @param callback 回调函数，传 NULL 取消注册
+ */
+void ha_mqtt_register_connect_callback(ha_mqtt_connect_callback_t callback);
+
+/**
+ * @brief 生成 Home Assistant 自动发现配置 JSON
+ * 
+ * @param buf 输出缓冲区
+ * @param len 缓冲区大小
+ * @return 写入的字节数 (不含 '\0')，缓冲区不足返回 -1
+ */
+int ha_mqtt_build_discovery(char *buf, size_t len);
+
+/**
+ * @brief 发布遥测数据
+ * 
+ * 发布到 esp32c6/<device_id>/telemetry/<name>，QoS 0，不保留
+ * 
+ * @param name 遥测子主题名称
+ * @param payload 负载字符串
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 未连接，其他失败
+ */
+esp_err_t ha_mqtt_publish_telemetry(const char *name, const char *payload);
+
+/**
+ * @brief 发布二进制遥测数据
+ * 
+ * @param name 遥测子主题名称
+ * @param data 负载
+ * @param len 负载长度
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 未连接，其他失败
+ */
+esp_err_t ha_mqtt_publish_telemetry_raw(const char *name, const void *data, size_t len);
+
+/**
+ * @brief 订阅设备主题 esp32c6/<device_id>/<suffix>
+ *
+ * 可在连接前调用，每次连接成功后自动重新订阅
+ *
+ * @param suffix 子主题 (静态字符串)
+ * @param qos 订阅 QoS
+ * @param callback 数据回调，在 MQTT 任务中执行
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 订阅表已满
+ */
+esp_err_t ha_mqtt_subscribe(const char *suffix, int qos, ha_mqtt_data_callback_t callback);
+
+/**
+ * @brief 发布到设备主题 esp32c6/<device_id>/<suffix>，不保留
+ *
+ * @param suffix 子主题
+ * @param data 负载
+ * @param len 负载长度
+ * @param qos QoS
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 未连接，其他失败
+ */
+esp_err_t ha_mqtt_publish(const char *suffix, const void *data, size_t len, int qos);
+
 /**
  * @brief 获取设备 ID
  * 
@@ -0,0 +1,108 @@
+/**
+ * @file heap_monitor.h
+ * @brief 堆监控 - 按子系统统计堆占用，跟踪最大空闲块和碎片率
+ *
+ * Wi-Fi、NimBLE、esp-mqtt 和应用任务共用同一个堆。开启 CONFIG_HEAP_TASK_TRACKING 后
+ * 每个块记录分配它的任务，周期采样时按任务汇总，再按任务归属折算到子系统
+ * (app / wifi / ble / mqtt / net / sys)；已删除任务仍持有的内存单独记为 dead，
+ * 调度器启动前的分配记为 boot。
+ *
+ * 碎片率 = 1 - 最大空闲块 / 空闲总量 (‰)，最近 CONFIG_HEAP_MONITOR_HISTORY 个采样保留在
+ * 环形缓冲区中用于观察趋势。分配失败时立即唤醒采样任务，记录失败大小、调用任务
+ * 和当时的子系统分布，并写入飞行记录器。
+ *
+ * 查询: 诊断命令 HEAP / HEAP HIST，周期上报 MQTT telemetry/heap。
+ */
+
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEAP_MONITOR_TOP_TASKS 8
+
+/**
+ * @brief 子系统
+ */
+typedef enum {
+    HEAP_SUBSYS_APP = 0,    /**< APP_TASK_TABLE 中的任务 */
+    HEAP_SUBSYS_WIFI,       /**< Wi-Fi 驱动 */
+    HEAP_SUBSYS_BLE,        /**< NimBLE host / 控制器 */
+    HEAP_SUBSYS_MQTT,       /**< esp-mqtt 客户端任务 */
+    HEAP_SUBSYS_NET,        /**< lwIP、事件循环、httpd、mDNS */
+    HEAP_SUBSYS_SYS,        /**< 其他系统任务 */
+    HEAP_SUBSYS_DEAD,       /**< 已删除的任务 */
+    HEAP_SUBSYS_BOOT,       /**< 调度器启动前 */
+    HEAP_SUBSYS_MAX
+} heap_subsys_t;
+
+/**
+ * @brief 单个任务的堆占用
+ */
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t bytes;
+    uint32_t blocks;
+} heap_task_usage_t;
+
+/**
+ * @brief 采样快照
+ */
+typedef struct {
+    uint32_t free;              /**< 空闲总量 (字节) */
+    uint32_t largest;           /**< 最大空闲块 (字节) */
+    uint32_t min_free;          /**< 启动以来最低空闲量 (字节) */
+    uint16_t frag_pm;           /**< 碎片率 (‰) */
+    uint32_t largest_min;       /**< 历史窗口内最大空闲块的最小值 */
+    uint16_t frag_max_pm;       /**< 历史窗口内碎片率最大值 */
+    uint32_t fail_count;        /**< 启动以来分配失败次数 */
+    uint32_t fail_size;         /**< 最近一次失败的请求大小 */
+    char fail_task[configMAX_TASK_NAME_LEN];    /**< 最近一次失败的调用任务 */
+    bool tracked;               /**< 是否有按子系统统计 (CONFIG_HEAP_TASK_TRACKING) */
+    uint32_t subsys[HEAP_SUBSYS_MAX];           /**< 各子系统占用 (字节) */
+    uint8_t count;              /**< tasks 有效个数 */
+    heap_task_usage_t tasks[HEAP_MONITOR_TOP_TASKS];    /**< 占用最多的任务，降序 */
+} heap_stats_t;
+
+/**
+ * @brief 注册分配失败回调，启动采样任务并注册 HEAP 诊断命令
+ *
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t heap_monitor_start(void);
+
+/**
+ * @brief 获取最近一次采样结果
+ *
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE尚未采样
+ */
+esp_err_t heap_monitor_get(heap_stats_t *out);
+
+/**
+ * @brief 子系统名称
+ */
+const char *heap_monitor_subsys_name(heap_subsys_t subsys);
+
+/**
+ * @brief 将采样结果序列化为 JSON
+ *
+ * 格式: {"free":N,"largest":N,"min":N,"frag":pm,"largest_min":N,"frag_max":pm,
+ *        "fail":[count,size,"task"],"subsys":{"app":N,...},"tasks":{"<name>":[bytes,blocks],...}}
+ *
+ * @return 写入长度，失败返回 -1
+ */
+int heap_monitor_to_json(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEAP_MONITOR_H */
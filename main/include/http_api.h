@@ -0,0 +1,63 @@
+/**
+ * @file http_api.h
+ * @brief 局域网 HTTP REST API - 不经过 MQTT broker 直接控制门锁
+ *
+ * 端点 (JSON 应答):
+ *   GET  /api/status   门状态、运行时间、空闲堆、WiFi/MQTT 连接状态
+ *   POST /api/open     开门 (到时自动关门)
+ *   POST /api/close    关门
+ *   GET  /api/config   设备 ID、开门时长、舵机角度等只读配置
+ *   GET  /api/ws       WebSocket 实时推送，见 ws_push.h
+ *   GET  /api/coredump 下载核心转储 (分区原始格式)，DELETE 擦除，见 crash_report.h
+ *
+ * 开/关门命令直接写入舵机任务队列，与按键、蓝牙、MQTT 命令走同一条处理路径，
+ * 队列满时返回 503。连接使用 HTTP/1.1 keep-alive，连接数达到上限时淘汰最久
+ * 未使用的连接。
+ *
+ * 鉴权: 请求需携带 "Authorization: Bearer <CONFIG_HTTP_API_TOKEN>"，只有 /api/ws
+ * 另外接受 ?token= (浏览器 WebSocket 无法设置请求头)。未配置令牌时只注册
+ * GET /api/status 和 GET /api/config，开关门、推送和转储端点均不开放。
+ *
+ * 延迟/吞吐测试: tools/http_bench.py，对设备或主机仿真 (SIM_HTTP=1，见 sim_main.c) 运行；
+ * 仿真走主机 TCP 栈，结果用于比较处理路径的改动，不代表设备上的绝对延迟
+ */
+
+#ifndef HTTP_API_H
+#define HTTP_API_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 启动 HTTP 服务器 (需在 esp_netif 初始化之后调用)
+ *
+ * 服务器监听所有接口，WiFi 连上之前也可以启动
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t http_api_start(void);
+
+/**
+ * @brief 检查请求的 Authorization 头是否携带有效令牌 (常量时间比较)
+ *
+ * @return true 令牌正确；未配置令牌时总是 false
+ */
+bool http_api_authorized(httpd_req_t *req);
+
+/**
+ * @brief WebSocket 握手鉴权: Authorization 头或 ?token= 查询参数
+ *
+ * @return true 令牌正确；未配置令牌时总是 false
+ */
+bool http_api_ws_authorized(httpd_req_t *req);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTP_API_H */
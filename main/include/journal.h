@@ -0,0 +1,169 @@
+/**
+ * @file journal.h
+ * @brief 门禁事件日志 - 专用分区中的追加式循环日志
+ *
+ * 调用方只把记录拷贝到 RAM 批缓冲区，不会阻塞在 Flash 操作上；后台任务在攒满
+ * 一批或超过 CONFIG_JOURNAL_FLUSH_DELAY_S 后整批写入，每批一个块头和 CRC32。
+ * 块不跨扇区，扇区写满后擦除下一个 (最旧的) 扇区继续写，每 4KB 只擦除一次。
+ *
+ * 分区布局 (每扇区 4KB，小端):
+ *   扇区头: journal_sector_header_t
+ *   块:     journal_block_header_t + count 条 journal_record_t，直到扇区末尾或擦除态
+ *
+ * 挂载时扫描所有扇区建立每扇区的时间索引 (最早/最晚时间、记录数)，
+ * 按时间范围读取时跳过不相交的扇区。掉电造成的半写块按 CRC 丢弃，该扇区不再追加。
+ *
+ * 导出: L2CAP 数据流 BT_L2CAP_STREAM_JOURNAL (范围由 "JOURNAL EXPORT" 设置)，
+ * 或诊断命令 "JOURNAL LIST"；主机端用 tools/journal_decode.py 解码。
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JOURNAL_SECTOR_MAGIC    0x314E524A  /* "JRN1" */
+#define JOURNAL_BLOCK_MAGIC     0xB10C
+#define JOURNAL_EXPORT_MAGIC    0x3158524A  /* "JRX1" */
+
+/* 时间早于此值表示设备时钟未同步，time 为上电后秒数 */
+#define JOURNAL_TIME_VALID_MIN  1577836800  /* 2020-01-01 */
+
+/**
+ * @brief 事件类型 (只能追加)
+ */
+typedef enum {
+    JOURNAL_EVT_BOOT = 0,           /**< arg=复位原因 */
+    JOURNAL_EVT_DOOR_OPEN,
+    JOURNAL_EVT_DOOR_CLOSE,
+    JOURNAL_EVT_CREDENTIALS_CLEAR,  /**< 清除 WiFi 凭据 */
+    JOURNAL_EVT_OTA,                /**< 固件升级，arg=esp_err_t 结果 */
+    JOURNAL_EVT_TASK_STALL,         /**< 任务违反 SLO，arg=app_task_id_t << 8 | supervisor_kind_t */
+    JOURNAL_EVT_MAX
+} journal_evt_t;
+
+/**
+ * @brief 事件来源 (谁触发)
+ */
+typedef enum {
+    JOURNAL_SRC_SYS = 0,
+    JOURNAL_SRC_KEY,                /**< 本地按键 */
+    JOURNAL_SRC_BLE,                /**< 蓝牙命令 */
+    JOURNAL_SRC_MQTT,               /**< Home Assistant / MQTT */
+    JOURNAL_SRC_TIMER,              /**< 自动关门 */
+    JOURNAL_SRC_HTTP,               /**< 局域网 HTTP API */
+    JOURNAL_SRC_COAP,               /**< CoAP */
+    JOURNAL_SRC_DIAG,               /**< 串口诊断命令 SERVO，arg=舵机角度 */
+    JOURNAL_SRC_MAX
+} journal_src_t;
+
+/**
+ * @brief 日志记录 (16 字节，与 Flash 和导出格式一致)
+ */
+typedef struct {
+    uint32_t time;      /**< Unix 秒 (未同步时为上电后秒数) */
+    uint32_t seq;       /**< 全局递增序号 */
+    uint8_t evt;        /**< journal_evt_t */
+    uint8_t src;        /**< journal_src_t */
+    uint16_t boot;      /**< 启动次数低 16 位 */
+    uint32_t arg;
+} journal_record_t;
+
+/**
+ * @brief 扇区头，擦除后立即写入
+ */
+typedef struct {
+    uint32_t magic;     /**< JOURNAL_SECTOR_MAGIC */
+    uint32_t seq;       /**< 扇区序号，最大者为当前写入扇区 */
+    uint32_t reserved[2];
+} journal_sector_header_t;
+
+/**
+ * @brief 批次块头，随后为 count 条记录
+ */
+typedef struct {
+    uint16_t magic;     /**< JOURNAL_BLOCK_MAGIC */
+    uint8_t count;
+    uint8_t reserved;
+    uint32_t crc;       /**< 记录区 CRC32 */
+} journal_block_header_t;
+
+/**
+ * @brief 导出流头，随后为按时间范围过滤、从旧到新的记录
+ */
+typedef struct {
+    uint32_t magic;     /**< JOURNAL_EXPORT_MAGIC */
+    uint16_t record_size;
+    uint16_t reserved;
+    uint32_t from;
+    uint32_t to;
+} journal_export_header_t;
+
+/**
+ * @brief 范围读取回调
+ *
+ * @return true 继续, false 停止
+ */
+typedef bool (*journal_visit_t)(const journal_record_t *rec, void *ctx);
+
+/**
+ * @brief 查找分区、注册导出通道与诊断命令、创建后台任务
+ *
+ * 分区扫描在后台任务中完成，挂载前记录的事件暂存在 RAM 中
+ *
+ * @return ESP_OK成功, ESP_ERR_NOT_FOUND 无日志分区
+ */
+esp_err_t journal_init(void);
+
+/**
+ * @brief 追加一条事件 (只拷贝到 RAM，不访问 Flash)
+ *
+ * 批缓冲区满时丢弃并计数
+ */
+void journal_log(journal_evt_t evt, journal_src_t src, uint32_t arg);
+
+/**
+ * @brief 事件类型名 (与 tools/journal_decode.py 一致)
+ */
+const char *journal_evt_name(journal_evt_t evt);
+
+/**
+ * @brief 事件来源名
+ */
+const char *journal_src_name(journal_src_t src);
+
+/**
+ * @brief 立即提交 RAM 中的记录 (重启或导出前调用)
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t journal_flush(void);
+
+/**
+ * @brief 按时间范围读取已提交的记录，从旧到新
+ *
+ * @param from 起始时间 (含)
+ * @param to 结束时间 (含)，UINT32_MAX 表示不限
+ * @param fn 回调
+ * @param ctx 回调参数
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE 尚未挂载
+ */
+esp_err_t journal_read_range(uint32_t from, uint32_t to, journal_visit_t fn, void *ctx);
+
+/**
+ * @brief L2CAP 导出流读取回调
+ */
+int journal_export_read(uint32_t offset, uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JOURNAL_H */
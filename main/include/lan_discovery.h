@@ -0,0 +1,56 @@
+/**
+ * @file lan_discovery.h
+ * @brief 局域网服务发现 (mDNS / DNS-SD)
+ *
+ * 广播:
+ *   doorlock-<device_id>.local
+ *   _http._tcp      HTTP API 端口，TXT path=/api ws=/api/ws
+ *   _doorlock._tcp  TXT id=<device_id> ble=<BLE 设备名> fw=<版本>，供工具找到同一把锁的蓝牙通道
+ *
+ * 发现 MQTT broker (_mqtt._tcp)，只在配置了 CONFIG_LAN_DISCOVERY_BROKER_INSTANCE
+ * 或 CONFIG_HA_MQTT_BROKER_URI 为空时进行，否则局域网里任何应答方都能顶替配置的
+ * broker。结果 (主机名 + 端口) 缓存在 NVS:
+ *   1. 有缓存时只查询一次缓存主机名的 A 记录，broker 换 IP 也能直接解析
+ *   2. 无缓存或缓存主机无应答时浏览 _mqtt._tcp，取第一个带 IPv4 地址且实例名匹配
+ *      (未配置实例名时不限) 的实例并更新缓存
+ *   3. 都无应答时返回 ESP_ERR_NOT_FOUND，调用方沿用 CONFIG_HA_MQTT_BROKER_URI
+ */
+
+#ifndef LAN_DISCOVERY_H
+#define LAN_DISCOVERY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 启动 mDNS 并注册服务 (需在 esp_netif 和默认事件循环初始化之后调用)
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t lan_discovery_start(void);
+
+/**
+ * @brief 是否通过 mDNS 发现 broker: 配置了实例名，或没有配置 broker 地址
+ */
+bool lan_discovery_broker_enabled(void);
+
+/**
+ * @brief 解析 MQTT broker 地址 (阻塞，最长约 2 × CONFIG_LAN_DISCOVERY_QUERY_MS)
+ *
+ * @param uri 输出 "mqtt://a.b.c.d:port"
+ * @param len 缓冲区大小
+ * @return ESP_OK成功, ESP_ERR_NOT_FOUND 无应答, ESP_ERR_INVALID_STATE mDNS 未启动,
+ *         ESP_ERR_NOT_SUPPORTED 未启用或不发现 broker (见 lan_discovery_broker_enabled)
+ */
+esp_err_t lan_discovery_find_broker(char *uri, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LAN_DISCOVERY_H */
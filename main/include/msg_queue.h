@@ -32,6 +32,9 @@ typedef enum {
     MSG_TYPE_PWM,
     MSG_TYPE_WIFI,
     MSG_TYPE_MQTT,  /* MQTT 消息类型 */
+    MSG_TYPE_HTTP,  /* 局域网 HTTP API 命令 */
+    MSG_TYPE_COAP,  /* CoAP 命令 */
+    MSG_TYPE_TIMER, /* 时间轮定时器到期 */
     MSG_TYPE_MAX
 } msg_type_t;
 
@@ -65,7 +68,7 @@ typedef enum {
 
 typedef struct {
     pwm_event_t event;
-    uint8_t angle;          /* 用于 PWM_EVENT_SET_ANGLE */
+    uint8_t angle;          /* 用于 PWM_EVENT_SET_ANGLE (诊断命令 SERVO)，按开关门处理 */
 } pwm_msg_data_t;
 
 typedef enum {
@@ -85,6 +88,31 @@ typedef struct {
     mqtt_cmd_t cmd;
 } mqtt_msg_data_t;
 
+typedef enum {
+    HTTP_CMD_DOOR_OPEN = 0,
+    HTTP_CMD_DOOR_CLOSE,
+} http_cmd_t;
+
+typedef struct {
+    http_cmd_t cmd;
+} http_msg_data_t;
+
+typedef enum {
+    COAP_CMD_DOOR_OPEN = 0,
+    COAP_CMD_DOOR_CLOSE,
+} coap_cmd_t;
+
+typedef struct {
+    coap_cmd_t cmd;
+} coap_msg_data_t;
+
+struct wheel_timer;
+
+typedef struct {
+    struct wheel_timer *timer;  /* 到期的定时器 */
+    uint32_t gen;               /* 到期时的代数，见 timer_wheel_msg_is_current() */
+} timer_msg_data_t;
+
 typedef struct {
     msg_type_t type;
     union {
@@ -93,6 +121,9 @@ typedef struct {
         pwm_msg_data_t pwm;
         wifi_msg_data_t wifi;
         mqtt_msg_data_t mqtt;
+        http_msg_data_t http;
+        coap_msg_data_t coap;
+        timer_msg_data_t timer;
         uint8_t raw[8];
     } data;
 } msg_t;
@@ -113,6 +144,8 @@ bool msg_send_pwm_open_door(void);
 bool msg_send_pwm_set_angle(uint8_t angle);
 bool msg_send_to_wifi(wifi_cmd_t cmd);
 bool msg_send_mqtt_door_cmd(mqtt_cmd_t cmd);
+bool msg_send_http_door_cmd(http_cmd_t cmd);
+bool msg_send_coap_door_cmd(coap_cmd_t cmd);
 
 /* 发送按键事件到指定队列 */
 bool msg_send_key_event(queue_id_t queue_id, uint8_t gpio_num, key_event_t event);
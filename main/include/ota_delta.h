@@ -0,0 +1,91 @@
+/**
+ * @file ota_delta.h
+ * @brief 增量 OTA 补丁流式应用 - 以运行中的镜像为基准生成新镜像
+ *
+ * 补丁由 tools/ota_server.py pack --base 生成 (差分算法见 tools/ota_delta.py)，
+ * 作为 OTA_FLAG_DELTA 镜像的负载 (通常再经 deflate 压缩)。
+ *
+ * 补丁格式 (小端):
+ *   ota_delta_header_t
+ *   重复: ota_delta_op_t + add_len 字节差值 + insert_len 字节新数据
+ *
+ * add 段: new[k] = base[src_offset + k] + diff[k] (按字节模 256)，代码移动后
+ * 地址等字段的差值大多为 0 或少量相同的值，压缩率很高；insert 段为原样数据。
+ * 输出总长达到镜像头中的 image_size 即结束。
+ *
+ * 基准镜像按 base_size 和 SHA-256 校验，与运行中的分区不一致时拒绝升级。
+ */
+
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "ota_inflate.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_DELTA_MAGIC     0x31544C44  /* "DLT1" */
+
+/**
+ * @brief 补丁头 (40 字节)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         /**< OTA_DELTA_MAGIC */
+    uint32_t base_size;     /**< 基准镜像大小 */
+    uint8_t base_sha256[32];/**< 基准镜像 (前 base_size 字节) 的 SHA-256 */
+} ota_delta_header_t;
+
+/**
+ * @brief 补丁操作 (12 字节)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t add_len;       /**< 差值段长度 */
+    uint32_t insert_len;    /**< 新数据段长度 */
+    uint32_t src_offset;    /**< 差值段对应的基准镜像偏移 */
+} ota_delta_op_t;
+
+typedef struct ota_delta ota_delta_t;
+
+/**
+ * @brief 创建补丁应用器
+ *
+ * @param base 基准分区 (运行中的 app 分区)
+ * @param write 输出回调，按顺序收到新镜像
+ * @param ctx 回调参数
+ * @return 应用器，内存不足时为 NULL
+ */
+ota_delta_t *ota_delta_create(const esp_partition_t *base, ota_inflate_write_t write, void *ctx);
+
+/**
+ * @brief 输入一段补丁数据 (可任意切分)
+ *
+ * 签名与 ota_inflate_write_t 兼容，可直接作为解压器的输出回调
+ *
+ * @param ctx ota_delta_t
+ * @return ESP_OK成功, ESP_ERR_INVALID_VERSION 基准镜像不匹配,
+ *         ESP_ERR_INVALID_RESPONSE 补丁损坏, 或输出回调返回的错误
+ */
+esp_err_t ota_delta_feed(void *ctx, const uint8_t *buf, size_t len);
+
+/**
+ * @brief 补丁输入结束
+ *
+ * @return ESP_OK 补丁完整结束于操作边界, ESP_ERR_INVALID_RESPONSE 补丁截断
+ */
+esp_err_t ota_delta_finish(ota_delta_t *d);
+
+/**
+ * @brief 释放应用器
+ */
+void ota_delta_destroy(ota_delta_t *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_DELTA_H */
@@ -0,0 +1,79 @@
+/**
+ * @file ota_inflate.h
+ * @brief 流式 raw deflate 解压 (RFC 1951)，用于 OTA 压缩镜像
+ *
+ * 输入通过回调按需拉取，输出写入 2^window_bits 字节的环形窗口，窗口写满时整块
+ * 交给输出回调，RAM 占用与镜像大小无关。主机端压缩时必须使用相同的窗口位数
+ * (zlib wbits = -window_bits)，否则回溯距离可能超出窗口。
+ */
+
+#ifndef OTA_INFLATE_H
+#define OTA_INFLATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_INFLATE_WINDOW_BITS_MIN 9
+#define OTA_INFLATE_WINDOW_BITS_MAX 15
+
+/**
+ * @brief 输入回调
+ *
+ * @return 读取字节数 (>0)，0 表示输入结束，负数表示错误
+ */
+typedef int (*ota_inflate_read_t)(void *ctx, uint8_t *buf, size_t len);
+
+/**
+ * @brief 输出回调
+ *
+ * @return ESP_OK 继续，其他值中止解压并原样返回
+ */
+typedef esp_err_t (*ota_inflate_write_t)(void *ctx, const uint8_t *buf, size_t len);
+
+typedef struct ota_inflate ota_inflate_t;
+
+/**
+ * @brief 创建解压器
+ *
+ * @param window_bits 窗口位数 (9-15)
+ * @param read 输入回调
+ * @param write 输出回调
+ * @param ctx 回调参数
+ * @return 解压器，内存不足或参数错误时为 NULL
+ */
+ota_inflate_t *ota_inflate_create(int window_bits, ota_inflate_read_t read,
+                                  ota_inflate_write_t write, void *ctx);
+
+/**
+ * @brief 解压完整的 deflate 流，直到最后一个块结束
+ *
+ * @return ESP_OK成功, ESP_ERR_INVALID_RESPONSE 数据损坏或输入提前结束,
+ *         或输出回调返回的错误
+ */
+esp_err_t ota_inflate_run(ota_inflate_t *s);
+
+/**
+ * @brief 已消耗的输入字节数
+ */
+uint32_t ota_inflate_total_in(const ota_inflate_t *s);
+
+/**
+ * @brief 已输出的字节数
+ */
+uint32_t ota_inflate_total_out(const ota_inflate_t *s);
+
+/**
+ * @brief 释放解压器
+ */
+void ota_inflate_destroy(ota_inflate_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_INFLATE_H */
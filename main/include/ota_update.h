@@ -0,0 +1,93 @@
+/**
+ * @file ota_update.h
+ * @brief A/B 分区 OTA 升级 - 压缩镜像流式解压写入
+ *
+ * 镜像格式: ota_image_header_t + 负载 (raw deflate 或未压缩的 app bin)，
+ * 由 tools/ota_server.py pack 生成。负载边下载边解压，经 SHA-256 校验和
+ * esp_ota_end() 镜像校验后切换启动分区并重启。
+ *
+ * 签名: 镜像头带 ECDSA P-256 签名，开始写分区前用构建时嵌入的公钥
+ * (CONFIG_OTA_SIGNING_KEY) 校验，未签名或签名不符的镜像直接拒绝。签名覆盖
+ * 头中的 SHA-256，切换启动分区前又比对了最终镜像的 SHA-256，因此整个镜像
+ * 都经过认证。签名不防降级: 用同一私钥签过的旧镜像仍然可以装回。
+ *
+ * 增量镜像 (OTA_FLAG_DELTA, pack --base) 的负载是相对运行中镜像的补丁，
+ * 解压后经 ota_delta 应用得到完整镜像，见 ota_delta.h。
+ *
+ * 传输方式:
+ *  - HTTP: 诊断命令 "OTA HTTP <url>" (仅 UART 控制台) 或 MQTT 主题 esp32c6/<id>/ota/url
+ *  - MQTT: 主题 esp32c6/<id>/ota/chunk，每条消息 = 流偏移(4, 小端) + 数据，
+ *          设备在 esp32c6/<id>/ota/ack 回复下一个期望偏移，偏移 0 开始新的会话
+ *
+ * 回滚: 新镜像首次启动处于 PENDING_VERIFY 状态，启动失败立即回滚；
+ * 启动成功且 WiFi 连接后标记为有效，此前发生复位由 bootloader 回滚到旧分区。
+ */
+
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_IMAGE_MAGIC     0x3141544F  /* "OTA1" */
+#define OTA_FLAG_DEFLATE    0x0001      /* 负载为 raw deflate */
+#define OTA_FLAG_DELTA      0x0002      /* 负载 (解压后) 为 ota_delta 补丁 */
+#define OTA_SIGNATURE_MAX   72          /* P-256 ECDSA 签名 DER 编码的最大长度 */
+
+/**
+ * @brief OTA 镜像头 (128 字节，小端)
+ *
+ * 签名对象是 sig_len 之前各字段 (OTA_IMAGE_SIGNED_LEN 字节) 的 SHA-256
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         /**< OTA_IMAGE_MAGIC */
+    uint16_t header_size;   /**< sizeof(ota_image_header_t) */
+    uint16_t flags;         /**< OTA_FLAG_* */
+    uint8_t window_bits;    /**< 压缩窗口位数，不能大于 CONFIG_OTA_WINDOW_BITS */
+    uint8_t reserved[3];
+    uint32_t image_size;    /**< 解压 (及应用补丁) 后 app 镜像大小 */
+    uint32_t payload_size;  /**< 负载大小 */
+    uint8_t sha256[32];     /**< 最终镜像的 SHA-256 */
+    uint8_t sig_len;        /**< signature 有效长度 */
+    uint8_t reserved2[3];
+    uint8_t signature[OTA_SIGNATURE_MAX]; /**< ECDSA P-256 / SHA-256 签名 (DER) */
+} ota_image_header_t;
+
+#define OTA_IMAGE_SIGNED_LEN    offsetof(ota_image_header_t, sig_len)
+
+/**
+ * @brief 注册诊断命令和 MQTT OTA 主题
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t ota_update_init(void);
+
+/**
+ * @brief 从 HTTP URL 下载并升级 (后台任务中执行，成功后重启)
+ *
+ * @param url 镜像地址
+ * @return ESP_OK 已开始, ESP_ERR_INVALID_STATE 已有升级在进行
+ */
+esp_err_t ota_update_start_http(const char *url);
+
+/**
+ * @brief 启动结果确认，在启动流程结束后调用
+ *
+ * 当前镜像处于待验证状态时: 启动失败则立即回滚并重启，
+ * 启动成功则在 CONFIG_OTA_CONFIRM_DELAY_S 后且 WiFi 已连接时标记为有效
+ *
+ * @param healthy 启动流程是否成功
+ */
+void ota_update_confirm_boot(bool healthy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_UPDATE_H */
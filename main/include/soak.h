@@ -0,0 +1,111 @@
+/**
+ * @file soak.h
+ * @brief 长时间浸泡测试 - 随机执行开门/BLE/MQTT/配网循环，按轮次检测泄漏和延迟漂移
+ *
+ * 每次迭代按权重随机选择一个动作执行 (种子固定，同一固件的动作序列可复现):
+ *   key        单击开门 (按键事件送入 PWM 队列)，等待自动关门
+ *   ble        BLE 开门命令，等待自动关门
+ *   mqtt       MQTT ON，开门后立即 OFF
+ *   diag       执行一次 SUP 诊断命令
+ *   reconnect  停止并重新启动 MQTT 客户端 (仅在已连接时)
+ * 以及应用通过 soak_register_action 登记的动作 (配网循环、BLE 通知等)。
+ * 开门动作的延迟为命令发出到舵机到位，10 秒未到位计为丢失的命令。
+ *
+ * 每 CONFIG_SOAK_EPOCH_ITERATIONS 次迭代为一轮，统计堆占用下限、最低空闲、碎片率、
+ * 任务数和延迟 p50/p99/max。预热轮之后的第一轮作为基线，之后任一轮出现以下情况即失败:
+ *   - 堆占用下限比基线增长超过 CONFIG_SOAK_MAX_HEAP_GROWTH
+ *   - 任务数多于基线 (删除的任务未回收)
+ *   - 延迟 p99 比基线慢 CONFIG_SOAK_MAX_LATENCY_DRIFT_PCT 以上
+ *   - 碎片率比基线高 CONFIG_SOAK_MAX_FRAG_DRIFT_PM 以上
+ *   - 有丢失的命令或失败的动作
+ *
+ * 控制: 诊断命令 SOAK，主机仿真环境变量 SIM_SOAK。每轮结果上报 MQTT telemetry/soak。
+ * 测试期间门会反复开关，只用于测试台架。
+ */
+
+#ifndef SOAK_H
+#define SOAK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 动作函数，在浸泡任务中同步执行
+ *
+ * @return ESP_OK成功, ESP_ERR_NOT_SUPPORTED当前条件下跳过 (不计入迭代), 其他为失败
+ */
+typedef esp_err_t (*soak_action_fn_t)(void);
+
+/**
+ * @brief 测试结束回调 (在浸泡任务中调用)
+ *
+ * @param passed 全部迭代完成且没有漂移
+ */
+typedef void (*soak_done_cb_t)(bool passed);
+
+/**
+ * @brief 单轮统计
+ */
+typedef struct {
+    uint32_t epoch;             /**< 轮次，从 0 开始 */
+    uint32_t iterations;        /**< 本轮执行的动作数 */
+    uint32_t failures;          /**< 失败的动作数 (含丢失的命令) */
+    uint32_t samples;           /**< 延迟样本数 */
+    uint16_t p50_ms;
+    uint16_t p99_ms;
+    uint16_t max_ms;
+    uint32_t heap_used;         /**< 本轮各迭代后堆占用的最小值 */
+    uint32_t free_min;          /**< 本轮最低空闲量 */
+    uint16_t frag_pm;           /**< 本轮碎片率最大值 (‰) */
+    uint16_t tasks;             /**< 轮末任务数 */
+} soak_epoch_t;
+
+/**
+ * @brief 注册 SOAK 诊断命令和内置动作
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t soak_init(void);
+
+/**
+ * @brief 登记动作 (在 soak_start 之前调用)
+ *
+ * @param name 动作名 (静态字符串)
+ * @param fn 动作函数
+ * @param weight 选中权重，0 表示不执行
+ * @return ESP_OK成功, ESP_ERR_NO_MEM动作表已满, ESP_ERR_INVALID_STATE测试进行中
+ */
+esp_err_t soak_register_action(const char *name, soak_action_fn_t fn, uint8_t weight);
+
+/**
+ * @brief 启动浸泡测试
+ *
+ * @param iterations 迭代次数，0 表示一直运行直到 soak_stop 或失败
+ * @param done 结束回调，可为 NULL
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE已在运行, ESP_ERR_NO_MEM任务创建失败,
+ *         ESP_ERR_NOT_SUPPORTED未开启 CONFIG_SOAK_ENABLE
+ */
+esp_err_t soak_start(uint32_t iterations, soak_done_cb_t done);
+
+/**
+ * @brief 请求停止，当前动作完成后结束 (结果为通过)
+ */
+void soak_stop(void);
+
+/**
+ * @brief 读取最近一轮统计
+ *
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE尚无完整的一轮
+ */
+esp_err_t soak_get_last_epoch(soak_epoch_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOAK_H */
@@ -0,0 +1,96 @@
+/**
+ * @file state_shadow.h
+ * @brief 设备状态影子 - 门/网络状态、遥测与事件的统一出口
+ *
+ * 各模块在状态变化时更新影子，影子递增全局序号、编码一次 JSON，再按顺序交给
+ * 所有监听者 (例如 WebSocket 推送)，监听者不再重复编码。
+ *
+ * 消息格式:
+ *   {"type":"state","seq":N,"door":"open","wifi":true,"mqtt":false,"uptime":S}
+ *   {"type":"telemetry","seq":N,"name":"cpu","data":{...}}   内容与上次相同时不发送
+ *   {"type":"event","seq":N,"event":"OPEN","source":"HTTP","arg":0}
+ */
+
+#ifndef STATE_SHADOW_H
+#define STATE_SHADOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "journal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATE_SHADOW_LISTENER_MAX   3
+
+typedef enum {
+    STATE_SHADOW_STATE = 0,
+    STATE_SHADOW_TELEMETRY,
+    STATE_SHADOW_EVENT,
+} state_shadow_kind_t;
+
+/**
+ * @brief 监听回调，在更新方的任务中调用且持有影子锁，不能阻塞
+ *
+ * @param kind 消息类型
+ * @param json 编码后的消息 (回调返回后失效)
+ * @param len 消息长度
+ */
+typedef void (*state_shadow_listener_t)(state_shadow_kind_t kind, const char *json, size_t len);
+
+/**
+ * @brief 初始化 (在其他模块更新影子之前调用)
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t state_shadow_init(void);
+
+/**
+ * @brief 注册监听者
+ *
+ * @return ESP_OK成功, ESP_ERR_NO_MEM 监听者已满
+ */
+esp_err_t state_shadow_add_listener(state_shadow_listener_t fn);
+
+/**
+ * @brief 门状态变化
+ */
+void state_shadow_set_door(bool open);
+
+/**
+ * @brief WiFi 连接状态变化
+ */
+void state_shadow_set_wifi(bool connected);
+
+/**
+ * @brief MQTT 连接状态变化
+ */
+void state_shadow_set_mqtt(bool connected);
+
+/**
+ * @brief 遥测数据 (JSON 对象)，与该名称上一次内容相同时忽略
+ */
+void state_shadow_telemetry(const char *name, const char *json);
+
+/**
+ * @brief 门禁事件 (与事件日志同源)
+ */
+void state_shadow_event(journal_evt_t evt, journal_src_t src, uint32_t arg);
+
+/**
+ * @brief 编码当前完整状态 (新监听客户端的初始快照)
+ *
+ * @param buf 输出缓冲区
+ * @param len 缓冲区大小
+ * @return 消息长度，缓冲区不足时为 0
+ */
+size_t state_shadow_snapshot(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATE_SHADOW_H */
@@ -0,0 +1,96 @@
+/**
+ * @file supervisor.h
+ * @brief 任务监督 - 每个应用任务登记心跳周期和单次循环延迟上限 (SLO)
+ *
+ * 两类任务:
+ *   - 事件驱动任务 (队列/通知上无限期阻塞): 在处理一条消息前后调用
+ *     supervisor_loop_begin/end，处理超过 max_latency_ms 记为 LATENCY 违规。
+ *   - 周期任务: 每轮调用 supervisor_heartbeat，超过 heartbeat_ms 未上报记为 HEARTBEAT 违规。
+ *
+ * 监督任务由时间轮周期唤醒检查，违规时记录任务状态和飞行记录器快照，由独立的上报任务
+ * 写入事件日志并通过 MQTT telemetry/supervisor 上报 (监督任务自身不等待任何锁)，
+ * 再按 CONFIG_SUPERVISOR_RECOVERY_* 执行恢复: 仅上报 (默认)、重建子系统
+ * (无重启函数或重启次数用尽时重启设备)、或直接重启设备。
+ *
+ * 重建是协作式的: 处理中的任务可能持有其他模块的互斥锁，监督任务只置位重启请求，
+ * 任务下一次调用 supervisor_loop_end / supervisor_heartbeat (循环顶部的安全点) 时挂起自己，
+ * 监督任务再删除并调用重启函数重建。已阻塞在自己队列上的任务可立即重建；
+ * 请求后一直未回到安全点 (死锁) 则升级为重启设备。
+ * 监督任务自身订阅 Task WDT，监督任务或 idle 任务饿死时由 TWDT 兜底。
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "app_rtos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 低优先级周期任务的心跳上限: 3 个周期加余量 (BLE 批量传输、OTA 期间可能被推迟)
+ */
+#if CONFIG_SUPERVISOR_ENABLE
+#define SUPERVISOR_BACKGROUND_HEARTBEAT_MS(period_ms) \
+    (3 * (period_ms) + CONFIG_SUPERVISOR_HEARTBEAT_SLACK_MS)
+#else
+#define SUPERVISOR_BACKGROUND_HEARTBEAT_MS(period_ms) 0
+#endif
+
+/**
+ * @brief 违规类型 (trace/journal 中按数值记录，只能追加)
+ */
+typedef enum {
+    SUPERVISOR_KIND_LATENCY = 0,    /**< 单次循环处理超时 */
+    SUPERVISOR_KIND_HEARTBEAT,      /**< 心跳超时 */
+} supervisor_kind_t;
+
+/**
+ * @brief 子系统重启函数，在监督任务中调用
+ *
+ * 调用时任务停在安全点 (挂起在循环顶部或阻塞在自己的队列上)，不持有互斥锁和 PM 锁。
+ * 负责删除任务、撤销它登记的中断/定时器并重新创建；新任务启动后需重新调用 supervisor_register。
+ */
+typedef void (*supervisor_restart_fn_t)(void);
+
+/**
+ * @brief 启动监督任务，注册诊断命令 "SUP"
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t supervisor_start(void);
+
+/**
+ * @brief 登记任务的 SLO (任务启动时由任务自身调用，重复调用会重置状态)
+ *
+ * @param id 任务 ID
+ * @param heartbeat_ms 心跳上限，0 表示不检查心跳
+ * @param max_latency_ms 单次循环延迟上限，0 表示不检查延迟
+ * @param restart 子系统重启函数，NULL 时恢复动作升级为重启设备
+ */
+void supervisor_register(app_task_id_t id, uint32_t heartbeat_ms, uint32_t max_latency_ms,
+                         supervisor_restart_fn_t restart);
+
+/**
+ * @brief 开始处理一次事件 (同时计为一次心跳)
+ */
+void supervisor_loop_begin(app_task_id_t id);
+
+/**
+ * @brief 事件处理完成，回到等待状态 (安全点: 有重启请求时在此挂起)
+ */
+void supervisor_loop_end(app_task_id_t id);
+
+/**
+ * @brief 周期任务上报心跳 (在循环顶部调用，同为安全点)
+ */
+void supervisor_heartbeat(app_task_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUPERVISOR_H */
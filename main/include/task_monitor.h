@@ -0,0 +1,67 @@
+/**
+ * @file task_monitor.h
+ * @brief 任务栈水位监控 - 周期采样 APP_TASK_TABLE 中各任务的栈高水位，
+ *        记录历史最小剩余量并给出建议栈大小
+ */
+
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "app_rtos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 单个任务的栈使用统计
+ */
+typedef struct {
+    uint32_t stack_size;    /**< 配置的栈大小 (字节) */
+    uint32_t min_free;      /**< 历史最小剩余栈 (字节)，UINT32_MAX 表示尚未采样到 */
+    uint32_t recommended;   /**< 建议栈大小 = 峰值使用 + 余量，按 256 字节对齐 */
+} task_stack_stat_t;
+
+/**
+ * @brief 启动监控任务
+ *
+ * @return ESP_OK成功, 其他失败
+ */
+esp_err_t task_monitor_start(void);
+
+/**
+ * @brief 立即采样一次所有任务
+ */
+void task_monitor_sample(void);
+
+/**
+ * @brief 获取任务的栈统计
+ *
+ * @param id 任务 ID
+ * @param out 输出统计
+ * @return ESP_OK成功, ESP_ERR_NOT_FOUND尚未采样到该任务
+ */
+esp_err_t task_monitor_get_stat(app_task_id_t id, task_stack_stat_t *out);
+
+/**
+ * @brief 打印建议栈大小表
+ */
+void task_monitor_dump(void);
+
+/**
+ * @brief 将栈统计序列化为 JSON
+ *
+ * 格式: {"<task>":[stack,min_free,recommended],...}
+ *
+ * @return 写入长度，缓冲区不足返回 -1
+ */
+int task_monitor_to_json(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TASK_MONITOR_H */
@@ -0,0 +1,111 @@
+/**
+ * @file timer_wheel.h
+ * @brief 分层时间轮定时服务
+ *
+ * 所有应用超时 (自动关门、双击计数复位、配网指示灯闪烁、按键手势窗口、broker 监视)
+ * 挂在同一个时间轮上，由一个 esp_timer 按最近的截止时间唤醒，空闲时不产生周期唤醒。
+ *
+ * 3 级 × 64 槽，每级槽宽为下一级整圈 (tick, 64 tick, 4096 tick)；
+ * tick = CONFIG_TIMER_WHEEL_TICK_MS，10 ms 时单级覆盖约 43 分钟，更长的超时在顶级循环降级。
+ * 定时器节点由调用方静态持有，侵入式双向链表挂入槽位，arm/cancel 均为 O(1)。
+ *
+ * 到期不在 esp_timer 任务中执行回调，而是派发给所属任务:
+ *   - 消息型: 向 queue_id_t 队列投递 MSG_TYPE_TIMER 消息，由消费者任务处理。
+ *     队列满时单次定时器延后一个重试间隔再投递，周期定时器跳过本周期。
+ *   - 通知型: 对任务执行 xTaskNotify(bits, eSetBits)，适合不带队列的任务。
+ *
+ * 定时器重新 arm 或 cancel 后，已在队列中的旧消息通过 timer_wheel_msg_is_current() 识别丢弃。
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "msg_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    WHEEL_TARGET_QUEUE = 0,
+    WHEEL_TARGET_NOTIFY,
+} wheel_target_t;
+
+/**
+ * @brief 定时器节点 (字段仅供 timer_wheel.c 使用，调用方只需静态分配)
+ */
+typedef struct wheel_timer {
+    struct wheel_timer *next;
+    struct wheel_timer *prev;
+    const char *name;
+    uint32_t expires;       /* 到期 tick */
+    uint32_t period;        /* 周期 tick，0 为单次 */
+    uint32_t gen;           /* arm/cancel 时递增，用于识别过期消息 */
+    int16_t slot;           /* level * 64 + 槽号，-1 为未挂起 */
+    wheel_target_t target;
+    queue_id_t queue;
+    TaskHandle_t task;
+    uint32_t bits;
+} wheel_timer_t;
+
+/**
+ * @brief 初始化时间轮 (需在任何任务 arm 定时器之前调用)
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t timer_wheel_init(void);
+
+/**
+ * @brief 设置为消息型定时器，到期向 queue 投递 MSG_TYPE_TIMER
+ *
+ * @param t 定时器 (未挂起)
+ * @param name 名称，用于诊断输出
+ * @param queue 目标队列
+ */
+void timer_wheel_setup_msg(wheel_timer_t *t, const char *name, queue_id_t queue);
+
+/**
+ * @brief 设置为通知型定时器，到期对 task 置位 bits
+ *
+ * @param t 定时器 (未挂起)
+ * @param name 名称，用于诊断输出
+ * @param task 目标任务
+ * @param bits 通知位
+ */
+void timer_wheel_setup_notify(wheel_timer_t *t, const char *name, TaskHandle_t task, uint32_t bits);
+
+/**
+ * @brief 启动定时器，已挂起时按新的超时重新启动
+ *
+ * @param t 定时器
+ * @param delay_ms 首次到期时间
+ * @param period_ms 周期，0 为单次
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE 时间轮未初始化
+ */
+esp_err_t timer_wheel_arm(wheel_timer_t *t, uint32_t delay_ms, uint32_t period_ms);
+
+/**
+ * @brief 停止定时器，未挂起时无操作
+ */
+void timer_wheel_cancel(wheel_timer_t *t);
+
+/**
+ * @brief 定时器是否挂起 (等待到期)
+ */
+bool timer_wheel_is_pending(const wheel_timer_t *t);
+
+/**
+ * @brief 收到的 MSG_TYPE_TIMER 消息是否仍有效 (之后未被重新 arm 或 cancel)
+ */
+bool timer_wheel_msg_is_current(const timer_msg_data_t *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,138 @@
+/**
+ * @file trace.h
+ * @brief 飞行记录器 - 跨模块事件的紧凑二进制跟踪
+ *
+ * 每条记录固定 16 字节，写入每个核心独立的环形缓冲区，索引通过原子加法分配，
+ * 不加锁、可在中断中调用。缓冲区位于 noinit RAM，软件复位和 panic 复位后保留，
+ * 启动时追加 TRACE_EVT_BOOT 作为分界，上电复位时清空。
+ *
+ * 转储: L2CAP 数据流 BT_L2CAP_STREAM_TRACE，或诊断命令 "TRACE PUB" 发布到
+ * MQTT telemetry/trace；主机端用 tools/trace_decode.py 渲染时间线。
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_MAGIC     0x31435254  /* "TRC1" */
+
+/**
+ * @brief 事件来源
+ */
+typedef enum {
+    TRACE_SRC_SYS = 0,
+    TRACE_SRC_KEY,
+    TRACE_SRC_BLE,
+    TRACE_SRC_MQTT,
+    TRACE_SRC_QUEUE,
+    TRACE_SRC_SERVO,
+    TRACE_SRC_WIFI,
+    TRACE_SRC_MAX
+} trace_src_t;
+
+/**
+ * @brief 事件 (参数含义见注释，a16/a0/a1)
+ *
+ * 新增事件只能追加，主机端解码表 tools/trace_decode.py 需同步更新。
+ */
+typedef enum {
+    TRACE_EVT_BOOT = 0,         /**< SYS: a0=复位原因, a1=启动次数 */
+    TRACE_EVT_KEY,              /**< KEY: a16=GPIO, a0=key_event_t */
+    TRACE_EVT_BLE_CONNECT,      /**< BLE: a16=连接句柄 */
+    TRACE_EVT_BLE_DISCONNECT,   /**< BLE: a16=连接句柄, a0=原因 */
+    TRACE_EVT_BLE_OPEN,         /**< BLE: a0=1 已投递, 0 投递失败 */
+    TRACE_EVT_MQTT_CONNECT,     /**< MQTT */
+    TRACE_EVT_MQTT_DISCONNECT,  /**< MQTT */
+    TRACE_EVT_MQTT_DOOR_CMD,    /**< MQTT: a0=1 ON, 0 OFF */
+    TRACE_EVT_QUEUE_SEND,       /**< QUEUE: a16=msg_type_t, a0=负载前 4 字节 */
+    TRACE_EVT_QUEUE_FULL,       /**< QUEUE: a16=msg_type_t, a0=负载前 4 字节 */
+    TRACE_EVT_QUEUE_RECV,       /**< QUEUE: a16=msg_type_t, a0=负载前 4 字节 */
+    TRACE_EVT_SERVO_MOVE,       /**< SERVO: a0=起始角度, a1=目标角度 */
+    TRACE_EVT_SERVO_DONE,       /**< SERVO: a0=到达角度, a1=错误码 */
+    TRACE_EVT_DOOR_OPEN,        /**< SERVO */
+    TRACE_EVT_DOOR_CLOSE,       /**< SERVO: a0=1 自动关门 */
+    TRACE_EVT_WIFI_GOT_IP,      /**< WIFI */
+    TRACE_EVT_WIFI_DISCONNECT,  /**< WIFI: a0=原因 */
+    TRACE_EVT_SLO_VIOLATION,    /**< SYS: a16=app_task_id_t, a0=supervisor_kind_t, a1=耗时(ms) */
+    TRACE_EVT_HEAP_ALLOC_FAIL,  /**< SYS: a0=请求大小, a1=caps */
+    TRACE_EVT_FAULT_INJECT,     /**< SYS: a16=fault_id_t, a0=累计注入次数 */
+    TRACE_EVT_FAULT_RECOVER,    /**< SYS: a16=fault_id_t, a1=恢复时间(ms) */
+    TRACE_EVT_MAX
+} trace_evt_t;
+
+/**
+ * @brief 跟踪记录 (16 字节，小端，与转储格式一致)
+ */
+typedef struct {
+    uint32_t ts_us;     /**< esp_timer 时间戳低 32 位 */
+    uint8_t src;        /**< trace_src_t */
+    uint8_t evt;        /**< trace_evt_t */
+    uint16_t a16;
+    uint32_t a0;
+    uint32_t a1;
+} trace_record_t;
+
+/**
+ * @brief 转储头，随后为每个核心的 {uint32_t head; trace_record_t ring[capacity];}
+ */
+typedef struct {
+    uint32_t magic;         /**< TRACE_MAGIC */
+    uint16_t record_size;   /**< sizeof(trace_record_t) */
+    uint8_t cores;
+    uint8_t reserved;
+    uint32_t boot_count;
+    uint32_t capacity;      /**< 每核心记录数 */
+} trace_dump_header_t;
+
+/**
+ * @brief 写入一条记录
+ */
+void trace_write(trace_src_t src, trace_evt_t evt, uint16_t a16, uint32_t a0, uint32_t a1);
+
+#if CONFIG_TRACE_ENABLE
+#define TRACE(src, evt, a16, a0, a1) \
+    trace_write((src), (evt), (uint16_t)(a16), (uint32_t)(a0), (uint32_t)(a1))
+#else
+#define TRACE(src, evt, a16, a0, a1) do { } while (0)
+#endif
+
+/**
+ * @brief 校验/恢复 noinit 缓冲区，记录启动事件，注册转储通道与诊断命令
+ *
+ * @return ESP_OK成功
+ */
+esp_err_t trace_init(void);
+
+/**
+ * @brief 读取转储数据
+ *
+ * @return 读取字节数，0 表示结束
+ */
+int trace_dump_read(uint32_t offset, uint8_t *buf, size_t len);
+
+/**
+ * @brief 转储总长度 (字节)
+ */
+size_t trace_dump_size(void);
+
+/**
+ * @brief 复制最近的记录，按时间先后排列 (写入并发进行，结果为尽力而为的快照)
+ *
+ * @param out 输出缓冲区
+ * @param max 最多复制条数
+ * @return 实际复制条数
+ */
+size_t trace_snapshot(trace_record_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
@@ -6,6 +6,7 @@
 #ifndef WIFI_MANAGER_H
 #define WIFI_MANAGER_H
 
+#include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
 
@@ -16,7 +17,8 @@ extern "C" {
 /**
  * @brief 初始化WiFi管理器
  * 
- * 初始化NVS、网络接口、事件循环，配置WiFi为STA模式
+ * 初始化网络接口、事件循环，配置WiFi为STA模式。
+ * 调用前需要完成 NVS 初始化。
  * 
  * @return ESP_OK成功，其他失败
  */
@@ -29,6 +31,14 @@ esp_err_t wifi_manager_init(void);
  */
 bool wifi_manager_is_connected(void);
 
+/**
+ * @brief 阻塞等待WiFi连接
+ * 
+ * @param timeout_ms 超时时间，portMAX_DELAY 为一直等待
+ * @return true已连接，false超时或未初始化
+ */
+bool wifi_manager_wait_connected(uint32_t timeout_ms);
+
 /**
  * @brief 清除WiFi凭据并重启SmartConfig
  * 
@@ -38,6 +48,17 @@ bool wifi_manager_is_connected(void);
  */
 esp_err_t wifi_manager_clear_credentials(void);
 
+/**
+ * @brief 执行一次配网流程但不丢失凭据 (soak 测试)
+ *
+ * 断开连接并在 RAM 中清空凭据，创建配网任务启动 SmartConfig，保持 hold_ms 后
+ * 中止并删除任务，恢复凭据重新连接。调用方用 wifi_manager_wait_connected 等待重连。
+ *
+ * @param hold_ms SmartConfig 运行时间
+ * @return ESP_OK成功, ESP_ERR_INVALID_STATE未初始化/无凭据/正在配网, ESP_ERR_NO_MEM任务创建失败
+ */
+esp_err_t wifi_manager_provision_cycle(uint32_t hold_ms);
+
 /**
  * @brief 启动WiFi消息处理任务
  * 
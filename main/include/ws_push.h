@@ -0,0 +1,46 @@
+/**
+ * @file ws_push.h
+ * @brief WebSocket 实时推送 - 把状态影子的更新推送给局域网仪表盘
+ *
+ * 端点: ws://<设备>/api/ws (鉴权同 HTTP API，浏览器可用 ?token=<token>)。
+ * 连接后先收到一条完整状态快照，之后为 state_shadow.h 描述的 state/telemetry/event
+ * 消息，按 seq 递增；客户端发送文本 "snapshot" 可随时重新获取快照。
+ *
+ * 扇出: 每条更新只编码并分配一次，各客户端队列保存同一缓冲区的引用，
+ * 由 httpd 任务逐个发送，最后一个引用释放时回收。
+ *
+ * 背压: 客户端队列满时丢弃新消息并标记重同步，队列排空后补发一条最新快照；
+ * 连续 WS_OVERFLOW_CLOSE 次溢出的客户端被断开。客户端数上限
+ * CONFIG_HTTP_API_WS_MAX_CLIENTS，超出时握手后立即关闭。
+ */
+
+#ifndef WS_PUSH_H
+#define WS_PUSH_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 在 HTTP 服务器上注册 /api/ws 并订阅状态影子
+ *
+ * @param server http_api 的服务器句柄
+ * @return ESP_OK成功
+ */
+esp_err_t ws_push_register(httpd_handle_t server);
+
+/**
+ * @brief 连接关闭通知 (HTTP 服务器 close_fn 中调用)
+ *
+ * @param sockfd 关闭的套接字
+ */
+void ws_push_session_closed(int sockfd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WS_PUSH_H */
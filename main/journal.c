@@ -0,0 +1,675 @@
+/**
+ * @file journal.c
+ * @brief 门禁事件日志实现
+ */
+
+#include "journal.h"
+#include "state_shadow.h"
+#include "diag_cmd.h"
+#include "bt_l2cap.h"
+#include "app_rtos.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "journal";
+
+static const char *const s_evt_names[JOURNAL_EVT_MAX] = {
+    "BOOT", "OPEN", "CLOSE", "CRED_CLEAR", "OTA", "STALL",
+};
+
+static const char *const s_src_names[JOURNAL_SRC_MAX] = {
+    "SYS", "KEY", "BLE", "MQTT", "TIMER", "HTTP", "COAP", "DIAG",
+};
+
+const char *journal_evt_name(journal_evt_t evt)
+{
+    return (evt < JOURNAL_EVT_MAX) ? s_evt_names[evt] : "?";
+}
+
+const char *journal_src_name(journal_src_t src)
+{
+    return (src < JOURNAL_SRC_MAX) ? s_src_names[src] : "?";
+}
+
+#if CONFIG_JOURNAL_ENABLE
+
+#define JOURNAL_SECTOR_SIZE     4096
+#define JOURNAL_MAX_SECTORS     64
+#define JOURNAL_BATCH           CONFIG_JOURNAL_BATCH_SIZE
+#define JOURNAL_PENDING_MAX     (JOURNAL_BATCH * 2)
+#define JOURNAL_CHUNK           8       /* 游标每次读取的记录数 */
+#define JOURNAL_LIST_MAX        32      /* LIST 命令最多输出条数 */
+#define JOURNAL_NONE            UINT32_MAX
+
+#define BLOCK_BYTES(n)  (sizeof(journal_block_header_t) + (n) * sizeof(journal_record_t))
+
+_Static_assert(sizeof(journal_record_t) == 16, "journal_record_t layout is part of the flash format");
+_Static_assert(BLOCK_BYTES(JOURNAL_BATCH) + sizeof(journal_sector_header_t) <= JOURNAL_SECTOR_SIZE,
+               "CONFIG_JOURNAL_BATCH_SIZE does not fit in a sector");
+
+/**
+ * @brief 每扇区索引 (挂载时建立，提交时更新)
+ */
+typedef struct {
+    uint32_t seq;           /* 扇区序号，0 表示未使用 */
+    uint32_t min_time;
+    uint32_t max_time;
+    uint16_t end;           /* 有效块结束偏移 */
+    uint16_t used;          /* 写入偏移，半写块后置为扇区大小 */
+    uint16_t count;         /* 记录数 */
+} sector_index_t;
+
+/**
+ * @brief 按时间范围遍历的游标，扇区顺序从旧到新
+ */
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    uint32_t base;          /* 复位时的写入扇区 */
+    uint32_t max_seq;       /* 复位后新轮转的扇区不再遍历 */
+    uint32_t step;
+    uint32_t sector;
+    uint32_t sector_seq;    /* 0 表示需要切换扇区 */
+    uint32_t off;           /* 下一个块头偏移 */
+    uint32_t addr;          /* 当前块下一条记录地址 */
+    uint32_t remaining;     /* 当前块未读记录数 */
+    uint32_t pos;
+    uint32_t len;
+    journal_record_t chunk[JOURNAL_CHUNK];
+} journal_cursor_t;
+
+static const esp_partition_t *s_part = NULL;
+static sector_index_t s_index[JOURNAL_MAX_SECTORS];
+static uint32_t s_sectors = 0;
+static uint32_t s_head = 0;
+static uint32_t s_sector_seq = 0;
+static uint32_t s_next_seq = 1;
+static uint16_t s_boot = 0;
+static volatile bool s_mounted = false;
+
+static SemaphoreHandle_t s_flash_lock = NULL;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t s_flash_lock_buf;
+#endif
+static TaskHandle_t s_task = NULL;
+static uint8_t s_block_buf[BLOCK_BYTES(JOURNAL_BATCH)];
+
+/* RAM 批缓冲区 */
+static journal_record_t s_pending[JOURNAL_PENDING_MAX];
+static uint32_t s_pending_count = 0;
+static uint32_t s_dropped = 0;
+static portMUX_TYPE s_pending_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* 统计 */
+static uint32_t s_blocks_written = 0;
+static uint32_t s_erases = 0;
+static uint32_t s_corrupt = 0;
+
+/* L2CAP 导出 */
+static journal_cursor_t s_export;
+static journal_export_header_t s_export_hdr;
+static journal_record_t s_export_rec;
+static uint32_t s_export_have = JOURNAL_NONE;
+static uint32_t s_export_from = 0;
+static uint32_t s_export_to = UINT32_MAX;
+
+static void index_add(sector_index_t *idx, const journal_record_t *recs, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        if (recs[i].time < idx->min_time) {
+            idx->min_time = recs[i].time;
+        }
+        if (recs[i].time > idx->max_time) {
+            idx->max_time = recs[i].time;
+        }
+    }
+    idx->count += n;
+}
+
+/**
+ * @brief 扫描一个扇区的块链，校验 CRC 并建立索引
+ */
+static void mount_sector(uint32_t sector)
+{
+    sector_index_t *idx = &s_index[sector];
+    uint32_t base = sector * JOURNAL_SECTOR_SIZE;
+    journal_sector_header_t sh;
+
+    memset(idx, 0, sizeof(*idx));
+    if (esp_partition_read(s_part, base, &sh, sizeof(sh)) != ESP_OK ||
+        sh.magic != JOURNAL_SECTOR_MAGIC || sh.seq == 0 || sh.seq == UINT32_MAX) {
+        return;
+    }
+
+    idx->seq = sh.seq;
+    idx->min_time = UINT32_MAX;
+    idx->end = sizeof(sh);
+
+    while (idx->end + sizeof(journal_block_header_t) <= JOURNAL_SECTOR_SIZE) {
+        journal_block_header_t *bh = (journal_block_header_t *)s_block_buf;
+        const journal_record_t *recs = (const journal_record_t *)(s_block_buf + sizeof(*bh));
+
+        if (esp_partition_read(s_part, base + idx->end, bh, sizeof(*bh)) != ESP_OK) {
+            break;
+        }
+        if (bh->magic == 0xFFFF && bh->count == 0xFF) {
+            /* 擦除态，后续可继续追加 */
+            idx->used = idx->end;
+            return;
+        }
+        if (bh->magic != JOURNAL_BLOCK_MAGIC || bh->count == 0 || bh->count > JOURNAL_BATCH ||
+            idx->end + BLOCK_BYTES(bh->count) > JOURNAL_SECTOR_SIZE ||
+            esp_partition_read(s_part, base + idx->end + sizeof(*bh), (void *)recs,
+                               bh->count * sizeof(journal_record_t)) != ESP_OK ||
+            esp_rom_crc32_le(0, (const uint8_t *)recs, bh->count * sizeof(journal_record_t)) != bh->crc) {
+            /* 掉电半写的块: 之后不再向该扇区追加 */
+            ESP_LOGW(TAG, "Torn block in sector %lu at 0x%x",
+                     (unsigned long)sector, (unsigned)idx->end);
+            s_corrupt++;
+            break;
+        }
+
+        index_add(idx, recs, bh->count);
+        const journal_record_t *last = &recs[bh->count - 1];
+        if (last->seq >= s_next_seq) {
+            s_next_seq = last->seq + 1;
+            s_boot = last->boot;
+        }
+        idx->end += BLOCK_BYTES(bh->count);
+    }
+    idx->used = JOURNAL_SECTOR_SIZE;
+}
+
+static void journal_mount(void)
+{
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        journal_sector_header_t sh;
+        if (esp_partition_read(s_part, i * JOURNAL_SECTOR_SIZE, &sh, sizeof(sh)) == ESP_OK &&
+            sh.magic == JOURNAL_SECTOR_MAGIC && sh.seq != UINT32_MAX && sh.seq > s_sector_seq) {
+            s_sector_seq = sh.seq;
+            s_head = i;
+        }
+    }
+    /* 记录序号和启动次数取全分区最大者之后 */
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        mount_sector(i);
+    }
+    s_boot++;
+
+    uint32_t records = 0;
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        records += s_index[i].count;
+    }
+    ESP_LOGI(TAG, "Mounted %lu sectors: %lu records, head %lu, next seq %lu, boot %u",
+             (unsigned long)s_sectors, (unsigned long)records, (unsigned long)s_head,
+             (unsigned long)s_next_seq, s_boot);
+}
+
+/**
+ * @brief 擦除下一个扇区 (丢弃最旧数据) 并写入扇区头
+ */
+static esp_err_t rotate(void)
+{
+    uint32_t next = (s_index[s_head].seq == 0) ? s_head : (s_head + 1) % s_sectors;
+    uint32_t base = next * JOURNAL_SECTOR_SIZE;
+    journal_sector_header_t sh = {
+        .magic = JOURNAL_SECTOR_MAGIC,
+        .seq = s_sector_seq + 1,
+    };
+
+    memset(&s_index[next], 0, sizeof(s_index[next]));
+    esp_err_t ret = esp_partition_erase_range(s_part, base, JOURNAL_SECTOR_SIZE);
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(s_part, base, &sh, sizeof(sh));
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Rotate to sector %lu failed: %s", (unsigned long)next, esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_sector_seq = sh.seq;
+    s_head = next;
+    s_index[next].seq = sh.seq;
+    s_index[next].min_time = UINT32_MAX;
+    s_index[next].end = sizeof(sh);
+    s_index[next].used = sizeof(sh);
+    s_erases++;
+    return ESP_OK;
+}
+
+/**
+ * @brief 将一批记录作为一个块写入，块头与记录一次写入
+ */
+static esp_err_t write_block(const journal_record_t *recs, uint32_t n)
+{
+    size_t bytes = BLOCK_BYTES(n);
+
+    if (s_index[s_head].seq == 0 || s_index[s_head].used + bytes > JOURNAL_SECTOR_SIZE) {
+        esp_err_t ret = rotate();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    sector_index_t *idx = &s_index[s_head];
+    journal_block_header_t *bh = (journal_block_header_t *)s_block_buf;
+
+    bh->magic = JOURNAL_BLOCK_MAGIC;
+    bh->count = (uint8_t)n;
+    bh->reserved = 0xFF;
+    bh->crc = esp_rom_crc32_le(0, (const uint8_t *)recs, n * sizeof(journal_record_t));
+    memcpy(s_block_buf + sizeof(*bh), recs, n * sizeof(journal_record_t));
+
+    esp_err_t ret = esp_partition_write(s_part, s_head * JOURNAL_SECTOR_SIZE + idx->used,
+                                        s_block_buf, bytes);
+    if (ret != ESP_OK) {
+        /* 写入位置状态未知，换到新扇区 */
+        idx->used = JOURNAL_SECTOR_SIZE;
+        return ret;
+    }
+
+    idx->used += bytes;
+    idx->end = idx->used;
+    index_add(idx, recs, n);
+    s_blocks_written++;
+    return ESP_OK;
+}
+
+/**
+ * @brief 提交所有待写记录 (调用方持有 s_flash_lock)
+ */
+static esp_err_t commit_pending(void)
+{
+    journal_record_t batch[JOURNAL_BATCH];
+
+    while (1) {
+        uint32_t n;
+
+        portENTER_CRITICAL(&s_pending_lock);
+        n = s_pending_count < JOURNAL_BATCH ? s_pending_count : JOURNAL_BATCH;
+        memcpy(batch, s_pending, n * sizeof(journal_record_t));
+        portEXIT_CRITICAL(&s_pending_lock);
+
+        if (n == 0) {
+            return ESP_OK;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            batch[i].seq = s_next_seq + i;
+            batch[i].boot = s_boot;
+        }
+
+        esp_err_t ret = write_block(batch, n);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        s_next_seq += n;
+
+        /* 写入期间新追加的记录在尾部，只移除已提交的部分 */
+        portENTER_CRITICAL(&s_pending_lock);
+        s_pending_count -= n;
+        memmove(s_pending, s_pending + n, s_pending_count * sizeof(journal_record_t));
+        portEXIT_CRITICAL(&s_pending_lock);
+    }
+}
+
+void journal_log(journal_evt_t evt, journal_src_t src, uint32_t arg)
+{
+    journal_record_t rec = {
+        .time = (uint32_t)time(NULL),
+        .evt = (uint8_t)evt,
+        .src = (uint8_t)src,
+        .arg = arg,
+    };
+    bool full = false;
+
+    portENTER_CRITICAL(&s_pending_lock);
+    if (s_pending_count < JOURNAL_PENDING_MAX) {
+        s_pending[s_pending_count++] = rec;
+        full = (s_pending_count >= JOURNAL_BATCH);
+    } else {
+        s_dropped++;
+    }
+    portEXIT_CRITICAL(&s_pending_lock);
+
+    if (full && s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+    state_shadow_event(evt, src, arg);
+}
+
+esp_err_t journal_flush(void)
+{
+    if (!s_mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_flash_lock, portMAX_DELAY);
+    esp_err_t ret = commit_pending();
+    xSemaphoreGive(s_flash_lock);
+    return ret;
+}
+
+static void cursor_reset(journal_cursor_t *c, uint32_t from, uint32_t to)
+{
+    memset(c, 0, sizeof(*c));
+    c->from = from;
+    c->to = to;
+    c->base = s_head;
+    c->max_seq = s_sector_seq;
+}
+
+/**
+ * @brief 取下一条范围内的记录 (调用方持有 s_flash_lock)
+ */
+static bool cursor_next(journal_cursor_t *c, journal_record_t *out)
+{
+    while (1) {
+        if (c->pos < c->len) {
+            const journal_record_t *rec = &c->chunk[c->pos++];
+            if (rec->time >= c->from && rec->time <= c->to) {
+                *out = *rec;
+                return true;
+            }
+            continue;
+        }
+
+        const sector_index_t *idx = &s_index[c->sector];
+        /* 扇区在两次调用之间被轮转擦除时放弃剩余部分 */
+        if (c->sector_seq != 0 && idx->seq == c->sector_seq) {
+            uint32_t base = c->sector * JOURNAL_SECTOR_SIZE;
+
+            if (c->remaining > 0) {
+                uint32_t n = c->remaining < JOURNAL_CHUNK ? c->remaining : JOURNAL_CHUNK;
+                if (esp_partition_read(s_part, base + c->addr, c->chunk,
+                                       n * sizeof(journal_record_t)) != ESP_OK) {
+                    return false;
+                }
+                c->addr += n * sizeof(journal_record_t);
+                c->remaining -= n;
+                c->pos = 0;
+                c->len = n;
+                continue;
+            }
+
+            if (c->off < idx->end) {
+                journal_block_header_t bh;
+                if (esp_partition_read(s_part, base + c->off, &bh, sizeof(bh)) != ESP_OK) {
+                    return false;
+                }
+                c->addr = c->off + sizeof(bh);
+                c->remaining = bh.count;
+                c->off += BLOCK_BYTES(bh.count);
+                continue;
+            }
+        }
+
+        /* 下一个扇区: 按时间索引跳过不相交的扇区 */
+        c->sector_seq = 0;
+        c->remaining = 0;
+        if (c->step >= s_sectors) {
+            return false;
+        }
+        c->sector = (c->base + 1 + c->step) % s_sectors;
+        c->step++;
+
+        idx = &s_index[c->sector];
+        if (idx->seq == 0 || idx->seq > c->max_seq || idx->count == 0 ||
+            idx->max_time < c->from || idx->min_time > c->to) {
+            continue;
+        }
+        c->sector_seq = idx->seq;
+        c->off = sizeof(journal_sector_header_t);
+    }
+}
+
+esp_err_t journal_read_range(uint32_t from, uint32_t to, journal_visit_t fn, void *ctx)
+{
+    if (!s_mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    journal_cursor_t c;
+    journal_record_t rec;
+
+    xSemaphoreTake(s_flash_lock, portMAX_DELAY);
+    cursor_reset(&c, from, to);
+    while (cursor_next(&c, &rec) && fn(&rec, ctx)) {
+    }
+    xSemaphoreGive(s_flash_lock);
+    return ESP_OK;
+}
+
+int journal_export_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (!s_mounted) {
+        return -1;
+    }
+
+    if (offset == 0) {
+        journal_flush();
+        s_export_hdr.magic = JOURNAL_EXPORT_MAGIC;
+        s_export_hdr.record_size = sizeof(journal_record_t);
+        s_export_hdr.from = s_export_from;
+        s_export_hdr.to = s_export_to;
+        s_export_have = JOURNAL_NONE;
+    }
+
+    size_t done = 0;
+    xSemaphoreTake(s_flash_lock, portMAX_DELAY);
+    while (done < len) {
+        size_t pos = offset + done;
+        const uint8_t *src;
+        size_t avail;
+
+        if (pos < sizeof(s_export_hdr)) {
+            src = (const uint8_t *)&s_export_hdr + pos;
+            avail = sizeof(s_export_hdr) - pos;
+        } else {
+            uint32_t ridx = (pos - sizeof(s_export_hdr)) / sizeof(journal_record_t);
+            size_t roff = (pos - sizeof(s_export_hdr)) % sizeof(journal_record_t);
+
+            /* 顺序读取直接前进游标，回退时重新遍历 */
+            if (s_export_have == JOURNAL_NONE || ridx < s_export_have) {
+                cursor_reset(&s_export, s_export_from, s_export_to);
+                s_export_have = JOURNAL_NONE;
+            }
+            bool end = false;
+            while (s_export_have == JOURNAL_NONE || s_export_have < ridx) {
+                if (!cursor_next(&s_export, &s_export_rec)) {
+                    end = true;
+                    break;
+                }
+                s_export_have = (s_export_have == JOURNAL_NONE) ? 0 : s_export_have + 1;
+            }
+            if (end) {
+                break;
+            }
+            src = (const uint8_t *)&s_export_rec + roff;
+            avail = sizeof(journal_record_t) - roff;
+        }
+
+        size_t n = avail < len - done ? avail : len - done;
+        memcpy(buf + done, src, n);
+        done += n;
+    }
+    xSemaphoreGive(s_flash_lock);
+    return (int)done;
+}
+
+typedef struct {
+    const diag_out_t *out;
+    uint32_t count;
+} list_ctx_t;
+
+static bool list_visit(const journal_record_t *rec, void *ctx)
+{
+    list_ctx_t *lc = (list_ctx_t *)ctx;
+
+    diag_printf(lc->out, "#%lu b%u t=%lu%s %s %s arg=%lu\r\n",
+                (unsigned long)rec->seq, rec->boot, (unsigned long)rec->time,
+                rec->time < JOURNAL_TIME_VALID_MIN ? "(up)" : "",
+                journal_evt_name(rec->evt), journal_src_name(rec->src),
+                (unsigned long)rec->arg);
+    return ++lc->count < JOURNAL_LIST_MAX;
+}
+
+static void parse_range(int argc, char **argv, uint32_t *from, uint32_t *to)
+{
+    *from = (argc >= 3) ? strtoul(argv[2], NULL, 0) : 0;
+    *to = (argc >= 4) ? strtoul(argv[3], NULL, 0) : UINT32_MAX;
+}
+
+/**
+ * @brief JOURNAL 命令: 状态 / LIST [from [to]] / EXPORT [from [to]] / FLUSH
+ */
+static esp_err_t cmd_journal(int argc, char **argv, const diag_out_t *out)
+{
+    if (!s_mounted) {
+        diag_printf(out, "journal not mounted\r\n");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (argc >= 2 && strcasecmp(argv[1], "FLUSH") == 0) {
+        if (!diag_cmd_check_local(out)) {
+            return ESP_ERR_NOT_ALLOWED;
+        }
+        esp_err_t ret = journal_flush();
+        diag_printf(out, "flush: %s\r\n", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (argc >= 2 && strcasecmp(argv[1], "LIST") == 0) {
+        list_ctx_t lc = { .out = out, .count = 0 };
+        uint32_t from, to;
+
+        parse_range(argc, argv, &from, &to);
+        journal_flush();
+        esp_err_t ret = journal_read_range(from, to, list_visit, &lc);
+        diag_printf(out, "%lu records listed (max %d)\r\n", (unsigned long)lc.count, JOURNAL_LIST_MAX);
+        return ret;
+    }
+
+    if (argc >= 2 && strcasecmp(argv[1], "EXPORT") == 0) {
+        parse_range(argc, argv, &s_export_from, &s_export_to);
+        diag_printf(out, "L2CAP stream %d exports %lu..%lu\r\n", BT_L2CAP_STREAM_JOURNAL,
+                    (unsigned long)s_export_from, (unsigned long)s_export_to);
+        return ESP_OK;
+    }
+
+    uint32_t records = 0;
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        records += s_index[i].count;
+        used += (s_index[i].seq != 0);
+    }
+    diag_printf(out, "sectors %lu/%lu head %lu seq %lu boot %u\r\n",
+                (unsigned long)used, (unsigned long)s_sectors, (unsigned long)s_head,
+                (unsigned long)s_next_seq, s_boot);
+    diag_printf(out, "records %lu pending %lu dropped %lu\r\n", (unsigned long)records,
+                (unsigned long)s_pending_count, (unsigned long)s_dropped);
+    diag_printf(out, "blocks %lu erases %lu torn %lu\r\n", (unsigned long)s_blocks_written,
+                (unsigned long)s_erases, (unsigned long)s_corrupt);
+    return ESP_OK;
+}
+
+/**
+ * @brief 后台任务: 挂载分区，按批或超时提交
+ */
+static void journal_task(void *pvParameters)
+{
+    xSemaphoreTake(s_flash_lock, portMAX_DELAY);
+    journal_mount();
+    s_mounted = true;
+    xSemaphoreGive(s_flash_lock);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_JOURNAL_FLUSH_DELAY_S * 1000));
+
+        esp_err_t ret = journal_flush();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Commit failed: %s", esp_err_to_name(ret));
+        }
+    }
+}
+
+esp_err_t journal_init(void)
+{
+    /* 启动记录先进入 RAM，挂载后随第一批提交 */
+    journal_log(JOURNAL_EVT_BOOT, JOURNAL_SRC_SYS, esp_reset_reason());
+
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                      CONFIG_JOURNAL_PARTITION_LABEL);
+    if (s_part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", CONFIG_JOURNAL_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_sectors = s_part->size / JOURNAL_SECTOR_SIZE;
+    if (s_sectors > JOURNAL_MAX_SECTORS) {
+        ESP_LOGW(TAG, "Using %d of %lu sectors", JOURNAL_MAX_SECTORS, (unsigned long)s_sectors);
+        s_sectors = JOURNAL_MAX_SECTORS;
+    }
+    if (s_sectors < 2) {
+        ESP_LOGE(TAG, "Partition too small");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+#if CONFIG_APP_STATIC_ALLOCATION
+    s_flash_lock = xSemaphoreCreateMutexStatic(&s_flash_lock_buf);
+#else
+    s_flash_lock = xSemaphoreCreateMutex();
+#endif
+    if (s_flash_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (app_task_create(APP_TASK_JOURNAL, journal_task, NULL, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create journal task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    bt_l2cap_register_source(BT_L2CAP_STREAM_JOURNAL, journal_export_read);
+    diag_cmd_register("JOURNAL", "door event journal: LIST|EXPORT [from [to]], FLUSH",
+                      cmd_journal, DIAG_ACCESS_REMOTE);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_JOURNAL_ENABLE */
+
+esp_err_t journal_init(void)
+{
+    return ESP_OK;
+}
+
+void journal_log(journal_evt_t evt, journal_src_t src, uint32_t arg)
+{
+    state_shadow_event(evt, src, arg);
+}
+
+esp_err_t journal_flush(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t journal_read_range(uint32_t from, uint32_t to, journal_visit_t fn, void *ctx)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+int journal_export_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    return 0;
+}
+
+#endif /* CONFIG_JOURNAL_ENABLE */
@@ -0,0 +1,265 @@
+/**
+ * @file lan_discovery.c
+ * @brief 局域网服务发现实现
+ */
+
+#include "lan_discovery.h"
+#include "ha_mqtt.h"
+#include "bt_spp.h"
+#include "diag_cmd.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+
+#if CONFIG_LAN_DISCOVERY_ENABLE
+
+#include "mdns.h"
+#include "nvs.h"
+#include "esp_netif.h"
+#include "esp_app_desc.h"
+
+static const char *TAG = "lan_disc";
+
+#define DISC_NVS_NAMESPACE      "lan_disc"
+#define DISC_NVS_HOST           "broker_host"
+#define DISC_NVS_PORT           "broker_port"
+#define DISC_NVS_INSTANCE       "broker_inst"   /* 缓存时要求的实例名，与配置不同则作废 */
+#define DISC_HOST_LEN           64
+#define DISC_MAX_RESULTS        4
+#define DISC_QUERY_MS           CONFIG_LAN_DISCOVERY_QUERY_MS
+#define DISC_BROKER_INSTANCE    CONFIG_LAN_DISCOVERY_BROKER_INSTANCE
+
+static bool s_started = false;
+static char s_hostname[32];
+static char s_cached_host[DISC_HOST_LEN];
+static uint16_t s_cached_port = 0;
+static bool s_cache_loaded = false;
+static char s_last_uri[64];
+
+/* 诊断统计 */
+static uint32_t s_cache_hits = 0;
+static uint32_t s_browses = 0;
+static uint32_t s_misses = 0;
+
+bool lan_discovery_broker_enabled(void)
+{
+    return DISC_BROKER_INSTANCE[0] != '\0' || CONFIG_HA_MQTT_BROKER_URI[0] == '\0';
+}
+
+static void cache_load(void)
+{
+    nvs_handle_t nvs;
+    char instance[sizeof(DISC_BROKER_INSTANCE)];
+    size_t len = sizeof(s_cached_host);
+    size_t inst_len = sizeof(instance);
+
+    s_cache_loaded = true;
+    if (nvs_open(DISC_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    /* 没有实例名记录 (旧版本接受任意应答时写入) 或实例名已改的缓存不用 */
+    if (nvs_get_str(nvs, DISC_NVS_INSTANCE, instance, &inst_len) != ESP_OK ||
+        strcmp(instance, DISC_BROKER_INSTANCE) != 0 ||
+        nvs_get_str(nvs, DISC_NVS_HOST, s_cached_host, &len) != ESP_OK ||
+        nvs_get_u16(nvs, DISC_NVS_PORT, &s_cached_port) != ESP_OK) {
+        s_cached_host[0] = '\0';
+        s_cached_port = 0;
+    }
+    nvs_close(nvs);
+}
+
+/**
+ * @brief 保存 broker 主机名和端口，未变化时不写 flash
+ */
+static void cache_store(const char *host, uint16_t port)
+{
+    nvs_handle_t nvs;
+
+    if (strcmp(s_cached_host, host) == 0 && s_cached_port == port) {
+        return;
+    }
+    strlcpy(s_cached_host, host, sizeof(s_cached_host));
+    s_cached_port = port;
+
+    if (nvs_open(DISC_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_str(nvs, DISC_NVS_INSTANCE, DISC_BROKER_INSTANCE) == ESP_OK &&
+        nvs_set_str(nvs, DISC_NVS_HOST, host) == ESP_OK &&
+        nvs_set_u16(nvs, DISC_NVS_PORT, port) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    ESP_LOGI(TAG, "Cached broker %s.local:%u", host, port);
+}
+
+static esp_err_t format_uri(char *uri, size_t len, const esp_ip4_addr_t *ip, uint16_t port)
+{
+    int n = snprintf(uri, len, "mqtt://" IPSTR ":%u", IP2STR(ip), port);
+
+    if (n <= 0 || (size_t)n >= len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    strlcpy(s_last_uri, uri, sizeof(s_last_uri));
+    return ESP_OK;
+}
+
+/**
+ * @brief 第 1 步: 查询缓存主机名的 A 记录
+ */
+static esp_err_t resolve_cached(char *uri, size_t len)
+{
+    esp_ip4_addr_t ip;
+
+    if (s_cached_host[0] == '\0' ||
+        mdns_query_a(s_cached_host, DISC_QUERY_MS, &ip) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_cache_hits++;
+    return format_uri(uri, len, &ip, s_cached_port);
+}
+
+/**
+ * @brief 配置了实例名时只接受同名的 broker，局域网里其他 _mqtt._tcp 应答方不能顶替它
+ */
+static bool instance_accepted(const mdns_result_t *r)
+{
+    if (DISC_BROKER_INSTANCE[0] == '\0') {
+        return true;
+    }
+    return r->instance_name != NULL && strcmp(r->instance_name, DISC_BROKER_INSTANCE) == 0;
+}
+
+/**
+ * @brief 第 2 步: 浏览 _mqtt._tcp，响应方通常在同一应答里附带 SRV 和 A 记录
+ */
+static esp_err_t browse(char *uri, size_t len)
+{
+    mdns_result_t *results = NULL;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    s_browses++;
+    if (mdns_query_ptr("_mqtt", "_tcp", DISC_QUERY_MS, DISC_MAX_RESULTS, &results) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    for (mdns_result_t *r = results; r != NULL && ret != ESP_OK; r = r->next) {
+        if (r->hostname == NULL || r->port == 0) {
+            continue;
+        }
+        if (!instance_accepted(r)) {
+            ESP_LOGD(TAG, "Ignoring broker instance %s", r->instance_name ? r->instance_name : "?");
+            continue;
+        }
+        for (mdns_ip_addr_t *a = r->addr; a != NULL; a = a->next) {
+            if (a->addr.type == ESP_IPADDR_TYPE_V4) {
+                ESP_LOGI(TAG, "Found broker %s (%s.local:%u)",
+                         r->instance_name ? r->instance_name : "?", r->hostname, r->port);
+                cache_store(r->hostname, r->port);
+                ret = format_uri(uri, len, &a->addr.u_addr.ip4, r->port);
+                break;
+            }
+        }
+    }
+    mdns_query_results_free(results);
+    return ret;
+}
+
+esp_err_t lan_discovery_find_broker(char *uri, size_t len)
+{
+    if (!s_started || uri == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!lan_discovery_broker_enabled()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!s_cache_loaded) {
+        cache_load();
+    }
+    if (resolve_cached(uri, len) == ESP_OK || browse(uri, len) == ESP_OK) {
+        return ESP_OK;
+    }
+    s_misses++;
+    ESP_LOGW(TAG, "No MQTT broker answered on mDNS");
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief MDNS 命令: 主机名、缓存的 broker、解析统计
+ */
+static esp_err_t cmd_mdns(int argc, char **argv, const diag_out_t *out)
+{
+    diag_printf(out, "mdns %s.local, cached broker %s:%u, last %s\r\n",
+                s_hostname, s_cached_host[0] ? s_cached_host : "-", s_cached_port,
+                s_last_uri[0] ? s_last_uri : "-");
+    diag_printf(out, "broker discovery %s%s%s\r\n",
+                lan_discovery_broker_enabled() ? "on" : "off (broker configured)",
+                DISC_BROKER_INSTANCE[0] ? ", instance " : "", DISC_BROKER_INSTANCE);
+    diag_printf(out, "cache hits %lu, browses %lu, misses %lu\r\n",
+                (unsigned long)s_cache_hits, (unsigned long)s_browses,
+                (unsigned long)s_misses);
+    return ESP_OK;
+}
+
+esp_err_t lan_discovery_start(void)
+{
+    const char *id = ha_mqtt_get_device_id();
+    char instance[48];
+
+    if (s_started) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = mdns_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "mDNS init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    snprintf(s_hostname, sizeof(s_hostname), "doorlock-%s", id);
+    snprintf(instance, sizeof(instance), "Door Lock %s", id);
+    mdns_hostname_set(s_hostname);
+    mdns_instance_name_set(instance);
+
+#if CONFIG_HTTP_API_ENABLE
+    mdns_txt_item_t http_txt[] = {
+        { "path", "/api" },
+        { "ws", "/api/ws" },
+    };
+    mdns_service_add(NULL, "_http", "_tcp", CONFIG_HTTP_API_PORT,
+                     http_txt, sizeof(http_txt) / sizeof(http_txt[0]));
+    const uint16_t port = CONFIG_HTTP_API_PORT;
+#else
+    const uint16_t port = 0;
+#endif
+    mdns_txt_item_t lock_txt[] = {
+        { "id", id },
+        { "ble", BT_DEVICE_NAME },
+        { "fw", esp_app_get_description()->version },
+    };
+    mdns_service_add(NULL, "_doorlock", "_tcp", port,
+                     lock_txt, sizeof(lock_txt) / sizeof(lock_txt[0]));
+
+    s_started = true;
+    diag_cmd_register("MDNS", "mDNS hostname and cached MQTT broker", cmd_mdns, DIAG_ACCESS_REMOTE);
+    ESP_LOGI(TAG, "Advertising %s.local", s_hostname);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_LAN_DISCOVERY_ENABLE */
+
+esp_err_t lan_discovery_start(void)
+{
+    return ESP_OK;
+}
+
+bool lan_discovery_broker_enabled(void)
+{
+    return false;
+}
+
+esp_err_t lan_discovery_find_broker(char *uri, size_t len)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_LAN_DISCOVERY_ENABLE */
@@ -1,7 +1,11 @@
 #include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
 #include "board.h"
 #include "msg_queue.h"
 #include "led_task.h"
@@ -10,10 +14,67 @@
 #include "wifi_manager.h"
 #include "bt_spp.h"
 #include "ha_mqtt.h"
+#include "boot_trace.h"
+#include "app_rtos.h"
+#include "app_pm.h"
+#include "dlog.h"
+#include "trace.h"
+#include "journal.h"
+#include "state_shadow.h"
+#include "timer_wheel.h"
+#include "supervisor.h"
+#include "app_event.h"
+#include "crash_report.h"
+#include "ota_update.h"
+#include "http_api.h"
+#include "lan_discovery.h"
+#include "coap_server.h"
+#include "task_monitor.h"
+#include "cpu_stats.h"
+#include "heap_monitor.h"
+#include "fault_inject.h"
+#include "soak.h"
+#include "bench.h"
+#include "diag_cmd.h"
+#include "diag_console.h"
 
 static const char *TAG = "main";
 
-#define MSG_QUEUE_LEN 10
+/* 启动依赖图调度参数 */
+#define BOOT_MAIN_PRIORITY      3       /* 关键路径 (app_main) 优先级 */
+#define BOOT_TRACE_JSON_SIZE    768
+#define BROKER_URI_SIZE         64
+#define BROKER_WATCH_PERIOD_MS  5000
+#define SOAK_PROVISION_HOLD_MS  3000
+#define SOAK_RECONNECT_MS       30000
+
+#define STAGE_BIT(stage) (1UL << (stage))
+/* 阶段成功完成的位，与完成位放在同一事件组 (FreeRTOS 事件组可用 24 位) */
+#define STAGE_OK_BITS(bits) ((uint32_t)(bits) << BOOT_STAGE_MAX)
+
+_Static_assert(2 * BOOT_STAGE_MAX <= 24, "boot stage done and ok bits must fit the event group");
+
+typedef esp_err_t (*boot_stage_fn_t)(void);
+
+/**
+ * @brief 启动依赖图节点
+ */
+typedef struct {
+    boot_stage_t stage;
+    boot_stage_fn_t fn;
+    uint32_t deps;      /* 依赖阶段位图 */
+    uint32_t needs;     /* 须成功完成的依赖 (deps 的子集)，任一失败则跳过本阶段 */
+    bool parallel;      /* 在独立任务中执行，与关键路径重叠 */
+    app_task_id_t worker; /* 并行阶段使用的任务表 ID */
+    bool required;      /* 失败则停止调度后续阶段 */
+} boot_node_t;
+
+/* 启动结束后不删除: 工作任务在 xEventGroupSetBits 唤醒 app_main 之后仍会访问事件组 */
+static EventGroupHandle_t s_boot_events = NULL;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticEventGroup_t s_boot_events_buf;
+#endif
+static volatile bool s_boot_failed = false;
 
 /**
  * @brief MQTT 门命令回调函数
@@ -29,22 +90,72 @@ static void mqtt_door_callback(bool is_on)
     }
 }
 
+#if CONFIG_LAN_DISCOVERY_ENABLE
+/**
+ * @brief 监视 broker 连接，WiFi 正常但长时间连不上 broker 时重新发现
+ *
+ * broker 换 IP 后缓存的主机名仍可解析，新地址在 MQTT 下一次自动重连时生效
+ */
+static void broker_watch(char *uri)
+{
+    static wheel_timer_t s_watch_timer;
+    char found[BROKER_URI_SIZE];
+    int64_t lost_since = 0;
+
+    timer_wheel_setup_notify(&s_watch_timer, "broker_watch", xTaskGetCurrentTaskHandle(), BIT0);
+    timer_wheel_arm(&s_watch_timer, BROKER_WATCH_PERIOD_MS, BROKER_WATCH_PERIOD_MS);
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (ha_mqtt_is_connected() || !wifi_manager_is_connected()) {
+            lost_since = 0;
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (lost_since == 0) {
+            lost_since = now;
+            continue;
+        }
+        if (now - lost_since < (int64_t)CONFIG_LAN_DISCOVERY_REDISCOVER_S * 1000000) {
+            continue;
+        }
+        lost_since = now;
+        if (lan_discovery_find_broker(found, sizeof(found)) == ESP_OK && strcmp(found, uri) != 0) {
+            strlcpy(uri, found, BROKER_URI_SIZE);
+            ha_mqtt_set_broker_uri(uri);
+        }
+    }
+}
+#endif
+
 /**
  * @brief MQTT 启动任务
  * 
- * 等待 WiFi 连接成功后启动 MQTT 客户端
+ * 等待 WiFi 连接成功后启动 MQTT 客户端；启用 mDNS 发现时之后常驻监视 broker
  */
 static void mqtt_start_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "MQTT start task waiting for WiFi connection...");
     
     /* 等待 WiFi 连接 */
-    while (!wifi_manager_is_connected()) {
-        vTaskDelay(pdMS_TO_TICKS(500));
+    if (!wifi_manager_wait_connected(portMAX_DELAY)) {
+        ESP_LOGE(TAG, "WiFi manager not initialized, MQTT not started");
+        vTaskDelete(NULL);
+        return;
     }
     
     ESP_LOGI(TAG, "WiFi connected, starting MQTT client...");
     
+#if CONFIG_LAN_DISCOVERY_ENABLE
+    /* 一次 mDNS 查询解析 broker，未启用 broker 发现或无应答时沿用配置的 URI */
+    char uri[BROKER_URI_SIZE];
+    if (lan_discovery_find_broker(uri, sizeof(uri)) == ESP_OK) {
+        ha_mqtt_set_broker_uri(uri);
+    } else {
+        strlcpy(uri, CONFIG_HA_MQTT_BROKER_URI, sizeof(uri));
+    }
+#endif
+    
     /* 启动 MQTT 客户端 */
     if (ha_mqtt_start() == ESP_OK) {
         ESP_LOGI(TAG, "MQTT client started successfully");
@@ -52,6 +163,13 @@ static void mqtt_start_task(void *pvParameters)
         ESP_LOGE(TAG, "Failed to start MQTT client");
     }
     
+#if CONFIG_LAN_DISCOVERY_ENABLE
+    if (lan_discovery_broker_enabled()) {
+        /* 不返回 */
+        broker_watch(uri);
+    }
+#endif
+    
     /* 任务完成，删除自己 */
     vTaskDelete(NULL);
 }
@@ -61,6 +179,8 @@ static void mqtt_start_task(void *pvParameters)
  */
 static void key_event_handler(uint8_t gpio_num, key_event_t event)
 {
+    TRACE(TRACE_SRC_KEY, TRACE_EVT_KEY, gpio_num, event, 0);
+    
     switch (event) {
         case KEY_EVENT_SINGLE_CLICK:
             // 单击：执行开门操作
@@ -75,56 +195,97 @@ static void key_event_handler(uint8_t gpio_num, key_event_t event)
     }
 }
 
-void app_main(void)
+/**
+ * @brief MQTT 连接成功回调，首次连接时发布启动时间表
+ */
+static void mqtt_connect_callback(void)
 {
-    ESP_LOGI(TAG, "Hello ESP32-C6!");
-    
-    // 硬件初始化
-    configure_led();
-    configure_key();
+    static bool s_boot_trace_published = false;
     
-    if (configure_servo() != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to configure servo");
-    }
-    
-    // 消息队列初始化
-    if (msg_queue_init_all(MSG_QUEUE_LEN) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize message queues");
+    boot_trace_mark(BOOT_MARK_MQTT_UP);
+    crash_report_online();
+    if (s_boot_trace_published) {
         return;
     }
     
-    // wifi管理器初始化
-    if (wifi_manager_init() != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize WiFi manager");
+    char json[BOOT_TRACE_JSON_SIZE];
+    if (boot_trace_to_json(json, sizeof(json)) > 0 &&
+        ha_mqtt_publish_telemetry("boot", json) == ESP_OK) {
+        s_boot_trace_published = true;
     }
-    // wifi消息处理
-    wifi_manager_start_msg_task();
+}
 
-    // 蓝牙SPP服务初始化
-    if (bt_spp_init() != ESP_OK) {
-        ESP_LOGW(TAG, "Bluetooth SPP init failed, continuing without BT");
+#if CONFIG_SOAK_ENABLE
+/* 浸泡测试动作: 配网循环 (创建/删除 smartconfig_task 和 LED 闪烁定时器) */
+static esp_err_t soak_provision(void)
+{
+    if (!wifi_manager_is_connected()) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
+    esp_err_t ret = wifi_manager_provision_cycle(SOAK_PROVISION_HOLD_MS);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return wifi_manager_wait_connected(SOAK_RECONNECT_MS) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
 
-    // MQTT 客户端初始化
-    if (ha_mqtt_init() == ESP_OK) {
-        // 注册门命令回调
-        ha_mqtt_register_door_callback(mqtt_door_callback);
-        // 创建 MQTT 启动任务（等待 WiFi 连接后启动）
-        xTaskCreate(mqtt_start_task, "mqtt_start", 2048, NULL, 3, NULL);
-        ESP_LOGI(TAG, "MQTT client initialized, waiting for WiFi to start");
-    } else {
-        ESP_LOGW(TAG, "MQTT client init failed, continuing without MQTT");
+/* 浸泡测试动作: 向已连接的 BLE 客户端发送一条通知 */
+static esp_err_t soak_ble_notify(void)
+{
+    static const char msg[] = "soak\r\n";
+
+    if (!bt_spp_is_connected()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return bt_spp_send(msg, sizeof(msg) - 1);
+}
+#endif
+
+static esp_err_t stage_nvs(void)
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "NVS partition issue, erasing...");
+        ret = nvs_flash_erase();
+        if (ret == ESP_OK) {
+            ret = nvs_flash_init();
+        }
     }
+    return ret;
+}
+
+static esp_err_t stage_led(void)
+{
+    configure_led();
+    return ESP_OK;
+}
+
+static esp_err_t stage_key(void)
+{
+    configure_key();
+    return ESP_OK;
+}
+
+static esp_err_t stage_servo(void)
+{
+    return configure_servo();
+}
+
+static esp_err_t stage_queues(void)
+{
+    return msg_queue_init_all(APP_MSG_QUEUE_LEN);
+}
 
-    // 创建业务任务
+static esp_err_t stage_tasks(void)
+{
     if (led_task_create() != pdPASS) {
         ESP_LOGE(TAG, "Failed to create led task");
-        return;
+        return ESP_FAIL;
     }
     
     if (pwm_task_create() != pdPASS) {
         ESP_LOGE(TAG, "Failed to create pwm task");
-        return;
+        return ESP_FAIL;
     }
     
     key_task_config_t key_cfg = {
@@ -133,6 +294,231 @@ void app_main(void)
     };
     if (key_task_create(&key_cfg) != pdPASS) {
         ESP_LOGE(TAG, "Failed to create key task");
+        return ESP_FAIL;
+    }
+    
+    boot_trace_mark(BOOT_MARK_UNLOCK_READY);
+    return ESP_OK;
+}
+
+static esp_err_t stage_wifi(void)
+{
+    // wifi管理器初始化
+    esp_err_t ret = wifi_manager_init();
+    // wifi消息处理
+    wifi_manager_start_msg_task();
+    if (ret == ESP_OK) {
+        // 局域网 HTTP API，broker 不可用时仍可控制
+        http_api_start();
+        // CoAP/UDP 控制端点 (可选)
+        coap_server_start();
+        // mDNS 广播本机服务，并用于发现 broker
+        lan_discovery_start();
+    }
+    return ret;
+}
+
+static esp_err_t stage_ble(void)
+{
+    // 蓝牙SPP服务初始化
+    return bt_spp_init();
+}
+
+static esp_err_t stage_mqtt(void)
+{
+    // MQTT 客户端初始化
+    esp_err_t ret = ha_mqtt_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // 注册门命令回调
+    ha_mqtt_register_door_callback(mqtt_door_callback);
+    ha_mqtt_register_connect_callback(mqtt_connect_callback);
+    // 创建 MQTT 启动任务（等待 WiFi 连接后启动）
+    if (app_task_create(APP_TASK_MQTT_START, mqtt_start_task, NULL, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/*
+ * 启动依赖图
+ *
+ * 关键路径 (LED/按键/舵机/队列/业务任务) 在 app_main 中以较高优先级执行，
+ * WiFi 与 BLE 协议栈初始化在独立任务中并行进行，二者只依赖 NVS 和队列。
+ * 两个协议栈都在 NVS 中读写配置和配对信息，NVS 初始化失败时跳过，门锁本地功能不受影响。
+ * 同一遍扫描中先派生并行节点，再执行串行节点，因此表中顺序即关键路径顺序。
+ */
+static const boot_node_t s_boot_graph[] = {
+    { BOOT_STAGE_NVS,    stage_nvs,    0,
+      .parallel = false, .required = false },
+    { BOOT_STAGE_QUEUES, stage_queues, 0,
+      .parallel = false, .required = true },
+    { BOOT_STAGE_WIFI,   stage_wifi,   STAGE_BIT(BOOT_STAGE_NVS) | STAGE_BIT(BOOT_STAGE_QUEUES),
+      .needs = STAGE_BIT(BOOT_STAGE_NVS),
+      .parallel = true, .worker = APP_TASK_BOOT_WIFI, .required = false },
+    { BOOT_STAGE_BLE,    stage_ble,    STAGE_BIT(BOOT_STAGE_NVS) | STAGE_BIT(BOOT_STAGE_QUEUES),
+      .needs = STAGE_BIT(BOOT_STAGE_NVS),
+      .parallel = true, .worker = APP_TASK_BOOT_BLE, .required = false },
+    { BOOT_STAGE_LED,    stage_led,    0,
+      .parallel = false, .required = false },
+    { BOOT_STAGE_KEY,    stage_key,    0,
+      .parallel = false, .required = false },
+    { BOOT_STAGE_SERVO,  stage_servo,  0,
+      .parallel = false, .required = false },
+    { BOOT_STAGE_TASKS,  stage_tasks,  STAGE_BIT(BOOT_STAGE_LED) | STAGE_BIT(BOOT_STAGE_KEY) |
+                                       STAGE_BIT(BOOT_STAGE_SERVO) | STAGE_BIT(BOOT_STAGE_QUEUES),
+      .parallel = false, .required = true },
+    { BOOT_STAGE_MQTT,   stage_mqtt,   STAGE_BIT(BOOT_STAGE_WIFI),
+      .parallel = false, .required = false },
+};
+
+#define BOOT_NODE_COUNT (sizeof(s_boot_graph) / sizeof(s_boot_graph[0]))
+
+static void boot_run_node(const boot_node_t *node)
+{
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    uint32_t needs = STAGE_OK_BITS(node->needs);
+    
+    boot_trace_begin(node->stage);
+    if ((xEventGroupGetBits(s_boot_events) & needs) == needs) {
+        ret = node->fn();
+    } else {
+        ESP_LOGW(TAG, "Boot stage %d skipped: a stage it needs failed", node->stage);
+    }
+    boot_trace_end(node->stage, ret);
+    
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Boot stage %d failed: %s", node->stage, esp_err_to_name(ret));
+        if (node->required) {
+            s_boot_failed = true;
+        }
+    }
+    
+    /* 失败或跳过的阶段同样标记完成，needs 之外的依赖方自行降级运行 */
+    uint32_t bits = STAGE_BIT(node->stage);
+    xEventGroupSetBits(s_boot_events, ret == ESP_OK ? bits | STAGE_OK_BITS(bits) : bits);
+}
+
+static void boot_worker_task(void *pvParameters)
+{
+    boot_run_node((const boot_node_t *)pvParameters);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief 按依赖关系调度启动图，返回前所有节点均已完成
+ */
+static esp_err_t boot_run_graph(void)
+{
+    uint32_t all = 0;
+    uint32_t started = 0;
+    
+    for (size_t i = 0; i < BOOT_NODE_COUNT; i++) {
+        all |= STAGE_BIT(s_boot_graph[i].stage);
+    }
+    
+    while (1) {
+        uint32_t done = xEventGroupGetBits(s_boot_events) & all;
+        if (done == all) {
+            break;
+        }
+        
+        const boot_node_t *inline_node = NULL;
+        if (!s_boot_failed) {
+            for (size_t i = 0; i < BOOT_NODE_COUNT; i++) {
+                const boot_node_t *node = &s_boot_graph[i];
+                uint32_t bit = STAGE_BIT(node->stage);
+                
+                if ((started & bit) || (node->deps & done) != node->deps) {
+                    continue;
+                }
+                
+                if (node->parallel) {
+                    started |= bit;
+                    if (app_task_create(node->worker, boot_worker_task, (void *)node, NULL) != pdPASS) {
+                        ESP_LOGW(TAG, "No memory for boot worker, running stage %d inline", node->stage);
+                        boot_run_node(node);
+                    }
+                } else if (inline_node == NULL) {
+                    inline_node = node;
+                }
+            }
+        }
+        
+        if (inline_node != NULL) {
+            started |= STAGE_BIT(inline_node->stage);
+            boot_run_node(inline_node);
+            continue;
+        }
+        
+        /* 仅剩并行阶段在执行，或启动已失败：等待在途阶段结束 */
+        uint32_t pending = started & ~done;
+        if (pending == 0) {
+            break;
+        }
+        xEventGroupWaitBits(s_boot_events, pending, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+    
+    return s_boot_failed ? ESP_FAIL : ESP_OK;
+}
+
+void app_main(void)
+{
+    boot_trace_mark(BOOT_MARK_APP_MAIN);
+    ESP_LOGI(TAG, "Hello ESP32-C6!");
+    
+#if CONFIG_APP_STATIC_ALLOCATION
+    s_boot_events = xEventGroupCreateStatic(&s_boot_events_buf);
+#else
+    s_boot_events = xEventGroupCreate();
+#endif
+    if (s_boot_events == NULL) {
+        ESP_LOGE(TAG, "Failed to create boot event group");
+        return;
+    }
+    
+    trace_init();
+    fault_inject_init();
+    
+    /* 电源管理需在创建其他任务和外设之前配置 */
+    app_pm_init();
+    crash_report_init();
+    dlog_init();
+    timer_wheel_init();
+    diag_cmd_start();
+    supervisor_start();
+    app_event_start();
+    state_shadow_init();
+    journal_init();
+    ota_update_init();
+    
+    /* 尽早启动栈监控，覆盖启动阶段的工作任务 */
+    task_monitor_start();
+    cpu_stats_start();
+    heap_monitor_start();
+    bench_init();
+    diag_console_start();
+    
+    /* 浸泡测试只注册命令，由 SOAK START 启动 */
+    soak_init();
+#if CONFIG_SOAK_ENABLE
+    soak_register_action("provision", soak_provision, 1);
+    soak_register_action("ble_notify", soak_ble_notify, 2);
+#endif
+    
+    /* 关键路径优先于并行阶段执行 */
+    vTaskPrioritySet(NULL, BOOT_MAIN_PRIORITY);
+    esp_err_t ret = boot_run_graph();
+    
+    boot_trace_dump();
+    
+    /* 新镜像启动失败时回滚，成功则延时确认 */
+    ota_update_confirm_boot(ret == ESP_OK);
+    
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "System initialization failed");
         return;
     }
 
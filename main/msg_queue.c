@@ -1,10 +1,51 @@
 #include "msg_queue.h"
 #include "esp_log.h"
+#include "app_rtos.h"
+#include "trace.h"
+#include "fault_inject.h"
+#include "diag_cmd.h"
+
+#include <string.h>
 
 static const char *TAG = "msg_queue";
 
 /* 全局队列数组 */
 static QueueHandle_t s_queues[QUEUE_MAX] = {NULL};
+static const char *const s_queue_names[QUEUE_MAX] = { "led", "pwm", "wifi", "mqtt" };
+
+/* 每个队列发送失败 (满或超时) 次数 */
+static volatile uint32_t s_send_fails[QUEUE_MAX];
+
+/* 消息负载前 4 字节，作为跟踪参数 */
+static uint32_t msg_trace_arg(const msg_t *msg)
+{
+    uint32_t arg;
+    memcpy(&arg, msg->data.raw, sizeof(arg));
+    return arg;
+}
+
+/**
+ * @brief QUEUES 诊断命令: 各队列当前积压、深度和发送失败次数
+ */
+static esp_err_t cmd_queues(int argc, char **argv, const diag_out_t *out)
+{
+    for (int i = 0; i < QUEUE_MAX; i++) {
+        if (s_queues[i] == NULL) {
+            continue;
+        }
+        UBaseType_t waiting = uxQueueMessagesWaiting(s_queues[i]);
+        diag_printf(out, "%-5s %u/%u fails=%lu\r\n", s_queue_names[i], (unsigned)waiting,
+                    (unsigned)(waiting + uxQueueSpacesAvailable(s_queues[i])),
+                    (unsigned long)s_send_fails[i]);
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_APP_STATIC_ALLOCATION
+/* 静态队列存储，深度固定为 APP_MSG_QUEUE_LEN */
+static StaticQueue_t s_queue_bufs[QUEUE_MAX];
+static uint8_t s_queue_storage[QUEUE_MAX][APP_MSG_QUEUE_LEN * sizeof(msg_t)];
+#endif
 
 esp_err_t msg_queue_init_all(uint8_t queue_len)
 {
@@ -13,14 +54,28 @@ esp_err_t msg_queue_init_all(uint8_t queue_len)
         return ESP_ERR_INVALID_ARG;
     }
 
+#if CONFIG_APP_STATIC_ALLOCATION
+    if (queue_len > APP_MSG_QUEUE_LEN) {
+        ESP_LOGE(TAG, "Queue length %d exceeds static storage (%d)", queue_len, APP_MSG_QUEUE_LEN);
+        return ESP_ERR_INVALID_SIZE;
+    }
+#endif
+
     for (int i = 0; i < QUEUE_MAX; i++) {
+#if CONFIG_APP_STATIC_ALLOCATION
+        s_queues[i] = xQueueCreateStatic(queue_len, sizeof(msg_t),
+                                         s_queue_storage[i], &s_queue_bufs[i]);
+#else
         s_queues[i] = xQueueCreate(queue_len, sizeof(msg_t));
+#endif
         if (s_queues[i] == NULL) {
             ESP_LOGE(TAG, "Failed to create queue %d", i);
             return ESP_ERR_NO_MEM;
         }
     }
 
+    diag_cmd_register("QUEUES", "message queue depth and send failures", cmd_queues, DIAG_ACCESS_REMOTE);
+
     ESP_LOGI(TAG, "All queues initialized with length %d", queue_len);
     return ESP_OK;
 }
@@ -45,13 +100,23 @@ bool msg_queue_send(QueueHandle_t queue, const msg_t *msg, uint32_t timeout_ms)
                                ? portMAX_DELAY 
                                : pdMS_TO_TICKS(timeout_ms);
 
-    BaseType_t result = xQueueSend(queue, msg, ticks_to_wait);
+    BaseType_t result = FAULT_INJECT(FAULT_QUEUE_FULL) ? pdFALSE
+                                                        : xQueueSend(queue, msg, ticks_to_wait);
     
     if (result != pdTRUE) {
+        for (int i = 0; i < QUEUE_MAX; i++) {
+            if (s_queues[i] == queue) {
+                s_send_fails[i]++;
+                break;
+            }
+        }
+        TRACE(TRACE_SRC_QUEUE, TRACE_EVT_QUEUE_FULL, msg->type, msg_trace_arg(msg), 0);
         ESP_LOGW(TAG, "Failed to send message (type=%d), queue full or timeout", msg->type);
         return false;
     }
 
+    TRACE(TRACE_SRC_QUEUE, TRACE_EVT_QUEUE_SEND, msg->type, msg_trace_arg(msg), 0);
+    FAULT_RECOVERED(FAULT_QUEUE_FULL);
     return true;
 }
 
@@ -67,8 +132,12 @@ bool msg_queue_receive(QueueHandle_t queue, msg_t *msg, uint32_t timeout_ms)
                                : pdMS_TO_TICKS(timeout_ms);
 
     BaseType_t result = xQueueReceive(queue, msg, ticks_to_wait);
+    if (result != pdTRUE) {
+        return false;
+    }
     
-    return (result == pdTRUE);
+    TRACE(TRACE_SRC_QUEUE, TRACE_EVT_QUEUE_RECV, msg->type, msg_trace_arg(msg), 0);
+    return true;
 }
 
 
@@ -190,6 +259,44 @@ bool msg_send_mqtt_door_cmd(mqtt_cmd_t cmd)
     return msg_queue_send(queue, &msg, 100);
 }
 
+bool msg_send_http_door_cmd(http_cmd_t cmd)
+{
+    QueueHandle_t queue = msg_queue_get(QUEUE_PWM);
+    if (queue == NULL) {
+        ESP_LOGE(TAG, "PWM queue not initialized");
+        return false;
+    }
+
+    msg_t msg = {
+        .type = MSG_TYPE_HTTP,
+        .data.http = {
+            .cmd = cmd
+        }
+    };
+
+    /* HTTP 处理线程不长时间阻塞，队列满时由调用方返回 503 */
+    return msg_queue_send(queue, &msg, 0);
+}
+
+bool msg_send_coap_door_cmd(coap_cmd_t cmd)
+{
+    QueueHandle_t queue = msg_queue_get(QUEUE_PWM);
+    if (queue == NULL) {
+        ESP_LOGE(TAG, "PWM queue not initialized");
+        return false;
+    }
+
+    msg_t msg = {
+        .type = MSG_TYPE_COAP,
+        .data.coap = {
+            .cmd = cmd
+        }
+    };
+
+    /* CoAP 服务任务不阻塞，队列满时应答 5.03 */
+    return msg_queue_send(queue, &msg, 0);
+}
+
 bool msg_type_is_valid(msg_type_t type)
 {
     return (type > MSG_TYPE_NONE && type < MSG_TYPE_MAX);
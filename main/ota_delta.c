@@ -0,0 +1,239 @@
+/**
+ * @file ota_delta.c
+ * @brief 增量 OTA 补丁流式应用实现
+ *
+ * 输入按任意边界切分到达 (通常来自解压器输出)，逐段解析；差值段每次从基准
+ * 分区读取不超过 CONFIG_OTA_DELTA_BUF_SIZE 字节，与差值相加后交给输出回调，
+ * 新数据段直接透传，整个过程只需要一个工作缓冲区。
+ */
+
+#include "ota_delta.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "mbedtls/sha256.h"
+
+static const char *TAG = "ota_delta";
+
+#if CONFIG_OTA_ENABLE
+
+typedef enum {
+    DELTA_ST_HEADER = 0,
+    DELTA_ST_OP,
+    DELTA_ST_ADD,
+    DELTA_ST_INSERT,
+} delta_state_t;
+
+struct ota_delta {
+    const esp_partition_t *base;
+    ota_inflate_write_t write;
+    void *ctx;
+
+    delta_state_t state;
+    uint8_t field[sizeof(ota_delta_header_t)];  /* 跨输入边界的头/操作 */
+    size_t field_len;
+    ota_delta_header_t hdr;
+    ota_delta_op_t op;
+    uint32_t src;                               /* 当前差值段的基准偏移 */
+    esp_err_t err;
+
+    uint8_t buf[CONFIG_OTA_DELTA_BUF_SIZE];
+};
+
+_Static_assert(sizeof(ota_delta_header_t) == 40, "ota_delta_header_t layout is part of the patch format");
+_Static_assert(sizeof(ota_delta_op_t) == 12, "ota_delta_op_t layout is part of the patch format");
+
+ota_delta_t *ota_delta_create(const esp_partition_t *base, ota_inflate_write_t write, void *ctx)
+{
+    if (base == NULL || write == NULL) {
+        return NULL;
+    }
+
+    ota_delta_t *d = calloc(1, sizeof(*d));
+    if (d == NULL) {
+        return NULL;
+    }
+    d->base = base;
+    d->write = write;
+    d->ctx = ctx;
+    d->state = DELTA_ST_HEADER;
+    return d;
+}
+
+/**
+ * @brief 校验运行中的分区与补丁的基准镜像一致
+ */
+static esp_err_t verify_base(ota_delta_t *d)
+{
+    mbedtls_sha256_context sha;
+    uint8_t digest[32];
+    esp_err_t ret = ESP_OK;
+
+    if (d->hdr.base_size == 0 || d->hdr.base_size > d->base->size) {
+        ESP_LOGE(TAG, "Base size %lu does not fit %s", (unsigned long)d->hdr.base_size,
+                 d->base->label);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    for (uint32_t off = 0; off < d->hdr.base_size && ret == ESP_OK; off += sizeof(d->buf)) {
+        size_t n = d->hdr.base_size - off;
+        if (n > sizeof(d->buf)) {
+            n = sizeof(d->buf);
+        }
+        ret = esp_partition_read(d->base, off, d->buf, n);
+        if (ret == ESP_OK) {
+            mbedtls_sha256_update(&sha, d->buf, n);
+        }
+    }
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (memcmp(digest, d->hdr.base_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Patch was built for a different base image than %s", d->base->label);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    ESP_LOGI(TAG, "Base image %s verified (%lu bytes)", d->base->label,
+             (unsigned long)d->hdr.base_size);
+    return ESP_OK;
+}
+
+/**
+ * @brief 一条操作接收完整，检查范围并进入差值段或新数据段
+ */
+static esp_err_t begin_op(ota_delta_t *d)
+{
+    memcpy(&d->op, d->field, sizeof(d->op));
+
+    if (d->op.add_len > d->hdr.base_size || d->op.src_offset > d->hdr.base_size - d->op.add_len) {
+        ESP_LOGE(TAG, "Copy %lu+%lu outside base image", (unsigned long)d->op.src_offset,
+                 (unsigned long)d->op.add_len);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    d->src = d->op.src_offset;
+    d->state = d->op.add_len ? DELTA_ST_ADD : d->op.insert_len ? DELTA_ST_INSERT : DELTA_ST_OP;
+    return ESP_OK;
+}
+
+static esp_err_t feed_field(ota_delta_t *d, const uint8_t **buf, size_t *len)
+{
+    size_t need = (d->state == DELTA_ST_HEADER ? sizeof(d->hdr) : sizeof(d->op)) - d->field_len;
+    size_t n = *len < need ? *len : need;
+
+    memcpy(d->field + d->field_len, *buf, n);
+    d->field_len += n;
+    *buf += n;
+    *len -= n;
+    if (n < need) {
+        return ESP_OK;
+    }
+    d->field_len = 0;
+
+    if (d->state == DELTA_ST_OP) {
+        return begin_op(d);
+    }
+
+    memcpy(&d->hdr, d->field, sizeof(d->hdr));
+    if (d->hdr.magic != OTA_DELTA_MAGIC) {
+        ESP_LOGE(TAG, "Bad patch magic 0x%08lx", (unsigned long)d->hdr.magic);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    d->state = DELTA_ST_OP;
+    return verify_base(d);
+}
+
+static esp_err_t feed_add(ota_delta_t *d, const uint8_t **buf, size_t *len)
+{
+    size_t n = *len;
+
+    if (n > d->op.add_len) {
+        n = d->op.add_len;
+    }
+    if (n > sizeof(d->buf)) {
+        n = sizeof(d->buf);
+    }
+
+    esp_err_t ret = esp_partition_read(d->base, d->src, d->buf, n);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    for (size_t k = 0; k < n; k++) {
+        d->buf[k] += (*buf)[k];
+    }
+    ret = d->write(d->ctx, d->buf, n);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    d->src += n;
+    d->op.add_len -= n;
+    *buf += n;
+    *len -= n;
+    if (d->op.add_len == 0) {
+        d->state = d->op.insert_len ? DELTA_ST_INSERT : DELTA_ST_OP;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t feed_insert(ota_delta_t *d, const uint8_t **buf, size_t *len)
+{
+    size_t n = *len < d->op.insert_len ? *len : d->op.insert_len;
+
+    esp_err_t ret = d->write(d->ctx, *buf, n);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    d->op.insert_len -= n;
+    *buf += n;
+    *len -= n;
+    if (d->op.insert_len == 0) {
+        d->state = DELTA_ST_OP;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_delta_feed(void *ctx, const uint8_t *buf, size_t len)
+{
+    ota_delta_t *d = ctx;
+
+    while (d->err == ESP_OK && len > 0) {
+        switch (d->state) {
+            case DELTA_ST_HEADER:
+            case DELTA_ST_OP:
+                d->err = feed_field(d, &buf, &len);
+                break;
+            case DELTA_ST_ADD:
+                d->err = feed_add(d, &buf, &len);
+                break;
+            case DELTA_ST_INSERT:
+                d->err = feed_insert(d, &buf, &len);
+                break;
+        }
+    }
+    return d->err;
+}
+
+esp_err_t ota_delta_finish(ota_delta_t *d)
+{
+    if (d->err != ESP_OK) {
+        return d->err;
+    }
+    if (d->state != DELTA_ST_OP || d->field_len != 0) {
+        ESP_LOGE(TAG, "Patch truncated");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+void ota_delta_destroy(ota_delta_t *d)
+{
+    free(d);
+}
+
+#endif /* CONFIG_OTA_ENABLE */
@@ -0,0 +1,444 @@
+/**
+ * @file ota_inflate.c
+ * @brief 流式 raw deflate 解压实现
+ *
+ * 规范 Huffman 逐位解码 (参考 zlib contrib/puff 的算法)，不建查找表，
+ * 状态约 1.5KB 加窗口；解压速度远高于 Flash 写入速度，不是 OTA 的瓶颈。
+ */
+
+#include "ota_inflate.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXBITS     15      /* 码长上限 */
+#define MAXLCODES   286     /* 字面量/长度码数 */
+#define MAXDCODES   30      /* 距离码数 */
+#define MAXCODES    (MAXLCODES + MAXDCODES)
+#define FIXLCODES   288     /* 固定表字面量/长度码数 */
+#define IN_BUF_SIZE 512
+
+typedef struct {
+    uint16_t count[MAXBITS + 1];    /* 每种码长的符号数 */
+    uint16_t *symbol;               /* 按码排序的符号 */
+} huffman_t;
+
+struct ota_inflate {
+    ota_inflate_read_t read;
+    ota_inflate_write_t write;
+    void *ctx;
+
+    /* 输入 */
+    uint8_t in[IN_BUF_SIZE];
+    size_t in_len;
+    size_t in_pos;
+    uint32_t total_in;
+    uint32_t bitbuf;
+    uint32_t bitcnt;
+    bool eof;
+
+    /* 输出窗口 */
+    uint8_t *window;
+    uint32_t wsize;
+    uint32_t wpos;
+    uint32_t total_out;
+    esp_err_t err;
+
+    /* 解码表 */
+    uint16_t lensym[FIXLCODES];
+    uint16_t distsym[MAXDCODES];
+    uint16_t lengths[MAXCODES];
+    huffman_t lencode;
+    huffman_t distcode;
+};
+
+static const uint16_t s_lbase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_lext[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t s_dbase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t s_dext[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t s_clen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static int next_byte(ota_inflate_t *s)
+{
+    if (s->in_pos == s->in_len) {
+        if (s->eof) {
+            return -1;
+        }
+        int n = s->read(s->ctx, s->in, sizeof(s->in));
+        if (n <= 0) {
+            s->eof = true;
+            return -1;
+        }
+        s->in_len = (size_t)n;
+        s->in_pos = 0;
+    }
+    s->total_in++;
+    return s->in[s->in_pos++];
+}
+
+/**
+ * @brief 读取 need 位 (LSB 优先)，输入耗尽时置错误并返回 0
+ */
+static int bits(ota_inflate_t *s, int need)
+{
+    uint32_t val = s->bitbuf;
+
+    while (s->bitcnt < (uint32_t)need) {
+        int b = next_byte(s);
+        if (b < 0) {
+            if (s->err == ESP_OK) {
+                s->err = ESP_ERR_INVALID_RESPONSE;
+            }
+            return 0;
+        }
+        val |= (uint32_t)b << s->bitcnt;
+        s->bitcnt += 8;
+    }
+    s->bitbuf = val >> need;
+    s->bitcnt -= need;
+    return (int)(val & ((1UL << need) - 1));
+}
+
+static void flush_window(ota_inflate_t *s, uint32_t len)
+{
+    if (s->err == ESP_OK && len > 0) {
+        s->err = s->write(s->ctx, s->window, len);
+    }
+}
+
+static inline void put(ota_inflate_t *s, uint8_t b)
+{
+    s->window[s->wpos++] = b;
+    s->total_out++;
+    if (s->wpos == s->wsize) {
+        flush_window(s, s->wsize);
+        s->wpos = 0;
+    }
+}
+
+static esp_err_t stored(ota_inflate_t *s)
+{
+    /* 丢弃到字节边界 */
+    s->bitbuf = 0;
+    s->bitcnt = 0;
+
+    int b0 = next_byte(s), b1 = next_byte(s), b2 = next_byte(s), b3 = next_byte(s);
+    if (b3 < 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    uint32_t len = (uint32_t)b0 | ((uint32_t)b1 << 8);
+    if (((uint32_t)b2 | ((uint32_t)b3 << 8)) != (~len & 0xFFFF)) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    while (len-- > 0) {
+        int b = next_byte(s);
+        if (b < 0) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        put(s, (uint8_t)b);
+        if (s->err != ESP_OK) {
+            return s->err;
+        }
+    }
+    return ESP_OK;
+}
+
+static int decode(ota_inflate_t *s, const huffman_t *h)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (int len = 1; len <= MAXBITS; len++) {
+        code |= bits(s, 1);
+        int count = h->count[len];
+        if (code - count < first) {
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+        if (s->err != ESP_OK) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 由码长构建规范 Huffman 表
+ *
+ * @return 0 完整码, >0 不完整码, <0 超额订阅
+ */
+static int construct(huffman_t *h, const uint16_t *length, int n)
+{
+    uint16_t offs[MAXBITS + 1];
+    int left = 1;
+
+    memset(h->count, 0, sizeof(h->count));
+    for (int sym = 0; sym < n; sym++) {
+        h->count[length[sym]]++;
+    }
+    if (h->count[0] == n) {
+        return 0;
+    }
+
+    for (int len = 1; len <= MAXBITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) {
+            return left;
+        }
+    }
+
+    offs[1] = 0;
+    for (int len = 1; len < MAXBITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+    for (int sym = 0; sym < n; sym++) {
+        if (length[sym] != 0) {
+            h->symbol[offs[length[sym]]++] = (uint16_t)sym;
+        }
+    }
+    return left;
+}
+
+static esp_err_t codes(ota_inflate_t *s)
+{
+    int symbol;
+
+    do {
+        symbol = decode(s, &s->lencode);
+        if (symbol < 0 || s->err != ESP_OK) {
+            return s->err != ESP_OK ? s->err : ESP_ERR_INVALID_RESPONSE;
+        }
+
+        if (symbol < 256) {
+            put(s, (uint8_t)symbol);
+        } else if (symbol > 256) {
+            symbol -= 257;
+            if (symbol >= 29) {
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            uint32_t len = s_lbase[symbol] + bits(s, s_lext[symbol]);
+
+            symbol = decode(s, &s->distcode);
+            if (symbol < 0 || symbol >= MAXDCODES || s->err != ESP_OK) {
+                return s->err != ESP_OK ? s->err : ESP_ERR_INVALID_RESPONSE;
+            }
+            uint32_t dist = s_dbase[symbol] + bits(s, s_dext[symbol]);
+            /* 回溯距离不能超出窗口 (主机端窗口位数必须不大于设备端) */
+            if (dist > s->total_out || dist > s->wsize) {
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+
+            uint32_t from = (s->wpos - dist) & (s->wsize - 1);
+            while (len-- > 0) {
+                put(s, s->window[from]);
+                from = (from + 1) & (s->wsize - 1);
+            }
+        }
+        if (s->err != ESP_OK) {
+            return s->err;
+        }
+    } while (symbol != 256);
+
+    return ESP_OK;
+}
+
+static esp_err_t fixed(ota_inflate_t *s)
+{
+    int sym = 0;
+
+    for (; sym < 144; sym++) {
+        s->lengths[sym] = 8;
+    }
+    for (; sym < 256; sym++) {
+        s->lengths[sym] = 9;
+    }
+    for (; sym < 280; sym++) {
+        s->lengths[sym] = 7;
+    }
+    for (; sym < FIXLCODES; sym++) {
+        s->lengths[sym] = 8;
+    }
+    construct(&s->lencode, s->lengths, FIXLCODES);
+
+    for (sym = 0; sym < MAXDCODES; sym++) {
+        s->lengths[sym] = 5;
+    }
+    construct(&s->distcode, s->lengths, MAXDCODES);
+
+    return codes(s);
+}
+
+static esp_err_t dynamic(ota_inflate_t *s)
+{
+    int nlen = bits(s, 5) + 257;
+    int ndist = bits(s, 5) + 1;
+    int ncode = bits(s, 4) + 4;
+    int index;
+
+    if (s->err != ESP_OK || nlen > MAXLCODES || ndist > MAXDCODES) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    /* 码长码 */
+    for (index = 0; index < ncode; index++) {
+        s->lengths[s_clen_order[index]] = (uint16_t)bits(s, 3);
+    }
+    for (; index < 19; index++) {
+        s->lengths[s_clen_order[index]] = 0;
+    }
+    if (s->err != ESP_OK || construct(&s->lencode, s->lengths, 19) != 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    /* 字面量/长度和距离码长 */
+    index = 0;
+    while (index < nlen + ndist) {
+        int symbol = decode(s, &s->lencode);
+        if (symbol < 0 || s->err != ESP_OK) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (symbol < 16) {
+            s->lengths[index++] = (uint16_t)symbol;
+            continue;
+        }
+
+        uint16_t len = 0;
+        if (symbol == 16) {
+            if (index == 0) {
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            len = s->lengths[index - 1];
+            symbol = 3 + bits(s, 2);
+        } else if (symbol == 17) {
+            symbol = 3 + bits(s, 3);
+        } else {
+            symbol = 11 + bits(s, 7);
+        }
+        if (s->err != ESP_OK || index + symbol > nlen + ndist) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        while (symbol-- > 0) {
+            s->lengths[index++] = len;
+        }
+    }
+
+    if (s->lengths[256] == 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    /* 不完整码只允许单个码 */
+    int err = construct(&s->lencode, s->lengths, nlen);
+    if (err < 0 || (err > 0 && nlen - s->lencode.count[0] != 1)) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    err = construct(&s->distcode, s->lengths + nlen, ndist);
+    if (err < 0 || (err > 0 && ndist - s->distcode.count[0] != 1)) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    return codes(s);
+}
+
+ota_inflate_t *ota_inflate_create(int window_bits, ota_inflate_read_t read,
+                                  ota_inflate_write_t write, void *ctx)
+{
+    if (window_bits < OTA_INFLATE_WINDOW_BITS_MIN || window_bits > OTA_INFLATE_WINDOW_BITS_MAX ||
+        read == NULL || write == NULL) {
+        return NULL;
+    }
+
+    ota_inflate_t *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->wsize = 1UL << window_bits;
+    s->window = malloc(s->wsize);
+    if (s->window == NULL) {
+        free(s);
+        return NULL;
+    }
+
+    s->read = read;
+    s->write = write;
+    s->ctx = ctx;
+    s->lencode.symbol = s->lensym;
+    s->distcode.symbol = s->distsym;
+    return s;
+}
+
+esp_err_t ota_inflate_run(ota_inflate_t *s)
+{
+    int last;
+    esp_err_t ret;
+
+    do {
+        last = bits(s, 1);
+        int type = bits(s, 2);
+        if (s->err != ESP_OK) {
+            return s->err;
+        }
+
+        switch (type) {
+            case 0:
+                ret = stored(s);
+                break;
+            case 1:
+                ret = fixed(s);
+                break;
+            case 2:
+                ret = dynamic(s);
+                break;
+            default:
+                ret = ESP_ERR_INVALID_RESPONSE;
+                break;
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    } while (!last);
+
+    /* 输出窗口中剩余的数据 */
+    flush_window(s, s->wpos);
+    s->wpos = 0;
+    return s->err;
+}
+
+uint32_t ota_inflate_total_in(const ota_inflate_t *s)
+{
+    return s->total_in;
+}
+
+uint32_t ota_inflate_total_out(const ota_inflate_t *s)
+{
+    return s->total_out;
+}
+
+void ota_inflate_destroy(ota_inflate_t *s)
+{
+    if (s != NULL) {
+        free(s->window);
+        free(s);
+    }
+}
@@ -0,0 +1,652 @@
+/**
+ * @file ota_update.c
+ * @brief A/B 分区 OTA 升级实现
+ */
+
+#include "ota_update.h"
+#include "ota_inflate.h"
+#include "ota_delta.h"
+#include "app_rtos.h"
+#include "app_pm.h"
+#include "diag_cmd.h"
+#include "ha_mqtt.h"
+#include "journal.h"
+#include "wifi_manager.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/stream_buffer.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_ota_ops.h"
+#include "esp_http_client.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/pk.h"
+
+static const char *TAG = "ota";
+
+#if CONFIG_OTA_ENABLE
+
+#define OTA_URL_MAX             256
+#define OTA_RAW_BUF_SIZE        1024
+#define OTA_PROGRESS_STEP       10      /* 进度日志间隔 (%) */
+#define OTA_RESTART_DELAY_MS    1000
+#define OTA_CHUNK_HDR_LEN       4
+#define OTA_MQTT_SEND_TIMEOUT_MS 5000
+
+_Static_assert(sizeof(ota_image_header_t) == 128, "ota_image_header_t layout is part of the image format");
+
+typedef enum {
+    OTA_SOURCE_HTTP = 0,
+    OTA_SOURCE_MQTT,
+} ota_source_t;
+
+/**
+ * @brief 一次升级会话
+ */
+typedef struct {
+    ota_source_t source;
+    esp_http_client_handle_t http;
+    ota_image_header_t hdr;
+    ota_delta_t *delta;         /* 增量镜像时非 NULL */
+    uint32_t payload_read;      /* 已读取负载字节数 */
+    uint32_t written;           /* 已写入镜像字节数 */
+    uint32_t next_progress;
+    esp_ota_handle_t handle;
+    mbedtls_sha256_context sha;
+} ota_session_t;
+
+static char s_url[OTA_URL_MAX];
+static volatile bool s_busy = false;
+static portMUX_TYPE s_busy_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* 最近一次结果 */
+static esp_err_t s_last_result = ESP_OK;
+static uint32_t s_last_bytes = 0;
+static uint32_t s_last_image = 0;
+static uint32_t s_last_ms = 0;
+
+/* MQTT 分块传输 */
+static StreamBufferHandle_t s_mqtt_stream = NULL;
+static volatile bool s_mqtt_session = false;
+static uint32_t s_mqtt_expected = 0;
+static bool s_mqtt_accept = false;
+
+static esp_timer_handle_t s_confirm_timer = NULL;
+
+/* 构建时嵌入的签名公钥 (PEM，以 NUL 结尾)，见 CONFIG_OTA_SIGNING_KEY */
+extern const char ota_pubkey_pem_start[] asm("_binary_ota_pubkey_pem_start");
+
+static bool try_begin(void)
+{
+    bool ok = false;
+
+    portENTER_CRITICAL(&s_busy_lock);
+    if (!s_busy) {
+        s_busy = true;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_busy_lock);
+    return ok;
+}
+
+/**
+ * @brief 从传输层读取，0 表示结束或超时
+ */
+static int source_read(ota_session_t *s, uint8_t *buf, size_t len)
+{
+    if (s->source == OTA_SOURCE_HTTP) {
+        return esp_http_client_read(s->http, (char *)buf, (int)len);
+    }
+    return (int)xStreamBufferReceive(s_mqtt_stream, buf, len,
+                                     pdMS_TO_TICKS(CONFIG_OTA_MQTT_TIMEOUT_S * 1000));
+}
+
+static esp_err_t read_full(ota_session_t *s, void *buf, size_t len)
+{
+    size_t done = 0;
+
+    while (done < len) {
+        int n = source_read(s, (uint8_t *)buf + done, len - done);
+        if (n <= 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+        done += (size_t)n;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 负载读取，不超过镜像头声明的长度
+ */
+static int payload_read(void *ctx, uint8_t *buf, size_t len)
+{
+    ota_session_t *s = ctx;
+    uint32_t left = s->hdr.payload_size - s->payload_read;
+
+    if (left == 0) {
+        return 0;
+    }
+    if (len > left) {
+        len = left;
+    }
+    int n = source_read(s, buf, len);
+    if (n > 0) {
+        s->payload_read += (uint32_t)n;
+    }
+    return n;
+}
+
+/**
+ * @brief 解压输出: 计算摘要并顺序写入分区 (按需擦除)
+ */
+static esp_err_t image_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    ota_session_t *s = ctx;
+
+    if (s->written + len > s->hdr.image_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    mbedtls_sha256_update(&s->sha, buf, len);
+    esp_err_t ret = esp_ota_write(s->handle, buf, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    s->written += len;
+
+    uint32_t pct = (uint32_t)((uint64_t)s->written * 100 / s->hdr.image_size);
+    if (pct >= s->next_progress) {
+        ESP_LOGI(TAG, "Progress %lu%% (%lu/%lu)", (unsigned long)pct,
+                 (unsigned long)s->written, (unsigned long)s->hdr.image_size);
+        s->next_progress = pct + OTA_PROGRESS_STEP;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 负载输出: 增量镜像先经补丁应用，否则直接写入
+ */
+static esp_err_t payload_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    ota_session_t *s = ctx;
+
+    if (s->delta != NULL) {
+        return ota_delta_feed(s->delta, buf, len);
+    }
+    return image_write(s, buf, len);
+}
+
+static esp_err_t check_header(const ota_image_header_t *hdr, const esp_partition_t *part)
+{
+    if (hdr->magic != OTA_IMAGE_MAGIC || hdr->header_size != sizeof(*hdr)) {
+        ESP_LOGE(TAG, "Bad image header (magic 0x%08lx)", (unsigned long)hdr->magic);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (hdr->image_size == 0 || hdr->image_size > part->size) {
+        ESP_LOGE(TAG, "Image size %lu does not fit partition %s (%lu)",
+                 (unsigned long)hdr->image_size, part->label, (unsigned long)part->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if ((hdr->flags & OTA_FLAG_DEFLATE) &&
+        (hdr->window_bits < OTA_INFLATE_WINDOW_BITS_MIN || hdr->window_bits > CONFIG_OTA_WINDOW_BITS)) {
+        ESP_LOGE(TAG, "Window bits %d exceed limit %d", hdr->window_bits, CONFIG_OTA_WINDOW_BITS);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 用内置公钥校验镜像头签名
+ */
+static esp_err_t check_signature(const ota_image_header_t *hdr)
+{
+    if (hdr->sig_len == 0 || hdr->sig_len > sizeof(hdr->signature)) {
+        ESP_LOGE(TAG, "Image is not signed");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256((const uint8_t *)hdr, OTA_IMAGE_SIGNED_LEN, digest, 0);
+
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    int rc = mbedtls_pk_parse_public_key(&pk, (const unsigned char *)ota_pubkey_pem_start,
+                                         strlen(ota_pubkey_pem_start) + 1);
+    if (rc != 0 || !mbedtls_pk_can_do(&pk, MBEDTLS_PK_ECDSA)) {
+        ESP_LOGE(TAG, "Built-in signing key is not an EC public key (-0x%04x)", (unsigned)-rc);
+        mbedtls_pk_free(&pk);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    rc = mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, digest, sizeof(digest), hdr->signature, hdr->sig_len);
+    mbedtls_pk_free(&pk);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Image signature check failed (-0x%04x)", (unsigned)-rc);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t copy_raw(ota_session_t *s)
+{
+    uint8_t *buf = malloc(OTA_RAW_BUF_SIZE);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    while (ret == ESP_OK && s->payload_read < s->hdr.payload_size) {
+        int n = payload_read(s, buf, OTA_RAW_BUF_SIZE);
+        ret = (n > 0) ? payload_write(s, buf, (size_t)n) : ESP_ERR_TIMEOUT;
+    }
+    free(buf);
+    return ret;
+}
+
+/**
+ * @brief 读取镜像头、流式写入备用分区、校验并切换启动分区
+ */
+static esp_err_t run_update(ota_session_t *s)
+{
+    const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "No OTA partition available");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = read_full(s, &s->hdr, sizeof(s->hdr));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = check_header(&s->hdr, part);
+    if (ret == ESP_OK) {
+        ret = check_signature(&s->hdr);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Writing %s: image %lu bytes, payload %lu bytes%s%s",
+             part->label, (unsigned long)s->hdr.image_size, (unsigned long)s->hdr.payload_size,
+             (s->hdr.flags & OTA_FLAG_DEFLATE) ? " (deflate)" : "",
+             (s->hdr.flags & OTA_FLAG_DELTA) ? " (delta)" : "");
+
+    if (s->hdr.flags & OTA_FLAG_DELTA) {
+        /* 补丁以运行中的镜像为基准，补丁头到达时校验 */
+        s->delta = ota_delta_create(esp_ota_get_running_partition(), image_write, s);
+        if (s->delta == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    /* 顺序写入模式下边写边擦除，不在开始时整片擦除 */
+    ret = esp_ota_begin(part, OTA_WITH_SEQUENTIAL_WRITES, &s->handle);
+    if (ret != ESP_OK) {
+        ota_delta_destroy(s->delta);
+        s->delta = NULL;
+        return ret;
+    }
+    mbedtls_sha256_init(&s->sha);
+    mbedtls_sha256_starts(&s->sha, 0);
+
+    if (s->hdr.flags & OTA_FLAG_DEFLATE) {
+        ota_inflate_t *inf = ota_inflate_create(s->hdr.window_bits, payload_read, payload_write, s);
+        if (inf == NULL) {
+            ret = ESP_ERR_NO_MEM;
+        } else {
+            ret = ota_inflate_run(inf);
+            ota_inflate_destroy(inf);
+        }
+    } else {
+        ret = copy_raw(s);
+    }
+    if (s->delta != NULL) {
+        if (ret == ESP_OK) {
+            ret = ota_delta_finish(s->delta);
+        }
+        ota_delta_destroy(s->delta);
+        s->delta = NULL;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&s->sha, digest);
+    mbedtls_sha256_free(&s->sha);
+
+    if (ret == ESP_OK && s->written != s->hdr.image_size) {
+        ESP_LOGE(TAG, "Image truncated: %lu/%lu", (unsigned long)s->written,
+                 (unsigned long)s->hdr.image_size);
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    if (ret == ESP_OK && memcmp(digest, s->hdr.sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "SHA-256 mismatch");
+        ret = ESP_ERR_INVALID_CRC;
+    }
+    if (ret != ESP_OK) {
+        esp_ota_abort(s->handle);
+        return ret;
+    }
+
+    /* esp_ota_end 再校验 app 镜像格式和内置摘要 */
+    ret = esp_ota_end(s->handle);
+    if (ret == ESP_OK) {
+        ret = esp_ota_set_boot_partition(part);
+    }
+    return ret;
+}
+
+static esp_err_t http_open(ota_session_t *s)
+{
+    esp_http_client_config_t cfg = {
+        .url = s_url,
+        .timeout_ms = CONFIG_OTA_HTTP_TIMEOUT_MS,
+        .keep_alive_enable = true,
+    };
+
+    s->http = esp_http_client_init(&cfg);
+    if (s->http == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = esp_http_client_open(s->http, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (esp_http_client_fetch_headers(s->http) < 0) {
+        return ESP_FAIL;
+    }
+
+    int status = esp_http_client_get_status_code(s->http);
+    if (status != 200) {
+        ESP_LOGE(TAG, "HTTP status %d", status);
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+static void report_result(const ota_session_t *s, esp_err_t ret, int64_t start_us)
+{
+    char json[160];
+
+    s_last_result = ret;
+    s_last_bytes = sizeof(s->hdr) + s->payload_read;
+    s_last_image = s->written;
+    s_last_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+
+    uint32_t kbps = s_last_ms ? s_last_bytes / s_last_ms : 0;
+    ESP_LOGI(TAG, "%s: received %lu bytes for %lu byte image in %lu ms (%lu KB/s)",
+             esp_err_to_name(ret), (unsigned long)s_last_bytes, (unsigned long)s_last_image,
+             (unsigned long)s_last_ms, (unsigned long)kbps);
+
+    snprintf(json, sizeof(json),
+             "{\"result\":\"%s\",\"source\":\"%s\",\"delta\":%s,\"bytes\":%lu,\"image\":%lu,\"ms\":%lu}",
+             esp_err_to_name(ret), s->source == OTA_SOURCE_HTTP ? "http" : "mqtt",
+             (s->hdr.flags & OTA_FLAG_DELTA) ? "true" : "false",
+             (unsigned long)s_last_bytes, (unsigned long)s_last_image, (unsigned long)s_last_ms);
+    ha_mqtt_publish_telemetry("ota", json);
+}
+
+static void ota_task(void *pvParameters)
+{
+    ota_session_t *s = calloc(1, sizeof(*s));
+    ota_source_t source = (ota_source_t)(uintptr_t)pvParameters;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    app_pm_acquire(APP_PM_LOCK_OTA);
+    if (s != NULL) {
+        s->source = source;
+        ret = (source == OTA_SOURCE_HTTP) ? http_open(s) : ESP_OK;
+        if (ret == ESP_OK) {
+            ret = run_update(s);
+        }
+        if (s->http != NULL) {
+            esp_http_client_close(s->http);
+            esp_http_client_cleanup(s->http);
+        }
+        report_result(s, ret, start_us);
+        free(s);
+    }
+    app_pm_release(APP_PM_LOCK_OTA);
+
+    s_mqtt_session = false;
+    journal_log(JOURNAL_EVT_OTA, source == OTA_SOURCE_HTTP ? JOURNAL_SRC_SYS : JOURNAL_SRC_MQTT,
+                (uint32_t)ret);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Update complete, restarting");
+        journal_flush();
+        vTaskDelay(pdMS_TO_TICKS(OTA_RESTART_DELAY_MS));
+        esp_restart();
+    }
+
+    s_busy = false;
+    vTaskDelete(NULL);
+}
+
+static esp_err_t start_task(ota_source_t source)
+{
+    if (app_task_create(APP_TASK_OTA, ota_task, (void *)(uintptr_t)source, NULL) != pdPASS) {
+        s_mqtt_session = false;
+        s_busy = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_update_start_http(const char *url)
+{
+    if (url == NULL || strlen(url) >= sizeof(s_url)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!try_begin()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    strlcpy(s_url, url, sizeof(s_url));
+    ESP_LOGI(TAG, "HTTP update from %s", s_url);
+    return start_task(OTA_SOURCE_HTTP);
+}
+
+/**
+ * @brief MQTT ota/url: 整条消息为 URL
+ */
+static void mqtt_url_callback(const char *data, int len, int offset, int total)
+{
+    char url[OTA_URL_MAX];
+
+    if (offset != 0 || len != total || len <= 0 || len >= (int)sizeof(url)) {
+        ESP_LOGW(TAG, "Ignoring OTA URL message (%d bytes)", total);
+        return;
+    }
+    memcpy(url, data, len);
+    url[len] = '\0';
+
+    esp_err_t ret = ota_update_start_http(url);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "OTA not started: %s", esp_err_to_name(ret));
+    }
+}
+
+static esp_err_t mqtt_session_begin(void)
+{
+    if (!try_begin()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (s_mqtt_stream == NULL) {
+        /* 首次 MQTT 升级时创建，之后复用 */
+        s_mqtt_stream = xStreamBufferCreate(CONFIG_OTA_MQTT_BUFFER_SIZE, 1);
+        if (s_mqtt_stream == NULL) {
+            s_busy = false;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xStreamBufferReset(s_mqtt_stream);
+    s_mqtt_expected = 0;
+    s_mqtt_session = true;
+
+    ESP_LOGI(TAG, "MQTT update session started");
+    return start_task(OTA_SOURCE_MQTT);
+}
+
+/**
+ * @brief MQTT ota/chunk: 偏移(4) + 数据，按序写入流缓冲区并确认
+ *
+ * 在 MQTT 任务中执行；缓冲区满时阻塞等待解压任务消费，形成背压
+ */
+static void mqtt_chunk_callback(const char *data, int len, int offset, int total)
+{
+    int msg_len = len;
+
+    if (offset == 0) {
+        if (len < OTA_CHUNK_HDR_LEN) {
+            return;
+        }
+        uint32_t chunk_off = (uint32_t)(uint8_t)data[0] | ((uint32_t)(uint8_t)data[1] << 8) |
+                             ((uint32_t)(uint8_t)data[2] << 16) | ((uint32_t)(uint8_t)data[3] << 24);
+        data += OTA_CHUNK_HDR_LEN;
+        len -= OTA_CHUNK_HDR_LEN;
+
+        if (chunk_off == 0 && !s_mqtt_session) {
+            esp_err_t ret = mqtt_session_begin();
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "MQTT session not started: %s", esp_err_to_name(ret));
+            }
+        }
+        /* 重复或乱序的分块只回复期望偏移，由主机端重发 */
+        s_mqtt_accept = s_mqtt_session && chunk_off == s_mqtt_expected;
+    }
+
+    if (s_mqtt_accept && len > 0) {
+        size_t sent = xStreamBufferSend(s_mqtt_stream, data, (size_t)len,
+                                        pdMS_TO_TICKS(OTA_MQTT_SEND_TIMEOUT_MS));
+        s_mqtt_expected += (uint32_t)sent;
+        if (sent != (size_t)len) {
+            s_mqtt_accept = false;
+        }
+    }
+
+    if (offset + msg_len == total) {
+        char ack[16];
+        int n = snprintf(ack, sizeof(ack), "%lu", (unsigned long)(s_mqtt_session ? s_mqtt_expected : 0));
+        ha_mqtt_publish("ota/ack", ack, (size_t)n, 0);
+    }
+}
+
+static const char *img_state_name(esp_ota_img_states_t state)
+{
+    switch (state) {
+        case ESP_OTA_IMG_NEW:            return "new";
+        case ESP_OTA_IMG_PENDING_VERIFY: return "pending-verify";
+        case ESP_OTA_IMG_VALID:          return "valid";
+        case ESP_OTA_IMG_INVALID:        return "invalid";
+        case ESP_OTA_IMG_ABORTED:        return "aborted";
+        default:                         return "undefined";
+    }
+}
+
+/**
+ * @brief OTA 命令: 状态，或 "OTA HTTP <url>" 开始升级
+ */
+static esp_err_t cmd_ota(int argc, char **argv, const diag_out_t *out)
+{
+    if (argc >= 3 && strcasecmp(argv[1], "HTTP") == 0) {
+        if (!diag_cmd_check_local(out)) {
+            return ESP_ERR_NOT_ALLOWED;
+        }
+        esp_err_t ret = ota_update_start_http(argv[2]);
+        diag_printf(out, "ota http: %s\r\n", esp_err_to_name(ret));
+        return ret;
+    }
+
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *next = esp_ota_get_next_update_partition(NULL);
+    esp_ota_img_states_t state = ESP_OTA_IMG_UNDEFINED;
+    esp_app_desc_t desc;
+
+    esp_ota_get_state_partition(running, &state);
+    diag_printf(out, "running %s (%s), next %s\r\n", running ? running->label : "?",
+                img_state_name(state), next ? next->label : "none");
+    if (esp_ota_get_partition_description(running, &desc) == ESP_OK) {
+        diag_printf(out, "version %s built %s %s\r\n", desc.version, desc.date, desc.time);
+    }
+    diag_printf(out, "%s, last %s: %lu bytes -> %lu image, %lu ms\r\n",
+                s_busy ? "busy" : "idle", esp_err_to_name(s_last_result),
+                (unsigned long)s_last_bytes, (unsigned long)s_last_image, (unsigned long)s_last_ms);
+    return ESP_OK;
+}
+
+static void confirm_timer_callback(void *arg)
+{
+    /* 能重新连上网络才说明新镜像还能接收下一次升级 */
+    if (!wifi_manager_is_connected()) {
+        ESP_LOGW(TAG, "WiFi not connected, postponing image confirmation");
+        esp_timer_start_once(s_confirm_timer, (uint64_t)CONFIG_OTA_CONFIRM_DELAY_S * 1000000);
+        return;
+    }
+
+    esp_err_t ret = esp_ota_mark_app_valid_cancel_rollback();
+    ESP_LOGI(TAG, "Image marked valid: %s", esp_err_to_name(ret));
+}
+
+void ota_update_confirm_boot(bool healthy)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+
+    if (esp_ota_get_state_partition(running, &state) != ESP_OK ||
+        state != ESP_OTA_IMG_PENDING_VERIFY) {
+        return;
+    }
+
+    if (!healthy) {
+        ESP_LOGE(TAG, "Boot failed on new image, rolling back");
+        journal_flush();
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+        return;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = confirm_timer_callback,
+        .name = "ota_confirm",
+    };
+    if (esp_timer_create(&args, &s_confirm_timer) == ESP_OK) {
+        esp_timer_start_once(s_confirm_timer, (uint64_t)CONFIG_OTA_CONFIRM_DELAY_S * 1000000);
+        ESP_LOGI(TAG, "New image pending verification, confirming in %d s", CONFIG_OTA_CONFIRM_DELAY_S);
+    }
+}
+
+esp_err_t ota_update_init(void)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+
+    diag_cmd_register("OTA", "OTA status, OTA HTTP <url> starts an update", cmd_ota, DIAG_ACCESS_REMOTE);
+    ha_mqtt_subscribe("ota/url", 1, mqtt_url_callback);
+    ha_mqtt_subscribe("ota/chunk", 1, mqtt_chunk_callback);
+
+    ESP_LOGI(TAG, "Running from %s", running ? running->label : "?");
+    return ESP_OK;
+}
+
+#else /* !CONFIG_OTA_ENABLE */
+
+esp_err_t ota_update_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t ota_update_start_http(const char *url)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void ota_update_confirm_boot(bool healthy)
+{
+}
+
+#endif /* CONFIG_OTA_ENABLE */
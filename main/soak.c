@@ -0,0 +1,557 @@
+/**
+ * @file soak.c
+ * @brief 浸泡测试实现
+ */
+
+#include "soak.h"
+
+#if CONFIG_SOAK_ENABLE
+
+#include "diag_cmd.h"
+#include "ha_mqtt.h"
+#include "msg_queue.h"
+#include "pwm_task.h"
+#include "board.h"
+#include "app_rtos.h"
+#include "supervisor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include <malloc.h>
+#else
+#include "esp_heap_caps.h"
+#endif
+
+static const char *TAG = "soak";
+
+#define SOAK_MAX_ACTIONS        10
+#define SOAK_HISTORY            8
+#define SOAK_JSON_SIZE          256
+#define SOAK_POLL_MS            10
+#define SOAK_DOOR_TIMEOUT_MS    10000
+#define SOAK_MQTT_TIMEOUT_MS    30000
+#define SOAK_EPOCH_ITERATIONS   CONFIG_SOAK_EPOCH_ITERATIONS
+
+typedef struct {
+    const char *name;
+    soak_action_fn_t fn;
+    uint8_t weight;
+    uint32_t runs;
+    uint32_t fails;
+} soak_action_t;
+
+static soak_action_t s_actions[SOAK_MAX_ACTIONS];
+static uint8_t s_action_count = 0;
+static uint32_t s_weight_total = 0;
+
+static volatile bool s_running = false;
+static volatile bool s_stop = false;
+static uint32_t s_target = 0;
+static volatile uint32_t s_count = 0;
+static soak_done_cb_t s_done = NULL;
+static uint32_t s_rand = CONFIG_SOAK_SEED;
+
+/* 当前轮的延迟样本，轮末排序取分位数 */
+static uint16_t s_latency[SOAK_EPOCH_ITERATIONS];
+static uint32_t s_latency_count = 0;
+
+static soak_epoch_t s_history[SOAK_HISTORY];
+static uint32_t s_epoch_count = 0;
+static soak_epoch_t s_base;
+static bool s_base_valid = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* xorshift32，只在浸泡任务中调用 */
+static uint32_t next_random(void)
+{
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return s_rand;
+}
+
+/**
+ * @brief 等待门到达指定状态 (舵机到位后 pwm_task 才更新状态)
+ *
+ * @param elapsed_ms 输出等待时间，可为 NULL
+ * @return true 到达, false 超时
+ */
+static bool wait_door(bool open, uint32_t timeout_ms, uint32_t *elapsed_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    uint32_t ms = 0;
+
+    while (pwm_task_door_is_open() != open) {
+        ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+        if (ms >= timeout_ms) {
+            return false;
+        }
+        supervisor_heartbeat(APP_TASK_SOAK);
+        vTaskDelay(pdMS_TO_TICKS(SOAK_POLL_MS));
+    }
+    if (elapsed_ms != NULL) {
+        *elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+    }
+    return true;
+}
+
+/**
+ * @brief 一次开关门: 等待关门状态，发出开门命令并测量到位延迟，再等待关门
+ *
+ * @param close_with_mqtt 开门后发送 MQTT OFF，否则等待自动关门
+ */
+static esp_err_t door_cycle(bool (*open_cmd)(void), bool close_with_mqtt)
+{
+    uint32_t ms;
+
+    if (!wait_door(false, SOAK_DOOR_TIMEOUT_MS, NULL)) {
+        ESP_LOGW(TAG, "Door did not close before command");
+        return ESP_ERR_TIMEOUT;
+    }
+    if (!open_cmd()) {
+        return ESP_FAIL;
+    }
+    if (!wait_door(true, SOAK_DOOR_TIMEOUT_MS, &ms)) {
+        ESP_LOGW(TAG, "Open command lost");
+        return ESP_ERR_TIMEOUT;
+    }
+    if (s_latency_count < SOAK_EPOCH_ITERATIONS) {
+        s_latency[s_latency_count++] = ms > UINT16_MAX ? UINT16_MAX : (uint16_t)ms;
+    }
+
+    if (close_with_mqtt && !msg_send_mqtt_door_cmd(MQTT_CMD_DOOR_OFF)) {
+        return ESP_FAIL;
+    }
+    if (!wait_door(false, OPEN_TIME + SOAK_DOOR_TIMEOUT_MS, NULL)) {
+        ESP_LOGW(TAG, "Close lost");
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+static bool send_key_click(void)
+{
+    return msg_send_key_event(QUEUE_PWM, KEY_GPIO, KEY_EVENT_SINGLE_CLICK);
+}
+
+static bool send_mqtt_on(void)
+{
+    return msg_send_mqtt_door_cmd(MQTT_CMD_DOOR_ON);
+}
+
+static esp_err_t action_key(void)
+{
+    return door_cycle(send_key_click, false);
+}
+
+static esp_err_t action_ble(void)
+{
+    return door_cycle(msg_send_pwm_open_door, false);
+}
+
+static esp_err_t action_mqtt(void)
+{
+    return door_cycle(send_mqtt_on, true);
+}
+
+static void discard_output(const char *text, size_t len, void *ctx)
+{
+}
+
+static esp_err_t action_diag(void)
+{
+    static const diag_out_t out = { .fn = discard_output, .ctx = NULL };
+
+    return diag_cmd_execute("HELP", &out);
+}
+
+/* 重建 MQTT 会话: 停止客户端再启动，等待重新连接并订阅 */
+static esp_err_t action_reconnect(void)
+{
+    if (!ha_mqtt_is_connected()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    esp_err_t ret = ha_mqtt_stop();
+    if (ret == ESP_OK) {
+        ret = ha_mqtt_start();
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (!ha_mqtt_is_connected()) {
+        if (pdTICKS_TO_MS(xTaskGetTickCount() - start) >= SOAK_MQTT_TIMEOUT_MS) {
+            ESP_LOGW(TAG, "MQTT did not reconnect");
+            return ESP_ERR_TIMEOUT;
+        }
+        supervisor_heartbeat(APP_TASK_SOAK);
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return ESP_OK;
+}
+
+esp_err_t soak_register_action(const char *name, soak_action_fn_t fn, uint8_t weight)
+{
+    if (name == NULL || fn == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_action_count >= SOAK_MAX_ACTIONS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_actions[s_action_count++] = (soak_action_t){ .name = name, .fn = fn, .weight = weight };
+    s_weight_total += weight;
+    return ESP_OK;
+}
+
+static soak_action_t *pick_action(void)
+{
+    uint32_t r = next_random() % s_weight_total;
+
+    for (uint8_t i = 0; i < s_action_count; i++) {
+        if (r < s_actions[i].weight) {
+            return &s_actions[i];
+        }
+        r -= s_actions[i].weight;
+    }
+    return &s_actions[0];
+}
+
+/**
+ * @brief 每次迭代后采样堆: 占用取下限 (瞬时分配不影响)，空闲取最低，碎片取最高
+ *
+ * linux 目标没有 heap_caps 统计，占用取 glibc mallinfo2，空闲和碎片记为 0。
+ */
+static void sample_heap(soak_epoch_t *e)
+{
+    uint32_t used;
+    uint32_t free_bytes = 0;
+    uint16_t frag_pm = 0;
+
+#if CONFIG_IDF_TARGET_LINUX
+    struct mallinfo2 mi = mallinfo2();
+    used = (uint32_t)mi.uordblks;
+#else
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    used = info.total_allocated_bytes;
+    free_bytes = info.total_free_bytes;
+    frag_pm = free_bytes ? (uint16_t)(1000 - (uint64_t)info.largest_free_block * 1000 / free_bytes) : 0;
+#endif
+
+    if (e->iterations == 1 || used < e->heap_used) {
+        e->heap_used = used;
+    }
+    if (e->iterations == 1 || free_bytes < e->free_min) {
+        e->free_min = free_bytes;
+    }
+    if (frag_pm > e->frag_pm) {
+        e->frag_pm = frag_pm;
+    }
+}
+
+static int cmp_u16(const void *a, const void *b)
+{
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+static uint16_t percentile(uint32_t pct)
+{
+    if (s_latency_count == 0) {
+        return 0;
+    }
+    return s_latency[(s_latency_count - 1) * pct / 100];
+}
+
+/**
+ * @brief 与基线比较
+ *
+ * @return NULL 无漂移, 否则为失败原因
+ */
+static const char *check_drift(const soak_epoch_t *e)
+{
+    if (e->failures > 0) {
+        return "failed actions";
+    }
+    if (!s_base_valid) {
+        return NULL;
+    }
+    if (e->heap_used > s_base.heap_used + CONFIG_SOAK_MAX_HEAP_GROWTH) {
+        return "heap growth";
+    }
+    if (e->tasks > s_base.tasks) {
+        return "task count";
+    }
+    if (s_base.samples > 0 && e->samples > 0 &&
+        (uint32_t)e->p99_ms * 100 > (uint32_t)s_base.p99_ms * (100 + CONFIG_SOAK_MAX_LATENCY_DRIFT_PCT)) {
+        return "latency drift";
+    }
+    if (e->frag_pm > s_base.frag_pm + CONFIG_SOAK_MAX_FRAG_DRIFT_PM) {
+        return "fragmentation";
+    }
+    return NULL;
+}
+
+static void publish_epoch(const soak_epoch_t *e, const char *result)
+{
+    char json[SOAK_JSON_SIZE];
+
+    if (!ha_mqtt_is_connected()) {
+        return;
+    }
+    int n = snprintf(json, sizeof(json),
+                     "{\"epoch\":%lu,\"iter\":%lu,\"fail\":%lu,\"p50\":%u,\"p99\":%u,\"max\":%u,"
+                     "\"heap\":%lu,\"free_min\":%lu,\"frag\":%u,\"tasks\":%u,\"result\":\"%s\"}",
+                     (unsigned long)e->epoch, (unsigned long)e->iterations,
+                     (unsigned long)e->failures, e->p50_ms, e->p99_ms, e->max_ms,
+                     (unsigned long)e->heap_used, (unsigned long)e->free_min, e->frag_pm,
+                     e->tasks, result);
+    if (n > 0 && (size_t)n < sizeof(json)) {
+        ha_mqtt_publish_telemetry("soak", json);
+    }
+}
+
+/**
+ * @brief 结束一轮: 计算分位数，记录历史，预热后首轮定为基线，其后检查漂移
+ *
+ * @return true 通过, false 出现漂移或失败
+ */
+static bool finish_epoch(soak_epoch_t *e)
+{
+    qsort(s_latency, s_latency_count, sizeof(s_latency[0]), cmp_u16);
+    e->samples = s_latency_count;
+    e->p50_ms = percentile(50);
+    e->p99_ms = percentile(99);
+    e->max_ms = s_latency_count ? s_latency[s_latency_count - 1] : 0;
+    e->tasks = (uint16_t)uxTaskGetNumberOfTasks();
+    s_latency_count = 0;
+
+    const char *reason = check_drift(e);
+    const char *result = reason ? reason : "ok";
+    if (reason == NULL && !s_base_valid) {
+        if (e->epoch < CONFIG_SOAK_WARMUP_EPOCHS) {
+            result = "warmup";
+        } else {
+            s_base = *e;
+            s_base_valid = true;
+            result = "baseline";
+        }
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_history[s_epoch_count++ % SOAK_HISTORY] = *e;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Epoch %lu: %lu iter, %lu fail, p50 %u p99 %u max %u ms, heap %lu, "
+             "free min %lu, frag %u, tasks %u: %s",
+             (unsigned long)e->epoch, (unsigned long)e->iterations, (unsigned long)e->failures,
+             e->p50_ms, e->p99_ms, e->max_ms, (unsigned long)e->heap_used,
+             (unsigned long)e->free_min, e->frag_pm, e->tasks, result);
+    publish_epoch(e, result);
+
+    if (reason != NULL) {
+        ESP_LOGE(TAG, "Soak failed in epoch %lu: %s", (unsigned long)e->epoch, reason);
+    }
+    return reason == NULL;
+}
+
+static void soak_task(void *pvParameters)
+{
+    soak_epoch_t cur = { 0 };
+    bool passed = true;
+
+    /* 最长的阻塞是等待 MQTT/Wi-Fi 重连 */
+    supervisor_register(APP_TASK_SOAK, SUPERVISOR_BACKGROUND_HEARTBEAT_MS(SOAK_MQTT_TIMEOUT_MS), 0, NULL);
+
+    while (!s_stop && (s_target == 0 || s_count < s_target)) {
+        supervisor_heartbeat(APP_TASK_SOAK);
+
+        soak_action_t *a = pick_action();
+        esp_err_t ret = a->fn();
+        if (ret == ESP_ERR_NOT_SUPPORTED) {
+            continue;
+        }
+
+        a->runs++;
+        cur.iterations++;
+        s_count++;
+        if (ret != ESP_OK) {
+            a->fails++;
+            cur.failures++;
+            ESP_LOGW(TAG, "Action %s failed: %s", a->name, esp_err_to_name(ret));
+        }
+        sample_heap(&cur);
+
+        if (cur.iterations >= SOAK_EPOCH_ITERATIONS) {
+            if (!finish_epoch(&cur)) {
+                passed = false;
+                break;
+            }
+            cur = (soak_epoch_t){ .epoch = cur.epoch + 1 };
+        }
+    }
+
+    ESP_LOGI(TAG, "Soak %s after %lu iterations", passed ? "passed" : "FAILED", (unsigned long)s_count);
+
+    /* 任务退出，撤销心跳检查 */
+    supervisor_register(APP_TASK_SOAK, 0, 0, NULL);
+    s_running = false;
+    if (s_done != NULL) {
+        s_done(passed);
+    }
+    vTaskDelete(NULL);
+}
+
+esp_err_t soak_start(uint32_t iterations, soak_done_cb_t done)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool busy = s_running;
+    s_running = true;
+    portEXIT_CRITICAL(&s_lock);
+    if (busy || s_weight_total == 0) {
+        if (!busy) {
+            s_running = false;
+        }
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_target = iterations;
+    s_count = 0;
+    s_stop = false;
+    s_done = done;
+    s_latency_count = 0;
+    s_epoch_count = 0;
+    s_base_valid = false;
+    for (uint8_t i = 0; i < s_action_count; i++) {
+        s_actions[i].runs = 0;
+        s_actions[i].fails = 0;
+    }
+
+    if (app_task_create(APP_TASK_SOAK, soak_task, NULL, NULL) != pdPASS) {
+        s_running = false;
+        ESP_LOGE(TAG, "Failed to create soak task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGW(TAG, "Soak started: %lu iterations, %d per epoch", (unsigned long)iterations,
+             SOAK_EPOCH_ITERATIONS);
+    return ESP_OK;
+}
+
+void soak_stop(void)
+{
+    s_stop = true;
+}
+
+esp_err_t soak_get_last_epoch(soak_epoch_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool valid = s_epoch_count > 0;
+    if (valid) {
+        *out = s_history[(s_epoch_count - 1) % SOAK_HISTORY];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+/**
+ * @brief SOAK 命令:
+ *   SOAK              进度、各动作执行/失败次数和最近几轮统计
+ *   SOAK START [n]    启动，n 为迭代次数 (默认一直运行)
+ *   SOAK STOP         当前动作完成后停止
+ */
+static esp_err_t cmd_soak(int argc, char **argv, const diag_out_t *out)
+{
+    /* START 会循环开关门，STOP 同样只接受串口 */
+    if (argc >= 2 && (strcasecmp(argv[1], "START") == 0 || strcasecmp(argv[1], "STOP") == 0) &&
+        !diag_cmd_check_local(out)) {
+        return ESP_ERR_NOT_ALLOWED;
+    }
+    if (argc >= 2 && strcasecmp(argv[1], "START") == 0) {
+        uint32_t n = argc >= 3 ? strtoul(argv[2], NULL, 10) : 0;
+        esp_err_t ret = soak_start(n, NULL);
+        diag_printf(out, "%s\r\n", ret == ESP_OK ? "OK" : esp_err_to_name(ret));
+        return ret;
+    }
+    if (argc >= 2 && strcasecmp(argv[1], "STOP") == 0) {
+        soak_stop();
+        diag_printf(out, "OK\r\n");
+        return ESP_OK;
+    }
+
+    diag_printf(out, "%s, %lu/%lu iterations\r\n", s_running ? "running" : "idle",
+                (unsigned long)s_count, (unsigned long)s_target);
+    for (uint8_t i = 0; i < s_action_count; i++) {
+        diag_printf(out, "  %-10s w%-3u %8lu runs %5lu fails\r\n", s_actions[i].name,
+                    s_actions[i].weight, (unsigned long)s_actions[i].runs,
+                    (unsigned long)s_actions[i].fails);
+    }
+
+    uint32_t count = s_epoch_count;
+    uint32_t first = count > SOAK_HISTORY ? count - SOAK_HISTORY : 0;
+    diag_printf(out, "%5s %5s %4s %5s %5s %5s %8s %8s %5s %5s\r\n", "epoch", "iter", "fail",
+                "p50", "p99", "max", "heap", "free_min", "frag", "tasks");
+    for (uint32_t i = first; i < count; i++) {
+        const soak_epoch_t *e = &s_history[i % SOAK_HISTORY];
+        diag_printf(out, "%5lu %5lu %4lu %5u %5u %5u %8lu %8lu %5u %5u%s\r\n",
+                    (unsigned long)e->epoch, (unsigned long)e->iterations,
+                    (unsigned long)e->failures, e->p50_ms, e->p99_ms, e->max_ms,
+                    (unsigned long)e->heap_used, (unsigned long)e->free_min, e->frag_pm, e->tasks,
+                    (s_base_valid && e->epoch == s_base.epoch) ? " *" : "");
+    }
+    return ESP_OK;
+}
+
+esp_err_t soak_init(void)
+{
+    soak_register_action("key", action_key, 4);
+    soak_register_action("ble", action_ble, 3);
+    soak_register_action("mqtt", action_mqtt, 3);
+    soak_register_action("diag", action_diag, 2);
+    soak_register_action("reconnect", action_reconnect, 1);
+
+    diag_cmd_register("SOAK", "soak test: SOAK [START [n]|STOP]", cmd_soak, DIAG_ACCESS_REMOTE);
+    ESP_LOGW(TAG, "Soak test compiled in, door will cycle while it runs");
+    return ESP_OK;
+}
+
+#else /* !CONFIG_SOAK_ENABLE */
+
+esp_err_t soak_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t soak_register_action(const char *name, soak_action_fn_t fn, uint8_t weight)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t soak_start(uint32_t iterations, soak_done_cb_t done)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void soak_stop(void)
+{
+}
+
+esp_err_t soak_get_last_epoch(soak_epoch_t *out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_SOAK_ENABLE */
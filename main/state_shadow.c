@@ -0,0 +1,221 @@
+/**
+ * @file state_shadow.c
+ * @brief 设备状态影子实现
+ */
+
+#include "state_shadow.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "shadow";
+
+#define SHADOW_MSG_SIZE         160     /* 状态/事件消息 */
+#define SHADOW_TELEMETRY_MAX    8       /* 去重的遥测名称数 */
+#define SHADOW_NAME_LEN         16
+#define SHADOW_TELEMETRY_HDR    64      /* 遥测消息外层字段 */
+
+typedef struct {
+    char name[SHADOW_NAME_LEN];
+    uint32_t hash;                      /* 上次内容的 FNV-1a */
+} telemetry_slot_t;
+
+static SemaphoreHandle_t s_lock = NULL;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t s_lock_buf;
+#endif
+static state_shadow_listener_t s_listeners[STATE_SHADOW_LISTENER_MAX];
+static size_t s_listener_count = 0;
+
+static uint32_t s_seq = 0;
+static bool s_door_open = false;
+static bool s_wifi = false;
+static bool s_mqtt = false;
+static telemetry_slot_t s_telemetry[SHADOW_TELEMETRY_MAX];
+
+static uint32_t fnv1a(const char *s)
+{
+    uint32_t h = 2166136261u;
+
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief 持锁后分配序号；初始化之前的更新只记录状态，不通知
+ */
+static bool lock(void)
+{
+    if (s_lock == NULL) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    return true;
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_lock);
+}
+
+static void notify(state_shadow_kind_t kind, const char *json, int len)
+{
+    if (len <= 0) {
+        return;
+    }
+    for (size_t i = 0; i < s_listener_count; i++) {
+        s_listeners[i](kind, json, (size_t)len);
+    }
+}
+
+static int encode_state(char *buf, size_t len, uint32_t seq)
+{
+    int n = snprintf(buf, len,
+                     "{\"type\":\"state\",\"seq\":%lu,\"door\":\"%s\",\"wifi\":%s,\"mqtt\":%s,\"uptime\":%lu}",
+                     (unsigned long)seq, s_door_open ? "open" : "closed",
+                     s_wifi ? "true" : "false", s_mqtt ? "true" : "false",
+                     (unsigned long)(esp_timer_get_time() / 1000000));
+    return (n > 0 && (size_t)n < len) ? n : 0;
+}
+
+/**
+ * @brief 状态字段已更新 (持锁)，有变化时推送完整状态
+ */
+static void publish_state(bool changed)
+{
+    char json[SHADOW_MSG_SIZE];
+
+    if (changed) {
+        notify(STATE_SHADOW_STATE, json, encode_state(json, sizeof(json), ++s_seq));
+    }
+}
+
+esp_err_t state_shadow_init(void)
+{
+    if (s_lock != NULL) {
+        return ESP_OK;
+    }
+#if CONFIG_APP_STATIC_ALLOCATION
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+#else
+    s_lock = xSemaphoreCreateMutex();
+#endif
+    return s_lock ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t state_shadow_add_listener(state_shadow_listener_t fn)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    if (fn == NULL || !lock()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_listener_count < STATE_SHADOW_LISTENER_MAX) {
+        s_listeners[s_listener_count++] = fn;
+        ret = ESP_OK;
+    }
+    unlock();
+    return ret;
+}
+
+void state_shadow_set_door(bool open)
+{
+    bool changed = (s_door_open != open);
+
+    s_door_open = open;
+    if (lock()) {
+        publish_state(changed);
+        unlock();
+    }
+}
+
+void state_shadow_set_wifi(bool connected)
+{
+    bool changed = (s_wifi != connected);
+
+    s_wifi = connected;
+    if (lock()) {
+        publish_state(changed);
+        unlock();
+    }
+}
+
+void state_shadow_set_mqtt(bool connected)
+{
+    bool changed = (s_mqtt != connected);
+
+    s_mqtt = connected;
+    if (lock()) {
+        publish_state(changed);
+        unlock();
+    }
+}
+
+void state_shadow_telemetry(const char *name, const char *json)
+{
+    if (name == NULL || json == NULL || !lock()) {
+        return;
+    }
+
+    /* 与上次内容相同的遥测不推送；名称表满时不去重 */
+    uint32_t hash = fnv1a(json);
+    telemetry_slot_t *slot = NULL;
+    for (size_t i = 0; i < SHADOW_TELEMETRY_MAX; i++) {
+        if (s_telemetry[i].name[0] == '\0' || strcmp(s_telemetry[i].name, name) == 0) {
+            slot = &s_telemetry[i];
+            break;
+        }
+    }
+    if (slot != NULL && slot->name[0] != '\0' && slot->hash == hash) {
+        unlock();
+        return;
+    }
+    if (slot != NULL) {
+        strlcpy(slot->name, name, sizeof(slot->name));
+        slot->hash = hash;
+    }
+
+    size_t size = strlen(json) + strlen(name) + SHADOW_TELEMETRY_HDR;
+    char *msg = malloc(size);
+    if (msg != NULL) {
+        int n = snprintf(msg, size, "{\"type\":\"telemetry\",\"seq\":%lu,\"name\":\"%s\",\"data\":%s}",
+                         (unsigned long)++s_seq, name, json);
+        notify(STATE_SHADOW_TELEMETRY, msg, (n > 0 && (size_t)n < size) ? n : 0);
+        free(msg);
+    } else {
+        ESP_LOGW(TAG, "No memory for telemetry %s", name);
+    }
+    unlock();
+}
+
+void state_shadow_event(journal_evt_t evt, journal_src_t src, uint32_t arg)
+{
+    char json[SHADOW_MSG_SIZE];
+
+    if (!lock()) {
+        return;
+    }
+    int n = snprintf(json, sizeof(json),
+                     "{\"type\":\"event\",\"seq\":%lu,\"event\":\"%s\",\"source\":\"%s\",\"arg\":%lu}",
+                     (unsigned long)++s_seq, journal_evt_name(evt), journal_src_name(src),
+                     (unsigned long)arg);
+    notify(STATE_SHADOW_EVENT, json, (n > 0 && (size_t)n < sizeof(json)) ? n : 0);
+    unlock();
+}
+
+size_t state_shadow_snapshot(char *buf, size_t len)
+{
+    if (!lock()) {
+        return 0;
+    }
+    size_t n = (size_t)encode_state(buf, len, s_seq);
+    unlock();
+    return n;
+}
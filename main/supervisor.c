@@ -0,0 +1,478 @@
+/**
+ * @file supervisor.c
+ * @brief 任务监督实现
+ */
+
+#include "supervisor.h"
+#include "timer_wheel.h"
+#include "trace.h"
+#include "journal.h"
+#include "diag_cmd.h"
+#include "ha_mqtt.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#if CONFIG_ESP_TASK_WDT_EN
+#include "esp_task_wdt.h"
+#endif
+
+static const char *TAG = "supervisor";
+
+#if CONFIG_SUPERVISOR_ENABLE
+
+#define SUP_NOTIFY_CHECK        (1UL << 0)
+#define SUP_NOTIFY_REPORT       (1UL << 0)
+#define SUP_HISTORY_LEN         4
+/* 请求协作重启后等待任务回到安全点的时间，超时升级为重启设备 */
+#define SUP_PARK_TIMEOUT_MS     10000
+#define SUP_TRACE_RECORDS       CONFIG_SUPERVISOR_TRACE_RECORDS
+#define SUP_JSON_SIZE           (256 + SUP_TRACE_RECORDS * 64)
+/* 重启前留给 MQTT 发送违规报告的时间 */
+#define SUP_REBOOT_DELAY_MS     1000
+
+typedef enum {
+    SUP_ACTION_REPORT = 0,
+    SUP_ACTION_RESTART,
+    SUP_ACTION_REBOOT,
+} sup_action_t;
+
+/*
+ * 每个任务一个槽位。last_beat/busy_since/busy 只由被监督任务写入、监督任务读取，
+ * 均为单字写入；busy 在 busy_since 之后写入，监督任务看到 busy 时 busy_since 已有效。
+ * restart_pending 由监督任务置位，被监督任务在安全点 (循环顶部) 看到后置 parked 并挂起自己。
+ */
+typedef struct {
+    volatile bool registered;
+    volatile bool busy;
+    volatile bool restart_pending;
+    volatile bool parked;
+    volatile TickType_t last_beat;
+    volatile TickType_t busy_since;
+    TickType_t restart_since;
+    uint32_t heartbeat_ms;
+    uint32_t max_latency_ms;
+    supervisor_restart_fn_t restart;
+    bool violated;          /* 当前违规已处理，恢复正常前不重复上报 */
+    uint32_t violations;
+    uint32_t restarts;
+} sup_slot_t;
+
+typedef struct {
+    uint32_t uptime_ms;
+    uint8_t task;           /* app_task_id_t */
+    uint8_t kind;           /* supervisor_kind_t */
+    uint8_t state;          /* eTaskState */
+    uint8_t action;         /* sup_action_t */
+    uint32_t elapsed_ms;
+    uint32_t limit_ms;
+    uint32_t trace_count;
+    trace_record_t trace[SUP_TRACE_RECORDS];
+} sup_violation_t;
+
+static sup_slot_t s_slots[APP_TASK_MAX];
+static sup_violation_t s_history[SUP_HISTORY_LEN];
+static uint32_t s_history_count = 0;
+static uint32_t s_reported = 0;     /* 已由上报任务处理的违规数 */
+static TaskHandle_t s_task = NULL;
+static TaskHandle_t s_report_task = NULL;
+static portMUX_TYPE s_history_lock = portMUX_INITIALIZER_UNLOCKED;
+static wheel_timer_t s_check_timer;
+
+static const char *const s_kind_names[] = { "latency", "heartbeat" };
+static const char *const s_action_names[] = { "report", "restart", "reboot" };
+
+static const char *state_name(uint8_t state)
+{
+    switch (state) {
+        case eRunning:   return "running";
+        case eReady:     return "ready";
+        case eBlocked:   return "blocked";
+        case eSuspended: return "suspended";
+        case eDeleted:   return "deleted";
+        default:         return "invalid";
+    }
+}
+
+void supervisor_register(app_task_id_t id, uint32_t heartbeat_ms, uint32_t max_latency_ms,
+                         supervisor_restart_fn_t restart)
+{
+    if (id >= APP_TASK_MAX) {
+        return;
+    }
+
+    sup_slot_t *s = &s_slots[id];
+    s->registered = false;
+    s->heartbeat_ms = heartbeat_ms;
+    s->max_latency_ms = max_latency_ms;
+    s->restart = restart;
+    s->busy = false;
+    s->restart_pending = false;
+    s->parked = false;
+    s->last_beat = xTaskGetTickCount();
+    s->violated = false;
+    s->registered = true;
+}
+
+void supervisor_loop_begin(app_task_id_t id)
+{
+    if (id < APP_TASK_MAX) {
+        TickType_t now = xTaskGetTickCount();
+        s_slots[id].last_beat = now;
+        s_slots[id].busy_since = now;
+        s_slots[id].busy = true;
+    }
+}
+
+/**
+ * @brief 安全点检查: 有重启请求时挂起调用任务，由监督任务删除并重建
+ *
+ * 只在循环顶部调用，此时任务不持有任何互斥锁或 PM 锁，删除不会留下被占用的资源。
+ */
+static void park_if_requested(app_task_id_t id)
+{
+    sup_slot_t *s = &s_slots[id];
+
+    if (s->restart_pending && s_task != NULL) {
+        s->parked = true;
+        xTaskNotify(s_task, SUP_NOTIFY_CHECK, eSetBits);
+        vTaskSuspend(NULL);
+    }
+}
+
+void supervisor_loop_end(app_task_id_t id)
+{
+    if (id < APP_TASK_MAX) {
+        s_slots[id].busy = false;
+        s_slots[id].last_beat = xTaskGetTickCount();
+        park_if_requested(id);
+    }
+}
+
+void supervisor_heartbeat(app_task_id_t id)
+{
+    if (id < APP_TASK_MAX) {
+        s_slots[id].last_beat = xTaskGetTickCount();
+        park_if_requested(id);
+    }
+}
+
+static sup_action_t choose_action(const sup_slot_t *s)
+{
+#if CONFIG_SUPERVISOR_RECOVERY_REPORT
+    return SUP_ACTION_REPORT;
+#elif CONFIG_SUPERVISOR_RECOVERY_RESTART
+    /* 没有重启函数或反复卡住的子系统升级为重启设备 */
+    if (s->restart == NULL || s->restarts >= CONFIG_SUPERVISOR_MAX_RESTARTS) {
+        return SUP_ACTION_REBOOT;
+    }
+    return SUP_ACTION_RESTART;
+#else
+    return SUP_ACTION_REBOOT;
+#endif
+}
+
+/**
+ * @brief 违规报告序列化为 JSON
+ *
+ * 格式: {"task":..,"kind":..,"elapsed":ms,"limit":ms,"state":..,"action":..,
+ *        "trace":[[ts_us,src,evt,a16,a0,a1],...]}
+ */
+static int violation_to_json(const sup_violation_t *v, char *buf, size_t len)
+{
+    size_t pos = 0;
+    int n;
+
+#define APPEND(...) do { \
+        n = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n < 0 || (size_t)n >= len - pos) return -1; \
+        pos += n; \
+    } while (0)
+
+    APPEND("{\"task\":\"%s\",\"kind\":\"%s\",\"elapsed\":%lu,\"limit\":%lu,"
+           "\"state\":\"%s\",\"action\":\"%s\",\"trace\":[",
+           app_task_name((app_task_id_t)v->task), s_kind_names[v->kind],
+           (unsigned long)v->elapsed_ms, (unsigned long)v->limit_ms,
+           state_name(v->state), s_action_names[v->action]);
+    for (uint32_t i = 0; i < v->trace_count; i++) {
+        const trace_record_t *r = &v->trace[i];
+        APPEND("%s[%lu,%u,%u,%u,%lu,%lu]", i ? "," : "", (unsigned long)r->ts_us,
+               r->src, r->evt, r->a16, (unsigned long)r->a0, (unsigned long)r->a1);
+    }
+    APPEND("]}");
+
+#undef APPEND
+    return (int)pos;
+}
+
+/**
+ * @brief 上报任务: 把新的违规写入事件日志并发布到 MQTT
+ *
+ * 事件日志和 MQTT 发布都会等待互斥锁 (卡住的任务可能正持有)，MQTT 发布还可能等待网络超时，
+ * 因此不在订阅了 TWDT 的监督任务中执行。上报任务卡住只影响上报，不影响检查和恢复。
+ */
+static void report_task(void *pvParameters)
+{
+    static char json[SUP_JSON_SIZE];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        bool reboot = false;
+        while (s_reported < s_history_count) {
+            sup_violation_t v;
+            uint32_t count = s_history_count;
+            if (count - s_reported > SUP_HISTORY_LEN) {
+                s_reported = count - SUP_HISTORY_LEN;   /* 被覆盖的记录已丢失 */
+            }
+            portENTER_CRITICAL(&s_history_lock);
+            v = s_history[s_reported % SUP_HISTORY_LEN];
+            portEXIT_CRITICAL(&s_history_lock);
+            s_reported++;
+
+            journal_log(JOURNAL_EVT_TASK_STALL, JOURNAL_SRC_SYS, ((uint32_t)v.task << 8) | v.kind);
+            if (ha_mqtt_is_connected() && violation_to_json(&v, json, sizeof(json)) > 0) {
+                ha_mqtt_publish_telemetry("supervisor", json);
+            }
+            reboot |= v.action == SUP_ACTION_REBOOT;
+        }
+        if (reboot) {
+            journal_flush();
+        }
+    }
+}
+
+static void report_violation(const sup_violation_t *v)
+{
+    ESP_LOGE(TAG, "Task %s %s SLO violated: %lu ms > %lu ms, state %s, action %s",
+             app_task_name((app_task_id_t)v->task), s_kind_names[v->kind],
+             (unsigned long)v->elapsed_ms, (unsigned long)v->limit_ms,
+             state_name(v->state), s_action_names[v->action]);
+
+    /* 快照已取，违规本身再写入飞行记录器 (无锁) */
+    TRACE(TRACE_SRC_SYS, TRACE_EVT_SLO_VIOLATION, v->task, v->kind, v->elapsed_ms);
+
+    if (s_report_task != NULL) {
+        xTaskNotifyGive(s_report_task);
+    }
+}
+
+static void reboot_device(void)
+{
+    /* 留时间给上报任务写日志和发送报告，上报任务卡住也按时重启 */
+    vTaskDelay(pdMS_TO_TICKS(SUP_REBOOT_DELAY_MS));
+    esp_restart();
+}
+
+#if CONFIG_SUPERVISOR_RECOVERY_RESTART
+/**
+ * @brief 删除并重建处于安全点的任务
+ */
+static void restart_task(app_task_id_t id)
+{
+    sup_slot_t *s = &s_slots[id];
+
+    ESP_LOGW(TAG, "Restarting %s (%lu/%d)", app_task_name(id),
+             (unsigned long)s->restarts + 1, CONFIG_SUPERVISOR_MAX_RESTARTS);
+    s->restarts++;
+    s->restart_pending = false;
+    s->parked = false;
+    /* 新实例启动后重新登记，期间不检查 */
+    s->registered = false;
+    s->restart();
+}
+#endif
+
+static void handle_violation(app_task_id_t id, supervisor_kind_t kind, uint32_t elapsed_ms,
+                             uint32_t limit_ms)
+{
+    sup_slot_t *s = &s_slots[id];
+    TaskHandle_t handle = app_task_handle(id);
+    sup_violation_t v = {
+        .uptime_ms = pdTICKS_TO_MS(xTaskGetTickCount()),
+        .task = id,
+        .kind = kind,
+        .state = handle ? (uint8_t)eTaskGetState(handle) : (uint8_t)eInvalid,
+        .action = choose_action(s),
+        .elapsed_ms = elapsed_ms,
+        .limit_ms = limit_ms,
+    };
+    v.trace_count = trace_snapshot(v.trace, SUP_TRACE_RECORDS);
+
+    s->violated = true;
+    s->violations++;
+
+    portENTER_CRITICAL(&s_history_lock);
+    s_history[s_history_count++ % SUP_HISTORY_LEN] = v;
+    portEXIT_CRITICAL(&s_history_lock);
+
+    report_violation(&v);
+
+#if CONFIG_SUPERVISOR_RECOVERY_RESTART
+    if (v.action == SUP_ACTION_RESTART) {
+        /*
+         * 任务正在处理中时可能持有其他模块的互斥锁，不能直接删除: 先请求协作重启，
+         * 任务回到循环顶部时挂起自己，下一次检查再删除重建。
+         * 已回到等待状态 (阻塞在自己的队列/通知上) 的任务可立即重建; 监督任务在单核上
+         * 优先级最高，检查与删除之间被监督任务不会运行。
+         */
+        if (!s->busy && v.state == eBlocked) {
+            restart_task(id);
+        } else {
+            s->restart_since = xTaskGetTickCount();
+            s->restart_pending = true;
+        }
+        return;
+    }
+#endif
+    if (v.action == SUP_ACTION_REBOOT) {
+        reboot_device();
+    }
+}
+
+static void check_slot(app_task_id_t id)
+{
+    sup_slot_t *s = &s_slots[id];
+    TickType_t now = xTaskGetTickCount();
+
+    if (!s->registered) {
+        return;
+    }
+
+#if CONFIG_SUPERVISOR_RECOVERY_RESTART
+    if (s->restart_pending) {
+        if (s->parked) {
+            restart_task(id);
+        } else if (pdTICKS_TO_MS(now - s->restart_since) > SUP_PARK_TIMEOUT_MS) {
+            ESP_LOGE(TAG, "Task %s did not reach a safe point for restart, rebooting",
+                     app_task_name(id));
+            reboot_device();
+        }
+        return;
+    }
+#endif
+
+    bool busy = s->busy;
+    uint32_t latency_ms = busy ? pdTICKS_TO_MS(now - s->busy_since) : 0;
+    uint32_t silent_ms = pdTICKS_TO_MS(now - s->last_beat);
+
+    if (s->max_latency_ms > 0 && busy && latency_ms > s->max_latency_ms) {
+        if (!s->violated) {
+            handle_violation(id, SUPERVISOR_KIND_LATENCY, latency_ms, s->max_latency_ms);
+        }
+    } else if (s->heartbeat_ms > 0 && silent_ms > s->heartbeat_ms) {
+        if (!s->violated) {
+            handle_violation(id, SUPERVISOR_KIND_HEARTBEAT, silent_ms, s->heartbeat_ms);
+        }
+    } else if (s->violated) {
+        ESP_LOGW(TAG, "Task %s recovered", app_task_name(id));
+        s->violated = false;
+    }
+}
+
+static void supervisor_task(void *pvParameters)
+{
+    s_task = xTaskGetCurrentTaskHandle();
+    timer_wheel_setup_notify(&s_check_timer, "supervisor", xTaskGetCurrentTaskHandle(),
+                             SUP_NOTIFY_CHECK);
+    timer_wheel_arm(&s_check_timer, CONFIG_SUPERVISOR_CHECK_PERIOD_MS,
+                    CONFIG_SUPERVISOR_CHECK_PERIOD_MS);
+
+#if CONFIG_ESP_TASK_WDT_EN
+    /* 监督任务本身卡住或被饿死时由 TWDT 兜底 */
+    esp_task_wdt_add(NULL);
+#endif
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        for (int i = 0; i < APP_TASK_MAX; i++) {
+            check_slot((app_task_id_t)i);
+        }
+
+#if CONFIG_ESP_TASK_WDT_EN
+        esp_task_wdt_reset();
+#endif
+    }
+}
+
+/**
+ * @brief SUP 命令: 各任务 SLO 状态与最近的违规
+ */
+static esp_err_t cmd_sup(int argc, char **argv, const diag_out_t *out)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    diag_printf(out, "%-16s %6s %6s %8s %8s %4s %4s\r\n",
+                "task", "hb_ms", "lat_ms", "silent", "busy", "viol", "rst");
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        const sup_slot_t *s = &s_slots[i];
+        if (!s->registered && s->violations == 0) {
+            continue;
+        }
+        diag_printf(out, "%-16s %6lu %6lu %8lu %8lu %4lu %4lu\r\n",
+                    app_task_name((app_task_id_t)i), (unsigned long)s->heartbeat_ms,
+                    (unsigned long)s->max_latency_ms,
+                    (unsigned long)pdTICKS_TO_MS(now - s->last_beat),
+                    (unsigned long)(s->busy ? pdTICKS_TO_MS(now - s->busy_since) : 0),
+                    (unsigned long)s->violations, (unsigned long)s->restarts);
+    }
+
+    uint32_t count = s_history_count;
+    uint32_t first = count > SUP_HISTORY_LEN ? count - SUP_HISTORY_LEN : 0;
+    for (uint32_t i = first; i < count; i++) {
+        sup_violation_t v;
+        portENTER_CRITICAL(&s_history_lock);
+        v = s_history[i % SUP_HISTORY_LEN];
+        portEXIT_CRITICAL(&s_history_lock);
+        diag_printf(out, "@%lu ms %s %s %lu/%lu ms %s -> %s (%lu trace)\r\n",
+                    (unsigned long)v.uptime_ms, app_task_name((app_task_id_t)v.task),
+                    s_kind_names[v.kind], (unsigned long)v.elapsed_ms,
+                    (unsigned long)v.limit_ms, state_name(v.state), s_action_names[v.action],
+                    (unsigned long)v.trace_count);
+    }
+    return ESP_OK;
+}
+
+esp_err_t supervisor_start(void)
+{
+    if (app_task_create(APP_TASK_SUP_REPORT, report_task, NULL, &s_report_task) != pdPASS ||
+        app_task_create(APP_TASK_SUPERVISOR, supervisor_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create supervisor task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    diag_cmd_register("SUP", "task heartbeat/latency SLO status and violations", cmd_sup, DIAG_ACCESS_REMOTE);
+
+    ESP_LOGI(TAG, "Supervisor started, check every %d ms", CONFIG_SUPERVISOR_CHECK_PERIOD_MS);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_SUPERVISOR_ENABLE */
+
+esp_err_t supervisor_start(void)
+{
+    return ESP_OK;
+}
+
+void supervisor_register(app_task_id_t id, uint32_t heartbeat_ms, uint32_t max_latency_ms,
+                         supervisor_restart_fn_t restart)
+{
+}
+
+void supervisor_loop_begin(app_task_id_t id)
+{
+}
+
+void supervisor_loop_end(app_task_id_t id)
+{
+}
+
+void supervisor_heartbeat(app_task_id_t id)
+{
+}
+
+#endif /* CONFIG_SUPERVISOR_ENABLE */
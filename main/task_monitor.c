@@ -0,0 +1,238 @@
+/**
+ * @file task_monitor.c
+ * @brief 任务栈水位监控实现
+ */
+
+#include "task_monitor.h"
+#include "ha_mqtt.h"
+#include "supervisor.h"
+#include "diag_cmd.h"
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "task_mon";
+
+#if CONFIG_TASK_MONITOR_ENABLE
+
+#define STACK_ALIGN             256
+#define TASK_MONITOR_JSON_SIZE  768
+
+static uint32_t s_min_free[APP_TASK_MAX] = { [0 ... APP_TASK_MAX - 1] = UINT32_MAX };
+static bool s_warned[APP_TASK_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t recommended_size(uint32_t stack_size, uint32_t min_free)
+{
+    uint32_t used = stack_size - min_free;
+    uint32_t size = used + CONFIG_TASK_MONITOR_MARGIN;
+    return (size + STACK_ALIGN - 1) / STACK_ALIGN * STACK_ALIGN;
+}
+
+void task_monitor_sample(void)
+{
+    uint32_t free_bytes[APP_TASK_MAX];
+
+    /* 挂起调度器期间 idle 任务无法回收已删除任务的 TCB，句柄保持有效 */
+    vTaskSuspendAll();
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        TaskHandle_t handle = app_task_handle((app_task_id_t)i);
+        /* ESP-IDF 中高水位以字节为单位 */
+        free_bytes[i] = handle ? (uint32_t)uxTaskGetStackHighWaterMark(handle) : UINT32_MAX;
+    }
+    xTaskResumeAll();
+
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        bool warn = false;
+
+        portENTER_CRITICAL(&s_lock);
+        if (free_bytes[i] < s_min_free[i]) {
+            s_min_free[i] = free_bytes[i];
+            if (free_bytes[i] < CONFIG_TASK_MONITOR_WARN_BYTES && !s_warned[i]) {
+                s_warned[i] = true;
+                warn = true;
+            }
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (warn) {
+            ESP_LOGW(TAG, "Task %s stack low: %lu of %lu bytes free",
+                     app_task_name((app_task_id_t)i), (unsigned long)free_bytes[i],
+                     (unsigned long)app_task_stack_size((app_task_id_t)i));
+        }
+    }
+}
+
+esp_err_t task_monitor_get_stat(app_task_id_t id, task_stack_stat_t *out)
+{
+    if (id >= APP_TASK_MAX || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t min_free = s_min_free[id];
+    portEXIT_CRITICAL(&s_lock);
+
+    out->stack_size = app_task_stack_size(id);
+    out->min_free = min_free;
+    if (min_free == UINT32_MAX) {
+        out->recommended = 0;
+        return ESP_ERR_NOT_FOUND;
+    }
+    out->recommended = recommended_size(out->stack_size, min_free);
+    return ESP_OK;
+}
+
+void task_monitor_dump(void)
+{
+    task_stack_stat_t stat;
+
+    ESP_LOGI(TAG, "%-18s %6s %8s %6s", "task", "stack", "min_free", "recom");
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        if (task_monitor_get_stat((app_task_id_t)i, &stat) != ESP_OK) {
+            ESP_LOGI(TAG, "%-18s %6lu %8s %6s", app_task_name((app_task_id_t)i),
+                     (unsigned long)stat.stack_size, "-", "-");
+            continue;
+        }
+        ESP_LOGI(TAG, "%-18s %6lu %8lu %6lu%s", app_task_name((app_task_id_t)i),
+                 (unsigned long)stat.stack_size, (unsigned long)stat.min_free,
+                 (unsigned long)stat.recommended,
+                 stat.recommended > stat.stack_size ? " GROW" : "");
+    }
+}
+
+int task_monitor_to_json(char *buf, size_t len)
+{
+    task_stack_stat_t stat;
+    size_t pos = 0;
+    bool first = true;
+    int n;
+
+#define APPEND(...) do { \
+        n = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n < 0 || (size_t)n >= len - pos) return -1; \
+        pos += n; \
+    } while (0)
+
+    APPEND("{");
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        if (task_monitor_get_stat((app_task_id_t)i, &stat) != ESP_OK) {
+            continue;
+        }
+        APPEND("%s\"%s\":[%lu,%lu,%lu]", first ? "" : ",", app_task_name((app_task_id_t)i),
+               (unsigned long)stat.stack_size, (unsigned long)stat.min_free,
+               (unsigned long)stat.recommended);
+        first = false;
+    }
+    APPEND("}");
+
+#undef APPEND
+    return (int)pos;
+}
+
+/**
+ * @brief TASKS 诊断命令: 应用任务状态、优先级、栈水位和建议栈大小
+ */
+static esp_err_t cmd_tasks(int argc, char **argv, const diag_out_t *out)
+{
+    static const char states[] = "XRBSD";    /* eTaskState: 运行/就绪/阻塞/挂起/已删除 */
+    eTaskState state[APP_TASK_MAX];
+    UBaseType_t prio[APP_TASK_MAX];
+    task_stack_stat_t stat;
+
+    task_monitor_sample();
+
+    /* 同 task_monitor_sample，挂起调度器期间句柄保持有效 */
+    vTaskSuspendAll();
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        TaskHandle_t handle = app_task_handle((app_task_id_t)i);
+        state[i] = handle ? eTaskGetState(handle) : eInvalid;
+        prio[i] = handle ? uxTaskPriorityGet(handle) : 0;
+    }
+    xTaskResumeAll();
+
+    diag_printf(out, "%-16s st pr %6s %8s %6s\r\n", "task", "stack", "min_free", "recom");
+    for (int i = 0; i < APP_TASK_MAX; i++) {
+        if (state[i] == eInvalid || task_monitor_get_stat((app_task_id_t)i, &stat) != ESP_OK) {
+            continue;
+        }
+        diag_printf(out, "%-16s %c %3u %6lu %8lu %6lu\r\n", app_task_name((app_task_id_t)i),
+                    state[i] < (eTaskState)(sizeof(states) - 1) ? states[state[i]] : '?',
+                    (unsigned)prio[i], (unsigned long)stat.stack_size,
+                    (unsigned long)stat.min_free, (unsigned long)stat.recommended);
+    }
+    diag_printf(out, "total tasks %u\r\n", (unsigned)uxTaskGetNumberOfTasks());
+    return ESP_OK;
+}
+
+static void task_monitor_task(void *pvParameters)
+{
+    const uint32_t report_every = (CONFIG_TASK_MONITOR_REPORT_PERIOD_S * 1000) /
+                                  CONFIG_TASK_MONITOR_PERIOD_MS;
+    uint32_t count = 0;
+
+    supervisor_register(APP_TASK_MONITOR,
+                        SUPERVISOR_BACKGROUND_HEARTBEAT_MS(CONFIG_TASK_MONITOR_PERIOD_MS), 0, NULL);
+
+    while (1) {
+        supervisor_heartbeat(APP_TASK_MONITOR);
+        task_monitor_sample();
+
+        if (report_every > 0 && ++count >= report_every) {
+            count = 0;
+            task_monitor_dump();
+
+            if (ha_mqtt_is_connected()) {
+                char json[TASK_MONITOR_JSON_SIZE];
+                if (task_monitor_to_json(json, sizeof(json)) > 0) {
+                    ha_mqtt_publish_telemetry("stack", json);
+                }
+            }
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_TASK_MONITOR_PERIOD_MS));
+    }
+}
+
+esp_err_t task_monitor_start(void)
+{
+    diag_cmd_register("TASKS", "app task state, priority and stack watermarks",
+                      cmd_tasks, DIAG_ACCESS_REMOTE);
+
+    if (app_task_create(APP_TASK_MONITOR, task_monitor_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create task monitor");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Stack monitor started, period %d ms", CONFIG_TASK_MONITOR_PERIOD_MS);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_TASK_MONITOR_ENABLE */
+
+esp_err_t task_monitor_start(void)
+{
+    return ESP_OK;
+}
+
+void task_monitor_sample(void)
+{
+}
+
+esp_err_t task_monitor_get_stat(app_task_id_t id, task_stack_stat_t *out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void task_monitor_dump(void)
+{
+}
+
+int task_monitor_to_json(char *buf, size_t len)
+{
+    return -1;
+}
+
+#endif /* CONFIG_TASK_MONITOR_ENABLE */
@@ -0,0 +1,502 @@
+/**
+ * @file timer_wheel.c
+ * @brief 分层时间轮实现
+ *
+ * s_base 为下一个待处理的 tick，所有挂起定时器的 expires >= s_base。
+ * 推进时逐 tick 处理第 0 级槽，跨 64 tick 边界时把上一级对应槽降级重新插入；
+ * 空槽区间按位图直接跳过，长时间休眠后追赶的代价与经过的边界数成正比。
+ */
+
+#include "timer_wheel.h"
+#include "diag_cmd.h"
+
+#include <string.h>
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "timer_wheel";
+
+#define TW_LEVELS           3
+#define TW_SLOT_BITS        6
+#define TW_SLOTS            (1 << TW_SLOT_BITS)
+#define TW_SLOT_MASK        (TW_SLOTS - 1)
+#define TW_TICK_MS          CONFIG_TIMER_WHEEL_TICK_MS
+#define TW_TICK_US          ((int64_t)TW_TICK_MS * 1000)
+#define TW_SPAN             (1UL << (TW_SLOT_BITS * TW_LEVELS))
+#define TW_RETRY_MS         20      /* 队列满时单次定时器的重投间隔 */
+#define TW_DUMP_MAX         16
+
+/* 环形比较，tick 按 32 位回绕 */
+#define TW_BEFORE(a, b)     ((int32_t)((a) - (b)) < 0)
+
+static wheel_timer_t *s_slots[TW_LEVELS][TW_SLOTS];
+static uint64_t s_bitmap[TW_LEVELS];
+static uint32_t s_base = 0;
+static uint32_t s_count = 0;
+
+static esp_timer_handle_t s_timer = NULL;
+static bool s_programmed = false;
+static uint32_t s_programmed_tick = 0;
+
+static SemaphoreHandle_t s_mutex = NULL;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t s_mutex_buf;
+#endif
+
+/* 诊断统计 */
+static uint32_t s_wakeups = 0;
+static uint32_t s_fired = 0;
+static uint32_t s_cascaded = 0;
+static uint32_t s_post_fail = 0;
+
+static inline uint32_t now_tick(void)
+{
+    return (uint32_t)(esp_timer_get_time() / TW_TICK_US);
+}
+
+static inline uint32_t ms_to_ticks(uint32_t ms)
+{
+    return (ms + TW_TICK_MS - 1) / TW_TICK_MS;
+}
+
+/**
+ * @brief 从 from 开始 (含) 环形查找下一个置位的槽，返回距离，位图为空返回 TW_SLOTS
+ */
+static uint32_t next_set(uint64_t bitmap, uint32_t from)
+{
+    if (bitmap == 0) {
+        return TW_SLOTS;
+    }
+    uint64_t rot = (bitmap >> from) | (from ? bitmap << (TW_SLOTS - from) : 0);
+    return (uint32_t)__builtin_ctzll(rot);
+}
+
+static void slot_link(wheel_timer_t *t, int level, uint32_t idx)
+{
+    wheel_timer_t **head = &s_slots[level][idx];
+
+    t->prev = NULL;
+    t->next = *head;
+    if (*head != NULL) {
+        (*head)->prev = t;
+    }
+    *head = t;
+    t->slot = (int16_t)(level * TW_SLOTS + idx);
+    s_bitmap[level] |= 1ULL << idx;
+}
+
+static void slot_unlink(wheel_timer_t *t)
+{
+    int level = t->slot / TW_SLOTS;
+    uint32_t idx = t->slot % TW_SLOTS;
+
+    if (t->prev != NULL) {
+        t->prev->next = t->next;
+    } else {
+        s_slots[level][idx] = t->next;
+    }
+    if (t->next != NULL) {
+        t->next->prev = t->prev;
+    }
+    if (s_slots[level][idx] == NULL) {
+        s_bitmap[level] &= ~(1ULL << idx);
+    }
+    t->next = t->prev = NULL;
+    t->slot = -1;
+}
+
+/**
+ * @brief 按相对 s_base 的距离选择级别和槽，超出范围的放在顶级最远的槽中循环降级
+ */
+static void insert(wheel_timer_t *t)
+{
+    uint32_t delta = t->expires - s_base;
+    uint32_t e = t->expires;
+    int level;
+
+    if (delta < TW_SLOTS) {
+        level = 0;
+    } else if (delta < (1UL << (2 * TW_SLOT_BITS))) {
+        level = 1;
+    } else {
+        level = 2;
+        if (delta >= TW_SPAN) {
+            e = s_base + TW_SPAN - 1;
+        }
+    }
+    slot_link(t, level, (e >> (level * TW_SLOT_BITS)) & TW_SLOT_MASK);
+}
+
+/**
+ * @brief 上级槽 idx 下一次降级的 tick
+ */
+static uint32_t cascade_tick(int level, uint32_t idx)
+{
+    uint32_t shift = level * TW_SLOT_BITS;
+    uint32_t block = s_base >> shift;
+    uint32_t dist = (idx - block) & TW_SLOT_MASK;
+
+    if (dist == 0 && (s_base & ((1UL << shift) - 1)) != 0) {
+        dist = TW_SLOTS;
+    }
+    return (block + dist) << shift;
+}
+
+/**
+ * @brief 定时器需要唤醒的 tick
+ *
+ * 顶级槽中可能有超出范围被截断放置的定时器，截止时间不在该槽的块内，
+ * 需在降级时唤醒重新放置；其余定时器直接在截止时间唤醒，推进时顺带完成降级。
+ */
+static uint32_t wake_tick(const wheel_timer_t *t)
+{
+    int level = t->slot / TW_SLOTS;
+
+    if (level < TW_LEVELS - 1) {
+        return t->expires;
+    }
+    uint32_t ct = cascade_tick(level, t->slot % TW_SLOTS);
+    return (t->expires - ct < (1UL << (level * TW_SLOT_BITS))) ? t->expires : ct;
+}
+
+/**
+ * @brief 最近需要处理的 tick
+ *
+ * 每级按槽号从当前位置环形查找第一个非空槽，其中最早的唤醒时间即为该级最早。
+ */
+static bool next_deadline(uint32_t *out)
+{
+    bool found = false;
+    uint32_t best = 0;
+
+    for (int level = 0; level < TW_LEVELS; level++) {
+        uint32_t shift = level * TW_SLOT_BITS;
+        uint32_t cur = (s_base >> shift) & TW_SLOT_MASK;
+        if (level > 0 && (s_base & ((1UL << shift) - 1)) != 0) {
+            /* 当前块已降级过，该槽里的定时器要到整圈之后 */
+            cur = (cur + 1) & TW_SLOT_MASK;
+        }
+        uint32_t dist = next_set(s_bitmap[level], cur);
+        if (dist >= TW_SLOTS) {
+            continue;
+        }
+        uint32_t cand;
+        if (level == 0) {
+            cand = s_base + dist;
+        } else {
+            const wheel_timer_t *t = s_slots[level][(cur + dist) & TW_SLOT_MASK];
+            cand = wake_tick(t);
+            for (t = t->next; t != NULL; t = t->next) {
+                uint32_t w = wake_tick(t);
+                if (TW_BEFORE(w, cand)) {
+                    cand = w;
+                }
+            }
+        }
+        if (!found || TW_BEFORE(cand, best)) {
+            best = cand;
+            found = true;
+        }
+    }
+    *out = best;
+    return found;
+}
+
+static void program(uint32_t tick)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t delay = (int64_t)(int32_t)(tick - (uint32_t)(now / TW_TICK_US)) * TW_TICK_US - now % TW_TICK_US;
+
+    if (delay < 1) {
+        delay = 1;
+    }
+    esp_timer_stop(s_timer);
+    if (esp_timer_start_once(s_timer, (uint64_t)delay) == ESP_OK) {
+        s_programmed = true;
+        s_programmed_tick = tick;
+    } else {
+        s_programmed = false;
+    }
+}
+
+/**
+ * @brief 派发到期定时器，返回 false 表示投递失败需重试
+ */
+static bool dispatch(wheel_timer_t *t)
+{
+    if (t->target == WHEEL_TARGET_NOTIFY) {
+        if (t->task != NULL) {
+            xTaskNotify(t->task, t->bits, eSetBits);
+        }
+        return true;
+    }
+
+    msg_t msg = {
+        .type = MSG_TYPE_TIMER,
+        .data.timer = { .timer = t, .gen = t->gen },
+    };
+    if (!msg_queue_send(msg_queue_get(t->queue), &msg, 0)) {
+        s_post_fail++;
+        return false;
+    }
+    return true;
+}
+
+static void expire_slot(uint32_t idx, uint32_t tick)
+{
+    wheel_timer_t *list = s_slots[0][idx];
+
+    s_slots[0][idx] = NULL;
+    s_bitmap[0] &= ~(1ULL << idx);
+
+    while (list != NULL) {
+        wheel_timer_t *t = list;
+        list = t->next;
+        t->next = t->prev = NULL;
+        t->slot = -1;
+        s_count--;
+        s_fired++;
+
+        bool ok = dispatch(t);
+        if (t->period != 0) {
+            t->expires = tick + t->period;
+        } else if (!ok) {
+            t->expires = tick + ms_to_ticks(TW_RETRY_MS);
+        } else {
+            continue;
+        }
+        insert(t);
+        s_count++;
+    }
+}
+
+static void cascade(int level, uint32_t idx)
+{
+    wheel_timer_t *list = s_slots[level][idx];
+
+    if (list == NULL) {
+        return;
+    }
+    s_slots[level][idx] = NULL;
+    s_bitmap[level] &= ~(1ULL << idx);
+    while (list != NULL) {
+        wheel_timer_t *t = list;
+        list = t->next;
+        insert(t);
+        s_cascaded++;
+    }
+}
+
+/**
+ * @brief 处理 [s_base, cur] 内的所有 tick
+ */
+static void advance(uint32_t cur)
+{
+    if (s_count == 0) {
+        s_base = cur + 1;
+        return;
+    }
+    while (!TW_BEFORE(cur, s_base)) {
+        if ((s_base & TW_SLOT_MASK) == 0) {
+            uint32_t idx1 = (s_base >> TW_SLOT_BITS) & TW_SLOT_MASK;
+            if (idx1 == 0) {
+                cascade(2, (s_base >> (2 * TW_SLOT_BITS)) & TW_SLOT_MASK);
+            }
+            cascade(1, idx1);
+        }
+        expire_slot(s_base & TW_SLOT_MASK, s_base);
+        s_base++;
+
+        /* 跳到下一个非空槽或下一个降级边界 */
+        uint32_t pos = s_base & TW_SLOT_MASK;
+        uint32_t step = next_set(s_bitmap[0], pos);
+        uint32_t to_edge = pos ? TW_SLOTS - pos : 0;
+        if (step > to_edge) {
+            step = to_edge;
+        }
+        uint32_t room = cur + 1 - s_base;
+        if ((int32_t)room <= 0) {
+            break;
+        }
+        s_base += step < room ? step : room;
+    }
+}
+
+static void wheel_timer_cb(void *arg)
+{
+    uint32_t next;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_wakeups++;
+    s_programmed = false;
+    advance(now_tick());
+    if (next_deadline(&next)) {
+        program(next);
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void timer_wheel_setup_msg(wheel_timer_t *t, const char *name, queue_id_t queue)
+{
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->slot = -1;
+    t->target = WHEEL_TARGET_QUEUE;
+    t->queue = queue;
+}
+
+void timer_wheel_setup_notify(wheel_timer_t *t, const char *name, TaskHandle_t task, uint32_t bits)
+{
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->slot = -1;
+    t->target = WHEEL_TARGET_NOTIFY;
+    t->task = task;
+    t->bits = bits;
+}
+
+esp_err_t timer_wheel_arm(wheel_timer_t *t, uint32_t delay_ms, uint32_t period_ms)
+{
+    if (s_mutex == NULL || t == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint32_t expires = (uint32_t)((now + (int64_t)delay_ms * 1000 + TW_TICK_US - 1) / TW_TICK_US);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool was_next = false;
+    if (t->slot >= 0) {
+        was_next = s_programmed && wake_tick(t) == s_programmed_tick;
+        slot_unlink(t);
+        s_count--;
+    }
+    /* 先把轮推进到当前 tick，否则 s_base 滞后会让新定时器落入过高的级别 */
+    advance((uint32_t)(now / TW_TICK_US));
+    if (TW_BEFORE(expires, s_base)) {
+        expires = s_base;
+    }
+    t->expires = expires;
+    t->period = period_ms ? ms_to_ticks(period_ms) : 0;
+    t->gen++;
+    insert(t);
+    s_count++;
+
+    /* 新定时器早于已编程的唤醒时提前；推迟的正是最近的定时器时重新查找 */
+    uint32_t wake = wake_tick(t);
+    if (!s_programmed || TW_BEFORE(wake, s_programmed_tick)) {
+        program(wake);
+    } else if (was_next && next_deadline(&wake) && wake != s_programmed_tick) {
+        program(wake);
+    }
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+void timer_wheel_cancel(wheel_timer_t *t)
+{
+    if (s_mutex == NULL || t == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (t->slot >= 0) {
+        bool was_next = s_programmed && wake_tick(t) == s_programmed_tick;
+        slot_unlink(t);
+        s_count--;
+        /* 取消的是最近的定时器时顺延唤醒，避免一次空唤醒 */
+        uint32_t next;
+        if (s_count == 0) {
+            esp_timer_stop(s_timer);
+            s_programmed = false;
+        } else if (was_next && next_deadline(&next) && next != s_programmed_tick) {
+            program(next);
+        }
+    }
+    t->gen++;
+    xSemaphoreGive(s_mutex);
+}
+
+bool timer_wheel_is_pending(const wheel_timer_t *t)
+{
+    return t != NULL && t->slot >= 0;
+}
+
+bool timer_wheel_msg_is_current(const timer_msg_data_t *msg)
+{
+    return msg != NULL && msg->timer != NULL && msg->timer->gen == msg->gen;
+}
+
+/**
+ * @brief TIMERS 命令: 统计与挂起的定时器
+ */
+static esp_err_t cmd_timers(int argc, char **argv, const diag_out_t *out)
+{
+    const wheel_timer_t *list[TW_DUMP_MAX];
+    uint32_t remain[TW_DUMP_MAX];
+    uint32_t period[TW_DUMP_MAX];
+    int n = 0;
+    uint32_t next = 0;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t cur = now_tick();
+    bool has_next = next_deadline(&next);
+    for (int level = 0; level < TW_LEVELS; level++) {
+        for (int idx = 0; idx < TW_SLOTS; idx++) {
+            for (const wheel_timer_t *t = s_slots[level][idx]; t != NULL && n < TW_DUMP_MAX; t = t->next) {
+                list[n] = t;
+                remain[n] = TW_BEFORE(t->expires, cur) ? 0 : (t->expires - cur) * TW_TICK_MS;
+                period[n] = t->period * TW_TICK_MS;
+                n++;
+            }
+        }
+    }
+    uint32_t count = s_count;
+    xSemaphoreGive(s_mutex);
+
+    diag_printf(out, "tick %d ms, pending %lu, next in %ld ms\r\n", TW_TICK_MS, (unsigned long)count,
+                has_next ? (long)((int32_t)(next - cur) * TW_TICK_MS) : -1L);
+    diag_printf(out, "wakeups %lu, fired %lu, cascaded %lu, post fail %lu\r\n",
+                (unsigned long)s_wakeups, (unsigned long)s_fired,
+                (unsigned long)s_cascaded, (unsigned long)s_post_fail);
+    for (int i = 0; i < n; i++) {
+        diag_printf(out, "  %-16s %8lu ms  period %lu ms\r\n", list[i]->name ? list[i]->name : "?",
+                    (unsigned long)remain[i], (unsigned long)period[i]);
+    }
+    return ESP_OK;
+}
+
+esp_err_t timer_wheel_init(void)
+{
+    if (s_mutex != NULL) {
+        return ESP_OK;
+    }
+
+#if CONFIG_APP_STATIC_ALLOCATION
+    s_mutex = xSemaphoreCreateMutexStatic(&s_mutex_buf);
+#else
+    s_mutex = xSemaphoreCreateMutex();
+#endif
+    if (s_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = wheel_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "timer_wheel",
+    };
+    esp_err_t ret = esp_timer_create(&args, &s_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_timer create failed: %s", esp_err_to_name(ret));
+        vSemaphoreDelete(s_mutex);
+        s_mutex = NULL;
+        return ret;
+    }
+
+    s_base = now_tick();
+    diag_cmd_register("TIMERS", "timer wheel stats and pending timers", cmd_timers, DIAG_ACCESS_REMOTE);
+    ESP_LOGI(TAG, "Timer wheel ready, tick %d ms, span %lu s", TW_TICK_MS,
+             (unsigned long)(TW_SPAN * TW_TICK_MS / 1000));
+    return ESP_OK;
+}
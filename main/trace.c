@@ -0,0 +1,267 @@
+/**
+ * @file trace.c
+ * @brief 飞行记录器实现
+ */
+
+#include "trace.h"
+#include "diag_cmd.h"
+#include "bt_l2cap.h"
+#include "ha_mqtt.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+static const char *TAG = "trace";
+
+#if CONFIG_TRACE_ENABLE
+
+#define TRACE_CAPACITY  CONFIG_TRACE_RING_SIZE
+#define TRACE_MASK      (TRACE_CAPACITY - 1)
+#define TRACE_BLOCK_SIZE (sizeof(uint32_t) + TRACE_CAPACITY * sizeof(trace_record_t))
+#define TRACE_DUMP_DEFAULT  16
+#define TRACE_DUMP_MAX      32
+
+_Static_assert((TRACE_CAPACITY & TRACE_MASK) == 0, "CONFIG_TRACE_RING_SIZE must be a power of two");
+_Static_assert(sizeof(trace_record_t) == 16, "trace_record_t layout is part of the dump format");
+
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;
+    uint32_t boot_count;
+    uint32_t head[portNUM_PROCESSORS];
+    trace_record_t ring[portNUM_PROCESSORS][TRACE_CAPACITY];
+} trace_buf_t;
+
+/* 软件复位后保留 */
+static __NOINIT_ATTR trace_buf_t s_trace;
+
+static trace_dump_header_t s_dump_hdr;
+static uint32_t s_write_cycles = 0;
+
+void IRAM_ATTR trace_write(trace_src_t src, trace_evt_t evt, uint16_t a16, uint32_t a0, uint32_t a1)
+{
+    uint32_t core = esp_cpu_get_core_id();
+    /* 同核的任务和中断通过原子加法获得不同槽位 */
+    uint32_t idx = __atomic_fetch_add(&s_trace.head[core], 1, __ATOMIC_RELAXED);
+    trace_record_t *rec = &s_trace.ring[core][idx & TRACE_MASK];
+
+    rec->ts_us = (uint32_t)esp_timer_get_time();
+    rec->src = (uint8_t)src;
+    rec->evt = (uint8_t)evt;
+    rec->a16 = a16;
+    rec->a0 = a0;
+    rec->a1 = a1;
+}
+
+size_t trace_dump_size(void)
+{
+    return sizeof(trace_dump_header_t) + portNUM_PROCESSORS * TRACE_BLOCK_SIZE;
+}
+
+int trace_dump_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    size_t total = trace_dump_size();
+
+    if (offset == 0) {
+        s_dump_hdr.magic = TRACE_MAGIC;
+        s_dump_hdr.record_size = sizeof(trace_record_t);
+        s_dump_hdr.cores = portNUM_PROCESSORS;
+        s_dump_hdr.boot_count = s_trace.boot_count;
+        s_dump_hdr.capacity = TRACE_CAPACITY;
+    }
+    if (offset >= total) {
+        return 0;
+    }
+    if (len > total - offset) {
+        len = total - offset;
+    }
+
+    size_t done = 0;
+    while (done < len) {
+        size_t pos = offset + done;
+        const uint8_t *src;
+        size_t avail;
+
+        if (pos < sizeof(s_dump_hdr)) {
+            src = (const uint8_t *)&s_dump_hdr + pos;
+            avail = sizeof(s_dump_hdr) - pos;
+        } else {
+            size_t rel = pos - sizeof(s_dump_hdr);
+            size_t core = rel / TRACE_BLOCK_SIZE;
+            size_t block_off = rel % TRACE_BLOCK_SIZE;
+
+            if (block_off < sizeof(uint32_t)) {
+                src = (const uint8_t *)&s_trace.head[core] + block_off;
+                avail = sizeof(uint32_t) - block_off;
+            } else {
+                /* 直接读取在用的环形区，主机端按时间戳排序 */
+                src = (const uint8_t *)s_trace.ring[core] + (block_off - sizeof(uint32_t));
+                avail = TRACE_BLOCK_SIZE - block_off;
+            }
+        }
+
+        size_t n = avail < len - done ? avail : len - done;
+        memcpy(buf + done, src, n);
+        done += n;
+    }
+    return (int)done;
+}
+
+size_t trace_snapshot(trace_record_t *out, size_t max)
+{
+    uint32_t next[portNUM_PROCESSORS];
+    uint32_t left[portNUM_PROCESSORS];
+    size_t n = 0;
+
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        next[i] = __atomic_load_n(&s_trace.head[i], __ATOMIC_RELAXED);
+        left[i] = next[i] < TRACE_CAPACITY ? next[i] : TRACE_CAPACITY;
+    }
+
+    /* 从最新往回取，多核时每次选时间戳最新的核心 (按差值比较，容忍 32 位回绕) */
+    while (n < max) {
+        int pick = -1;
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            if (left[i] == 0) {
+                continue;
+            }
+            if (pick < 0 || (int32_t)(s_trace.ring[i][(next[i] - 1) & TRACE_MASK].ts_us -
+                                      s_trace.ring[pick][(next[pick] - 1) & TRACE_MASK].ts_us) > 0) {
+                pick = i;
+            }
+        }
+        if (pick < 0) {
+            break;
+        }
+        next[pick]--;
+        left[pick]--;
+        out[n++] = s_trace.ring[pick][next[pick] & TRACE_MASK];
+    }
+
+    for (size_t i = 0; i < n / 2; i++) {
+        trace_record_t tmp = out[i];
+        out[i] = out[n - 1 - i];
+        out[n - 1 - i] = tmp;
+    }
+    return n;
+}
+
+/**
+ * @brief 通过 MQTT 发布完整转储
+ */
+static esp_err_t publish_dump(void)
+{
+    size_t size = trace_dump_size();
+    uint8_t *buf = malloc(size);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int len = trace_dump_read(0, buf, size);
+    esp_err_t ret = ha_mqtt_publish_telemetry_raw("trace", buf, (size_t)len);
+    free(buf);
+    return ret;
+}
+
+/**
+ * @brief 以文本输出最近 n 条记录: 时间戳 源 事件 a16 a0 a1
+ */
+static void dump_records(size_t n, const diag_out_t *out)
+{
+    /* 命令在 diag 任务中串行执行，缓冲区不放在栈上 */
+    static trace_record_t records[TRACE_DUMP_MAX];
+
+    n = trace_snapshot(records, n < TRACE_DUMP_MAX ? n : TRACE_DUMP_MAX);
+    for (size_t i = 0; i < n; i++) {
+        const trace_record_t *r = &records[i];
+        diag_printf(out, "%10lu %u %2u %5u %lu %lu\r\n", (unsigned long)r->ts_us, r->src, r->evt,
+                    r->a16, (unsigned long)r->a0, (unsigned long)r->a1);
+    }
+}
+
+/**
+ * @brief TRACE 命令: 状态，"TRACE DUMP [n]" 输出最近记录，"TRACE PUB" 发布转储
+ */
+static esp_err_t cmd_trace(int argc, char **argv, const diag_out_t *out)
+{
+    if (argc >= 2 && strcasecmp(argv[1], "DUMP") == 0) {
+        dump_records(argc >= 3 ? strtoul(argv[2], NULL, 10) : TRACE_DUMP_DEFAULT, out);
+        return ESP_OK;
+    }
+    if (argc >= 2 && strcasecmp(argv[1], "PUB") == 0) {
+        esp_err_t ret = publish_dump();
+        diag_printf(out, "trace publish: %s (%u bytes)\r\n", esp_err_to_name(ret),
+                    (unsigned)trace_dump_size());
+        return ret;
+    }
+
+    diag_printf(out, "boot %lu, %d x %d records, write %lu cycles\r\n",
+                (unsigned long)s_trace.boot_count, portNUM_PROCESSORS, TRACE_CAPACITY,
+                (unsigned long)s_write_cycles);
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        diag_printf(out, "core%d head %lu\r\n", i, (unsigned long)s_trace.head[i]);
+    }
+    return ESP_OK;
+}
+
+esp_err_t trace_init(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    /* 上电、欠压或布局变化时 noinit 内容无效 */
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT || reason == ESP_RST_DEEPSLEEP ||
+        s_trace.magic != TRACE_MAGIC || s_trace.capacity != TRACE_CAPACITY) {
+        memset(&s_trace, 0, sizeof(s_trace));
+        s_trace.magic = TRACE_MAGIC;
+        s_trace.capacity = TRACE_CAPACITY;
+    }
+    s_trace.boot_count++;
+
+    /* 启动记录同时用于测量单条写入开销 */
+    uint32_t start = esp_cpu_get_cycle_count();
+    TRACE(TRACE_SRC_SYS, TRACE_EVT_BOOT, 0, reason, s_trace.boot_count);
+    s_write_cycles = esp_cpu_get_cycle_count() - start;
+
+    bt_l2cap_register_source(BT_L2CAP_STREAM_TRACE, trace_dump_read);
+    diag_cmd_register("TRACE", "flight recorder status, TRACE DUMP [n] prints records, TRACE PUB publishes dump",
+                      cmd_trace, DIAG_ACCESS_REMOTE);
+
+    ESP_LOGI(TAG, "Flight recorder: boot %lu, reset reason %d",
+             (unsigned long)s_trace.boot_count, reason);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_TRACE_ENABLE */
+
+void trace_write(trace_src_t src, trace_evt_t evt, uint16_t a16, uint32_t a0, uint32_t a1)
+{
+}
+
+esp_err_t trace_init(void)
+{
+    return ESP_OK;
+}
+
+int trace_dump_read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    return 0;
+}
+
+size_t trace_dump_size(void)
+{
+    return 0;
+}
+
+size_t trace_snapshot(trace_record_t *out, size_t max)
+{
+    return 0;
+}
+
+#endif /* CONFIG_TRACE_ENABLE */
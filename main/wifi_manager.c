@@ -12,11 +12,19 @@
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_smartconfig.h"
-#include "nvs_flash.h"
 
 #include "wifi_manager.h"
 #include "board.h"
 #include "msg_queue.h"
+#include "boot_trace.h"
+#include "app_rtos.h"
+#include "trace.h"
+#include "state_shadow.h"
+#include "timer_wheel.h"
+#include "supervisor.h"
+#include "app_event.h"
+#include "fault_inject.h"
+#include "diag_cmd.h"
 
 static const char *TAG = "wifi_manager";
 
@@ -27,29 +35,85 @@ static const int SMARTCONFIG_RUNNING_BIT = BIT2;
 
 /* 静态变量 */
 static EventGroupHandle_t s_wifi_event_group = NULL;
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticEventGroup_t s_wifi_event_group_buf;
+#endif
 static TaskHandle_t s_smartconfig_task_handle = NULL;
-static TaskHandle_t s_led_blink_task_handle = NULL;
 static TaskHandle_t s_wifi_msg_task_handle = NULL;
 
+/* 配网期间红灯闪烁，定时器到期消息由 wifi_msg_task 处理 */
+#define LED_BLINK_PERIOD_MS 200
+static wheel_timer_t s_led_blink_timer;
+static uint8_t s_led_blink_state = LED_RED_OFF;
+
+/* wifi_msg_task 单条消息处理上限 */
+#define WIFI_MSG_LOOP_SLO_MS 5000
+
 /* 前向声明 */
 static void smartconfig_task(void *parm);
-static void led_status_task(void *parm);
 static void wifi_msg_task(void *parm);
-static void event_handler(void *arg, esp_event_base_t event_base,
-                          int32_t event_id, void *event_data);
+static void system_event_handler(void *arg, esp_event_base_t event_base,
+                                 int32_t event_id, void *event_data);
+static void wifi_event_handler(app_event_id_t id, const void *data, void *arg);
 
 /* 重连计数器 */
 static int s_retry_count = 0;
 static const int MAX_RETRY_COUNT = 3;
 static bool s_has_saved_credentials = false;
 
-static void event_handler(void *arg, esp_event_base_t event_base,
-                          int32_t event_id, void *event_data)
+/* 默认事件循环队列满时的投递等待上限 */
+#define WIFI_EVENT_POST_TIMEOUT_MS 100
+
+/**
+ * @brief 默认事件循环上的处理函数: 只拷贝所需字段投递到应用事件循环
+ *
+ * 默认循环与 Wi-Fi/IP 驱动共用，此处不做阻塞操作；跟踪事件和启动标记在此记录以保留准确时间。
+ */
+static void system_event_handler(void *arg, esp_event_base_t event_base,
+                                 int32_t event_id, void *event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        app_event_post(APP_EVENT_WIFI_STA_START, NULL, 0, WIFI_EVENT_POST_TIMEOUT_MS);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        const wifi_event_sta_disconnected_t *disc = (const wifi_event_sta_disconnected_t *)event_data;
+        app_event_wifi_disconnected_t evt = { .reason = disc->reason };
+        TRACE(TRACE_SRC_WIFI, TRACE_EVT_WIFI_DISCONNECT, 0, disc->reason, 0);
+        app_event_post(APP_EVENT_WIFI_DISCONNECTED, &evt, sizeof(evt), WIFI_EVENT_POST_TIMEOUT_MS);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        const ip_event_got_ip_t *got = (const ip_event_got_ip_t *)event_data;
+        app_event_got_ip_t evt = { .ip = got->ip_info.ip.addr };
+        boot_trace_mark(BOOT_MARK_WIFI_UP);
+        TRACE(TRACE_SRC_WIFI, TRACE_EVT_WIFI_GOT_IP, 0, evt.ip, 0);
+        app_event_post(APP_EVENT_WIFI_GOT_IP, &evt, sizeof(evt), WIFI_EVENT_POST_TIMEOUT_MS);
+    } else if (event_base == SC_EVENT &&
+               (event_id == SC_EVENT_SCAN_DONE || event_id == SC_EVENT_FOUND_CHANNEL)) {
+        app_event_sc_status_t evt = { .sc_event = event_id };
+        app_event_post(APP_EVENT_SC_STATUS, &evt, sizeof(evt), WIFI_EVENT_POST_TIMEOUT_MS);
+    } else if (event_base == SC_EVENT && event_id == SC_EVENT_GOT_SSID_PSWD) {
+        const smartconfig_event_got_ssid_pswd_t *sc = (const smartconfig_event_got_ssid_pswd_t *)event_data;
+        app_event_sc_credentials_t evt;
+
+        memcpy(evt.ssid, sc->ssid, sizeof(evt.ssid));
+        memcpy(evt.password, sc->password, sizeof(evt.password));
+        memcpy(evt.bssid, sc->bssid, sizeof(evt.bssid));
+        evt.bssid_set = sc->bssid_set;
+        app_event_post(APP_EVENT_SC_GOT_CREDENTIALS, &evt, sizeof(evt), WIFI_EVENT_POST_TIMEOUT_MS);
+    } else if (event_base == SC_EVENT && event_id == SC_EVENT_SEND_ACK_DONE) {
+        app_event_post(APP_EVENT_SC_ACK_DONE, NULL, 0, WIFI_EVENT_POST_TIMEOUT_MS);
+    }
+}
+
+/**
+ * @brief 应用事件循环上的连接状态处理: 重连、启动 SmartConfig、保存凭据
+ */
+static void wifi_event_handler(app_event_id_t id, const void *data, void *arg)
+{
+    esp_err_t ret;
+
+    if (id == APP_EVENT_WIFI_STA_START) {
         /* 检查是否有保存的 WiFi 凭据 */
         wifi_config_t wifi_config;
-        esp_err_t ret = esp_wifi_get_config(WIFI_IF_STA, &wifi_config);
+        ret = esp_wifi_get_config(WIFI_IF_STA, &wifi_config);
         
         if (ret == ESP_OK && strlen((char *)wifi_config.sta.ssid) > 0) {
             /* 有保存的凭据，尝试连接 */
@@ -61,10 +125,11 @@ static void event_handler(void *arg, esp_event_base_t event_base,
             /* 没有保存的凭据，启动 SmartConfig */
             ESP_LOGI(TAG, "No saved WiFi credentials, starting SmartConfig...");
             s_has_saved_credentials = false;
-            xTaskCreate(smartconfig_task, "smartconfig_task", 4096, NULL, 3, &s_smartconfig_task_handle);
+            app_task_create(APP_TASK_SMARTCONFIG, smartconfig_task, NULL, &s_smartconfig_task_handle);
         }
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+    } else if (id == APP_EVENT_WIFI_DISCONNECTED) {
         xEventGroupClearBits(s_wifi_event_group, CONNECTED_BIT);
+        state_shadow_set_wifi(false);
         
         if (s_has_saved_credentials && s_retry_count < MAX_RETRY_COUNT) {
             s_retry_count++;
@@ -75,26 +140,34 @@ static void event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGW(TAG, "WiFi connection failed after %d retries, starting SmartConfig...", MAX_RETRY_COUNT);
             s_has_saved_credentials = false;
             if (s_smartconfig_task_handle == NULL) {
-                xTaskCreate(smartconfig_task, "smartconfig_task", 4096, NULL, 3, &s_smartconfig_task_handle);
+                app_task_create(APP_TASK_SMARTCONFIG, smartconfig_task, NULL, &s_smartconfig_task_handle);
             }
         } else {
             /* SmartConfig 模式下断开，继续尝试连接 */
             ESP_LOGI(TAG, "WiFi disconnected, attempting to reconnect...");
             esp_wifi_connect();
         }
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "WiFi connected, IP: " IPSTR, IP2STR(&event->ip_info.ip));
+    } else if (id == APP_EVENT_WIFI_GOT_IP) {
+        const app_event_got_ip_t *evt = (const app_event_got_ip_t *)data;
+        esp_ip4_addr_t ip = { .addr = evt->ip };
+        if (FAULT_INJECT(FAULT_WIFI_DISCONNECT)) {
+            /* 连续断开: 重试计数不清零，与真实的反复掉线一致 */
+            ESP_LOGW(TAG, "Fault injection: dropping connection after got IP");
+            esp_wifi_disconnect();
+            return;
+        }
+        ESP_LOGI(TAG, "WiFi connected, IP: " IPSTR, IP2STR(&ip));
         xEventGroupSetBits(s_wifi_event_group, CONNECTED_BIT);
         s_retry_count = 0;  /* 连接成功，重置重试计数 */
-    } else if (event_base == SC_EVENT && event_id == SC_EVENT_SCAN_DONE) {
-        ESP_LOGI(TAG, "SmartConfig scan done");
-    } else if (event_base == SC_EVENT && event_id == SC_EVENT_FOUND_CHANNEL) {
-        ESP_LOGI(TAG, "SmartConfig found channel");
-    } else if (event_base == SC_EVENT && event_id == SC_EVENT_GOT_SSID_PSWD) {
+        state_shadow_set_wifi(true);
+        FAULT_RECOVERED(FAULT_WIFI_DISCONNECT);
+    } else if (id == APP_EVENT_SC_STATUS) {
+        const app_event_sc_status_t *evt = (const app_event_sc_status_t *)data;
+        ESP_LOGI(TAG, "SmartConfig %s", evt->sc_event == SC_EVENT_SCAN_DONE ? "scan done" : "found channel");
+    } else if (id == APP_EVENT_SC_GOT_CREDENTIALS) {
         ESP_LOGI(TAG, "SmartConfig got SSID and password");
 
-        smartconfig_event_got_ssid_pswd_t *evt = (smartconfig_event_got_ssid_pswd_t *)event_data;
+        const app_event_sc_credentials_t *evt = (const app_event_sc_credentials_t *)data;
         wifi_config_t wifi_config;
 
         memset(&wifi_config, 0, sizeof(wifi_config_t));
@@ -107,43 +180,55 @@ static void event_handler(void *arg, esp_event_base_t event_base,
 
         ESP_LOGI(TAG, "SSID: %s", wifi_config.sta.ssid);
 
-        ESP_ERROR_CHECK(esp_wifi_disconnect());
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+        ret = esp_wifi_disconnect();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "WiFi disconnect failed: %s", esp_err_to_name(ret));
+        }
+        /* 凭据写入 NVS */
+        ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "WiFi set config failed: %s", esp_err_to_name(ret));
+            return;
+        }
         esp_wifi_connect();
-    } else if (event_base == SC_EVENT && event_id == SC_EVENT_SEND_ACK_DONE) {
+    } else if (id == APP_EVENT_SC_ACK_DONE) {
         ESP_LOGI(TAG, "SmartConfig send ACK done");
         xEventGroupSetBits(s_wifi_event_group, ESPTOUCH_DONE_BIT);
     }
 }
 
-static void led_status_task(void *parm)
+static void led_blink_start(void)
+{
+    s_led_blink_state = LED_RED_OFF;
+    timer_wheel_arm(&s_led_blink_timer, 0, LED_BLINK_PERIOD_MS);
+}
+
+static void led_blink_stop(void)
+{
+    timer_wheel_cancel(&s_led_blink_timer);
+    msg_send_to_led(LED_RED_GPIO, LED_RED_OFF);
+}
+
+/**
+ * @brief 闪烁定时器到期: 已连接或配网结束时熄灭红灯并停止，否则翻转一次
+ */
+static void led_blink_tick(void)
 {
-    uint8_t led_state = LED_RED_OFF;
+    EventBits_t bits = xEventGroupGetBits(s_wifi_event_group);
     
-    ESP_LOGI(TAG, "LED status task started");
+    if (bits & CONNECTED_BIT) {
+        led_blink_stop();
+        ESP_LOGI(TAG, "WiFi connected, red LED off");
+        return;
+    }
     
-    while (1) {
-        EventBits_t bits = xEventGroupGetBits(s_wifi_event_group);
-        
-        if (bits & CONNECTED_BIT) {
-            msg_send_to_led(LED_RED_GPIO, LED_RED_OFF);
-            ESP_LOGI(TAG, "WiFi connected, red LED off");
-            break;
-        }
-        
-        if (!(bits & SMARTCONFIG_RUNNING_BIT)) {
-            msg_send_to_led(LED_RED_GPIO, LED_RED_OFF);
-            break;
-        }
-        
-        led_state = (led_state == LED_RED_OFF) ? LED_RED_ON : LED_RED_OFF;
-        msg_send_to_led(LED_RED_GPIO, led_state);
-        
-        vTaskDelay(pdMS_TO_TICKS(200));
+    if (!(bits & SMARTCONFIG_RUNNING_BIT)) {
+        led_blink_stop();
+        return;
     }
     
-    s_led_blink_task_handle = NULL;
-    vTaskDelete(NULL);
+    s_led_blink_state = (s_led_blink_state == LED_RED_OFF) ? LED_RED_ON : LED_RED_OFF;
+    msg_send_to_led(LED_RED_GPIO, s_led_blink_state);
 }
 
 static void smartconfig_task(void *parm)
@@ -151,7 +236,7 @@ static void smartconfig_task(void *parm)
     EventBits_t uxBits;
     
     xEventGroupSetBits(s_wifi_event_group, SMARTCONFIG_RUNNING_BIT);
-    xTaskCreate(led_status_task, "led_status_task", 2048, NULL, 2, &s_led_blink_task_handle);
+    led_blink_start();
     
     ESP_ERROR_CHECK(esp_smartconfig_set_type(SC_TYPE_ESPTOUCH));
     
@@ -168,12 +253,7 @@ static void smartconfig_task(void *parm)
             ESP_LOGI(TAG, "SmartConfig completed successfully");
             esp_smartconfig_stop();
             xEventGroupClearBits(s_wifi_event_group, SMARTCONFIG_RUNNING_BIT);
-            
-            if (s_led_blink_task_handle != NULL) {
-                vTaskDelete(s_led_blink_task_handle);
-                s_led_blink_task_handle = NULL;
-            }
-            msg_send_to_led(LED_RED_GPIO, LED_RED_OFF);
+            led_blink_stop();
             
             s_smartconfig_task_handle = NULL;
             vTaskDelete(NULL);
@@ -190,10 +270,14 @@ static void wifi_msg_task(void *parm)
     QueueHandle_t wifi_queue = msg_queue_get(QUEUE_WIFI);
     msg_t msg;
     
+    /* 清除凭据涉及 NVS 擦写，无重启函数，违规时升级为重启设备 */
+    supervisor_register(APP_TASK_WIFI_MSG, 0, WIFI_MSG_LOOP_SLO_MS, NULL);
+
     ESP_LOGI(TAG, "WiFi message task started");
     
     while (1) {
         if (msg_queue_receive(wifi_queue, &msg, portMAX_DELAY)) {
+            supervisor_loop_begin(APP_TASK_WIFI_MSG);
             if (msg.type == MSG_TYPE_WIFI) {
                 switch (msg.data.wifi.cmd) {
                     case WIFI_CMD_CLEAR_CREDENTIALS:
@@ -204,34 +288,56 @@ static void wifi_msg_task(void *parm)
                         ESP_LOGW(TAG, "Unknown WiFi command: %d", msg.data.wifi.cmd);
                         break;
                 }
+            } else if (msg.type == MSG_TYPE_TIMER) {
+                if (msg.data.timer.timer == &s_led_blink_timer &&
+                    timer_wheel_msg_is_current(&msg.data.timer)) {
+                    led_blink_tick();
+                }
             } else {
                 ESP_LOGW(TAG, "Received non-WiFi message type: %d", msg.type);
             }
+            supervisor_loop_end(APP_TASK_WIFI_MSG);
         }
     }
 }
 
-esp_err_t wifi_manager_init(void)
+static void wifi_fault_disconnect(void)
 {
-    esp_err_t ret;
+    esp_wifi_disconnect();
+}
 
-    ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_LOGW(TAG, "NVS partition issue, erasing...");
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "NVS init failed: %s", esp_err_to_name(ret));
-        return ret;
+/**
+ * @brief WIFI 诊断命令: 连接状态、AP 信息、重试次数、配网状态
+ */
+static esp_err_t cmd_wifi(int argc, char **argv, const diag_out_t *out)
+{
+    wifi_ap_record_t ap;
+    EventBits_t bits = xEventGroupGetBits(s_wifi_event_group);
+
+    diag_printf(out, "connected=%d smartconfig=%d retry=%d/%d\r\n",
+                (bits & CONNECTED_BIT) != 0, (bits & SMARTCONFIG_RUNNING_BIT) != 0,
+                s_retry_count, MAX_RETRY_COUNT);
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        diag_printf(out, "ssid=%s rssi=%d channel=%u\r\n",
+                    (const char *)ap.ssid, ap.rssi, ap.primary);
     }
-    ESP_LOGI(TAG, "NVS initialized");
+    return ESP_OK;
+}
 
+esp_err_t wifi_manager_init(void)
+{
+    esp_err_t ret;
+
+#if CONFIG_APP_STATIC_ALLOCATION
+    s_wifi_event_group = xEventGroupCreateStatic(&s_wifi_event_group_buf);
+#else
     s_wifi_event_group = xEventGroupCreate();
+#endif
     if (s_wifi_event_group == NULL) {
         ESP_LOGE(TAG, "Failed to create event group");
         return ESP_FAIL;
     }
+    timer_wheel_setup_msg(&s_led_blink_timer, "led_blink", QUEUE_WIFI);
 
     ret = esp_netif_init();
     if (ret != ESP_OK) {
@@ -254,9 +360,16 @@ esp_err_t wifi_manager_init(void)
         return ret;
     }
 
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(SC_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL));
+    /* 连接状态处理在应用事件循环中执行，默认循环上只做拷贝和投递 */
+    for (int id = APP_EVENT_WIFI_STA_START; id <= APP_EVENT_SC_ACK_DONE; id++) {
+        ESP_ERROR_CHECK(app_event_register((app_event_id_t)id, wifi_event_handler, NULL));
+    }
+    ESP_ERROR_CHECK(app_event_register_system(WIFI_EVENT, ESP_EVENT_ANY_ID, &system_event_handler, NULL));
+    ESP_ERROR_CHECK(app_event_register_system(IP_EVENT, IP_EVENT_STA_GOT_IP, &system_event_handler, NULL));
+    ESP_ERROR_CHECK(app_event_register_system(SC_EVENT, ESP_EVENT_ANY_ID, &system_event_handler, NULL));
+    fault_inject_set_trigger(FAULT_WIFI_DISCONNECT, wifi_fault_disconnect);
+    diag_cmd_register("WIFI", "WiFi link state, AP RSSI/channel and provisioning",
+                      cmd_wifi, DIAG_ACCESS_REMOTE);
 
     ret = esp_wifi_set_mode(WIFI_MODE_STA);
     if (ret != ESP_OK) {
@@ -281,12 +394,18 @@ bool wifi_manager_is_connected(void)
     return (bits & CONNECTED_BIT) != 0;
 }
 
-esp_err_t wifi_manager_clear_credentials(void)
+bool wifi_manager_wait_connected(uint32_t timeout_ms)
+{
+    if (s_wifi_event_group == NULL) return false;
+    TickType_t ticks = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, CONNECTED_BIT,
+                                           pdFALSE, pdTRUE, ticks);
+    return (bits & CONNECTED_BIT) != 0;
+}
+
+/* 中止进行中的 SmartConfig 并删除配网任务 */
+static void smartconfig_abort(void)
 {
-    esp_err_t ret;
-    
-    ESP_LOGI(TAG, "Clearing WiFi credentials...");
-    
     if (s_smartconfig_task_handle != NULL) {
         esp_smartconfig_stop();
         xEventGroupClearBits(s_wifi_event_group, SMARTCONFIG_RUNNING_BIT);
@@ -294,11 +413,16 @@ esp_err_t wifi_manager_clear_credentials(void)
         s_smartconfig_task_handle = NULL;
     }
     
-    if (s_led_blink_task_handle != NULL) {
-        vTaskDelete(s_led_blink_task_handle);
-        s_led_blink_task_handle = NULL;
-    }
-    msg_send_to_led(LED_RED_GPIO, LED_RED_OFF);
+    led_blink_stop();
+}
+
+esp_err_t wifi_manager_clear_credentials(void)
+{
+    esp_err_t ret;
+    
+    ESP_LOGI(TAG, "Clearing WiFi credentials...");
+    
+    smartconfig_abort();
     
     ret = esp_wifi_disconnect();
     if (ret != ESP_OK) {
@@ -331,10 +455,46 @@ esp_err_t wifi_manager_clear_credentials(void)
     return ESP_OK;
 }
 
+esp_err_t wifi_manager_provision_cycle(uint32_t hold_ms)
+{
+    wifi_config_t saved;
+    wifi_config_t empty = { 0 };
+
+    if (s_wifi_event_group == NULL || s_smartconfig_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = esp_wifi_get_config(WIFI_IF_STA, &saved);
+    if (ret != ESP_OK || strlen((char *)saved.sta.ssid) == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* 凭据只在 RAM 中清空，NVS 保持不变 */
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    s_has_saved_credentials = false;
+    esp_wifi_disconnect();
+    xEventGroupClearBits(s_wifi_event_group, CONNECTED_BIT);
+    esp_wifi_set_config(WIFI_IF_STA, &empty);
+
+    /* 与无凭据启动时相同: 创建配网任务，启动 SmartConfig 和 LED 闪烁 */
+    ret = app_task_create(APP_TASK_SMARTCONFIG, smartconfig_task, NULL,
+                          &s_smartconfig_task_handle) == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
+    if (ret == ESP_OK) {
+        vTaskDelay(pdMS_TO_TICKS(hold_ms));
+        smartconfig_abort();
+    }
+
+    esp_wifi_set_config(WIFI_IF_STA, &saved);
+    esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+    s_has_saved_credentials = true;
+    s_retry_count = 0;
+    esp_wifi_connect();
+    return ret;
+}
+
 void wifi_manager_start_msg_task(void)
 {
     if (s_wifi_msg_task_handle == NULL) {
-        xTaskCreate(wifi_msg_task, "wifi_msg_task", 2048, NULL, 4, &s_wifi_msg_task_handle);
+        app_task_create(APP_TASK_WIFI_MSG, wifi_msg_task, NULL, &s_wifi_msg_task_handle);
         ESP_LOGI(TAG, "WiFi message task created");
     }
 }
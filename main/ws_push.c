@@ -0,0 +1,424 @@
+/**
+ * @file ws_push.c
+ * @brief WebSocket 实时推送实现
+ */
+
+#include "ws_push.h"
+#include "http_api.h"
+#include "state_shadow.h"
+#include "diag_cmd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "ws_push";
+
+#if CONFIG_HTTP_API_WS_ENABLE
+
+#define WS_URI                  "/api/ws"
+#define WS_MAX_CLIENTS          CONFIG_HTTP_API_WS_MAX_CLIENTS
+#define WS_QUEUE_LEN            CONFIG_HTTP_API_WS_QUEUE_LEN
+#define WS_FLUSH_BATCH          4       /* 每次调度最多发送条数，之后让出 httpd 任务 */
+#define WS_OVERFLOW_CLOSE       16      /* 未排空期间累计丢弃达到该数则断开 */
+#define WS_PING_INTERVAL_US     (20 * 1000000)
+#define WS_RX_MAX               32
+#define WS_SNAPSHOT_SIZE        192
+#define WS_CMD_SNAPSHOT         "snapshot"
+
+/**
+ * @brief 引用计数的已编码消息，所有客户端队列共享
+ */
+typedef struct {
+    uint32_t refs;
+    size_t len;
+    uint8_t data[];
+} ws_msg_t;
+
+typedef struct {
+    int fd;                     /* -1 表示空闲 */
+    QueueHandle_t queue;        /* ws_msg_t * */
+    bool scheduled;             /* 已提交 flush_work */
+    bool resync;                /* 丢过消息或新连接，排空后发送快照 */
+    uint32_t backlog_drops;
+    uint32_t sent;
+    uint32_t dropped;
+} ws_client_t;
+
+static httpd_handle_t s_server = NULL;
+static ws_client_t s_clients[WS_MAX_CLIENTS];
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_ref_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_ping_timer = NULL;
+static uint32_t s_encoded = 0;      /* 分配的消息数 */
+static uint32_t s_enqueued = 0;     /* 入队次数 (扇出) */
+
+#if CONFIG_APP_STATIC_ALLOCATION
+static StaticSemaphore_t s_lock_buf;
+static StaticQueue_t s_queue_bufs[WS_MAX_CLIENTS];
+static uint8_t s_queue_storage[WS_MAX_CLIENTS][WS_QUEUE_LEN * sizeof(ws_msg_t *)];
+#endif
+
+static void flush_work(void *arg);
+
+static void msg_release(ws_msg_t *m)
+{
+    bool last;
+
+    portENTER_CRITICAL(&s_ref_lock);
+    last = (--m->refs == 0);
+    portEXIT_CRITICAL(&s_ref_lock);
+    if (last) {
+        free(m);
+    }
+}
+
+/**
+ * @brief 提交发送工作到 httpd 任务 (持锁调用)
+ */
+static void schedule(int idx)
+{
+    ws_client_t *c = &s_clients[idx];
+
+    if (!c->scheduled && httpd_queue_work(s_server, flush_work, (void *)(intptr_t)idx) == ESP_OK) {
+        c->scheduled = true;
+    }
+}
+
+/**
+ * @brief 释放客户端槽位和排队的消息 (持锁调用)
+ */
+static void client_reset(ws_client_t *c)
+{
+    ws_msg_t *m;
+
+    while (xQueueReceive(c->queue, &m, 0) == pdTRUE) {
+        msg_release(m);
+    }
+    c->fd = -1;
+    c->resync = false;
+    c->backlog_drops = 0;
+}
+
+/**
+ * @brief 状态影子监听: 编码结果只拷贝一次，各客户端队列共享引用
+ */
+static void shadow_listener(state_shadow_kind_t kind, const char *json, size_t len)
+{
+    uint32_t active = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        active += (s_clients[i].fd >= 0);
+    }
+    if (active == 0) {
+        xSemaphoreGive(s_lock);
+        return;
+    }
+
+    ws_msg_t *m = malloc(sizeof(*m) + len);
+    if (m != NULL) {
+        m->refs = active;
+        m->len = len;
+        memcpy(m->data, json, len);
+        s_encoded++;
+    }
+
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ws_client_t *c = &s_clients[i];
+        if (c->fd < 0) {
+            continue;
+        }
+        if (m != NULL && xQueueSend(c->queue, &m, 0) == pdTRUE) {
+            s_enqueued++;
+        } else {
+            /* 慢客户端: 丢弃并在排空后补发快照，长期跟不上则断开 */
+            if (m != NULL) {
+                msg_release(m);
+            }
+            c->dropped++;
+            c->resync = true;
+            if (++c->backlog_drops == WS_OVERFLOW_CLOSE) {
+                ESP_LOGW(TAG, "Client %d cannot keep up, closing", c->fd);
+                httpd_sess_trigger_close(s_server, c->fd);
+            }
+        }
+        schedule(i);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/**
+ * @brief 在 httpd 任务中发送一个客户端排队的消息
+ */
+static void flush_work(void *arg)
+{
+    int idx = (int)(intptr_t)arg;
+    ws_client_t *c = &s_clients[idx];
+    char snapshot[WS_SNAPSHOT_SIZE];
+
+    for (int n = 0; n < WS_FLUSH_BATCH; n++) {
+        ws_msg_t *m = NULL;
+        bool want_snapshot = false;
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int fd = c->fd;
+        if (fd >= 0 && xQueueReceive(c->queue, &m, 0) != pdTRUE) {
+            m = NULL;
+            want_snapshot = c->resync;
+            c->resync = false;
+            c->backlog_drops = 0;
+        }
+        if (fd < 0 || (m == NULL && !want_snapshot)) {
+            c->scheduled = false;
+            xSemaphoreGive(s_lock);
+            return;
+        }
+        xSemaphoreGive(s_lock);
+
+        httpd_ws_frame_t frame = {
+            .type = HTTPD_WS_TYPE_TEXT,
+            .final = true,
+        };
+        if (m != NULL) {
+            frame.payload = m->data;
+            frame.len = m->len;
+        } else {
+            frame.payload = (uint8_t *)snapshot;
+            frame.len = state_shadow_snapshot(snapshot, sizeof(snapshot));
+        }
+
+        esp_err_t ret = frame.len ? httpd_ws_send_frame_async(s_server, fd, &frame) : ESP_OK;
+        if (m != NULL) {
+            msg_release(m);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Send to client %d failed: %s", fd, esp_err_to_name(ret));
+            httpd_sess_trigger_close(s_server, fd);
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            c->scheduled = false;
+            xSemaphoreGive(s_lock);
+            return;
+        }
+        c->sent++;
+    }
+
+    /* 达到批量上限，重新排队让其他连接先处理 */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    c->scheduled = false;
+    schedule(idx);
+    xSemaphoreGive(s_lock);
+}
+
+static esp_err_t client_add(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    int idx = -1;
+
+    if (!http_api_ws_authorized(req)) {
+        ESP_LOGW(TAG, "Unauthorized client %d", fd);
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_CLIENTS && idx < 0; i++) {
+        if (s_clients[i].fd < 0) {
+            idx = i;
+        }
+    }
+    if (idx >= 0) {
+        ws_client_t *c = &s_clients[idx];
+        c->fd = fd;
+        c->resync = true;
+        c->backlog_drops = 0;
+        c->sent = 0;
+        c->dropped = 0;
+        schedule(idx);
+    }
+    xSemaphoreGive(s_lock);
+
+    if (idx < 0) {
+        ESP_LOGW(TAG, "Client limit (%d) reached, rejecting %d", WS_MAX_CLIENTS, fd);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Client %d connected", fd);
+    return ESP_OK;
+}
+
+/**
+ * @brief 握手 (GET) 或客户端发来的数据帧
+ */
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    uint8_t buf[WS_RX_MAX];
+    httpd_ws_frame_t frame = { 0 };
+
+    if (req->method == HTTP_GET) {
+        return client_add(req);
+    }
+
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK || frame.len > sizeof(buf)) {
+        return ESP_FAIL;
+    }
+    if (frame.len > 0) {
+        frame.payload = buf;
+        ret = httpd_ws_recv_frame(req, &frame, frame.len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    if (frame.type == HTTPD_WS_TYPE_TEXT && frame.len == strlen(WS_CMD_SNAPSHOT) &&
+        memcmp(buf, WS_CMD_SNAPSHOT, frame.len) == 0) {
+        int fd = httpd_req_to_sockfd(req);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+            if (s_clients[i].fd == fd) {
+                s_clients[i].resync = true;
+                schedule(i);
+            }
+        }
+        xSemaphoreGive(s_lock);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 定期 PING: 及时发现断线，且对端 PONG 刷新连接的 LRU 时间，
+ *        避免只接收推送的仪表盘被 REST 请求挤掉
+ */
+static void ping_work(void *arg)
+{
+    httpd_ws_frame_t frame = {
+        .type = HTTPD_WS_TYPE_PING,
+        .final = true,
+    };
+    int fds[WS_MAX_CLIENTS];
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        fds[i] = s_clients[i].fd;
+    }
+    xSemaphoreGive(s_lock);
+
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (fds[i] >= 0 && httpd_ws_send_frame_async(s_server, fds[i], &frame) != ESP_OK) {
+            httpd_sess_trigger_close(s_server, fds[i]);
+        }
+    }
+}
+
+static void ping_timer_callback(void *arg)
+{
+    httpd_queue_work(s_server, ping_work, NULL);
+}
+
+/**
+ * @brief WS 命令: 客户端队列与发送统计
+ */
+static esp_err_t cmd_ws(int argc, char **argv, const diag_out_t *out)
+{
+    diag_printf(out, "ws: %lu encoded, %lu enqueued\r\n",
+                (unsigned long)s_encoded, (unsigned long)s_enqueued);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        const ws_client_t *c = &s_clients[i];
+        if (c->fd >= 0) {
+            diag_printf(out, "  fd %d: queued %lu/%d, sent %lu, dropped %lu\r\n", c->fd,
+                        (unsigned long)uxQueueMessagesWaiting(c->queue), WS_QUEUE_LEN,
+                        (unsigned long)c->sent, (unsigned long)c->dropped);
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+esp_err_t ws_push_register(httpd_handle_t server)
+{
+    static const httpd_uri_t uri = {
+        .uri = WS_URI,
+        .method = HTTP_GET,
+        .handler = ws_handler,
+        .is_websocket = true,
+    };
+
+    if (s_lock == NULL) {
+#if CONFIG_APP_STATIC_ALLOCATION
+        s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+#else
+        s_lock = xSemaphoreCreateMutex();
+#endif
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+#if CONFIG_APP_STATIC_ALLOCATION
+            s_clients[i].queue = xQueueCreateStatic(WS_QUEUE_LEN, sizeof(ws_msg_t *),
+                                                    s_queue_storage[i], &s_queue_bufs[i]);
+#else
+            s_clients[i].queue = xQueueCreate(WS_QUEUE_LEN, sizeof(ws_msg_t *));
+#endif
+            if (s_clients[i].queue == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+            s_clients[i].fd = -1;
+        }
+        state_shadow_add_listener(shadow_listener);
+        diag_cmd_register("WS", "WebSocket push clients", cmd_ws, DIAG_ACCESS_REMOTE);
+    }
+    s_server = server;
+
+    esp_err_t ret = httpd_register_uri_handler(server, &uri);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (s_ping_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = ping_timer_callback,
+            .name = "ws_ping",
+        };
+        if (esp_timer_create(&args, &s_ping_timer) == ESP_OK) {
+            esp_timer_start_periodic(s_ping_timer, WS_PING_INTERVAL_US);
+        }
+    }
+
+    ESP_LOGI(TAG, "Push endpoint %s (%d clients, queue %d)", WS_URI, WS_MAX_CLIENTS, WS_QUEUE_LEN);
+    return ESP_OK;
+}
+
+void ws_push_session_closed(int sockfd)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (s_clients[i].fd == sockfd) {
+            ESP_LOGI(TAG, "Client %d closed (sent %lu, dropped %lu)", sockfd,
+                     (unsigned long)s_clients[i].sent, (unsigned long)s_clients[i].dropped);
+            client_reset(&s_clients[i]);
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+#else /* !CONFIG_HTTP_API_WS_ENABLE */
+
+esp_err_t ws_push_register(httpd_handle_t server)
+{
+    return ESP_OK;
+}
+
+void ws_push_session_closed(int sockfd)
+{
+}
+
+#endif /* CONFIG_HTTP_API_WS_ENABLE */
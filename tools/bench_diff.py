@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Compare two outputs of the BENCH diagnostic command.
+
+BENCH prints one line per case: <case> <min> <median> <max> (CPU cycles),
+plus '#' comment lines with the firmware version and clock. Capture the
+output of each release (serial log, BLE or MQTT diag response) into a
+file; other log lines in the capture are ignored.
+
+Cases are compared by median. A case whose median grew by more than
+--tolerance percent is reported as a regression and makes the exit
+status 1. Cases missing from either side are listed but not failed.
+
+Usage:
+    tools/bench_diff.py bench_v1.2.txt bench_v1.3.txt
+    tools/bench_diff.py old.txt new.txt --tolerance 5
+"""
+
+import argparse
+import re
+import sys
+
+LINE = re.compile(r'^\s*([a-z_][a-z0-9_]*)\s+(\d+)\s+(\d+)\s+(\d+)\s*$')
+
+
+def load(path):
+    cases = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            if line.lstrip().startswith('#'):
+                continue
+            m = LINE.match(line)
+            if m:
+                cases[m.group(1)] = tuple(int(v) for v in m.group(2, 3, 4))
+    return cases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('old', help='BENCH output of the reference build')
+    parser.add_argument('new', help='BENCH output of the build under test')
+    parser.add_argument('--tolerance', type=float, default=10.0,
+                        help='allowed median increase in percent')
+    opts = parser.parse_args()
+
+    old, new = load(opts.old), load(opts.new)
+    if not old or not new:
+        sys.exit('no BENCH lines in %s' % (opts.old if not old else opts.new))
+
+    regressions = 0
+    print('%-16s %9s %9s %8s  %s' % ('case', 'old med', 'new med', 'change', 'new min/max'))
+    for name in sorted(set(old) | set(new)):
+        if name not in old or name not in new:
+            print('%-16s %s' % (name, 'only in ' + (opts.old if name in old else opts.new)))
+            continue
+        ref, cur = old[name][1], new[name][1]
+        change = (cur - ref) * 100.0 / ref if ref else 0.0
+        flag = ''
+        # a couple of cycles is counter jitter, not a regression
+        if cur - ref > 2 and cur > ref * (1 + opts.tolerance / 100.0):
+            flag = '  REGRESSION'
+            regressions += 1
+        print('%-16s %9d %9d %+7.1f%%  %d/%d%s' % (name, ref, cur, change,
+                                                  new[name][0], new[name][2], flag))
+
+    if regressions:
+        print('%d case(s) slower than %.0f%%' % (regressions, opts.tolerance))
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == '__main__':
+    main()
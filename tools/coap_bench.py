@@ -0,0 +1,684 @@
+#!/usr/bin/env python3
+"""Compare door command latency and radio activity over CoAP and MQTT.
+
+Both paths send the same alternating open/close commands and wait until the
+device confirms the new door state:
+
+  coap  PUT /door (CON) -> piggybacked 2.04 ACK, then the /door observe
+        notification carrying the new state
+  mqtt  PUBLISH esp32c6/<id>/door/set (QoS 1) -> PUBACK from the broker,
+        then the esp32c6/<id>/door/state message from the device
+
+For each command the report shows the ack and confirm latency, the frames
+exchanged, and an estimated radio-on time.
+- CoAP frames are counted exactly, because this tool is the device's peer.
+- MQTT frames: the device's link to the broker carries the mirror image of
+  this tool's link, so TCP segments counted on our socket (Linux TCP_INFO)
+  stand in for the device's.
+- Radio-on estimate: confirm latency plus --tail-ms per burst. For MQTT,
+  add the keepalive bursts that fall in --interval seconds between
+  commands. CoAP has no session to keep alive.
+
+Enable CONFIG_COAP_SERVER_ENABLE and set CONFIG_COAP_SERVER_KEY on the
+device first; without a key the device does not serve /door. The door moves!
+
+Usage:
+    tools/coap_bench.py coap 192.168.1.50 --key <key> -n 20
+    tools/coap_bench.py mqtt 192.168.1.10 --device a1b2c3 -n 20
+    tools/coap_bench.py both 192.168.1.50 --key <key> --broker 192.168.1.10 --device a1b2c3
+    tools/coap_bench.py get 192.168.1.50 /telemetry --observe 5
+    tools/coap_bench.py selftest
+"""
+
+import argparse
+import json
+import os
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+CON, NON, ACK, RST = range(4)
+GET, POST, PUT = 1, 2, 3
+CHANGED, CONTENT = 0x44, 0x45
+UNAUTHORIZED, NOT_FOUND = 0x81, 0x84
+OPT_OBSERVE, OPT_URI_PATH, OPT_CONTENT_FORMAT, OPT_URI_QUERY = 6, 11, 12, 15
+ACK_TIMEOUT = 2.0
+MAX_RETRANSMIT = 4
+
+
+def code_str(code):
+    return '%d.%02d' % (code >> 5, code & 0x1F)
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return 0.0
+    idx = min(len(sorted_values) - 1, int(round(pct / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[idx]
+
+
+# ---------------------------------------------------------------- CoAP codec
+
+def _ext(v):
+    if v < 13:
+        return v, b''
+    if v < 269:
+        return 13, bytes([v - 13])
+    return 14, struct.pack('>H', v - 269)
+
+
+def uint_opt(v):
+    return v.to_bytes((v.bit_length() + 7) // 8, 'big')
+
+
+def encode(mtype, code, mid, token=b'', options=(), payload=b''):
+    out = bytearray([0x40 | mtype << 4 | len(token), code]) + struct.pack('>H', mid) + token
+    last = 0
+    # sorted() is stable, so repeated options (Uri-Path) keep their order
+    for num, val in sorted(options, key=lambda o: o[0]):
+        dn, dx = _ext(num - last)
+        ln, lx = _ext(len(val))
+        out += bytes([dn << 4 | ln]) + dx + lx + val
+        last = num
+    if payload:
+        out += b'\xff' + payload
+    return bytes(out)
+
+
+class Message:
+    def __init__(self, mtype, code, mid, token, options, payload):
+        self.type, self.code, self.mid = mtype, code, mid
+        self.token, self.options, self.payload = token, options, payload
+
+    def opt(self, num):
+        return [v for n, v in self.options if n == num]
+
+    @property
+    def observe(self):
+        vals = self.opt(OPT_OBSERVE)
+        return int.from_bytes(vals[0], 'big') if vals else None
+
+    @property
+    def path(self):
+        return '/'.join(v.decode() for v in self.opt(OPT_URI_PATH))
+
+
+def _read_ext(data, pos, v):
+    if v == 13:
+        return data[pos] + 13, pos + 1
+    if v == 14:
+        return struct.unpack_from('>H', data, pos)[0] + 269, pos + 2
+    if v == 15:
+        raise ValueError('reserved option nibble')
+    return v, pos
+
+
+def decode(data):
+    if len(data) < 4 or data[0] >> 6 != 1:
+        raise ValueError('not a CoAP message')
+    mtype, tkl = data[0] >> 4 & 3, data[0] & 0x0F
+    code, mid = data[1], struct.unpack_from('>H', data, 2)[0]
+    if tkl > 8 or 4 + tkl > len(data):
+        raise ValueError('bad token length')
+    token, pos, num = bytes(data[4:4 + tkl]), 4 + tkl, 0
+    options, payload = [], b''
+    try:
+        while pos < len(data):
+            if data[pos] == 0xFF:
+                payload = bytes(data[pos + 1:])
+                if not payload:
+                    raise ValueError('payload marker without payload')
+                break
+            delta, length = data[pos] >> 4, data[pos] & 0x0F
+            delta, pos = _read_ext(data, pos + 1, delta)
+            length, pos = _read_ext(data, pos, length)
+            if pos + length > len(data):
+                raise ValueError('option runs past end')
+            num += delta
+            options.append((num, bytes(data[pos:pos + length])))
+            pos += length
+    except (IndexError, struct.error):
+        raise ValueError('truncated options')
+    return Message(mtype, code, mid, token, options, payload)
+
+
+def door_of(payload):
+    try:
+        return json.loads(payload).get('door')
+    except ValueError:
+        return None
+
+
+class CoapClient:
+    def __init__(self, host, port, timeout):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.addr = (host, port)
+        self.timeout = timeout
+        self.mid = random.randrange(0x10000)
+        self.tx = self.rx = 0
+        self.pending = []
+        self.observe_token = None
+        self.door = None
+
+    def close(self):
+        self.sock.close()
+
+    def next_mid(self):
+        self.mid = (self.mid + 1) & 0xFFFF
+        return self.mid
+
+    def send(self, data):
+        self.sock.sendto(data, self.addr)
+        self.tx += 1
+
+    def recv(self, deadline):
+        remaining = deadline - time.perf_counter()
+        if remaining <= 0:
+            raise socket.timeout()
+        self.sock.settimeout(remaining)
+        data, _ = self.sock.recvfrom(2048)
+        self.rx += 1
+        msg = decode(data)
+        if msg.type == CON:
+            self.send(encode(ACK, 0, msg.mid))
+        if self.observe_token is not None and msg.token == self.observe_token and msg.payload:
+            self.door = door_of(msg.payload) or self.door
+        return msg
+
+    def request(self, code, path, payload=b'', observe=None, query=None, token=None):
+        token = token or os.urandom(4)
+        mid = self.next_mid()
+        opts = [(OPT_URI_PATH, p.encode()) for p in path.strip('/').split('/') if p]
+        if observe is not None:
+            opts.append((OPT_OBSERVE, uint_opt(observe)))
+        if query:
+            opts.append((OPT_URI_QUERY, query.encode()))
+        pkt = encode(CON, code, mid, token, opts, payload)
+        wait = ACK_TIMEOUT * random.uniform(1.0, 1.5)
+        for _ in range(MAX_RETRANSMIT + 1):
+            self.send(pkt)
+            deadline = time.perf_counter() + wait
+            while True:
+                try:
+                    msg = self.recv(deadline)
+                except socket.timeout:
+                    break
+                if msg.type == ACK and msg.mid == mid and msg.code:
+                    return token, msg
+                if msg.token == token and msg.code and msg.type != ACK:
+                    return token, msg       # separate response
+                self.pending.append(msg)
+            wait *= 2
+        raise TimeoutError('no response to %s /%s' % (code_str(code), path))
+
+    def wait_for(self, predicate, deadline):
+        for i, msg in enumerate(self.pending):
+            if predicate(msg):
+                del self.pending[i]
+                return msg
+        while True:
+            msg = self.recv(deadline)
+            if predicate(msg):
+                return msg
+
+
+# ---------------------------------------------------------------- MQTT 3.1.1
+
+def _varint(n):
+    out = bytearray()
+    while True:
+        b, n = n & 0x7F, n >> 7
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def _mstr(s):
+    b = s.encode() if isinstance(s, str) else s
+    return struct.pack('>H', len(b)) + b
+
+
+def mqtt_packet(ptype, flags, body=b''):
+    return bytes([ptype << 4 | flags]) + _varint(len(body)) + body
+
+
+def tcp_segments(sock):
+    """(segs_out, segs_in) from Linux TCP_INFO, or None elsewhere."""
+    try:
+        info = sock.getsockopt(socket.IPPROTO_TCP, socket.TCP_INFO, 256)
+    except (AttributeError, OSError):
+        return None
+    if len(info) < 144:
+        return None
+    return struct.unpack_from('<II', info, 136)
+
+
+class MqttClient:
+    CONNECT, CONNACK, PUBLISH, PUBACK, SUBSCRIBE, SUBACK = 1, 2, 3, 4, 8, 9
+    PINGREQ, PINGRESP, DISCONNECT = 12, 13, 14
+
+    def __init__(self, host, port, timeout, keepalive=120, user=None, password=None):
+        started = time.perf_counter()
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.timeout = timeout
+        self.pid = 0
+        self.buf = b''
+        self.messages = []
+        flags = 0x02 | (0x80 if user else 0) | (0x40 if password else 0)
+        body = _mstr('MQTT') + bytes([4, flags]) + struct.pack('>H', keepalive)
+        body += _mstr('bench-%06x' % random.randrange(1 << 24))
+        if user:
+            body += _mstr(user)
+        if password:
+            body += _mstr(password)
+        self.sock.sendall(mqtt_packet(self.CONNECT, 0, body))
+        ptype, _, body = self.read_packet(time.perf_counter() + timeout)
+        if ptype != self.CONNACK or body[1] != 0:
+            raise ConnectionError('CONNACK refused (%d)' % body[1])
+        self.connect_time = time.perf_counter() - started
+
+    def close(self, graceful=True):
+        try:
+            if graceful:
+                self.sock.sendall(mqtt_packet(self.DISCONNECT, 0))
+        finally:
+            self.sock.close()
+
+    def _read(self, n, deadline):
+        while len(self.buf) < n:
+            remaining = deadline - time.perf_counter()
+            if remaining <= 0:
+                raise socket.timeout()
+            self.sock.settimeout(remaining)
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError('broker closed the connection')
+            self.buf += chunk
+        out, self.buf = self.buf[:n], self.buf[n:]
+        return out
+
+    def read_packet(self, deadline):
+        head = self._read(1, deadline)[0]
+        length, shift = 0, 0
+        while True:
+            b = self._read(1, deadline)[0]
+            length |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        body = self._read(length, deadline)
+        ptype, flags = head >> 4, head & 0x0F
+        if ptype == self.PUBLISH:
+            tlen = struct.unpack_from('>H', body)[0]
+            topic, rest = body[2:2 + tlen].decode(), body[2 + tlen:]
+            if (flags >> 1) & 3:
+                pid = rest[:2]
+                rest = rest[2:]
+                self.sock.sendall(mqtt_packet(self.PUBACK, 0, pid))
+            self.messages.append((topic, rest))
+        return ptype, flags, body
+
+    def next_pid(self):
+        self.pid = self.pid % 0xFFFF + 1
+        return self.pid
+
+    def wait(self, ptype, deadline, pid=None):
+        while True:
+            got, _, body = self.read_packet(deadline)
+            if got == ptype and (pid is None or struct.unpack_from('>H', body)[0] == pid):
+                return body
+
+    def wait_message(self, topic, payload, deadline):
+        while True:
+            for i, (t, p) in enumerate(self.messages):
+                if t == topic and (payload is None or p == payload):
+                    del self.messages[i]
+                    return p
+            self.read_packet(deadline)
+
+    def subscribe(self, topic, qos=0):
+        pid = self.next_pid()
+        self.sock.sendall(mqtt_packet(self.SUBSCRIBE, 2, struct.pack('>H', pid) + _mstr(topic) + bytes([qos])))
+        self.wait(self.SUBACK, time.perf_counter() + self.timeout, pid)
+
+    def publish(self, topic, payload, qos=1):
+        pid = self.next_pid() if qos else None
+        body = _mstr(topic) + (struct.pack('>H', pid) if qos else b'') + payload
+        self.sock.sendall(mqtt_packet(self.PUBLISH, qos << 1, body))
+        return pid
+
+    def ping(self):
+        started = time.perf_counter()
+        self.sock.sendall(mqtt_packet(self.PINGREQ, 0))
+        self.wait(self.PINGRESP, started + self.timeout)
+        return time.perf_counter() - started
+
+
+# ---------------------------------------------------------------- benchmarks
+
+class Result:
+    def __init__(self, name):
+        self.name = name
+        self.ack, self.confirm, self.frames = [], [], []
+        self.errors = []
+        self.keepalive_ms = 0.0         # one keepalive exchange
+        self.keepalive_frames = 0
+        self.keepalive_s = 0
+
+
+def run_coap(opts):
+    res = Result('coap')
+    client = CoapClient(opts.host, opts.coap_port, opts.timeout)
+    query = 'k=' + opts.key if opts.key else None
+    try:
+        token, resp = client.request(GET, 'door', observe=0)
+        if resp.observe is None:
+            raise RuntimeError('device did not accept the /door observation')
+        client.observe_token = token
+        client.door = door_of(resp.payload)
+        for _ in range(opts.requests):
+            want = 'closed' if client.door == 'open' else 'open'
+            tx0, rx0 = client.tx, client.rx
+            t0 = time.perf_counter()
+            try:
+                _, ack = client.request(PUT, 'door', b'open' if want == 'open' else b'close', query=query)
+                t_ack = time.perf_counter()
+                if ack.code != CHANGED:
+                    res.errors.append(code_str(ack.code))
+                    continue
+                client.wait_for(lambda m: m.token == token and door_of(m.payload) == want,
+                                t0 + opts.timeout)
+            except (socket.timeout, TimeoutError, ValueError) as exc:
+                res.errors.append(type(exc).__name__)
+                continue
+            t_conf = time.perf_counter()
+            res.ack.append(t_ack - t0)
+            res.confirm.append(t_conf - t0)
+            res.frames.append(client.tx - tx0 + client.rx - rx0)
+            time.sleep(opts.gap)
+        # GET without Observe cancels the registration
+        client.observe_token = None
+        client.request(GET, 'door', token=token)
+    finally:
+        client.close()
+    return res
+
+
+def run_mqtt(opts):
+    res = Result('mqtt')
+    prefix = 'esp32c6/%s' % opts.device
+    state_topic, cmd_topic = prefix + '/door/state', prefix + '/door/set'
+    client = MqttClient(opts.broker, opts.mqtt_port, opts.timeout, opts.keepalive,
+                        opts.user, opts.password)
+    try:
+        client.subscribe(state_topic)
+        # the retained state arrives right after SUBACK
+        state = client.wait_message(state_topic, None, time.perf_counter() + opts.timeout)
+        seg0 = tcp_segments(client.sock)
+        res.keepalive_ms = client.ping() * 1000
+        time.sleep(0.3)     # let the trailing ACK, if any, go out
+        seg1 = tcp_segments(client.sock)
+        res.keepalive_frames = sum(seg1) - sum(seg0) if seg0 and seg1 else 2
+        res.keepalive_s = opts.keepalive
+
+        segs = tcp_segments(client.sock)
+        for _ in range(opts.requests):
+            want = b'OFF' if state == b'ON' else b'ON'
+            t0 = time.perf_counter()
+            try:
+                pid = client.publish(cmd_topic, want, qos=1)
+                client.wait(client.PUBACK, t0 + opts.timeout, pid)
+                t_ack = time.perf_counter()
+                state = client.wait_message(state_topic, want, t0 + opts.timeout)
+            except (socket.timeout, ConnectionError) as exc:
+                res.errors.append(type(exc).__name__)
+                break
+            t_conf = time.perf_counter()
+            res.ack.append(t_ack - t0)
+            res.confirm.append(t_conf - t0)
+            # counted up to the next command so delayed ACKs are included
+            time.sleep(opts.gap)
+            now = tcp_segments(client.sock)
+            res.frames.append(sum(now) - sum(segs) if now and segs else 4)
+            segs = now
+    finally:
+        client.close()
+    return res
+
+
+def report(res, opts):
+    ack = sorted(v * 1000 for v in res.ack)
+    conf = sorted(v * 1000 for v in res.confirm)
+    print('%-5s %d ok, %d errors' % (res.name, len(conf), len(res.errors)))
+    if not conf:
+        if res.errors:
+            print('      errors: %s' % ', '.join(sorted(set(res.errors))))
+        return
+    frames = sum(res.frames) / float(len(res.frames))
+    radio = sum(conf) / len(conf) + opts.tail_ms
+    if res.keepalive_s:
+        bursts = opts.interval / float(res.keepalive_s)
+        radio += bursts * (res.keepalive_ms + opts.tail_ms)
+        frames_ka = bursts * res.keepalive_frames
+    else:
+        frames_ka = 0.0
+    print('      ack ms:     p50 %7.2f  p90 %7.2f' % (percentile(ack, 50), percentile(ack, 90)))
+    print('      confirm ms: p50 %7.2f  p90 %7.2f' % (percentile(conf, 50), percentile(conf, 90)))
+    print('      frames/cmd: %.1f + %.1f keepalive over %ds' % (frames, frames_ka, opts.interval))
+    print('      est. radio-on per cmd: %.1f ms (tail %d ms per burst)' % (radio, opts.tail_ms))
+    if res.errors:
+        print('      errors: %s' % ', '.join(sorted(set(res.errors))))
+
+
+def run_get(opts):
+    client = CoapClient(opts.host, opts.coap_port, opts.timeout)
+    try:
+        observe = 0 if opts.observe else None
+        token, resp = client.request(GET, opts.path, observe=observe)
+        print('%s obs=%s %s' % (code_str(resp.code), resp.observe, resp.payload.decode(errors='replace')))
+        for _ in range(opts.observe):
+            msg = client.wait_for(lambda m: m.token == token, time.perf_counter() + 3600)
+            print('%s obs=%s %s' % (code_str(msg.code), msg.observe, msg.payload.decode(errors='replace')))
+        if opts.observe:
+            client.request(GET, opts.path, token=token)
+    finally:
+        client.close()
+
+
+# ---------------------------------------------------------------- selftest
+
+class FakeDevice:
+    """CoAP server and MQTT broker+device on localhost sharing one door state."""
+
+    def __init__(self, key):
+        self.key = key
+        self.door = False
+        self.lock = threading.Lock()
+        self.udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.udp.bind(('127.0.0.1', 0))
+        self.tcp = socket.socket()
+        self.tcp.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.tcp.bind(('127.0.0.1', 0))
+        self.tcp.listen(1)
+        self.observers = {}
+        self.seq = 0
+        self.mid = 1000
+        for fn in (self.coap_loop, self.mqtt_loop):
+            threading.Thread(target=fn, daemon=True).start()
+
+    def state_json(self):
+        return json.dumps({'type': 'state', 'seq': self.seq,
+                           'door': 'open' if self.door else 'closed'}).encode()
+
+    def coap_loop(self):
+        while True:
+            data, addr = self.udp.recvfrom(2048)
+            msg = decode(data)
+            if msg.type in (ACK, RST) or not msg.code:
+                continue
+            fmt = [(OPT_CONTENT_FORMAT, uint_opt(50))]
+            if msg.path != 'door':
+                self.udp.sendto(encode(ACK, NOT_FOUND, msg.mid, msg.token), addr)
+            elif msg.code == GET:
+                if msg.observe == 0:
+                    self.observers[addr] = msg.token
+                    opts = [(OPT_OBSERVE, uint_opt(self.seq))] + fmt
+                else:
+                    self.observers.pop(addr, None)
+                    opts = fmt
+                self.udp.sendto(encode(ACK, CONTENT, msg.mid, msg.token, opts, self.state_json()), addr)
+            elif msg.opt(OPT_URI_QUERY) != [b'k=' + self.key.encode()]:
+                self.udp.sendto(encode(ACK, UNAUTHORIZED, msg.mid, msg.token), addr)
+            else:
+                self.udp.sendto(encode(ACK, CHANGED, msg.mid, msg.token), addr)
+                self.set_door(msg.payload == b'open')
+
+    def set_door(self, is_open):
+        with self.lock:
+            self.door = is_open
+            self.seq += 1
+            for addr, token in self.observers.items():
+                self.mid += 1
+                self.udp.sendto(encode(CON, CONTENT, self.mid, token,
+                                       [(OPT_OBSERVE, uint_opt(self.seq))], self.state_json()), addr)
+            conn = getattr(self, 'conn', None)
+            if conn is not None and getattr(self, 'state_topic', None):
+                body = _mstr(self.state_topic) + (b'ON' if is_open else b'OFF')
+                conn.sendall(mqtt_packet(MqttClient.PUBLISH, 0, body))
+
+    def mqtt_loop(self):
+        while True:
+            self.conn, _ = self.tcp.accept()
+            reader = MqttClient.__new__(MqttClient)
+            reader.sock, reader.buf, reader.messages = self.conn, b'', []
+            try:
+                while True:
+                    ptype, flags, body = reader.read_packet(time.perf_counter() + 30)
+                    if ptype == MqttClient.CONNECT:
+                        self.conn.sendall(mqtt_packet(MqttClient.CONNACK, 0, b'\x00\x00'))
+                    elif ptype == MqttClient.SUBSCRIBE:
+                        tlen = struct.unpack_from('>H', body, 2)[0]
+                        self.state_topic = body[4:4 + tlen].decode()
+                        self.conn.sendall(mqtt_packet(MqttClient.SUBACK, 0, body[:2] + b'\x00'))
+                        self.conn.sendall(mqtt_packet(MqttClient.PUBLISH, 1, _mstr(self.state_topic) +
+                                                      (b'ON' if self.door else b'OFF')))
+                    elif ptype == MqttClient.PUBLISH:
+                        topic, payload = reader.messages.pop()
+                        self.set_door(payload == b'ON')
+                    elif ptype == MqttClient.PINGREQ:
+                        self.conn.sendall(mqtt_packet(MqttClient.PINGRESP, 0))
+                    elif ptype == MqttClient.DISCONNECT:
+                        break
+            except (ConnectionError, OSError, socket.timeout):
+                pass
+            self.conn.close()
+            self.conn = None
+
+
+def selftest():
+    # codec: extended option deltas and lengths, repeated options, payload
+    long_val = bytes(range(256)) + b'xyz' * 20
+    opts = [(OPT_URI_PATH, b'a'), (OPT_URI_PATH, b'b'), (OPT_OBSERVE, uint_opt(0x123456)),
+            (300, long_val), (OPT_URI_QUERY, b'k=secret')]
+    pkt = encode(CON, PUT, 0xBEEF, b'\x01\x02\x03', opts, b'open')
+    msg = decode(pkt)
+    assert (msg.type, msg.code, msg.mid, msg.token) == (CON, PUT, 0xBEEF, b'\x01\x02\x03')
+    assert msg.path == 'a/b' and msg.observe == 0x123456 and msg.payload == b'open'
+    assert msg.opt(300) == [long_val] and msg.opt(OPT_URI_QUERY) == [b'k=secret']
+    assert uint_opt(0) == b'' and decode(encode(ACK, 0, 1)).options == []
+    for cut in range(1, len(pkt) - 4):
+        try:
+            m = decode(pkt[:-cut])
+            assert m.payload != b'open', 'truncated packet decoded intact'
+        except ValueError:
+            pass
+    for bad in (b'\x40\x01\x00', b'\x80\x01\x00\x00', b'\x49\x01\x00\x00', b'\x40\x01\x00\x00\xff'):
+        try:
+            decode(bad)
+            assert False, 'accepted %r' % bad
+        except ValueError:
+            pass
+    assert _varint(0) == b'\x00' and _varint(127) == b'\x7f' and _varint(16384) == b'\x80\x80\x01'
+    print('codec ok')
+
+    dev = FakeDevice('secret')
+    opts = argparse.Namespace(host='127.0.0.1', coap_port=dev.udp.getsockname()[1],
+                              broker='127.0.0.1', mqtt_port=dev.tcp.getsockname()[1],
+                              device='test', key='secret', user=None, password=None,
+                              requests=6, timeout=2.0, gap=0.05, keepalive=120,
+                              interval=600, tail_ms=50)
+    coap = run_coap(opts)
+    assert not coap.errors and len(coap.confirm) == 6, coap.errors
+    assert all(f == 4 for f in coap.frames), coap.frames    # PUT, ACK, CON notify, ACK
+    mqtt = run_mqtt(opts)
+    assert not mqtt.errors and len(mqtt.confirm) == 6, mqtt.errors
+    report(coap, opts)
+    report(mqtt, opts)
+    print('selftest ok')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    def common(p):
+        p.add_argument('-n', '--requests', type=int, default=20, help='commands per path')
+        p.add_argument('--timeout', type=float, default=10.0)
+        p.add_argument('--gap', type=float, default=1.0, help='seconds between commands')
+        p.add_argument('--interval', type=int, default=600,
+                       help='assumed seconds between commands in the radio-on estimate')
+        p.add_argument('--tail-ms', type=int, default=50,
+                       help='radio awake time after each burst (power-save tail)')
+
+    def coap_args(p):
+        p.add_argument('host', help='device address')
+        p.add_argument('--coap-port', type=int, default=5683)
+        p.add_argument('--key', default=None, help='CONFIG_COAP_SERVER_KEY')
+
+    def mqtt_args(p, positional):
+        if positional:
+            p.add_argument('broker', help='broker address')
+        else:
+            p.add_argument('--broker', required=True)
+        p.add_argument('--mqtt-port', type=int, default=1883)
+        p.add_argument('--device', required=True, help='device id (MQTT topic component)')
+        p.add_argument('--user', default=None)
+        p.add_argument('--password', default=None)
+        p.add_argument('--keepalive', type=int, default=120,
+                       help='device MQTT keepalive in seconds (esp-mqtt default 120)')
+
+    p = sub.add_parser('coap', help='CoAP command path')
+    coap_args(p)
+    common(p)
+    p = sub.add_parser('mqtt', help='MQTT command path')
+    mqtt_args(p, True)
+    common(p)
+    p = sub.add_parser('both', help='CoAP then MQTT against the same device')
+    coap_args(p)
+    mqtt_args(p, False)
+    common(p)
+    p = sub.add_parser('get', help='GET (and observe) a CoAP resource')
+    coap_args(p)
+    p.add_argument('path')
+    p.add_argument('--observe', type=int, default=0, help='print N notifications')
+    p.add_argument('--timeout', type=float, default=10.0)
+    sub.add_parser('selftest', help='codec checks and a loopback run against a fake device')
+    opts = parser.parse_args()
+
+    if opts.cmd == 'selftest':
+        selftest()
+    elif opts.cmd == 'get':
+        run_get(opts)
+    else:
+        if opts.cmd in ('coap', 'both'):
+            report(run_coap(opts), opts)
+        if opts.cmd in ('mqtt', 'both'):
+            report(run_mqtt(opts), opts)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
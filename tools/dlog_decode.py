@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Decode a deferred-log (dlog) dump using the application ELF.
+
+The dump is the byte stream of L2CAP stream 1 (see main/include/dlog.h):
+a 16-byte header followed by 32-byte records holding the format string
+pointer, tag pointer and up to four raw 32-bit arguments. Pointers are
+resolved against the ELF, so the ELF must match the running firmware.
+
+Usage:
+    tools/dlog_decode.py --elf build/blink.elf dlog.bin
+
+Requires pyelftools (shipped with ESP-IDF's Python environment).
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+DLOG_MAGIC = 0x31474C44
+HEADER = struct.Struct('<IHHII')
+RECORD = struct.Struct('<IIIBBH4I')
+LEVELS = 'NEWIDV'
+
+# %[flags][width][.precision][length]conversion
+FMT_RE = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t)?([diouxXcsp%])')
+
+
+class ElfStrings:
+    def __init__(self, path):
+        self._segments = []
+        with open(path, 'rb') as f:
+            elf = ELFFile(f)
+            for section in elf.iter_sections():
+                if section['sh_type'] == 'SHT_PROGBITS' and section['sh_addr']:
+                    self._segments.append((section['sh_addr'], section.data()))
+
+    def read_str(self, addr):
+        for base, data in self._segments:
+            if base <= addr < base + len(data):
+                end = data.find(b'\0', addr - base)
+                if end < 0:
+                    end = len(data)
+                return data[addr - base:end].decode('utf-8', errors='replace')
+        return '<0x%08x>' % addr
+
+
+def format_record(fmt, args, strings):
+    args = list(args)
+
+    def convert(m):
+        flags, width, prec, _length, conv = m.groups()
+        if conv == '%':
+            return '%'
+        value = args.pop(0) if args else 0
+        spec = '%' + flags + (width or '') + ('.' + prec if prec else '')
+        if conv == 's':
+            return (spec + 's') % strings.read_str(value)
+        if conv in 'di':
+            return (spec + 'd') % (value - (1 << 32) if value & 0x80000000 else value)
+        if conv == 'p':
+            return '0x%08x' % value
+        if conv == 'c':
+            return chr(value & 0xFF)
+        return (spec + conv) % value
+
+    return FMT_RE.sub(convert, fmt)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--elf', required=True, help='application ELF matching the firmware')
+    parser.add_argument('dump', help='raw dump received from L2CAP stream 1')
+    opts = parser.parse_args()
+
+    with open(opts.dump, 'rb') as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit('dump too short')
+
+    magic, rec_size, count, head, dropped = HEADER.unpack_from(data, 0)
+    if magic != DLOG_MAGIC or rec_size != RECORD.size:
+        sys.exit('not a dlog dump (magic 0x%08x, record size %d)' % (magic, rec_size))
+
+    strings = ElfStrings(opts.elf)
+    print('# %d records, %d written, %d dropped on device' % (count, head, dropped))
+
+    expect = (head - count) & 0xFFFF
+    for i in range(count):
+        off = HEADER.size + i * RECORD.size
+        if off + RECORD.size > len(data):
+            print('# truncated after %d records' % i)
+            break
+        ts, tag, fmt, level, nargs, seq, *args = RECORD.unpack_from(data, off)
+        if seq != expect:
+            print('# seq jump %d -> %d (overwritten during dump)' % (expect, seq))
+        expect = (seq + 1) & 0xFFFF
+        text = format_record(strings.read_str(fmt), args[:nargs], strings)
+        letter = LEVELS[level] if level < len(LEVELS) else '?'
+        print('%s (%d) %s: %s' % (letter, ts // 1000, strings.read_str(tag), text))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Measure latency and throughput of the LAN HTTP API.
+
+Point it at a device on the LAN, or at the host simulator started with
+SIM_HTTP=1 (components/sim, port 8080 and token "sim" from sdkconfig.sim),
+which runs the same main/http_api.c on the host TCP stack. Simulator
+numbers are for comparing changes to the request path, not device latency.
+Exits non-zero if any request failed.
+
+Each worker keeps a single keep-alive connection open. With --no-keepalive
+every request opens a new connection, which shows what the keep-alive path
+saves.
+
+Usage:
+    tools/http_bench.py 192.168.1.50
+    tools/http_bench.py 192.168.1.50:8080 -n 2000 -c 4
+    SIM_HTTP=1 build_sim/smart_door_locker.elf &
+    tools/http_bench.py 127.0.0.1:8080 --token sim --wait 30
+    tools/http_bench.py 192.168.1.50 --path /api/open --method POST --token secret   # moves the servo!
+"""
+
+import argparse
+import http.client
+import socket
+import sys
+import threading
+import time
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return 0.0
+    idx = min(len(sorted_values) - 1, int(round(pct / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[idx]
+
+
+def worker(opts, count, latencies, errors):
+    headers = {'Authorization': 'Bearer ' + opts.token} if opts.token else {}
+    if opts.no_keepalive:
+        headers['Connection'] = 'close'
+    conn = None
+    for _ in range(count):
+        start = time.perf_counter()
+        try:
+            if conn is None:
+                conn = http.client.HTTPConnection(opts.host, opts.port, timeout=opts.timeout)
+                conn.connect()
+                # Headers and body go out in separate writes; without this Nagle
+                # holds back the second one until the previous response is acked.
+                conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            conn.request(opts.method, opts.path, body=opts.body, headers=headers)
+            resp = conn.getresponse()
+            resp.read()
+            if resp.status != 200:
+                errors.append(resp.status)
+        except (OSError, http.client.HTTPException) as exc:
+            errors.append(type(exc).__name__)
+            if conn is not None:
+                conn.close()
+            conn = None
+            continue
+        latencies.append(time.perf_counter() - start)
+        if opts.no_keepalive or resp.will_close:
+            conn.close()
+            conn = None
+    if conn is not None:
+        conn.close()
+
+
+def wait_for(host, port, seconds):
+    deadline = time.monotonic() + seconds
+    while True:
+        try:
+            socket.create_connection((host, port), timeout=1).close()
+            return
+        except OSError:
+            if time.monotonic() > deadline:
+                sys.exit('%s:%d not accepting connections after %ds' % (host, port, seconds))
+            time.sleep(0.2)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('target', help='host[:port]')
+    parser.add_argument('-n', '--requests', type=int, default=500, help='total requests')
+    parser.add_argument('-c', '--connections', type=int, default=1, help='parallel connections')
+    parser.add_argument('--path', default='/api/status')
+    parser.add_argument('--method', default='GET')
+    parser.add_argument('--body', default=None)
+    parser.add_argument('--token', default=None, help='CONFIG_HTTP_API_TOKEN')
+    parser.add_argument('--timeout', type=float, default=5.0)
+    parser.add_argument('--no-keepalive', action='store_true', help='new connection per request')
+    parser.add_argument('--wait', type=int, default=0, help='seconds to wait for the server to come up')
+    opts = parser.parse_args()
+
+    host, _, port = opts.target.partition(':')
+    opts.host, opts.port = host, int(port or 80)
+    if opts.wait:
+        wait_for(opts.host, opts.port, opts.wait)
+
+    latencies, errors = [], []
+    per_worker = [opts.requests // opts.connections] * opts.connections
+    per_worker[0] += opts.requests % opts.connections
+    threads = [threading.Thread(target=worker, args=(opts, n, latencies, errors)) for n in per_worker]
+
+    started = time.perf_counter()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.perf_counter() - started
+
+    lat = sorted(v * 1000 for v in latencies)
+    print('%s %s on %s:%d, %d connection(s), keep-alive %s' %
+          (opts.method, opts.path, opts.host, opts.port, opts.connections,
+           'off' if opts.no_keepalive else 'on'))
+    print('%d ok, %d errors in %.2fs: %.1f req/s' %
+          (len(lat), len(errors), elapsed, len(lat) / elapsed if elapsed else 0))
+    if lat:
+        print('latency ms: min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f' %
+              (lat[0], percentile(lat, 50), percentile(lat, 90), percentile(lat, 99), lat[-1]))
+    if errors:
+        print('errors: %s' % ', '.join(sorted(set(str(e) for e in errors))))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Print a door event journal export.
+
+The export comes from L2CAP stream 3. Set the time range first with the
+"JOURNAL EXPORT [from [to]]" diagnostic command (see
+main/include/journal.h for the layout). Passing --partition instead
+decodes a raw dump of the journal partition, for example one read with
+`parttool.py read_partition --partition-name journal`.
+
+Usage:
+    tools/journal_decode.py journal.bin
+    tools/journal_decode.py --csv journal.bin > journal.csv
+    tools/journal_decode.py --partition journal_part.bin
+"""
+
+import argparse
+import binascii
+import datetime
+import struct
+import sys
+
+EXPORT_MAGIC = 0x3158524A
+SECTOR_MAGIC = 0x314E524A
+BLOCK_MAGIC = 0xB10C
+SECTOR_SIZE = 4096
+TIME_VALID_MIN = 1577836800
+
+EXPORT_HEADER = struct.Struct('<IHHII')
+SECTOR_HEADER = struct.Struct('<II8x')
+BLOCK_HEADER = struct.Struct('<HBBI')
+RECORD = struct.Struct('<IIBBHI')
+
+# Must match journal_evt_t / journal_src_t in main/include/journal.h
+EVENTS = ['BOOT', 'OPEN', 'CLOSE', 'CRED_CLEAR', 'OTA', 'STALL']
+SOURCES = ['SYS', 'KEY', 'BLE', 'MQTT', 'TIMER', 'HTTP', 'COAP', 'DIAG']
+
+
+def name(table, idx):
+    return table[idx] if 0 <= idx < len(table) else str(idx)
+
+
+def fmt_time(t):
+    if t < TIME_VALID_MIN:
+        return 'uptime+%ds' % t
+    return datetime.datetime.fromtimestamp(t, datetime.timezone.utc).strftime('%Y-%m-%d %H:%M:%SZ')
+
+
+def load_export(data):
+    if len(data) < EXPORT_HEADER.size:
+        sys.exit('export too short')
+    magic, rec_size, _, t_from, t_to = EXPORT_HEADER.unpack_from(data, 0)
+    if magic != EXPORT_MAGIC or rec_size != RECORD.size:
+        sys.exit('not a journal export (magic 0x%08x, record size %d)' % (magic, rec_size))
+    records = [RECORD.unpack_from(data, off)
+               for off in range(EXPORT_HEADER.size, len(data) - RECORD.size + 1, RECORD.size)]
+    return '# range %d..%d' % (t_from, t_to), records
+
+
+def load_partition(data):
+    sectors = []
+    torn = 0
+    for base in range(0, len(data) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        magic, seq = SECTOR_HEADER.unpack_from(data, base)
+        if magic != SECTOR_MAGIC or seq in (0, 0xFFFFFFFF):
+            continue
+        records = []
+        off = base + SECTOR_HEADER.size
+        while off + BLOCK_HEADER.size <= base + SECTOR_SIZE:
+            bmagic, count, _, crc = BLOCK_HEADER.unpack_from(data, off)
+            if bmagic == 0xFFFF and count == 0xFF:
+                break
+            body = data[off + BLOCK_HEADER.size:off + BLOCK_HEADER.size + count * RECORD.size]
+            if (bmagic != BLOCK_MAGIC or count == 0 or len(body) != count * RECORD.size or
+                    binascii.crc32(body) != crc):
+                torn += 1
+                break
+            records.extend(RECORD.unpack_from(body, i * RECORD.size) for i in range(count))
+            off += BLOCK_HEADER.size + len(body)
+        sectors.append((seq, records))
+    sectors.sort()
+    records = [rec for _, recs in sectors for rec in recs]
+    return '# %d sectors, %d torn block(s)' % (len(sectors), torn), records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('dump', help='L2CAP export, or partition image with --partition')
+    parser.add_argument('--partition', action='store_true', help='input is a raw partition image')
+    parser.add_argument('--csv', action='store_true', help='CSV output')
+    opts = parser.parse_args()
+
+    with open(opts.dump, 'rb') as f:
+        data = f.read()
+    summary, records = load_partition(data) if opts.partition else load_export(data)
+
+    if opts.csv:
+        print('seq,boot,time,event,source,arg')
+    else:
+        print('%s, %d records' % (summary, len(records)))
+    for t, seq, evt, src, boot, arg in records:
+        if opts.csv:
+            print('%d,%d,%d,%s,%s,%d' % (seq, boot, t, name(EVENTS, evt), name(SOURCES, src), arg))
+        else:
+            print('%8d  boot %-5d %-22s %-10s %-5s %d' % (seq, boot, fmt_time(t),
+                                                          name(EVENTS, evt), name(SOURCES, src), arg))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+"""Build and apply delta patches between two app images.
+
+The patch format is described in main/include/ota_delta.h. Each op adds a
+byte-wise difference to a range of the base image and then inserts new
+bytes. When code moves, the difference is mostly zero or a few repeated
+address deltas, so the deflate pass in `ota_server.py pack` shrinks it
+well. Matching works like bsdiff: exact seeds from a hash index, then
+approximate extension in both directions.
+
+Usage:
+    tools/ota_server.py pack build/blink.bin blink.ota --base release.bin
+    tools/ota_delta.py apply release.bin blink.ota out.bin   # check a patch on the host
+    tools/ota_delta.py selftest [release.bin]                # round-trip tests
+
+apply() is the Python reference; tools/ota_host_test.py checks the C applier
+(main/ota_delta.c) against diff() byte for byte.
+"""
+
+import argparse
+import hashlib
+import random
+import struct
+import sys
+import zlib
+
+DELTA_MAGIC = 0x31544C44
+DELTA_HEADER = struct.Struct('<II32s')
+DELTA_OP = struct.Struct('<III')
+
+SEED_LEN = 8        # exact match needed to start an add region
+INDEX_STEP = 4      # index every 4th base offset; the scan tries every new offset
+MIN_MATCH = 16      # shorter regions cost more as ops than as inserted bytes
+SLACK = 64          # stop extending after this many bytes without improvement
+
+
+def build_index(old):
+    index = {}
+    for j in range(0, len(old) - SEED_LEN + 1, INDEX_STEP):
+        index.setdefault(old[j:j + SEED_LEN], j)
+    return index
+
+
+def extend_forward(old, new, j, i):
+    """Longest prefix of new[i:] vs old[j:] where matches outweigh mismatches."""
+    limit = min(len(old) - j, len(new) - i)
+    score = best_score = best = k = 0
+    while k < limit:
+        if k + 64 <= limit and old[j + k:j + k + 64] == new[i + k:i + k + 64]:
+            k += 64
+            score += 64
+        else:
+            score += old[j + k] == new[i + k]
+            k += 1
+        if score * 2 - k > best_score * 2 - best:
+            best_score, best = score, k
+        elif k - best > SLACK:
+            break
+    return best
+
+
+def extend_backward(old, new, j, i, floor):
+    limit = min(j, i - floor)
+    score = best_score = best = 0
+    for k in range(1, limit + 1):
+        score += old[j - k] == new[i - k]
+        if score * 2 - k > best_score * 2 - best:
+            best_score, best = score, k
+        elif k - best > SLACK:
+            break
+    return best
+
+
+def diff(old, new):
+    """Return a patch that rebuilds `new` from `old`."""
+    index = build_index(old)
+    out = [DELTA_HEADER.pack(DELTA_MAGIC, len(old), hashlib.sha256(old).digest())]
+    add_src = add_len = 0       # pending add region, emitted with the insert that follows it
+    lit = 0                     # start of bytes not yet covered
+    shift = 0                   # old - new offset of the previous region
+    i = 0
+
+    while i <= len(new) - SEED_LEN:
+        seed = new[i:i + SEED_LEN]
+        j = i + shift
+        if not (0 <= j <= len(old) - SEED_LEN and old[j:j + SEED_LEN] == seed):
+            j = index.get(seed)
+            if j is None:
+                i += 1
+                continue
+        fwd = extend_forward(old, new, j, i)
+        back = extend_backward(old, new, j, i, lit)
+        if back + fwd < MIN_MATCH:
+            i += 1
+            continue
+
+        start = i - back
+        out.append(encode_op(old, new, add_src, add_len, lit, start))
+        add_src, add_len = j - back, back + fwd
+        lit = i = start + add_len
+        shift = add_src - start
+
+    out.append(encode_op(old, new, add_src, add_len, lit, len(new)))
+    return b''.join(out)
+
+
+def encode_op(old, new, add_src, add_len, lit, insert_end):
+    """Op for the add region that ends at `lit`, followed by new[lit:insert_end]."""
+    add_dst = lit - add_len
+    diff_bytes = bytes((new[add_dst + k] - old[add_src + k]) & 0xFF for k in range(add_len))
+    return DELTA_OP.pack(add_len, insert_end - lit, add_src) + diff_bytes + new[lit:insert_end]
+
+
+def apply(old, patch):
+    """Reference implementation of ota_delta.c, used to check patches on the host."""
+    magic, base_size, base_sha = DELTA_HEADER.unpack_from(patch, 0)
+    if magic != DELTA_MAGIC:
+        raise ValueError('not a delta patch')
+    if base_size > len(old) or hashlib.sha256(old[:base_size]).digest() != base_sha:
+        raise ValueError('patch was built for a different base image')
+    out = bytearray()
+    pos = DELTA_HEADER.size
+    while pos < len(patch):
+        add_len, insert_len, src = DELTA_OP.unpack_from(patch, pos)
+        pos += DELTA_OP.size
+        if src + add_len > base_size or pos + add_len + insert_len > len(patch):
+            raise ValueError('corrupt patch at offset %d' % pos)
+        out += bytes((old[src + k] + patch[pos + k]) & 0xFF for k in range(add_len))
+        pos += add_len
+        out += patch[pos:pos + insert_len]
+        pos += insert_len
+    return bytes(out)
+
+
+def fake_firmware(size, rng):
+    """Code-like bytes: repeated instruction patterns, pointer tables and strings."""
+    out = bytearray()
+    while len(out) < size:
+        kind = rng.random()
+        if kind < 0.7:
+            out += bytes(rng.choice((0x13, 0x93, 0x23, 0x83, 0xef, 0x67)) if n % 4 == 0 else rng.randrange(32)
+                         for n in range(rng.randrange(16, 256, 4)))
+        elif kind < 0.85:
+            base = 0x42000000 + rng.randrange(0, len(out) + 1)
+            out += b''.join(struct.pack('<I', base + 4 * rng.randrange(64)) for _ in range(rng.randrange(4, 32)))
+        else:
+            out += bytes(rng.choice(b'abcdefghijklmnopqrstuvwxyz _%:') for _ in range(rng.randrange(8, 64))) + b'\0'
+    return bytes(out[:size])
+
+
+def mutate(old, rng, edits):
+    """Simulate a small release: insert/replace code and relocate pointers after it."""
+    new = bytearray(old)
+    for _ in range(edits):
+        at = rng.randrange(len(new)) & ~3
+        grow = rng.randrange(0, 256, 4)
+        new[at:at + rng.randrange(0, 64, 4)] = fake_firmware(grow, rng)
+        for off in range(0, len(new) - 4, 4):
+            word = struct.unpack_from('<I', new, off)[0]
+            if 0x42000000 + at <= word < 0x42000000 + len(old):
+                struct.pack_into('<I', new, off, word + grow)
+    return bytes(new)
+
+
+def check(name, old, new, window_bits=14):
+    patch = diff(old, new)
+    if apply(old, patch) != new:
+        sys.exit('%s: round trip FAILED' % name)
+    full = len(zlib.compress(new, 9))
+    comp = zlib.compressobj(9, zlib.DEFLATED, -window_bits, 9)
+    packed = len(comp.compress(patch) + comp.flush())
+    print('%-28s image %8d  full %8d  delta %7d  (%.1fx smaller)' %
+          (name, len(new), full, packed, full / max(packed, 1)))
+    return patch
+
+
+def cmd_apply(opts):
+    import ota_server
+    with open(opts.base, 'rb') as f:
+        old = f.read()
+    with open(opts.container, 'rb') as f:
+        image = ota_server.unpack(f.read(), base=old)
+    with open(opts.output, 'wb') as f:
+        f.write(image)
+    print('%s: %d bytes, SHA-256 ok' % (opts.output, len(image)))
+
+
+def cmd_selftest(opts):
+    rng = random.Random(opts.seed)
+    old = open(opts.base, 'rb').read() if opts.base else fake_firmware(opts.size, rng)
+
+    check('identical', old, old)
+    check('empty base', b'\0' * 64, old[:4096])
+    check('one byte changed', old, old[:1000] + bytes([old[1000] ^ 0xFF]) + old[1001:])
+    check('truncated', old, old[:len(old) // 2])
+    check('unrelated', old[:8192], fake_firmware(8192, random.Random(opts.seed + 1)))
+    for edits in (1, 4, 16):
+        check('%d edit(s) + relocation' % edits, old, mutate(old, rng, edits))
+
+    new = mutate(old, rng, 2)
+    patch = diff(old, new)
+    for cut in (1, DELTA_OP.size + 1, len(patch) // 2):
+        try:
+            if apply(old, patch[:-cut]) == new:
+                sys.exit('truncated patch accepted')
+        except (ValueError, struct.error):
+            pass
+    try:
+        apply(old[:-1] + bytes([old[-1] ^ 0xFF]), patch)
+        sys.exit('wrong base accepted')
+    except ValueError:
+        pass
+    print('ok')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('apply', help='apply a delta container to a base image')
+    p.add_argument('base')
+    p.add_argument('container')
+    p.add_argument('output')
+    p.set_defaults(fn=cmd_apply)
+
+    p = sub.add_parser('selftest', help='round-trip tests on synthetic or given images')
+    p.add_argument('base', nargs='?', help='real app image to mutate (default: synthetic)')
+    p.add_argument('--size', type=int, default=512 * 1024)
+    p.add_argument('--seed', type=int, default=1)
+    p.set_defaults(fn=cmd_selftest)
+
+    opts = parser.parse_args()
+    opts.fn(opts)
+
+
+if __name__ == '__main__':
+    main()
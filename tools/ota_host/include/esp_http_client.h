@@ -0,0 +1,29 @@
+/**
+ * @file esp_http_client.h
+ * @brief OTA 主机测试用的 ESP-IDF 替身: 响应体来自测试镜像文件
+ */
+
+#ifndef OTA_HOST_ESP_HTTP_CLIENT_H
+#define OTA_HOST_ESP_HTTP_CLIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef struct {
+    const char *url;
+    int timeout_ms;
+    bool keep_alive_enable;
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+
+#endif /* OTA_HOST_ESP_HTTP_CLIENT_H */
@@ -0,0 +1,18 @@
+/**
+ * @file esp_log.h
+ * @brief OTA 主机测试用的 ESP-IDF 替身: 日志输出到 stderr
+ */
+
+#ifndef OTA_HOST_ESP_LOG_H
+#define OTA_HOST_ESP_LOG_H
+
+#include <stdio.h>
+
+#define OTA_HOST_LOG(level, tag, fmt, ...) fprintf(stderr, level " (%s) " fmt "\n", tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...) OTA_HOST_LOG("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) OTA_HOST_LOG("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) OTA_HOST_LOG("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); } while (0)
+
+#endif /* OTA_HOST_ESP_LOG_H */
@@ -0,0 +1,21 @@
+/**
+ * @file esp_partition.h
+ * @brief OTA 主机测试用的 ESP-IDF 替身: 分区内容在内存中
+ */
+
+#ifndef OTA_HOST_ESP_PARTITION_H
+#define OTA_HOST_ESP_PARTITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef struct {
+    const char *label;
+    uint32_t size;
+    uint8_t *data;          /**< 替身专用: 分区内容 */
+} esp_partition_t;
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+
+#endif /* OTA_HOST_ESP_PARTITION_H */
@@ -0,0 +1,11 @@
+/**
+ * @file esp_system.h
+ * @brief OTA 主机测试用的 ESP-IDF 替身
+ */
+
+#ifndef OTA_HOST_ESP_SYSTEM_H
+#define OTA_HOST_ESP_SYSTEM_H
+
+void esp_restart(void);
+
+#endif /* OTA_HOST_ESP_SYSTEM_H */
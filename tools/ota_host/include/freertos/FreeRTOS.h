@@ -0,0 +1,28 @@
+/**
+ * @file FreeRTOS.h
+ * @brief OTA 主机测试用的 FreeRTOS 替身: 单线程运行，临界区为空操作
+ */
+
+#ifndef OTA_HOST_FREERTOS_H
+#define OTA_HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define pdPASS                          1
+#define pdFAIL                          0
+#define portMAX_DELAY                   0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+
+#endif /* OTA_HOST_FREERTOS_H */
@@ -0,0 +1,18 @@
+/**
+ * @file stream_buffer.h
+ * @brief OTA 主机测试用的 FreeRTOS 替身
+ */
+
+#ifndef OTA_HOST_STREAM_BUFFER_H
+#define OTA_HOST_STREAM_BUFFER_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct StreamBufferDef_t *StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level);
+size_t xStreamBufferSend(StreamBufferHandle_t buf, const void *data, size_t len, TickType_t wait);
+size_t xStreamBufferReceive(StreamBufferHandle_t buf, void *data, size_t len, TickType_t wait);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t buf);
+
+#endif /* OTA_HOST_STREAM_BUFFER_H */
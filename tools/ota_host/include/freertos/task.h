@@ -0,0 +1,17 @@
+/**
+ * @file task.h
+ * @brief OTA 主机测试用的 FreeRTOS 替身
+ */
+
+#ifndef OTA_HOST_TASK_H
+#define OTA_HOST_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+
+#endif /* OTA_HOST_TASK_H */
@@ -0,0 +1,14 @@
+/**
+ * @file md.h
+ * @brief OTA 主机测试用的 mbedtls 替身: 摘要算法标识 (取值与 mbedtls 3.x 一致)
+ */
+
+#ifndef OTA_HOST_MBEDTLS_MD_H
+#define OTA_HOST_MBEDTLS_MD_H
+
+typedef enum {
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 0x09,
+} mbedtls_md_type_t;
+
+#endif /* OTA_HOST_MBEDTLS_MD_H */
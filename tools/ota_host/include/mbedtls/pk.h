@@ -0,0 +1,37 @@
+/**
+ * @file pk.h
+ * @brief OTA 主机测试用的 mbedtls 替身: 公钥解析和签名校验，由主机 OpenSSL 实现
+ *
+ * 与 mbedtls 一样，PEM 公钥的长度要包含结尾的 NUL
+ */
+
+#ifndef OTA_HOST_MBEDTLS_PK_H
+#define OTA_HOST_MBEDTLS_PK_H
+
+#include <stddef.h>
+#include "mbedtls/md.h"
+
+#define MBEDTLS_ERR_PK_KEY_INVALID_FORMAT   -0x3D00
+#define MBEDTLS_ERR_PK_BAD_INPUT_DATA       -0x3E80
+#define MBEDTLS_ERR_ECP_VERIFY_FAILED       -0x4E00
+
+typedef enum {
+    MBEDTLS_PK_NONE = 0,
+    MBEDTLS_PK_RSA,
+    MBEDTLS_PK_ECKEY,
+    MBEDTLS_PK_ECKEY_DH,
+    MBEDTLS_PK_ECDSA,
+} mbedtls_pk_type_t;
+
+typedef struct {
+    void *key;      /* EVP_PKEY */
+} mbedtls_pk_context;
+
+void mbedtls_pk_init(mbedtls_pk_context *ctx);
+void mbedtls_pk_free(mbedtls_pk_context *ctx);
+int mbedtls_pk_parse_public_key(mbedtls_pk_context *ctx, const unsigned char *key, size_t keylen);
+int mbedtls_pk_can_do(const mbedtls_pk_context *ctx, mbedtls_pk_type_t type);
+int mbedtls_pk_verify(mbedtls_pk_context *ctx, mbedtls_md_type_t md_alg, const unsigned char *hash,
+                      size_t hash_len, const unsigned char *sig, size_t sig_len);
+
+#endif /* OTA_HOST_MBEDTLS_PK_H */
@@ -0,0 +1,25 @@
+/**
+ * @file sha256.h
+ * @brief OTA 主机测试用的 mbedtls 替身: 自带的 SHA-256 (FIPS 180-4)，不依赖主机库
+ */
+
+#ifndef OTA_HOST_MBEDTLS_SHA256_H
+#define OTA_HOST_MBEDTLS_SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t total;
+    uint8_t block[64];
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen);
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32]);
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char output[32], int is224);
+
+#endif /* OTA_HOST_MBEDTLS_SHA256_H */
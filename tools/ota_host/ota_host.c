@@ -0,0 +1,632 @@
+/**
+ * @file ota_host.c
+ * @brief OTA 主机测试程序 - 在 PC 上运行固件的 run_update()
+ *
+ * 直接包含 main/ota_update.c，与 main/ota_inflate.c、main/ota_delta.c 一起用主机
+ * gcc 编译，IDF/FreeRTOS/mbedtls 由 include/ 下的替身提供:
+ *  - HTTP 响应体为命令行给出的容器文件，每次读取返回随机长度 (1..max_read)，
+ *    覆盖解压器和补丁应用器的任意输入边界
+ *  - 运行分区内容为基准镜像 (增量升级的基准)，备用分区在内存中
+ *  - esp_ota_write 与 IDF 一样检查首字节为 app 镜像魔数；esp_ota_end 不做
+ *    app 镜像格式校验，这部分只能在设备上验证
+ *  - 签名校验的 mbedtls_pk_* 用主机 OpenSSL (libcrypto) 实现，内置公钥从
+ *    pubkey 文件读入 (见 ota_host_key.c)
+ *
+ * 用法: ota_host <pubkey> <container> <output> [base|-] [max_read] [seed]
+ * 升级成功时把备用分区中写入的镜像保存到 output。
+ *
+ * 退出码: 0 升级成功, 1 升级被拒绝 (正常的失败路径), 2 用法错误或违反了
+ * 固件的约定 (失败后未 abort、未写完就切换启动分区等)。
+ * 由 tools/ota_host_test.py 编译和驱动。
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+#include "ota_update.c"
+
+#define OTA_HOST_PART_SIZE      0x1E0000    /* 与 partitions.csv 中 ota_0/ota_1 一致 */
+#define OTA_HOST_APP_MAGIC      0xE9
+#define OTA_HOST_HANDLE         1
+
+#define EXIT_UPDATE_OK          0
+#define EXIT_UPDATE_REJECTED    1
+#define EXIT_HARNESS            2
+
+static uint8_t s_running_data[OTA_HOST_PART_SIZE];
+static uint8_t s_next_data[OTA_HOST_PART_SIZE];
+static esp_partition_t s_running = { .label = "ota_0", .size = OTA_HOST_PART_SIZE, .data = s_running_data };
+static esp_partition_t s_next = { .label = "ota_1", .size = OTA_HOST_PART_SIZE, .data = s_next_data };
+
+/* 备用分区写入状态 */
+static bool s_ota_open = false;
+static bool s_ota_begun = false;
+static bool s_ota_ended = false;
+static bool s_ota_aborted = false;
+static size_t s_ota_pos = 0;
+static const esp_partition_t *s_boot = NULL;
+
+struct esp_http_client {
+    uint8_t *data;
+    size_t len;
+    size_t pos;
+    size_t max_read;
+    uint32_t rng;
+};
+
+static struct esp_http_client s_http;
+
+char *ota_host_pubkey(size_t *size);
+
+/* ---------- esp_err / libc ---------- */
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:      return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:       return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NOT_ALLOWED:           return "ESP_ERR_NOT_ALLOWED";
+        case ESP_ERR_OTA_VALIDATE_FAILED:   return "ESP_ERR_OTA_VALIDATE_FAILED";
+        default:                            return "UNKNOWN ERROR";
+    }
+}
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+/* ---------- 分区与 OTA ---------- */
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, partition->data + src_offset, size);
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return &s_running;
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    return &s_next;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+{
+    if (partition != &s_next || s_ota_open) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* 顺序写入模式: 不预先擦除 */
+    s_ota_open = true;
+    s_ota_begun = true;
+    s_ota_pos = 0;
+    *out_handle = OTA_HOST_HANDLE;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    if (handle != OTA_HOST_HANDLE || !s_ota_open) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_ota_pos == 0 && size > 0 && ((const uint8_t *)data)[0] != OTA_HOST_APP_MAGIC) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (size > s_next.size - s_ota_pos) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(s_next.data + s_ota_pos, data, size);
+    s_ota_pos += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    if (handle != OTA_HOST_HANDLE || !s_ota_open) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ota_open = false;
+    s_ota_ended = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    if (handle != OTA_HOST_HANDLE || !s_ota_open) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ota_open = false;
+    s_ota_aborted = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    s_boot = partition;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *partition, esp_ota_img_states_t *ota_state)
+{
+    *ota_state = ESP_OTA_IMG_VALID;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_get_partition_description(const esp_partition_t *partition, esp_app_desc_t *app_desc)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot(void)
+{
+    return ESP_OK;
+}
+
+/* ---------- HTTP: 随机长度的短读 ---------- */
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    return &s_http;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    return ESP_OK;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    return (int64_t)client->len;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return 200;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    size_t left = client->len - client->pos;
+    size_t n = (size_t)len;
+
+    /* xorshift32，同一 seed 结果可复现 */
+    client->rng ^= client->rng << 13;
+    client->rng ^= client->rng >> 17;
+    client->rng ^= client->rng << 5;
+    size_t chunk = 1 + client->rng % client->max_read;
+
+    if (n > chunk) {
+        n = chunk;
+    }
+    if (n > left) {
+        n = left;
+    }
+    memcpy(buffer, client->data + client->pos, n);
+    client->pos += n;
+    return (int)n;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    return ESP_OK;
+}
+
+/* ---------- SHA-256 (FIPS 180-4) ---------- */
+
+static const uint32_t s_sha_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(mbedtls_sha256_context *ctx, const uint8_t *p)
+{
+    uint32_t w[64];
+    uint32_t v[8];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+               ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    memcpy(v, ctx->state, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = v[7] + (ROR32(v[4], 6) ^ ROR32(v[4], 11) ^ ROR32(v[4], 25)) +
+                      ((v[4] & v[5]) ^ (~v[4] & v[6])) + s_sha_k[i] + w[i];
+        uint32_t t2 = (ROR32(v[0], 2) ^ ROR32(v[0], 13) ^ ROR32(v[0], 22)) +
+                      ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v + 1, v, 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++) {
+        ctx->state[i] += v[i];
+    }
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    if (is224) {
+        return -1;
+    }
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->total = 0;
+    return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    while (ilen > 0) {
+        size_t fill = ctx->total % 64;
+        size_t n = ilen < 64 - fill ? ilen : 64 - fill;
+
+        memcpy(ctx->block + fill, input, n);
+        ctx->total += n;
+        input += n;
+        ilen -= n;
+        if (ctx->total % 64 == 0) {
+            sha256_block(ctx, ctx->block);
+        }
+    }
+    return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    static const uint8_t pad[64] = { 0x80 };
+    uint64_t bits = ctx->total * 8;
+    uint8_t len[8];
+
+    for (int i = 0; i < 8; i++) {
+        len[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    mbedtls_sha256_update(ctx, pad, 1 + (119 - ctx->total % 64) % 64);
+    mbedtls_sha256_update(ctx, len, sizeof(len));
+    for (int i = 0; i < 8; i++) {
+        output[4 * i] = (uint8_t)(ctx->state[i] >> 24);
+        output[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+        output[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+        output[4 * i + 3] = (uint8_t)ctx->state[i];
+    }
+    return 0;
+}
+
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char output[32], int is224)
+{
+    mbedtls_sha256_context ctx;
+
+    mbedtls_sha256_init(&ctx);
+    int rc = mbedtls_sha256_starts(&ctx, is224);
+    if (rc == 0) {
+        mbedtls_sha256_update(&ctx, input, ilen);
+        mbedtls_sha256_finish(&ctx, output);
+    }
+    mbedtls_sha256_free(&ctx);
+    return rc;
+}
+
+/* ---------- mbedtls pk (OpenSSL) ---------- */
+
+void mbedtls_pk_init(mbedtls_pk_context *ctx)
+{
+    ctx->key = NULL;
+}
+
+void mbedtls_pk_free(mbedtls_pk_context *ctx)
+{
+    EVP_PKEY_free(ctx->key);
+    ctx->key = NULL;
+}
+
+int mbedtls_pk_parse_public_key(mbedtls_pk_context *ctx, const unsigned char *key, size_t keylen)
+{
+    /* mbedtls 只在 keylen 包含结尾 NUL 时按 PEM 解析 */
+    if (ctx->key != NULL || keylen == 0 || key[keylen - 1] != '\0') {
+        return MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+    }
+    BIO *bio = BIO_new_mem_buf(key, (int)(keylen - 1));
+    ctx->key = bio != NULL ? PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL) : NULL;
+    BIO_free(bio);
+    return ctx->key != NULL ? 0 : MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+}
+
+int mbedtls_pk_can_do(const mbedtls_pk_context *ctx, mbedtls_pk_type_t type)
+{
+    bool ec = ctx->key != NULL && EVP_PKEY_get_base_id(ctx->key) == EVP_PKEY_EC;
+    return ec && (type == MBEDTLS_PK_ECKEY || type == MBEDTLS_PK_ECKEY_DH || type == MBEDTLS_PK_ECDSA);
+}
+
+int mbedtls_pk_verify(mbedtls_pk_context *ctx, mbedtls_md_type_t md_alg, const unsigned char *hash,
+                      size_t hash_len, const unsigned char *sig, size_t sig_len)
+{
+    if (ctx->key == NULL || md_alg != MBEDTLS_MD_SHA256 || hash_len != 32) {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new(ctx->key, NULL);
+    int ok = pctx != NULL && EVP_PKEY_verify_init(pctx) == 1 &&
+             EVP_PKEY_CTX_set_signature_md(pctx, EVP_sha256()) == 1 &&
+             EVP_PKEY_verify(pctx, sig, sig_len, hash, hash_len) == 1;
+    EVP_PKEY_CTX_free(pctx);
+    return ok ? 0 : MBEDTLS_ERR_ECP_VERIFY_FAILED;
+}
+
+/* ---------- 升级流程之外的依赖，测试中不会调用 ---------- */
+
+void esp_restart(void)
+{
+    abort();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return 0;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level)
+{
+    return NULL;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t buf, const void *data, size_t len, TickType_t wait)
+{
+    return 0;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t buf, void *data, size_t len, TickType_t wait)
+{
+    return 0;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t buf)
+{
+    return pdPASS;
+}
+
+BaseType_t app_task_create(app_task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *out)
+{
+    return pdFAIL;
+}
+
+void app_pm_acquire(app_pm_lock_id_t id)
+{
+}
+
+void app_pm_release(app_pm_lock_id_t id)
+{
+}
+
+esp_err_t diag_cmd_register(const char *name, const char *help, diag_cmd_handler_t handler,
+                            diag_access_t access)
+{
+    return ESP_OK;
+}
+
+bool diag_cmd_check_local(const diag_out_t *out)
+{
+    return out->local;
+}
+
+void diag_printf(const diag_out_t *out, const char *fmt, ...)
+{
+}
+
+esp_err_t ha_mqtt_subscribe(const char *suffix, int qos, ha_mqtt_data_callback_t callback)
+{
+    return ESP_OK;
+}
+
+esp_err_t ha_mqtt_publish(const char *suffix, const void *data, size_t len, int qos)
+{
+    return ESP_OK;
+}
+
+esp_err_t ha_mqtt_publish_telemetry(const char *name, const char *payload)
+{
+    return ESP_OK;
+}
+
+void journal_log(journal_evt_t evt, journal_src_t src, uint32_t arg)
+{
+}
+
+esp_err_t journal_flush(void)
+{
+    return ESP_OK;
+}
+
+bool wifi_manager_is_connected(void)
+{
+    return true;
+}
+
+/* ---------- 测试入口 ---------- */
+
+static long load_file(const char *path, uint8_t *buf, size_t max)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    size_t n = fread(buf, 1, max, f);
+    bool more = fgetc(f) != EOF;
+    fclose(f);
+    if (more) {
+        fprintf(stderr, "%s: larger than %zu bytes\n", path, max);
+        return -1;
+    }
+    return (long)n;
+}
+
+/**
+ * @brief 检查 run_update 返回后分区和启动设置与结果一致
+ */
+static bool check_outcome(esp_err_t ret, const ota_session_t *s)
+{
+    if (s_ota_open) {
+        fprintf(stderr, "harness: OTA handle left open\n");
+        return false;
+    }
+    if (ret == ESP_OK) {
+        if (!s_ota_ended || s_boot != &s_next || s_ota_pos != s->hdr.image_size) {
+            fprintf(stderr, "harness: success without a complete image in the boot partition\n");
+            return false;
+        }
+        return true;
+    }
+    if (s_boot != NULL || s_ota_ended || (s_ota_begun && !s_ota_aborted)) {
+        fprintf(stderr, "harness: failed update was not aborted cleanly\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t container[2 * OTA_HOST_PART_SIZE];
+
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s <pubkey> <container> <output> [base|-] [max_read] [seed]\n", argv[0]);
+        return EXIT_HARNESS;
+    }
+
+    /* 保留结尾 NUL，与 target_add_binary_data(... TEXT) 一致 */
+    size_t key_max;
+    char *key = ota_host_pubkey(&key_max);
+    long key_len = load_file(argv[1], (uint8_t *)key, key_max - 1);
+    if (key_len < 0) {
+        return EXIT_HARNESS;
+    }
+    key[key_len] = '\0';
+    argc--;
+    argv++;
+
+    long len = load_file(argv[1], container, sizeof(container));
+    if (len < 0) {
+        return EXIT_HARNESS;
+    }
+    memset(s_running_data, 0xFF, sizeof(s_running_data));
+    memset(s_next_data, 0xFF, sizeof(s_next_data));
+    if (argc > 3 && strcmp(argv[3], "-") != 0 && load_file(argv[3], s_running_data, sizeof(s_running_data)) < 0) {
+        return EXIT_HARNESS;
+    }
+
+    s_http.data = container;
+    s_http.len = (size_t)len;
+    s_http.max_read = argc > 4 ? strtoul(argv[4], NULL, 0) : OTA_RAW_BUF_SIZE;
+    s_http.rng = argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 0) : 1;
+    if (s_http.max_read == 0 || s_http.rng == 0) {
+        fprintf(stderr, "max_read and seed must be non-zero\n");
+        return EXIT_HARNESS;
+    }
+
+    ota_session_t *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return EXIT_HARNESS;
+    }
+    s->source = OTA_SOURCE_HTTP;
+    s->http = &s_http;
+
+    esp_err_t ret = run_update(s);
+    printf("%s %lu\n", esp_err_to_name(ret), (unsigned long)s->written);
+
+    bool ok = check_outcome(ret, s);
+    if (ok && ret == ESP_OK) {
+        FILE *f = fopen(argv[2], "wb");
+        ok = f != NULL && fwrite(s_next_data, 1, s_ota_pos, f) == s_ota_pos;
+        if (f != NULL) {
+            ok = (fclose(f) == 0) && ok;
+        }
+    }
+    free(s);
+
+    if (!ok) {
+        return EXIT_HARNESS;
+    }
+    return ret == ESP_OK ? EXIT_UPDATE_OK : EXIT_UPDATE_REJECTED;
+}
@@ -0,0 +1,19 @@
+/**
+ * @file ota_host_key.c
+ * @brief OTA 主机测试: 签名公钥符号
+ *
+ * 设备上 _binary_ota_pubkey_pem_start 由 target_add_binary_data 生成。这里在
+ * 单独的编译单元里定义同名符号，ota_host.c 启动时把公钥文件读进来。
+ */
+
+#include <stddef.h>
+
+#define OTA_HOST_KEY_MAX    4096
+
+char ota_host_pubkey_pem[OTA_HOST_KEY_MAX] __asm__("_binary_ota_pubkey_pem_start");
+
+char *ota_host_pubkey(size_t *size)
+{
+    *size = sizeof(ota_host_pubkey_pem);
+    return ota_host_pubkey_pem;
+}
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""Run packed OTA images through the firmware's C update path on the host.
+
+Builds main/ota_update.c, main/ota_inflate.c and main/ota_delta.c with the
+host fakes in tools/ota_host/ (see ota_host.c) and feeds containers made by
+`ota_server.py pack` through run_update(): good images, full or delta
+against the image in the running slot, must land byte for byte in the
+spare partition and switch the boot partition; truncated, corrupt and
+mismatched images must be rejected, aborted and leave the boot partition
+alone. The HTTP fake returns random short reads, and the build
+uses ASan/UBSan, so parser boundary bugs show up as failures.
+
+Every run signs with a fresh key pair; the harness embeds the public key
+and verifies signatures with the host's libcrypto, so unsigned, re-signed
+with another key and tampered headers are covered too. Needs the openssl
+tool and the libcrypto headers (libssl-dev).
+
+esp_ota_end() is faked: the app image format check it does on the device
+is not covered here.
+
+Usage:
+    tools/ota_host_test.py                              # synthetic images
+    tools/ota_host_test.py build/smart_door_locker.bin  # a real app image
+    tools/ota_host_test.py --cc clang --no-sanitize
+"""
+
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+import ota_delta
+import ota_server
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES = ('tools/ota_host/ota_host.c', 'tools/ota_host/ota_host_key.c', 'main/ota_inflate.c', 'main/ota_delta.c')
+# Kconfig defaults (main/Kconfig.projbuild)
+CONFIG = {
+    'CONFIG_OTA_ENABLE': 1,
+    'CONFIG_OTA_WINDOW_BITS': 14,
+    'CONFIG_OTA_DELTA_BUF_SIZE': 1024,
+    'CONFIG_OTA_HTTP_TIMEOUT_MS': 10000,
+    'CONFIG_OTA_MQTT_BUFFER_SIZE': 4096,
+    'CONFIG_OTA_MQTT_TIMEOUT_S': 30,
+    'CONFIG_OTA_CONFIRM_DELAY_S': 30,
+}
+PART_SIZE = 0x1E0000
+APP_MAGIC = 0xE9
+SANITIZER_EXIT = 99
+
+EXIT_OK, EXIT_REJECTED = 0, 1
+ANY_ERROR = None
+
+
+def build(opts, outdir):
+    exe = os.path.join(outdir, 'ota_host')
+    cmd = [opts.cc, '-std=gnu17', '-O1', '-g', '-Wall', '-Wextra', '-Werror', '-Wno-unused-parameter',
+           '-Itools/ota_host/include', '-Imain', '-Imain/include', '-o', exe]
+    cmd += ['-D%s=%d' % item for item in CONFIG.items()]
+    if not opts.no_sanitize:
+        cmd += ['-fsanitize=address,undefined', '-fno-omit-frame-pointer']
+    subprocess.run(cmd + list(SOURCES) + ['-lcrypto'], cwd=ROOT, check=True)
+    return exe
+
+
+class Keys:
+    """The key pair the cases sign with, plus a second one the device does not trust."""
+    def __init__(self, outdir):
+        self.private = os.path.join(outdir, 'signing.pem')
+        self.public = ota_server.keygen(self.private)
+        self.other = os.path.join(outdir, 'other.pem')
+        ota_server.keygen(self.other)
+
+
+KEYS = None
+
+
+def pack(image, window_bits, **kwargs):
+    return ota_server.pack(image, window_bits, key=KEYS.private, **kwargs)
+
+
+class Runner:
+    def __init__(self, exe, outdir, verbose):
+        self.exe, self.outdir, self.verbose = exe, outdir, verbose
+        self.env = dict(os.environ,
+                        ASAN_OPTIONS='exitcode=%d' % SANITIZER_EXIT,
+                        UBSAN_OPTIONS='halt_on_error=1:print_stacktrace=1:exitcode=%d' % SANITIZER_EXIT)
+        self.count = 0
+
+    def run(self, name, blob, image=None, expect=ANY_ERROR, base=None, max_read=1024, seed=1):
+        """image set: the update must succeed and write exactly these bytes.
+        Otherwise it must be rejected, with `expect` as the error if given."""
+        container = os.path.join(self.outdir, 'case.ota')
+        output = os.path.join(self.outdir, 'case.bin')
+        base_path = '-'
+        with open(container, 'wb') as f:
+            f.write(blob)
+        if base is not None:
+            base_path = os.path.join(self.outdir, 'base.bin')
+            with open(base_path, 'wb') as f:
+                f.write(base)
+        if os.path.exists(output):
+            os.remove(output)
+
+        proc = subprocess.run([self.exe, KEYS.public, container, output, base_path, str(max_read), str(seed)],
+                              capture_output=True, text=True, env=self.env)
+        result = proc.stdout.split()[0] if proc.stdout else '?'
+        self.count += 1
+
+        def fail(why):
+            sys.stderr.write(proc.stderr[-4000:])
+            sys.exit('%s: %s (exit %d, %s)' % (name, why, proc.returncode, result))
+
+        if image is not None:
+            if proc.returncode != EXIT_OK:
+                fail('update failed')
+            with open(output, 'rb') as f:
+                if f.read() != image:
+                    fail('written image differs')
+        else:
+            if proc.returncode != EXIT_REJECTED:
+                fail('expected rejection' if proc.returncode == EXIT_OK else 'harness error')
+            if expect is not ANY_ERROR and result != expect:
+                fail('expected %s' % expect)
+        if self.verbose:
+            print('%-32s %s' % (name, result))
+
+
+def reheader(blob, key=True, **fields):
+    """Rewrite ota_image_header_t fields of a packed container and sign it again
+    (key=True: the trusted key, a path: that key, None: keep the old signature)."""
+    names = ('magic', 'header_size', 'flags', 'window_bits', 'image_size', 'payload_size', 'sha256',
+             'sig_len', 'signature')
+    values = dict(zip(names, ota_server.HEADER.unpack_from(blob, 0)))
+    values.update(fields)
+    if key is None:
+        header = ota_server.HEADER.pack(*(values[n] for n in names))
+    else:
+        header = ota_server.sign_header([values[n] for n in names[:-2]], KEYS.private if key is True else key)
+    return header + blob[ota_server.HEADER.size:]
+
+
+def flip(blob, pos):
+    return blob[:pos] + bytes([blob[pos] ^ 0xFF]) + blob[pos + 1:]
+
+
+def full_image_cases(run, image, rng, fuzz):
+    hsize = ota_server.HEADER.size
+    packed = pack(image, 14)
+    stored = pack(image, 14, raw=True)
+
+    run('deflate window 14', packed, image)
+    run('deflate window 9, 1 byte reads', pack(image, 9), image, max_read=1)
+    run('deflate level 1', pack(image, 12, level=1), image, max_read=333)
+    run('stored', stored, image, max_read=7)
+    for seed in range(1, 4):
+        run('deflate, read seed %d' % seed, packed, image, max_read=rng.randrange(1, 8192), seed=seed)
+
+    run('header truncated', packed[:hsize - 1], expect='ESP_ERR_TIMEOUT')
+    run('header only', packed[:hsize])
+    run('deflate truncated mid-payload', packed[:hsize + (len(packed) - hsize) // 2])
+    run('deflate last byte missing', packed[:-1])
+    run('stored last byte missing', stored[:-1], expect='ESP_ERR_TIMEOUT')
+    run('bad magic', reheader(packed, magic=0x12345678), expect='ESP_ERR_INVALID_VERSION')
+    run('bad header size', reheader(packed, header_size=hsize + 4), expect='ESP_ERR_INVALID_VERSION')
+    run('window above CONFIG', pack(image, 15), expect='ESP_ERR_NOT_SUPPORTED')
+    run('image larger than slot', reheader(packed, image_size=PART_SIZE + 1), expect='ESP_ERR_INVALID_SIZE')
+    run('image size too small', reheader(packed, image_size=len(image) - 1), expect='ESP_ERR_INVALID_SIZE')
+    run('image size too large', reheader(packed, image_size=len(image) + 1), expect='ESP_ERR_INVALID_SIZE')
+    run('payload size too large', reheader(stored, payload_size=len(image) + 1), expect='ESP_ERR_TIMEOUT')
+    run('bad SHA-256', reheader(packed, sha256=bytes(32)), expect='ESP_ERR_INVALID_CRC')
+    run('stored byte flipped', flip(stored, hsize + len(image) // 2), expect='ESP_ERR_INVALID_CRC')
+    run('not an app image', pack(bytes([0]) + image[1:], 14), expect='ESP_ERR_OTA_VALIDATE_FAILED')
+
+    # The signature check runs before anything is written to the spare slot
+    run('unsigned', reheader(packed, key=None, sig_len=0, signature=bytes(72)),
+        expect='ESP_ERR_OTA_VALIDATE_FAILED')
+    run('signature length too large', reheader(packed, key=None, sig_len=73),
+        expect='ESP_ERR_OTA_VALIDATE_FAILED')
+    run('signed with another key', reheader(packed, key=KEYS.other), expect='ESP_ERR_OTA_VALIDATE_FAILED')
+    run('signature byte flipped', flip(packed, hsize - 40), expect='ESP_ERR_OTA_VALIDATE_FAILED')
+    run('SHA-256 changed after signing', reheader(packed, key=None, sha256=bytes(32)),
+        expect='ESP_ERR_OTA_VALIDATE_FAILED')
+    run('image size changed after signing', reheader(packed, key=None, image_size=len(image) - 1),
+        expect='ESP_ERR_OTA_VALIDATE_FAILED')
+
+    # Wherever the inflater trips, the image must be rejected without touching memory it does not own
+    for n in range(fuzz):
+        pos = rng.randrange(hsize, len(packed))
+        run('deflate fuzz %d (byte %d)' % (n, pos), flip(packed, pos),
+            max_read=rng.randrange(1, 4096), seed=n + 1)
+        cut = rng.randrange(hsize, len(packed))
+        run('deflate cut %d (at %d)' % (n, cut), packed[:cut], max_read=rng.randrange(1, 4096), seed=n + 1)
+
+
+def patch_op(container, fn):
+    """Rewrite the first add op of a stored delta container: fn(op dict) updates its fields."""
+    pos = ota_server.HEADER.size + ota_delta.DELTA_HEADER.size
+    names = ('add_len', 'insert_len', 'src_offset')
+    while True:
+        op = dict(zip(names, ota_delta.DELTA_OP.unpack_from(container, pos)))
+        if op['add_len']:
+            break
+        pos += ota_delta.DELTA_OP.size + op['insert_len']
+    fn(op)
+    return container[:pos] + ota_delta.DELTA_OP.pack(*(op[n] for n in names)) + \
+        container[pos + ota_delta.DELTA_OP.size:]
+
+
+def delta_cases(run, base, rng, fuzz):
+    """The C patch applier (main/ota_delta.c) against ota_delta.diff()."""
+    hsize = ota_server.HEADER.size
+    new = bytes([APP_MAGIC]) + ota_delta.mutate(base, rng, 4)[1:]
+    packed = pack(new, 14, base=base)
+    stored = pack(new, 14, raw=True, base=base)
+
+    run('delta deflate', packed, new, base=base)
+    run('delta stored, 1 byte reads', stored, new, base=base, max_read=1)
+    for seed in range(1, 4):
+        run('delta deflate, read seed %d' % seed, packed, new, base=base,
+            max_read=rng.randrange(1, 8192), seed=seed)
+    run('delta identical', pack(base, 14, base=base), base, base=base)
+    busy = bytes([APP_MAGIC]) + ota_delta.mutate(base, rng, 16)[1:]
+    run('delta 16 edits', pack(busy, 14, base=base), busy, base=base)
+    shrunk = base[:len(base) // 2]
+    run('delta to a smaller image', pack(shrunk, 14, base=base), shrunk, base=base)
+    unrelated = bytes([APP_MAGIC]) + ota_delta.fake_firmware(64 * 1024, random.Random(rng.random()))[1:]
+    run('delta unrelated image', pack(unrelated, 14, base=base), unrelated, base=base)
+
+    run('delta wrong base', packed, base=flip(base, len(base) // 2), expect='ESP_ERR_INVALID_VERSION')
+    run('delta base missing', packed, expect='ESP_ERR_INVALID_VERSION')
+    run('delta bad patch magic', flip(stored, hsize), base=base, expect='ESP_ERR_INVALID_RESPONSE')
+    run('delta copy one byte past base',
+        patch_op(stored, lambda op: op.update(src_offset=len(base) - op['add_len'] + 1)),
+        base=base, expect='ESP_ERR_INVALID_RESPONSE')
+    run('delta add longer than base', patch_op(stored, lambda op: op.update(add_len=len(base) + 1)),
+        base=base, expect='ESP_ERR_INVALID_RESPONSE')
+    run('delta stored last byte missing', stored[:-1], base=base, expect='ESP_ERR_TIMEOUT')
+    run('delta patch ends mid-op', reheader(stored[:hsize + ota_delta.DELTA_HEADER.size + 5],
+                                            payload_size=ota_delta.DELTA_HEADER.size + 5),
+        base=base, expect='ESP_ERR_INVALID_RESPONSE')
+    run('delta image size too small', reheader(packed, image_size=len(new) - 1), base=base,
+        expect='ESP_ERR_INVALID_SIZE')
+    run('delta bad SHA-256', reheader(packed, sha256=bytes(32)), base=base, expect='ESP_ERR_INVALID_CRC')
+
+    for n in range(fuzz):
+        pos = rng.randrange(hsize, len(stored))
+        run('delta fuzz %d (byte %d)' % (n, pos), flip(stored, pos), base=base,
+            max_read=rng.randrange(1, 4096), seed=n + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('image', nargs='?', help='app image to use (default: synthetic)')
+    parser.add_argument('--size', type=int, default=384 * 1024, help='synthetic image size')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--fuzz', type=int, default=25, help='random corrupt/truncated images per kind')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'))
+    parser.add_argument('--no-sanitize', action='store_true')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    opts = parser.parse_args()
+
+    rng = random.Random(opts.seed)
+    if opts.image:
+        with open(opts.image, 'rb') as f:
+            image = f.read()
+        if not image or image[0] != APP_MAGIC or len(image) > PART_SIZE:
+            sys.exit('%s: not an app image that fits the OTA slot' % opts.image)
+    else:
+        image = bytes([APP_MAGIC]) + ota_delta.fake_firmware(opts.size - 1, rng)
+
+    global KEYS
+    with tempfile.TemporaryDirectory() as outdir:
+        KEYS = Keys(outdir)
+        run = Runner(build(opts, outdir), outdir, opts.verbose)
+        full_image_cases(run.run, image, rng, opts.fuzz)
+        delta_cases(run.run, image, rng, opts.fuzz)
+    print('ok: %d cases through run_update()' % run.count)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,336 @@
+#!/usr/bin/env python3
+"""Pack and serve compressed OTA images.
+
+The container is an ota_image_header_t followed by a raw deflate stream of
+the app image (see main/include/ota_update.h). The device inflates it on
+the fly into the inactive OTA slot, so the window size must not exceed
+CONFIG_OTA_WINDOW_BITS.
+
+The header carries an ECDSA P-256 signature over its fields; the device
+checks it against the public key built into the firmware
+(CONFIG_OTA_SIGNING_KEY) and rejects unsigned images. Keys and signatures
+are made with the openssl command line tool.
+
+Usage:
+    tools/ota_server.py keygen                 # ota_signing_key.pem + ota_signing_key.pub.pem
+    tools/ota_server.py pack build/blink.bin blink.ota [--key ota_signing_key.pem]
+    tools/ota_server.py pack build/blink.bin blink.ota --base release.bin   # delta against release.bin
+    tools/ota_server.py serve blink.ota --port 8070 [--rate 20000]
+    tools/ota_server.py serve blink.ota --mqtt broker --device <id>   # also publish ota/url
+    tools/ota_server.py mqtt blink.ota --mqtt broker --device <id>    # chunked MQTT transfer
+    tools/ota_server.py selftest build/blink.bin
+
+selftest only checks this script's packing and serving; tools/ota_host_test.py
+feeds packed images through the firmware's C inflater and run_update().
+"""
+
+import argparse
+import hashlib
+import http.server
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+import zlib
+
+OTA_IMAGE_MAGIC = 0x3141544F
+OTA_FLAG_DEFLATE = 0x0001
+OTA_FLAG_DELTA = 0x0002
+SIGNED = struct.Struct('<IHHB3xII32s')     # the fields covered by the signature
+HEADER = struct.Struct('<IHHB3xII32sB3x72s')
+SIGNATURE_MAX = 72
+DEFAULT_KEY = 'ota_signing_key.pem'
+CHUNK_SIZE = 1000
+CHUNK_WINDOW = 4
+ACK_TIMEOUT_S = 10
+
+
+def openssl(*args, data=None):
+    try:
+        return subprocess.run(('openssl',) + args, input=data, capture_output=True, check=True).stdout
+    except FileNotFoundError:
+        sys.exit('the openssl command line tool is required for OTA signing keys')
+    except subprocess.CalledProcessError as e:
+        raise ValueError('openssl %s: %s' % (args[0], e.stderr.decode(errors='replace').strip()))
+
+
+def keygen(private_path):
+    """Create a P-256 key pair; returns the public key path."""
+    public_path = private_path[:-len('.pem')] + '.pub.pem' if private_path.endswith('.pem') \
+        else private_path + '.pub.pem'
+    key = openssl('ecparam', '-name', 'prime256v1', '-genkey', '-noout')
+    fd = os.open(private_path, os.O_WRONLY | os.O_CREAT | os.O_EXCL, 0o600)
+    with os.fdopen(fd, 'wb') as f:
+        f.write(key)
+    with open(public_path, 'wb') as f:
+        f.write(openssl('ec', '-in', private_path, '-pubout'))
+    return public_path
+
+
+def sign_header(fields, key):
+    """Pack the header fields and sign them with the private key file `key`."""
+    signed = SIGNED.pack(*fields)
+    sig = openssl('dgst', '-sha256', '-sign', key, data=signed)
+    if len(sig) > SIGNATURE_MAX:
+        raise ValueError('%s: signature is %d bytes, expected a P-256 key' % (key, len(sig)))
+    return signed + HEADER.pack(*fields, len(sig), sig)[SIGNED.size:]
+
+
+def verify(data, public_key):
+    """Check a container's header signature against a public key file."""
+    sig_len, sig = HEADER.unpack_from(data, 0)[-2:]
+    with tempfile.NamedTemporaryFile() as f:
+        f.write(sig[:sig_len])
+        f.flush()
+        try:
+            openssl('dgst', '-sha256', '-verify', public_key, '-signature', f.name,
+                    data=data[:SIGNED.size])
+        except ValueError:
+            raise ValueError('bad signature for %s' % public_key)
+
+
+def pack(image, window_bits, level=9, raw=False, base=None, key=DEFAULT_KEY):
+    payload, flags = image, 0
+    if base is not None:
+        import ota_delta
+        payload, flags = ota_delta.diff(base, image), OTA_FLAG_DELTA
+    if not raw:
+        comp = zlib.compressobj(level, zlib.DEFLATED, -window_bits, 9)
+        payload, flags = comp.compress(payload) + comp.flush(), flags | OTA_FLAG_DEFLATE
+    header = sign_header((OTA_IMAGE_MAGIC, HEADER.size, flags, window_bits,
+                          len(image), len(payload), hashlib.sha256(image).digest()), key)
+    return header + payload
+
+
+def unpack(data, base=None):
+    """Check a container and return the image; delta images need their base."""
+    magic, hsize, flags, wbits, image_size, payload_size, digest, sig_len, _ = HEADER.unpack_from(data, 0)
+    if magic != OTA_IMAGE_MAGIC or hsize != HEADER.size:
+        raise ValueError('not an OTA container')
+    if not 0 < sig_len <= SIGNATURE_MAX:
+        raise ValueError('container is not signed')
+    payload = data[hsize:hsize + payload_size]
+    image = zlib.decompressobj(-wbits).decompress(payload) if flags & OTA_FLAG_DEFLATE else payload
+    if flags & OTA_FLAG_DELTA:
+        if base is None:
+            return None
+        import ota_delta
+        image = ota_delta.apply(base, image)
+    if len(image) != image_size or hashlib.sha256(image).digest() != digest:
+        raise ValueError('image size or SHA-256 mismatch')
+    return image
+
+
+def make_handler(blob, rate):
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            self.send_response(200)
+            self.send_header('Content-Type', 'application/octet-stream')
+            self.send_header('Content-Length', str(len(blob)))
+            self.end_headers()
+            step = max(1, rate // 10) if rate else len(blob)
+            for off in range(0, len(blob), step):
+                self.wfile.write(blob[off:off + step])
+                if rate:
+                    time.sleep(step / rate)
+
+        def log_message(self, fmt, *args):
+            sys.stderr.write('%s %s\n' % (self.address_string(), fmt % args))
+
+    return Handler
+
+
+def start_server(blob, port, rate):
+    server = http.server.ThreadingHTTPServer(('', port), make_handler(blob, rate))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def local_ip():
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        try:
+            s.connect(('10.255.255.255', 1))
+            return s.getsockname()[0]
+        except OSError:
+            return '127.0.0.1'
+
+
+def mqtt_client(opts):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit('paho-mqtt is required for MQTT transfers (pip install paho-mqtt)')
+    client = mqtt.Client()
+    if opts.user:
+        client.username_pw_set(opts.user, opts.password)
+    client.connect(opts.mqtt, opts.mqtt_port)
+    return client
+
+
+def prefix(opts):
+    return 'esp32c6/%s/' % opts.device
+
+
+def cmd_keygen(opts):
+    public_path = keygen(opts.key)
+    print('wrote %s (keep it private) and %s (CONFIG_OTA_SIGNING_KEY)' % (opts.key, public_path))
+
+
+def cmd_pack(opts):
+    if not os.path.exists(opts.key):
+        sys.exit('%s: no signing key (create one with: %s keygen)' % (opts.key, sys.argv[0]))
+    with open(opts.image, 'rb') as f:
+        image = f.read()
+    base = None
+    if opts.base:
+        with open(opts.base, 'rb') as f:
+            base = f.read()
+    blob = pack(image, opts.window_bits, opts.level, opts.raw, base, opts.key)
+    with open(opts.output, 'wb') as f:
+        f.write(blob)
+    print('%s: %d -> %d bytes (%.1f%%), window 2^%d%s' %
+          (opts.output, len(image), len(blob), 100.0 * len(blob) / len(image), opts.window_bits,
+           ', delta against %s' % opts.base if base else ''))
+
+
+def cmd_serve(opts):
+    with open(opts.container, 'rb') as f:
+        blob = f.read()
+    unpack(blob)
+    start_server(blob, opts.port, opts.rate)
+    url = 'http://%s:%d/%s' % (local_ip(), opts.port, opts.container.split('/')[-1])
+    print('serving %d bytes at %s' % (len(blob), url))
+    if opts.mqtt:
+        client = mqtt_client(opts)
+        client.loop_start()
+        client.publish(prefix(opts) + 'ota/url', url, qos=1).wait_for_publish()
+        print('published %sota/url' % prefix(opts))
+    else:
+        print('start it on the device with: OTA HTTP %s' % url)
+    try:
+        while True:
+            time.sleep(1)
+    except KeyboardInterrupt:
+        pass
+
+
+def cmd_mqtt(opts):
+    with open(opts.container, 'rb') as f:
+        blob = f.read()
+    unpack(blob)
+
+    acked = threading.Condition()
+    state = {'ack': None}
+
+    def on_message(client, userdata, msg):
+        with acked:
+            state['ack'] = int(msg.payload.decode() or 0)
+            acked.notify()
+
+    client = mqtt_client(opts)
+    client.on_message = on_message
+    client.subscribe(prefix(opts) + 'ota/ack', qos=1)
+    client.loop_start()
+    topic = prefix(opts) + 'ota/chunk'
+
+    # Keep CHUNK_WINDOW chunks in flight. The device acks the next offset it
+    # expects; resend from there when it falls behind. An ack of 0 after
+    # progress means the device dropped the session.
+    sent = confirmed = 0
+    started = time.monotonic()
+    while confirmed < len(blob):
+        while sent < len(blob) and sent - confirmed < CHUNK_WINDOW * CHUNK_SIZE:
+            client.publish(topic, struct.pack('<I', sent) + blob[sent:sent + CHUNK_SIZE], qos=1)
+            sent = min(sent + CHUNK_SIZE, len(blob))
+        with acked:
+            if not acked.wait_for(lambda: state['ack'] is not None, ACK_TIMEOUT_S):
+                sys.exit('no ack from device at offset %d' % confirmed)
+            ack, state['ack'] = state['ack'], None
+        if ack == 0 and confirmed > 0:
+            sys.exit('device aborted the update at offset %d' % confirmed)
+        if ack < sent:
+            sent = ack
+        confirmed = max(confirmed, ack)
+        sys.stderr.write('\r%d / %d' % (confirmed, len(blob)))
+    elapsed = time.monotonic() - started
+    print('\nsent %d bytes in %.1fs (%.1f KB/s)' % (len(blob), elapsed, len(blob) / elapsed / 1024))
+    client.loop_stop()
+
+
+def cmd_selftest(opts):
+    with open(opts.image, 'rb') as f:
+        image = f.read()
+    with tempfile.TemporaryDirectory() as keydir:
+        key = os.path.join(keydir, 'selftest.pem')
+        public_key = keygen(key)
+        blob = pack(image, opts.window_bits, key=key)
+        verify(blob, public_key)
+        tampered = blob[:8] + bytes([blob[8] ^ 1]) + blob[9:]
+        try:
+            verify(tampered, public_key)
+            sys.exit('a tampered header passed the signature check')
+        except ValueError:
+            pass
+    server = start_server(blob, 0, opts.rate)
+    url = 'http://127.0.0.1:%d/selftest.ota' % server.server_address[1]
+    started = time.monotonic()
+    with urllib.request.urlopen(url) as resp:
+        data = resp.read()
+    elapsed = time.monotonic() - started
+    server.shutdown()
+    unpack(data)
+    print('ok: %d -> %d bytes (%.1f%%), fetched in %.2fs' %
+          (len(image), len(blob), 100.0 * len(blob) / len(image), elapsed))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('keygen', help='create an ECDSA P-256 signing key pair')
+    p.add_argument('key', nargs='?', default=DEFAULT_KEY, help='private key file to create')
+    p.set_defaults(fn=cmd_keygen)
+
+    p = sub.add_parser('pack', help='build an OTA container from an app image')
+    p.add_argument('image')
+    p.add_argument('output')
+    p.add_argument('--window-bits', type=int, default=14, help='deflate window (<= CONFIG_OTA_WINDOW_BITS)')
+    p.add_argument('--level', type=int, default=9)
+    p.add_argument('--raw', action='store_true', help='store uncompressed')
+    p.add_argument('--base', help='build a delta against this image (the one running on the device)')
+    p.add_argument('--key', default=DEFAULT_KEY, help='private signing key (PEM)')
+    p.set_defaults(fn=cmd_pack)
+
+    for name, fn, text in (('serve', cmd_serve, 'serve a container over HTTP'),
+                           ('mqtt', cmd_mqtt, 'send a container as MQTT chunks')):
+        p = sub.add_parser(name, help=text)
+        p.add_argument('container')
+        p.add_argument('--mqtt', required=(name == 'mqtt'), help='broker host')
+        p.add_argument('--mqtt-port', type=int, default=1883)
+        p.add_argument('--user')
+        p.add_argument('--password')
+        p.add_argument('--device', help='device id in esp32c6/<id>/...')
+        if name == 'serve':
+            p.add_argument('--port', type=int, default=8070)
+            p.add_argument('--rate', type=int, default=0, help='throttle to bytes/s')
+        p.set_defaults(fn=fn)
+
+    p = sub.add_parser('selftest', help='sign, pack, serve and verify on localhost (Python side only)')
+    p.add_argument('image')
+    p.add_argument('--window-bits', type=int, default=14)
+    p.add_argument('--rate', type=int, default=0)
+    p.set_defaults(fn=cmd_selftest)
+
+    opts = parser.parse_args()
+    if getattr(opts, 'mqtt', None) and not opts.device:
+        parser.error('--device is required with --mqtt')
+    opts.fn(opts)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Summarise a host simulator recording and compare it with a baseline.
+
+The simulator (components/sim) writes one CSV row per event in virtual time:
+t_us,kind,id,value (see components/sim/include/sim_record.h). This tool
+derives:
+
+  key latency    key press -> first servo PWM update
+  mqtt latency   injected door command -> first servo PWM update
+  servo moves    runs of PWM updates, with travel time and end angle
+  outputs        GPIO output toggles per pin
+  checks         script expectations passed / failed
+  faults         per fault class: injected, recovered, max/avg recovery time
+
+Key latency includes the click itself: the 100 ms hold of a scripted click
+plus the key task's 300 ms double-click window. A door cycle is a move back
+to the angle the servo was initialised at.
+
+With --baseline the latency and travel percentiles are compared with a
+previous --json output, as is the worst recovery time of each fault class;
+any metric slower by more than --tolerance percent, or any failed check,
+makes the exit status 1.
+
+Usage:
+    tools/sim_report.py sim_record.csv
+    tools/sim_report.py sim_record.csv --json baseline.json
+    tools/sim_report.py sim_record.csv --baseline baseline.json --tolerance 10
+"""
+
+import argparse
+import csv
+import json
+import sys
+
+SERVO_CHANNEL = 0
+# PWM updates further apart than this start a new move (servo step is 20 ms)
+MOVE_GAP_US = 100000
+
+
+def load(path):
+    meta = {}
+    rows = []
+    with open(path, newline='') as f:
+        for line in f:
+            if line.startswith('#'):
+                key, _, value = line[1:].strip().partition('=')
+                meta[key] = value
+                continue
+            for t_us, kind, ident, value in csv.reader([line]):
+                rows.append((int(t_us), kind, int(ident), int(value)))
+    return meta, rows
+
+
+def percentile(values, pct):
+    if not values:
+        return None
+    ordered = sorted(values)
+    k = min(len(ordered) - 1, max(0, int(round(pct / 100.0 * (len(ordered) - 1)))))
+    return ordered[k]
+
+
+def summary(values):
+    return {
+        'count': len(values),
+        'p50': percentile(values, 50),
+        'p90': percentile(values, 90),
+        'p99': percentile(values, 99),
+        'max': max(values) if values else None,
+    }
+
+
+def analyse(meta, rows):
+    min_us = int(meta.get('servo_min_us', 500))
+    max_us = int(meta.get('servo_max_us', 2500))
+    max_angle = int(meta.get('servo_max_angle', 180))
+    key_gpio = int(meta.get('key_gpio', 2))
+
+    def angle(pulse):
+        return round((pulse - min_us) * max_angle / (max_us - min_us))
+
+    key_lat, mqtt_lat = [], []
+    pending = []          # (kind, t_us) waiting for the next servo update
+    moves = []            # [start_us, end_us, end_angle]
+    toggles = {}
+    checks = [0, 0]
+    key_level = 1
+    started = False       # PWM updates before the first input are servo init
+    home = None
+
+    for t_us, kind, ident, value in rows:
+        if kind == 'in' and ident == key_gpio:
+            if key_level == 1 and value == 0:
+                pending.append(('key', t_us))
+                started = True
+            key_level = value
+        elif kind == 'cmd':
+            pending.append(('mqtt', t_us))
+            started = True
+        elif kind == 'pwm' and ident == SERVO_CHANNEL:
+            if not started:
+                home = angle(value)
+                continue
+            for src, t0 in pending:
+                (key_lat if src == 'key' else mqtt_lat).append((t_us - t0) / 1000.0)
+            pending = []
+            if moves and t_us - moves[-1][1] <= MOVE_GAP_US:
+                moves[-1][1] = t_us
+                moves[-1][2] = angle(value)
+            else:
+                moves.append([t_us, t_us, angle(value)])
+        elif kind == 'gpio':
+            toggles[ident] = toggles.get(ident, 0) + 1
+        elif kind == 'check':
+            checks[0 if value else 1] += 1
+
+    end_angles = {}
+    for m in moves:
+        end_angles[m[2]] = end_angles.get(m[2], 0) + 1
+
+    faults = {}
+    for key, value in meta.items():
+        if key.startswith('fault_'):
+            injected, recovered, unrecovered, max_ms, avg_ms = (int(v) for v in value.split(','))
+            faults[key[6:]] = {'injected': injected, 'recovered': recovered,
+                               'pending': unrecovered, 'max_ms': max_ms, 'avg_ms': avg_ms}
+
+    duration_s = (rows[-1][0] / 1e6) if rows else 0.0
+    return {
+        'virtual_s': duration_s,
+        'key_latency_ms': summary(key_lat),
+        'mqtt_latency_ms': summary(mqtt_lat),
+        'servo_travel_ms': summary([(m[1] - m[0]) / 1000.0 for m in moves]),
+        'servo_end_angles': {str(k): v for k, v in sorted(end_angles.items())},
+        'door_cycles': sum(1 for m in moves if m[2] == home),
+        'gpio_toggles': {str(k): v for k, v in sorted(toggles.items())},
+        'unanswered': len(pending),
+        'faults': faults,
+        'checks_passed': checks[0],
+        'checks_failed': checks[1],
+    }
+
+
+def fmt(v):
+    return '-' if v is None else '%.1f' % v
+
+
+def report(r):
+    print('virtual time      %.1f s' % r['virtual_s'])
+    print('%-17s %6s %8s %8s %8s %8s' % ('metric (ms)', 'n', 'p50', 'p90', 'p99', 'max'))
+    for name in ('key_latency_ms', 'mqtt_latency_ms', 'servo_travel_ms'):
+        s = r[name]
+        print('%-17s %6d %8s %8s %8s %8s' % (name.rsplit('_', 1)[0], s['count'], fmt(s['p50']),
+                                             fmt(s['p90']), fmt(s['p99']), fmt(s['max'])))
+    print('servo end angles  %s' % ', '.join('%sdeg x%d' % kv for kv in r['servo_end_angles'].items()))
+    print('door cycles       %d' % r['door_cycles'])
+    print('gpio toggles      %s' % (', '.join('GPIO%s x%d' % kv for kv in r['gpio_toggles'].items()) or '-'))
+    for name, f in sorted(r['faults'].items()):
+        print('fault %-11s %d injected, %d recovered%s, max %d ms, avg %d ms' % (
+            name, f['injected'], f['recovered'], ' (1 pending)' if f['pending'] else '',
+            f['max_ms'], f['avg_ms']))
+    if r['unanswered']:
+        print('unanswered inputs %d' % r['unanswered'])
+    print('checks            %d passed, %d failed' % (r['checks_passed'], r['checks_failed']))
+
+
+def compare(r, base, tolerance):
+    """Return the list of regressions against a baseline."""
+    bad = []
+    for name in ('key_latency_ms', 'mqtt_latency_ms', 'servo_travel_ms'):
+        for pct in ('p50', 'p99', 'max'):
+            now, ref = r[name][pct], base.get(name, {}).get(pct)
+            if now is None or ref is None:
+                continue
+            limit = ref * (1 + tolerance / 100.0)
+            if now > limit:
+                bad.append('%s %s %.1f > %.1f (baseline %.1f)' % (name, pct, now, limit, ref))
+    for name, f in r['faults'].items():
+        ref = base.get('faults', {}).get(name, {}).get('max_ms')
+        if ref is not None and f['max_ms'] > ref * (1 + tolerance / 100.0):
+            bad.append('fault %s recovery %d ms > baseline %d ms' % (name, f['max_ms'], ref))
+    if r['door_cycles'] < base.get('door_cycles', 0):
+        bad.append('door cycles %d < baseline %d' % (r['door_cycles'], base['door_cycles']))
+    return bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('record', help='CSV written by the simulator (SIM_OUT)')
+    parser.add_argument('--json', metavar='FILE', help='save the results as JSON')
+    parser.add_argument('--baseline', metavar='FILE', help='JSON from an earlier run')
+    parser.add_argument('--tolerance', type=float, default=10.0,
+                        help='allowed slowdown against the baseline in percent')
+    opts = parser.parse_args()
+
+    meta, rows = load(opts.record)
+    r = analyse(meta, rows)
+    if meta.get('script'):
+        print('script            %s' % meta['script'])
+    report(r)
+
+    if opts.json:
+        with open(opts.json, 'w') as f:
+            json.dump(r, f, indent=2)
+
+    failed = r['checks_failed'] > 0
+    if opts.baseline:
+        with open(opts.baseline) as f:
+            regressions = compare(r, json.load(f), opts.tolerance)
+        for line in regressions:
+            print('REGRESSION: ' + line)
+        if not regressions:
+            print('no regression against %s (tolerance %.0f%%)' % (opts.baseline, opts.tolerance))
+        failed = failed or bool(regressions)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Render a flight-recorder trace dump as a timeline.
+
+The dump comes from L2CAP stream 2 or from the MQTT topic
+esp32c6/<id>/telemetry/trace after the "TRACE PUB" diagnostic command
+(see main/include/trace.h for the layout).
+
+Usage:
+    tools/trace_decode.py trace.bin
+    tools/trace_decode.py --last 1 trace.bin     # only the most recent boot
+"""
+
+import argparse
+import heapq
+import struct
+import sys
+
+TRACE_MAGIC = 0x31435254
+HEADER = struct.Struct('<IHBBII')
+RECORD = struct.Struct('<IBBHII')
+
+SOURCES = ['SYS', 'KEY', 'BLE', 'MQTT', 'QUEUE', 'SERVO', 'WIFI']
+
+RESET_REASONS = ['UNKNOWN', 'POWERON', 'EXT', 'SW', 'PANIC', 'INT_WDT', 'TASK_WDT', 'WDT',
+                 'DEEPSLEEP', 'BROWNOUT', 'SDIO', 'USB', 'JTAG', 'EFUSE', 'PWR_GLITCH', 'CPU_LOCKUP']
+KEY_EVENTS = ['SINGLE_CLICK', 'DOUBLE_CLICK', 'LONG_PRESS']
+MSG_TYPES = ['NONE', 'LED', 'KEY', 'PWM', 'WIFI', 'MQTT', 'HTTP', 'COAP', 'TIMER']
+SLO_KINDS = ['LATENCY', 'HEARTBEAT']
+FAULTS = ['queue', 'wifi', 'mqtt', 'ble', 'servo']
+
+
+def name(table, idx):
+    return table[idx] if 0 <= idx < len(table) else str(idx)
+
+
+def ip4(addr):
+    return '.'.join(str((addr >> s) & 0xFF) for s in (0, 8, 16, 24))
+
+
+# Must match trace_evt_t order in main/include/trace.h
+EVENTS = [
+    ('BOOT', lambda a16, a0, a1: 'reason=%s count=%d' % (name(RESET_REASONS, a0), a1)),
+    ('KEY', lambda a16, a0, a1: 'gpio=%d %s' % (a16, name(KEY_EVENTS, a0))),
+    ('CONNECT', lambda a16, a0, a1: 'handle=%d' % a16),
+    ('DISCONNECT', lambda a16, a0, a1: 'handle=%d reason=0x%x' % (a16, a0)),
+    ('OPEN', lambda a16, a0, a1: 'queued' if a0 else 'QUEUE FAILED'),
+    ('CONNECT', lambda a16, a0, a1: ''),
+    ('DISCONNECT', lambda a16, a0, a1: ''),
+    ('DOOR_CMD', lambda a16, a0, a1: 'ON' if a0 else 'OFF'),
+    ('SEND', lambda a16, a0, a1: '%s data=%08x' % (name(MSG_TYPES, a16), a0)),
+    ('FULL', lambda a16, a0, a1: '%s data=%08x DROPPED' % (name(MSG_TYPES, a16), a0)),
+    ('RECV', lambda a16, a0, a1: '%s data=%08x' % (name(MSG_TYPES, a16), a0)),
+    ('MOVE', lambda a16, a0, a1: '%d -> %d deg' % (a0, a1)),
+    ('DONE', lambda a16, a0, a1: 'at %d deg%s' % (a0, '' if a1 == 0 else ' err=0x%x' % a1)),
+    ('DOOR_OPEN', lambda a16, a0, a1: ''),
+    ('DOOR_CLOSE', lambda a16, a0, a1: 'auto' if a0 else ''),
+    ('GOT_IP', lambda a16, a0, a1: ip4(a0)),
+    ('DISCONNECT', lambda a16, a0, a1: 'reason=%d' % a0),
+    ('SLO_VIOLATION', lambda a16, a0, a1: 'task=%d %s %d ms' % (a16, name(SLO_KINDS, a0), a1)),
+    ('HEAP_ALLOC_FAIL', lambda a16, a0, a1: 'size=%d caps=0x%x' % (a0, a1)),
+    ('FAULT_INJECT', lambda a16, a0, a1: '%s #%d' % (name(FAULTS, a16), a0)),
+    ('FAULT_RECOVER', lambda a16, a0, a1: '%s %d ms' % (name(FAULTS, a16), a1)),
+]
+
+
+def load(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit('dump too short')
+    magic, rec_size, cores, _, boot_count, capacity = HEADER.unpack_from(data, 0)
+    if magic != TRACE_MAGIC or rec_size != RECORD.size:
+        sys.exit('not a trace dump (magic 0x%08x, record size %d)' % (magic, rec_size))
+
+    per_core = []
+    off = HEADER.size
+    for core in range(cores):
+        (head,) = struct.unpack_from('<I', data, off)
+        ring = data[off + 4:off + 4 + capacity * RECORD.size]
+        off += 4 + capacity * RECORD.size
+        count = min(head, capacity)
+        records = []
+        # Ring order is the true write order within a core
+        for idx in range(head - count, head):
+            pos = (idx % capacity) * RECORD.size
+            if pos + RECORD.size > len(ring):
+                break
+            records.append((core,) + RECORD.unpack_from(ring, pos))
+        per_core.append(records)
+    return boot_count, per_core
+
+
+def split_boots(records):
+    boots = [[]]
+    for rec in records:
+        if rec[3] == 0 and rec[2] == 0 and boots[-1]:
+            boots.append([])
+        boots[-1].append(rec)
+    return boots
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('dump', help='raw trace dump')
+    parser.add_argument('--last', type=int, default=0, help='only show the last N boots')
+    opts = parser.parse_args()
+
+    boot_count, per_core = load(opts.dump)
+
+    # Boot segments per core, then merge cores by timestamp within each boot
+    core_boots = [split_boots(recs) for recs in per_core]
+    nboots = max(len(b) for b in core_boots)
+    segments = []
+    for i in range(nboots):
+        parts = [b[i - nboots + len(b)] for b in core_boots if i - nboots + len(b) >= 0]
+        segments.append(list(heapq.merge(*parts, key=lambda r: r[1])))
+    if opts.last:
+        segments = segments[-opts.last:]
+
+    print('# device boot count %d, %d core(s)' % (boot_count, len(per_core)))
+    for seg in segments:
+        prev = None
+        for core, ts, src, evt, a16, a0, a1 in seg:
+            if evt < len(EVENTS):
+                evt_name, fmt = EVENTS[evt]
+                detail = fmt(a16, a0, a1)
+            else:
+                evt_name, detail = 'EVT%d' % evt, 'a16=%d a0=0x%x a1=0x%x' % (a16, a0, a1)
+            if evt == 0:
+                print('---- %s' % detail)
+            delta = '' if prev is None else '+%.3f' % ((ts - prev) / 1000.0)
+            prev = ts
+            print('%12.6f %10s  c%d %-5s %-10s %s' % (ts / 1e6, delta, core,
+                                                     name(SOURCES, src), evt_name, detail))
+
+
+if __name__ == '__main__':
+    main()